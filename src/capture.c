@@ -0,0 +1,216 @@
+/**
+ * this file records the requests that the server receives, and how their
+ *   sessions went, into a compact binary log that replay.c plays back.
+ *
+ * @sourceFile capture.c
+ *
+ * @program    server.out
+ *
+ * @function   int capture_open(const char* path)
+ * @function   void capture_connect(const ConnectMsg* msg,
+ *   const struct stat* info)
+ * @function   void capture_done(long clientType, int streamId,
+ *   long long bytes, bool completed)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the server writes a CONNECT record for every request it receives, and the
+ *   session serving it a DONE or FAILED record when it is through with the
+ *   client. sessions inherit the log on fork.
+ *
+ * the log is opened for appending, and every record is written with a
+ *   single write, so the records of the server and of its sessions never
+ *   interleave, and a server that exec's itself on SIGUSR1 carries on with
+ *   the same log. capture_done is safe to call from a signal handler.
+ *
+ * a request that a sealed fanout session sends back to the server is
+ *   received, and recorded, a second time; replay.c ignores a CONNECT for a
+ *   client whose earlier request has not been through yet.
+ */
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "capture.h"
+#include "clockhelper.h"
+
+/* the capture log; -1 when the server is not capturing */
+static int captureFd = -1;
+
+/**
+ * opens the capture log, creating it if needed.
+ *
+ * @function   capture_open
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       must be called before any session is forked.
+ *
+ * @signature  int capture_open(const char* path)
+ *
+ * @param      path path of the log; records are appended to an existing one.
+ *
+ * @return     0 upon success; -1 if the log could not be opened, or is not a
+ *   capture log (errno is EINVAL).
+ */
+int capture_open(const char* path)
+{
+    char magic[CAPTURE_MAGIC_LEN];
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd < 0)
+    {
+        return -1;
+    }
+    if(fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    /* a new log starts with the magic; an old one must too */
+    if(st.st_size == 0)
+    {
+        if(write(fd, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != CAPTURE_MAGIC_LEN)
+        {
+            close(fd);
+            return -1;
+        }
+    }
+    else if(pread(fd, magic, CAPTURE_MAGIC_LEN, 0) != CAPTURE_MAGIC_LEN
+        || memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0)
+    {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    captureFd = fd;
+    return 0;
+}
+
+/**
+ * records a request received by the server.
+ *
+ * @function   capture_connect
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - records the stream of the request.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the file is only stat'd here if the caller has no stat of it, and the
+ *   server is capturing.
+ *
+ * @signature  void capture_connect(const ConnectMsg* msg,
+ *   const struct stat* info)
+ *
+ * @param      msg pointer to the connection request.
+ * @param      info pointer to the stat of the requested file; 0 if unknown.
+ */
+void capture_connect(const ConnectMsg* msg, const struct stat* info)
+{
+    struct
+    {
+        CaptureRecord rec;
+        char path[MAX_FILEPATH_LEN];
+    }
+    buf;
+    CaptureRecord* rec = &buf.rec;
+    struct stat st;
+    size_t pathLen;
+
+    if(captureFd < 0)
+    {
+        return;
+    }
+    if(info == 0 && stat(msg->filePath, &st) == 0)
+    {
+        info = &st;
+    }
+
+    pathLen = strnlen(msg->filePath, MAX_FILEPATH_LEN);
+    rec->len        = sizeof(CaptureRecord) + pathLen;
+    rec->kind       = CAPTURE_CONNECT;
+    rec->priority   = msg->priority;
+    rec->flags      = msg->flags;
+    rec->time       = clock_now_ns();
+    rec->clientType = msg->clientType;
+    rec->streamId   = msg->streamId;
+    rec->reserved   = 0;
+    rec->value      = (info != 0) ? (int64_t) info->st_size : -1;
+    memcpy(buf.path, msg->filePath, pathLen);
+
+    if(write(captureFd, &buf, rec->len) < 0)
+    {
+        fprintf(stderr, "capture write failed: %d\n", errno);
+    }
+}
+
+/**
+ * records that a session is through with a client.
+ *
+ * @function   capture_done
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - records the stream of the request.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void capture_done(long clientType, int streamId,
+ *   long long bytes, bool completed)
+ *
+ * @param      clientType message type of the client.
+ * @param      streamId stream of the request; 0 if the client has only one.
+ * @param      bytes number of file bytes sent to the client.
+ * @param      completed true if the whole file was sent; false if the
+ *   session failed, or the client left.
+ */
+void capture_done(long clientType, int streamId, long long bytes,
+    bool completed)
+{
+    CaptureRecord rec;
+
+    if(captureFd < 0)
+    {
+        return;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.len        = sizeof(CaptureRecord);
+    rec.kind       = completed ? CAPTURE_DONE : CAPTURE_FAILED;
+    rec.time       = clock_now_ns();
+    rec.clientType = clientType;
+    rec.streamId   = streamId;
+    rec.value      = bytes;
+
+    if(write(captureFd, &rec, sizeof(rec)) < 0)
+    {
+        /* nothing is printed; this may run in a signal handler */
+    }
+}
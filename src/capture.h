@@ -0,0 +1,75 @@
+/**
+ * header file for capture.c, exposing its interface, and the layout of the
+ *   capture log that replay.c reads.
+ *
+ * @sourceFile capture.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   int capture_open(const char* path);
+ * @function   void capture_connect(const ConnectMsg* msg,
+ *   const struct stat* info);
+ * @function   void capture_done(long clientType, int streamId,
+ *   long long bytes, bool completed);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - records the stream of a request; the log format
+ *   is MSGQCAP2.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "messagequeuehelper.h"
+
+/* first bytes of every capture log */
+#define CAPTURE_MAGIC     "MSGQCAP2"
+#define CAPTURE_MAGIC_LEN 8
+
+/* kinds of capture records */
+#define CAPTURE_CONNECT 1       /* the server received a request */
+#define CAPTURE_DONE    2       /* a session sent the whole file */
+#define CAPTURE_FAILED  3       /* a session stopped before the end */
+
+/**
+ * a record of the capture log, in host byte order.
+ *
+ * a CONNECT record is followed by the requested path, without a NUL; len
+ *   covers it. value is the size of the file for a CONNECT, or -1 if it
+ *   could not be stat'd, and the bytes sent to the client otherwise. time is
+ *   clock_now_ns() when the record was written; records of one request are
+ *   tied together by clientType, and streamId for the requests that a
+ *   client multiplexes over one message type.
+ */
+typedef struct
+{
+    uint16_t len;
+    uint8_t kind;
+    uint8_t priority;
+    int32_t flags;
+    int64_t time;
+    int64_t clientType;
+    int32_t streamId;
+    int32_t reserved;
+    int64_t value;
+}
+CaptureRecord;
+
+/**
+ * function prototypes
+ */
+int capture_open(const char* path);
+void capture_connect(const ConnectMsg* msg, const struct stat* info);
+void capture_done(long clientType, int streamId, long long bytes,
+    bool completed);
+
+#endif
@@ -0,0 +1,453 @@
+/**
+ * sends a file to a client as content-defined chunks, leaving out the chunks
+ *   that the client already holds in its chunk store.
+ *
+ * @sourceFile cas.c
+ *
+ * @program    server.out
+ *
+ * @function   int cas_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter)
+ * @function   static size_t cut_point(const unsigned char* data, size_t len)
+ * @function   static void init_gear(void)
+ * @function   static int send_manifest(const unsigned char* map, size_t size)
+ * @function   static int receive_wants(int msgQId)
+ * @function   static void send_chunk(const unsigned char* data, size_t len)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the file is cut where a gear hash over its last bytes has certain bits
+ *   clear, in the manner of fastcdc, so boundaries depend on the content
+ *   around them only. the same data in two files, or at two places in one
+ *   file, becomes the same chunks, even if it moved; which is what lets the
+ *   client's store, keyed by the sha-256 digest of each chunk, serve
+ *   artifacts that share most of their content.
+ *
+ * the session sends the manifest of the file while it chunks it, and the
+ *   client replies with the chunks that its store lacks. only those are sent
+ *   as data, in order.
+ */
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cas.h"
+#include "checksum.h"
+#include "clockhelper.h"
+#include "trace.h"
+#include "serverstats.h"
+#include "chunkctl.h"
+
+/* function prototypes */
+static size_t cut_point(const unsigned char*, size_t);
+static void init_gear(void);
+static int send_manifest(const unsigned char*, size_t);
+static int receive_wants(int);
+static void send_chunk(const unsigned char*, size_t);
+
+/* where the chunks are sent */
+static int queueId;
+static long destType;
+static ChunkCtl chunk;
+static int clientPriority;
+static RateLimiter* rateLimiter;
+
+/* random value of every byte, rolled into the gear hash */
+static uint64_t gear[256];
+static bool gearReady = false;
+
+/* lengths of the chunks of the file, and which the client wants */
+static unsigned int* chunkLens = 0;
+static bool* wanted = 0;
+static long long chunkCount = 0;
+
+/**
+ * sends the manifest of a file, and then the chunks the client asks for.
+ *
+ * @function   cas_send
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the wants are sent to the session's PID by the client, once it has the
+ *   whole manifest.
+ *
+ * @signature  int cas_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter)
+ *
+ * @param      msgQId id of the message queue to use.
+ * @param      clientType message type that the client receives messages with.
+ * @param      fd file descriptor of the file to send.
+ * @param      priority priority of the client; the size of data messages
+ *   is chosen the same way as for a plain transfer.
+ * @param      limiter pointer to the rate limiter of the client; manifest
+ *   messages count as messages, and chunks as bytes too.
+ *
+ * @return     0 upon success; -1 if the file could not be mapped, or the
+ *   wants could not be received.
+ */
+int cas_send(int msgQId, long clientType, int fd, int priority,
+    RateLimiter* limiter)
+{
+    struct stat st;
+    const unsigned char* map = 0;
+    size_t size;
+    size_t pos = 0;
+    long long i;
+
+    queueId = msgQId;
+    destType = clientType;
+    clientPriority = priority;
+    rateLimiter = limiter;
+    chunk_ctl_init(&chunk, msgQId, priority);
+    init_gear();
+
+    if(fstat(fd, &st) < 0)
+    {
+        return -1;
+    }
+    size = st.st_size;
+    if(size > 0)
+    {
+        map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            return -1;
+        }
+        madvise((void*) map, size, MADV_SEQUENTIAL);
+    }
+
+    TRACE_BEGIN("chunk manifest");
+    if(send_manifest(map, size) < 0)
+    {
+        munmap((void*) map, size);
+        return -1;
+    }
+    TRACE_END("chunk manifest");
+
+    TRACE_BEGIN("receive wants");
+    if(receive_wants(msgQId) < 0)
+    {
+        munmap((void*) map, size);
+        return -1;
+    }
+    TRACE_END("receive wants");
+
+    /* send the wanted chunks, in order */
+    TRACE_BEGIN("send chunks");
+    for(i = 0; i < chunkCount; ++i)
+    {
+        if(wanted[i])
+        {
+            send_chunk(map + pos, chunkLens[i]);
+        }
+        pos += chunkLens[i];
+    }
+    TRACE_END("send chunks");
+
+    if(map != 0)
+    {
+        munmap((void*) map, size);
+    }
+    return 0;
+}
+
+/**
+ * finds where the chunk that starts at the passed data ends.
+ *
+ * @function   cut_point
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the first CDC_MIN_LEN bytes are skipped, since no boundary may fall in
+ *   them. up to CDC_AVG_LEN, a boundary needs all bits of CDC_MASK_S clear,
+ *   and from there only those of CDC_MASK_L, so that most chunks end up
+ *   close to the target size.
+ *
+ * @signature  static size_t cut_point(const unsigned char* data, size_t len)
+ *
+ * @param      data pointer to the first byte of the chunk.
+ * @param      len number of bytes left in the file.
+ *
+ * @return     length of the chunk.
+ */
+static size_t cut_point(const unsigned char* data, size_t len)
+{
+    uint64_t hash = 0;
+    size_t normal = CDC_AVG_LEN;
+    size_t i = CDC_MIN_LEN;
+
+    if(len <= CDC_MIN_LEN)
+    {
+        return len;
+    }
+    if(len > CDC_MAX_LEN)
+    {
+        len = CDC_MAX_LEN;
+    }
+    if(len < normal)
+    {
+        normal = len;
+    }
+
+    for(; i < normal; ++i)
+    {
+        hash = (hash << 1) + gear[data[i]];
+        if((hash & CDC_MASK_S) == 0)
+        {
+            return i;
+        }
+    }
+    for(; i < len; ++i)
+    {
+        hash = (hash << 1) + gear[data[i]];
+        if((hash & CDC_MASK_L) == 0)
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+/**
+ * fills the gear table.
+ *
+ * @function   init_gear
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the values come from splitmix64 with a fixed seed, so every session, and
+ *   every version of the server, cuts the same data at the same places;
+ *   otherwise stored chunks would stop matching.
+ *
+ * @signature  static void init_gear(void)
+ */
+static void init_gear(void)
+{
+    uint64_t seed = 0x6d73677163646331ULL;
+    uint64_t z;
+    int i;
+
+    if(gearReady)
+    {
+        return;
+    }
+    for(i = 0; i < 256; ++i)
+    {
+        z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+    gearReady = true;
+}
+
+/**
+ * cuts the file into chunks, and sends the client their digests & lengths.
+ *
+ * @function   send_manifest
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * manifest messages are sent as they fill up, so the client can look the
+ *   first chunks up in its store while the rest are still being hashed.
+ *
+ * @signature  static int send_manifest(const unsigned char* map,
+ *   size_t size)
+ *
+ * @param      map the file, mapped into memory.
+ * @param      size size of the file.
+ *
+ * @return     0 upon success; -1 if the chunk lengths could not be kept.
+ */
+static int send_manifest(const unsigned char* map, size_t size)
+{
+    Message manifestMsg;
+    ManifestMsg* manifest = &manifestMsg.data.manifestMsg;
+    long long capacity = 0;
+    size_t pos = 0;
+    size_t len;
+
+    manifestMsg.dataType = MSG_DATA_MANIFEST;
+    manifest->count = 0;
+    chunkCount = 0;
+
+    while(pos < size)
+    {
+        if(chunkCount == capacity)
+        {
+            unsigned int* grown;
+            capacity = capacity == 0 ? 1024 : capacity * 2;
+            grown = realloc(chunkLens, capacity * sizeof(unsigned int));
+            if(grown == 0)
+            {
+                return -1;
+            }
+            chunkLens = grown;
+        }
+
+        len = cut_point(map + pos, size - pos);
+        chunkLens[chunkCount++] = len;
+        sha256(map + pos, len, manifest->chunks[manifest->count].hash);
+        manifest->chunks[manifest->count].len = len;
+        pos += len;
+
+        if(++manifest->count == MAX_MANIFEST_CHUNKS)
+        {
+            rate_limit_wait(rateLimiter, 0);
+            msg_send(queueId, &manifestMsg, destType);
+            manifest->count = 0;
+        }
+    }
+
+    /* send the last chunks, and then an empty message to end them */
+    if(manifest->count > 0)
+    {
+        rate_limit_wait(rateLimiter, 0);
+        msg_send(queueId, &manifestMsg, destType);
+        manifest->count = 0;
+    }
+    msg_send(queueId, &manifestMsg, destType);
+    return 0;
+}
+
+/**
+ * receives the indexes of the chunks that the client's store lacks.
+ *
+ * @function   receive_wants
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int receive_wants(int msgQId)
+ *
+ * @param      msgQId id of the message queue to receive from.
+ *
+ * @return     0 upon success; -1 if the wants could not be received, or one
+ *   of them is out of range (errno is EINVAL).
+ */
+static int receive_wants(int msgQId)
+{
+    Message msg;
+    int i;
+
+    wanted = calloc(chunkCount + 1, sizeof(bool));
+    if(wanted == 0)
+    {
+        return -1;
+    }
+
+    for(;;)
+    {
+        if(msg_recv(msgQId, &msg, getpid()) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if(msg.dataType != MSG_DATA_WANT || msg.data.wantMsg.count <= 0)
+        {
+            break;
+        }
+
+        for(i = 0; i < msg.data.wantMsg.count && i < MAX_WANTS; ++i)
+        {
+            if(msg.data.wantMsg.indexes[i] >= chunkCount)
+            {
+                errno = EINVAL;
+                return -1;
+            }
+            wanted[msg.data.wantMsg.indexes[i]] = true;
+        }
+    }
+    return 0;
+}
+
+/**
+ * sends the bytes of one chunk as data messages.
+ *
+ * @function   send_chunk
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void send_chunk(const unsigned char* data, size_t len)
+ *
+ * @param      data pointer to the first byte of the chunk.
+ * @param      len length of the chunk.
+ */
+static void send_chunk(const unsigned char* data, size_t len)
+{
+    Message dataMsg;
+    size_t n;
+
+    dataMsg.dataType = MSG_DATA_DATA;
+    while(len > 0)
+    {
+        stats_first_byte();
+        n = len < (size_t) chunk.len ? len : (size_t) chunk.len;
+        memcpy(dataMsg.data.dataMsg.data, data, n);
+        dataMsg.data.dataMsg.len = n;
+        rate_limit_wait(rateLimiter, n);
+        dataMsg.data.dataMsg.eventTime = clock_now_ns();
+        msg_send(queueId, &dataMsg, destType);
+        chunk_ctl_sent(&chunk, clock_now_ns() - dataMsg.sendTime);
+        stats_add_bytes(clientPriority, n);
+        data += n;
+        len -= n;
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * header file for cas.c, exposing its interface.
+ *
+ * @sourceFile cas.h
+ *
+ * @program    server.out
+ *
+ * @function   int cas_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef CAS_H
+#define CAS_H
+
+#include "messagequeuehelper.h"
+#include "ratelimit.h"
+
+/* bounds & target size of content-defined chunks */
+#define CDC_MIN_LEN (2 << 10)
+#define CDC_AVG_LEN (8 << 10)
+#define CDC_MAX_LEN MAX_CHUNK_LEN
+
+/* bits of the gear hash that must be zero at a boundary; more of them before
+ *   the target size, fewer after it, which pulls chunk sizes towards it */
+#define CDC_MASK_S 0x0003590703530000ULL
+#define CDC_MASK_L 0x0000d90003530000ULL
+
+/**
+ * function prototypes
+ */
+int cas_send(int msgQId, long clientType, int fd, int priority,
+    RateLimiter* limiter);
+
+#endif
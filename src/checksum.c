@@ -0,0 +1,461 @@
+/**
+ * this file contains the checksums used to verify the data that is moved
+ *   through the message queue.
+ *
+ * @sourceFile checksum.c
+ *
+ * @program    server.out, client.out
+ *
+ * @function   uint32_t adler32_update(uint32_t adler, const void* buf,
+ *   size_t len)
+ * @function   uint32_t adler32_zeros(uint32_t adler,
+ *   unsigned long long len)
+ * @function   uint32_t rolling_hash(const void* buf, size_t len)
+ * @function   uint32_t rolling_hash_roll(uint32_t hash, unsigned char out,
+ *   unsigned char in, size_t len)
+ * @function   void sha256_init(Sha256* ctx)
+ * @function   void sha256_update(Sha256* ctx, const void* buf, size_t len)
+ * @function   void sha256_final(Sha256* ctx,
+ *   unsigned char digest[SHA256_LEN])
+ * @function   void sha256(const void* buf, size_t len,
+ *   unsigned char digest[SHA256_LEN])
+ * @function   static void sha256_block(uint32_t state[8],
+ *   const unsigned char block[64])
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the rolling hash is the weak checksum of rsync; two 16 bit sums that can be
+ *   slid along the data one byte at a time. sha-256 is used where a match has
+ *   to be trusted.
+ */
+#include <string.h>
+#include "checksum.h"
+
+/* adler-32 modulus, and the most bytes that can be summed before reducing */
+#define ADLER32_MOD  65521
+#define ADLER32_NMAX 5552
+
+/* sha-256 helpers */
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/* sha-256 round constants */
+static const uint32_t SHA256_K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* function prototypes */
+static void sha256_block(uint32_t state[8], const unsigned char block[64]);
+
+/**
+ * extends an adler-32 checksum with the passed bytes.
+ *
+ * @function   adler32_update
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * start with ADLER32_INIT, and feed the data through in as many pieces as
+ *   convenient; the result is the same as checksumming it in one go.
+ *
+ * @signature  uint32_t adler32_update(uint32_t adler, const void* buf,
+ *   size_t len)
+ *
+ * @param      adler checksum of the bytes before buf.
+ * @param      buf pointer to the first byte to add to the checksum.
+ * @param      len number of bytes to add to the checksum.
+ *
+ * @return     checksum of the bytes before buf, followed by the passed bytes.
+ */
+uint32_t adler32_update(uint32_t adler, const void* buf, size_t len)
+{
+    const unsigned char* bytes = buf;
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+
+    while(len > 0)
+    {
+        size_t run = len < ADLER32_NMAX ? len : ADLER32_NMAX;
+        len -= run;
+        while(run-- > 0)
+        {
+            a += *bytes++;
+            b += a;
+        }
+        a %= ADLER32_MOD;
+        b %= ADLER32_MOD;
+    }
+
+    return (b << 16) | a;
+}
+
+/**
+ * extends an adler-32 checksum with a run of zero bytes.
+ *
+ * @function   adler32_zeros
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * zeros leave the first sum as it is, and add it to the second sum once per
+ *   byte, so the result can be computed without touching any data; holes of
+ *   any size cost the same.
+ *
+ * @signature  uint32_t adler32_zeros(uint32_t adler,
+ *   unsigned long long len)
+ *
+ * @param      adler checksum of the bytes before the zeros.
+ * @param      len number of zero bytes to add to the checksum.
+ *
+ * @return     checksum of the bytes before the zeros, followed by the zeros.
+ */
+uint32_t adler32_zeros(uint32_t adler, unsigned long long len)
+{
+    uint64_t a = adler & 0xffff;
+    uint64_t b = adler >> 16;
+
+    b = (b + a * (len % ADLER32_MOD)) % ADLER32_MOD;
+
+    return (uint32_t) (b << 16) | (uint32_t) a;
+}
+
+/**
+ * computes the rolling hash of a window of bytes.
+ *
+ * @function   rolling_hash
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  uint32_t rolling_hash(const void* buf, size_t len)
+ *
+ * @param      buf pointer to the first byte of the window.
+ * @param      len number of bytes in the window.
+ *
+ * @return     rolling hash of the window.
+ */
+uint32_t rolling_hash(const void* buf, size_t len)
+{
+    const unsigned char* bytes = buf;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    size_t i;
+
+    for(i = 0; i < len; ++i)
+    {
+        a += bytes[i];
+        b += (uint32_t) (len - i) * bytes[i];
+    }
+
+    return (a & 0xffff) | (b << 16);
+}
+
+/**
+ * slides the window of a rolling hash forward by one byte.
+ *
+ * @function   rolling_hash_roll
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the result is the same as calling rolling_hash on the window one byte
+ *   further along.
+ *
+ * @signature  uint32_t rolling_hash_roll(uint32_t hash, unsigned char out,
+ *   unsigned char in, size_t len)
+ *
+ * @param      hash rolling hash of the current window.
+ * @param      out first byte of the current window, that leaves it.
+ * @param      in byte just after the current window, that enters it.
+ * @param      len number of bytes in the window.
+ *
+ * @return     rolling hash of the next window.
+ */
+uint32_t rolling_hash_roll(uint32_t hash, unsigned char out,
+    unsigned char in, size_t len)
+{
+    uint32_t a = (hash - out + in) & 0xffff;
+    uint32_t b = ((hash >> 16) - (uint32_t) len * out + a) & 0xffff;
+
+    return a | (b << 16);
+}
+
+/**
+ * starts a new sha-256 digest.
+ *
+ * @function   sha256_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void sha256_init(Sha256* ctx)
+ *
+ * @param      ctx pointer to the digest state to reset.
+ */
+void sha256_init(Sha256* ctx)
+{
+    static const uint32_t initial[8] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->fill = 0;
+}
+
+/**
+ * adds the passed bytes to a sha-256 digest.
+ *
+ * @function   sha256_update
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void sha256_update(Sha256* ctx, const void* buf, size_t len)
+ *
+ * @param      ctx pointer to the digest state.
+ * @param      buf pointer to the first byte to add to the digest.
+ * @param      len number of bytes to add to the digest.
+ */
+void sha256_update(Sha256* ctx, const void* buf, size_t len)
+{
+    const unsigned char* bytes = buf;
+
+    ctx->length += len;
+
+    /* top up a partially filled block first */
+    if(ctx->fill > 0)
+    {
+        size_t take = 64 - ctx->fill < len ? 64 - ctx->fill : len;
+        memcpy(ctx->block + ctx->fill, bytes, take);
+        ctx->fill += take;
+        bytes += take;
+        len -= take;
+        if(ctx->fill < 64)
+        {
+            return;
+        }
+        sha256_block(ctx->state, ctx->block);
+        ctx->fill = 0;
+    }
+
+    /* whole blocks are hashed straight from the buffer */
+    while(len >= 64)
+    {
+        sha256_block(ctx->state, bytes);
+        bytes += 64;
+        len -= 64;
+    }
+
+    memcpy(ctx->block, bytes, len);
+    ctx->fill = len;
+}
+
+/**
+ * pads a sha-256 digest, and writes out its value.
+ *
+ * @function   sha256_final
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void sha256_final(Sha256* ctx,
+ *   unsigned char digest[SHA256_LEN])
+ *
+ * @param      ctx pointer to the digest state; it can not be updated after.
+ * @param      digest set to the digest of all bytes that were added.
+ */
+void sha256_final(Sha256* ctx, unsigned char digest[SHA256_LEN])
+{
+    uint64_t bits = ctx->length * 8;
+    int i;
+
+    ctx->block[ctx->fill++] = 0x80;
+    if(ctx->fill > 56)
+    {
+        memset(ctx->block + ctx->fill, 0, 64 - ctx->fill);
+        sha256_block(ctx->state, ctx->block);
+        ctx->fill = 0;
+    }
+    memset(ctx->block + ctx->fill, 0, 56 - ctx->fill);
+    for(i = 0; i < 8; ++i)
+    {
+        ctx->block[63 - i] = (unsigned char) (bits >> (8 * i));
+    }
+    sha256_block(ctx->state, ctx->block);
+
+    for(i = 0; i < 8; ++i)
+    {
+        digest[4 * i]     = (unsigned char) (ctx->state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char) (ctx->state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char) (ctx->state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char) ctx->state[i];
+    }
+}
+
+/**
+ * computes the sha-256 digest of a buffer in one go.
+ *
+ * @function   sha256
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void sha256(const void* buf, size_t len,
+ *   unsigned char digest[SHA256_LEN])
+ *
+ * @param      buf pointer to the first byte to digest.
+ * @param      len number of bytes to digest.
+ * @param      digest set to the digest of the bytes.
+ */
+void sha256(const void* buf, size_t len, unsigned char digest[SHA256_LEN])
+{
+    Sha256 ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, buf, len);
+    sha256_final(&ctx, digest);
+}
+
+/**
+ * runs the sha-256 compression function over one 64 byte block.
+ *
+ * @function   sha256_block
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void sha256_block(uint32_t state[8],
+ *   const unsigned char block[64])
+ *
+ * @param      state hash state to fold the block into.
+ * @param      block pointer to the 64 bytes to process.
+ */
+static void sha256_block(uint32_t state[8], const unsigned char block[64])
+{
+    uint32_t w[64];
+    uint32_t v[8];
+    int i;
+
+    for(i = 0; i < 16; ++i)
+    {
+        w[i] = (uint32_t) block[4 * i] << 24 | (uint32_t) block[4 * i + 1] << 16
+            | (uint32_t) block[4 * i + 2] << 8 | block[4 * i + 3];
+    }
+    for(i = 16; i < 64; ++i)
+    {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18)
+            ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19)
+            ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    memcpy(v, state, sizeof(v));
+    for(i = 0; i < 64; ++i)
+    {
+        uint32_t s1 = ROTR(v[4], 6) ^ ROTR(v[4], 11) ^ ROTR(v[4], 25);
+        uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint32_t t1 = v[7] + s1 + ch + SHA256_K[i] + w[i];
+        uint32_t s0 = ROTR(v[0], 2) ^ ROTR(v[0], 13) ^ ROTR(v[0], 22);
+        uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        uint32_t t2 = s0 + maj;
+
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = v[3] + t1;
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = t1 + t2;
+    }
+
+    for(i = 0; i < 8; ++i)
+    {
+        state[i] += v[i];
+    }
+}
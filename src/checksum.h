@@ -0,0 +1,69 @@
+/**
+ * header file for checksum.c, exposing its interface.
+ *
+ * @sourceFile checksum.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   uint32_t adler32_update(uint32_t adler, const void* buf,
+ *   size_t len);
+ * @function   uint32_t adler32_zeros(uint32_t adler,
+ *   unsigned long long len);
+ * @function   uint32_t rolling_hash(const void* buf, size_t len);
+ * @function   uint32_t rolling_hash_roll(uint32_t hash, unsigned char out,
+ *   unsigned char in, size_t len);
+ * @function   void sha256_init(Sha256* ctx);
+ * @function   void sha256_update(Sha256* ctx, const void* buf, size_t len);
+ * @function   void sha256_final(Sha256* ctx,
+ *   unsigned char digest[SHA256_LEN]);
+ * @function   void sha256(const void* buf, size_t len,
+ *   unsigned char digest[SHA256_LEN]);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* value of an adler-32 checksum over zero bytes */
+#define ADLER32_INIT 1
+
+/* number of bytes in a sha-256 digest */
+#define SHA256_LEN 32
+
+/**
+ * state of a sha-256 digest that is being computed.
+ */
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    size_t fill;
+}
+Sha256;
+
+/**
+ * function prototypes
+ */
+uint32_t adler32_update(uint32_t adler, const void* buf, size_t len);
+uint32_t adler32_zeros(uint32_t adler, unsigned long long len);
+uint32_t rolling_hash(const void* buf, size_t len);
+uint32_t rolling_hash_roll(uint32_t hash, unsigned char out,
+    unsigned char in, size_t len);
+void sha256_init(Sha256* ctx);
+void sha256_update(Sha256* ctx, const void* buf, size_t len);
+void sha256_final(Sha256* ctx, unsigned char digest[SHA256_LEN]);
+void sha256(const void* buf, size_t len, unsigned char digest[SHA256_LEN]);
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * this file contains the controller that sizes the chunks of file data that
+ *   a session sends, from how full the message queue is.
+ *
+ * @sourceFile chunkctl.c
+ *
+ * @program    server.out
+ *
+ * @function   void chunk_ctl_init(ChunkCtl* ctl, int msgQId, int priority)
+ * @function   void chunk_ctl_sent(ChunkCtl* ctl, long long blockedNs)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the controller is additive-increase / multiplicative-decrease, like TCP's
+ *   congestion window. chunks start out as large as allowed, so that few
+ *   system calls move the data. when sends keep blocking on a full queue,
+ *   the session is competing with others for room, and its chunks are
+ *   halved, so that it waits for less room at a time, and stops being passed
+ *   over by sessions sending smaller messages. while the queue is mostly
+ *   empty, chunks grow back by a step every interval.
+ *
+ * a full queue alone is not a reason to shrink; it usually just means that
+ *   the clients are slower than the sessions, and smaller chunks would only
+ *   cost them more system calls.
+ *
+ * the priority of the client divides the bounds, as it used to divide the
+ *   fixed chunk size; a low priority client still gets smaller chunks.
+ */
+#include "chunkctl.h"
+#include "messagequeuehelper.h"
+#include "trace.h"
+
+/**
+ * sets up the controller for a client of the passed priority.
+ *
+ * @function   chunk_ctl_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the largest chunk is also bound to a quarter of the queue, so that at
+ *   least four data messages fit into it, whatever msg_qbytes is set to.
+ *
+ * @signature  void chunk_ctl_init(ChunkCtl* ctl, int msgQId, int priority)
+ *
+ * @param      ctl pointer to the controller to set up.
+ * @param      msgQId id of the message queue that the chunks are sent on.
+ * @param      priority priority of the client, at least 1.
+ */
+void chunk_ctl_init(ChunkCtl* ctl, int msgQId, int priority)
+{
+    struct msqid_ds queue;
+    long maxLen = MAX_MSG_DATAMSGDATA_LEN;
+
+    if(msgctl(msgQId, IPC_STAT, &queue) == 0
+        && (long) (queue.msg_qbytes / 4 - MSG_DATA_HEADER_LEN) < maxLen)
+    {
+        maxLen = queue.msg_qbytes / 4 - MSG_DATA_HEADER_LEN;
+    }
+
+    ctl->msgQId = msgQId;
+    ctl->maxLen = maxLen / priority;
+    ctl->minLen = CHUNK_CTL_MIN_LEN / priority;
+    if(ctl->minLen < 1)
+    {
+        ctl->minLen = 1;
+    }
+    if(ctl->maxLen < ctl->minLen)
+    {
+        ctl->maxLen = ctl->minLen;
+    }
+    ctl->step = (ctl->maxLen - ctl->minLen) / 8 + 1;
+    ctl->len = ctl->maxLen;
+    ctl->sends = 0;
+    ctl->blockedNs = 0;
+}
+
+/**
+ * tells the controller that a chunk was sent, and adjusts the chunk size at
+ *   the end of each interval.
+ *
+ * @function   chunk_ctl_sent
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the queue is only looked at once per interval, so sampling it costs one
+ *   system call per CHUNK_CTL_INTERVAL sends.
+ *
+ * @signature  void chunk_ctl_sent(ChunkCtl* ctl, long long blockedNs)
+ *
+ * @param      ctl pointer to the controller.
+ * @param      blockedNs time that the send took, in nanoseconds.
+ */
+void chunk_ctl_sent(ChunkCtl* ctl, long long blockedNs)
+{
+    struct msqid_ds queue;
+    unsigned long usedPct;
+    int len = ctl->len;
+
+    ctl->blockedNs += blockedNs;
+    if(++ctl->sends < CHUNK_CTL_INTERVAL)
+    {
+        return;
+    }
+
+    if(msgctl(ctl->msgQId, IPC_STAT, &queue) == 0 && queue.msg_qbytes > 0)
+    {
+        usedPct = queue.__msg_cbytes * 100 / queue.msg_qbytes;
+        if(ctl->blockedNs > CHUNK_CTL_INTERVAL * CHUNK_CTL_BLOCKED_NS
+            && usedPct >= CHUNK_CTL_HIGH_PCT)
+        {
+            len = len / 2 > ctl->minLen ? len / 2 : ctl->minLen;
+        }
+        else if(usedPct <= CHUNK_CTL_LOW_PCT)
+        {
+            len = len + ctl->step < ctl->maxLen ? len + ctl->step : ctl->maxLen;
+        }
+    }
+
+    if(len != ctl->len)
+    {
+        TRACE_INSTANT("chunk size", len);
+        ctl->len = len;
+    }
+    ctl->sends = 0;
+    ctl->blockedNs = 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * header file for chunkctl.c, exposing its interface.
+ *
+ * @sourceFile chunkctl.h
+ *
+ * @program    server.out
+ *
+ * @function   void chunk_ctl_init(ChunkCtl* ctl, int msgQId, int priority);
+ * @function   void chunk_ctl_sent(ChunkCtl* ctl, long long blockedNs);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef CHUNKCTL_H
+#define CHUNKCTL_H
+
+/* smallest chunk that the controller shrinks to */
+#define CHUNK_CTL_MIN_LEN 64
+
+/* number of sends between two adjustments of the chunk size */
+#define CHUNK_CTL_INTERVAL 8
+
+/* average time that a send may block on a full queue before the chunk size
+ *   is cut */
+#define CHUNK_CTL_BLOCKED_NS 1000000LL
+
+/* queue occupancy, in percent of msg_qbytes, from which the queue counts as
+ *   full, and up to which the chunk size grows */
+#define CHUNK_CTL_HIGH_PCT 75
+#define CHUNK_CTL_LOW_PCT  25
+
+/**
+ * state of the chunk size controller of one stream of data messages.
+ *
+ * len is the size of the next chunk to send, always between minLen and
+ *   maxLen. sends & blockedNs accumulate over the current interval.
+ */
+typedef struct
+{
+    int msgQId;
+    int len;
+    int minLen;
+    int maxLen;
+    int step;
+    int sends;
+    long long blockedNs;
+}
+ChunkCtl;
+
+/**
+ * function prototypes
+ */
+void chunk_ctl_init(ChunkCtl* ctl, int msgQId, int priority);
+void chunk_ctl_sent(ChunkCtl* ctl, long long blockedNs);
+
+#endif
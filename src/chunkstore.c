@@ -0,0 +1,684 @@
+/**
+ * keeps a local store of content-defined chunks, keyed by their sha-256
+ *   digest, and puts a file together from it and the chunks that the session
+ *   sends.
+ *
+ * @sourceFile chunkstore.c
+ *
+ * @program    client.out
+ *
+ * @function   int chunk_store_open(const char* path, ChunkWriter writer)
+ * @function   void chunk_store_manifest(const ManifestMsg* msg, int msgQId,
+ *   pid_t sessionPid)
+ * @function   void chunk_store_data(const char* data, int len)
+ * @function   bool chunk_store_close(void)
+ * @function   void chunk_store_print_summary(FILE* file)
+ * @function   static void add_chunk(const ChunkRef* ref)
+ * @function   static bool seen_before(long long index)
+ * @function   static void send_wants(int msgQId, pid_t sessionPid)
+ * @function   static void assemble(void)
+ * @function   static bool read_chunk(const ChunkRef* ref)
+ * @function   static void write_chunk(const ChunkRef* ref)
+ * @function   static void chunk_path(const ChunkRef* ref, char* path)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * every chunk is a file named after the hex digest of its bytes, in a
+ *   subdirectory named after the first byte of the digest. chunks are
+ *   written to a temporary name, and renamed into place once complete, so
+ *   clients that share a store never see half a chunk.
+ *
+ * while the manifest arrives, every chunk is looked up in the store; the
+ *   ones that are missing, and have not been asked for earlier in the same
+ *   file, are wanted. the wants are only sent once the whole manifest has
+ *   been received, since until then the session is busy sending it, and
+ *   could fill the queue on both sides.
+ *
+ * the file is then put together in order, from the store where it can be,
+ *   and from the data messages where it can not. every chunk is checked
+ *   against its digest before it is written out, or stored.
+ */
+#include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "chunkstore.h"
+#include "checksum.h"
+
+/* what happens to a chunk of the manifest */
+#define CHUNK_STORED   0    /* read from the store */
+#define CHUNK_WANTED   1    /* received from the session */
+#define CHUNK_REPEATED 2    /* read from the store, once an earlier copy
+                             *   was received */
+
+/* length of the path of a chunk in the store, including the null */
+#define CHUNK_PATH_LEN (CHUNK_HASH_LEN * 2 + 2)
+
+/* function prototypes */
+static void add_chunk(const ChunkRef*);
+static bool seen_before(long long);
+static void send_wants(int, pid_t);
+static void assemble(void);
+static bool read_chunk(const ChunkRef*);
+static void write_chunk(const ChunkRef*);
+static void chunk_path(const ChunkRef*, char*);
+
+/* the store, and where the file is written */
+static int storeFd = -1;
+static ChunkWriter writeOut;
+
+/* chunks of the file, and what happens to each */
+static ChunkRef* chunks = 0;
+static unsigned char* fates = 0;
+static long long chunkCount = 0;
+static long long chunkCapacity = 0;
+static bool manifestDone = false;
+
+/* open addressing table of the wanted chunks, by digest; -1 if empty */
+static long long* seen = 0;
+static long long seenMask = -1;
+static long long wantCount = 0;
+
+/* next chunk to write out, and how much of it has been received */
+static long long nextChunk = 0;
+static char chunkBuf[MAX_CHUNK_LEN];
+static long long chunkFill = 0;
+
+/* set once the file can not be put together completely */
+static bool failed = false;
+
+/* bytes of the file that came from the store, and from the session */
+static long long storedBytes = 0;
+static long long receivedBytes = 0;
+
+/**
+ * opens the chunk store, creating it if it does not exist.
+ *
+ * @function   chunk_store_open
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int chunk_store_open(const char* path, ChunkWriter writer)
+ *
+ * @param      path path of the store's directory.
+ * @param      writer function that writes the file out, in order.
+ *
+ * @return     0 upon success; -1 if the store could not be opened.
+ */
+int chunk_store_open(const char* path, ChunkWriter writer)
+{
+    if(mkdir(path, 0755) < 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+    storeFd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    writeOut = writer;
+    return storeFd < 0 ? -1 : 0;
+}
+
+/**
+ * takes in a manifest message; once the manifest is complete, asks the
+ *   session for the missing chunks, and writes out what the store has.
+ *
+ * @function   chunk_store_manifest
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void chunk_store_manifest(const ManifestMsg* msg, int msgQId,
+ *   pid_t sessionPid)
+ *
+ * @param      msg pointer to the manifest message.
+ * @param      msgQId id of the message queue to send the wants on.
+ * @param      sessionPid PID of the session, that the wants are sent to.
+ */
+void chunk_store_manifest(const ManifestMsg* msg, int msgQId,
+    pid_t sessionPid)
+{
+    int i;
+
+    for(i = 0; i < msg->count && i < MAX_MANIFEST_CHUNKS; ++i)
+    {
+        add_chunk(&msg->chunks[i]);
+    }
+
+    if(msg->count == 0 && !manifestDone)
+    {
+        manifestDone = true;
+        send_wants(msgQId, sessionPid);
+        assemble();
+    }
+}
+
+/**
+ * takes in the data of the wanted chunks, and writes out every chunk that
+ *   it completes, along with the stored ones that follow it.
+ *
+ * @function   chunk_store_data
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a chunk whose data does not match its digest is neither written out, nor
+ *   stored; the rest of the file still is, but the transfer has failed.
+ *
+ * @signature  void chunk_store_data(const char* data, int len)
+ *
+ * @param      data pointer to the data.
+ * @param      len number of bytes of data.
+ */
+void chunk_store_data(const char* data, int len)
+{
+    unsigned char digest[SHA256_LEN];
+    const ChunkRef* ref;
+    long long n;
+
+    while(len > 0)
+    {
+        if(!manifestDone || nextChunk >= chunkCount)
+        {
+            failed = true;
+            return;
+        }
+
+        ref = &chunks[nextChunk];
+        n = ref->len - chunkFill < len ? ref->len - chunkFill : len;
+        memcpy(chunkBuf + chunkFill, data, n);
+        chunkFill += n;
+        receivedBytes += n;
+        data += n;
+        len -= n;
+        if(chunkFill < ref->len)
+        {
+            break;
+        }
+
+        sha256(chunkBuf, ref->len, digest);
+        if(memcmp(digest, ref->hash, CHUNK_HASH_LEN) != 0)
+        {
+            fprintf(stderr, "chunk %lld does not match its digest\n",
+                nextChunk);
+            failed = true;
+        }
+        else if(!writeOut(chunkBuf, ref->len))
+        {
+            failed = true;
+        }
+        else
+        {
+            write_chunk(ref);
+        }
+        ++nextChunk;
+        chunkFill = 0;
+        assemble();
+    }
+}
+
+/**
+ * closes the store.
+ *
+ * @function   chunk_store_close
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  bool chunk_store_close(void)
+ *
+ * @return     true if the whole file was written out; false otherwise.
+ */
+bool chunk_store_close(void)
+{
+    bool complete = manifestDone && !failed && nextChunk == chunkCount;
+
+    close(storeFd);
+    storeFd = -1;
+    free(chunks);
+    free(fates);
+    free(seen);
+    chunks = 0;
+    fates = 0;
+    seen = 0;
+    return complete;
+}
+
+/**
+ * prints how much of the file came from the store.
+ *
+ * @function   chunk_store_print_summary
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void chunk_store_print_summary(FILE* file)
+ *
+ * @param      file stream to print to.
+ */
+void chunk_store_print_summary(FILE* file)
+{
+    fprintf(file, "chunk store: chunks=%lld wanted=%lld stored_bytes=%lld "
+        "received_bytes=%lld\n", chunkCount, wantCount, storedBytes,
+        receivedBytes);
+}
+
+/**
+ * appends a chunk to the manifest, and decides where to take it from.
+ *
+ * @function   add_chunk
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a chunk that is longer than any the session sends fails the transfer; it
+ *   is kept as an empty chunk, which fails its digest check.
+ *
+ * @signature  static void add_chunk(const ChunkRef* ref)
+ *
+ * @param      ref pointer to the chunk.
+ */
+static void add_chunk(const ChunkRef* ref)
+{
+    char path[CHUNK_PATH_LEN];
+    struct stat st;
+
+    if(chunkCount == chunkCapacity)
+    {
+        long long capacity = chunkCapacity == 0 ? 1024 : chunkCapacity * 2;
+        ChunkRef* grownChunks = realloc(chunks, capacity * sizeof(ChunkRef));
+        unsigned char* grownFates;
+        if(grownChunks != 0)
+        {
+            chunks = grownChunks;
+        }
+        grownFates = realloc(fates, capacity);
+        if(grownChunks == 0 || grownFates == 0)
+        {
+            failed = true;
+            return;
+        }
+        fates = grownFates;
+        chunkCapacity = capacity;
+    }
+
+    chunks[chunkCount] = *ref;
+    if(ref->len > MAX_CHUNK_LEN)
+    {
+        failed = true;
+        chunks[chunkCount].len = 0;
+        fates[chunkCount] = CHUNK_WANTED;
+    }
+    else
+    {
+        chunk_path(ref, path);
+        if(fstatat(storeFd, path, &st, 0) == 0 && st.st_size == ref->len)
+        {
+            fates[chunkCount] = CHUNK_STORED;
+        }
+        else if(seen_before(chunkCount))
+        {
+            fates[chunkCount] = CHUNK_REPEATED;
+        }
+        else
+        {
+            fates[chunkCount] = CHUNK_WANTED;
+        }
+    }
+    ++chunkCount;
+}
+
+/**
+ * looks a missing chunk up among the wanted ones, and adds it to them if it
+ *   is not there.
+ *
+ * @function   seen_before
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the table is kept at most half full, and rebuilt twice as large when it
+ *   would not be.
+ *
+ * @signature  static bool seen_before(long long index)
+ *
+ * @param      index index of the chunk in the manifest.
+ *
+ * @return     true if a chunk with the same digest is wanted already.
+ */
+static bool seen_before(long long index)
+{
+    long long slot;
+    long long i;
+    uint64_t hash;
+
+    if((wantCount + 1) * 2 > seenMask + 1)
+    {
+        long long size = seenMask < 0 ? 1024 : (seenMask + 1) * 2;
+        long long* grown = malloc(size * sizeof(long long));
+        if(grown == 0)
+        {
+            return false;
+        }
+        memset(grown, 0xff, size * sizeof(long long));
+        for(i = 0; i <= seenMask; ++i)
+        {
+            if(seen[i] >= 0)
+            {
+                memcpy(&hash, chunks[seen[i]].hash, sizeof(hash));
+                slot = hash & (size - 1);
+                while(grown[slot] >= 0)
+                {
+                    slot = (slot + 1) & (size - 1);
+                }
+                grown[slot] = seen[i];
+            }
+        }
+        free(seen);
+        seen = grown;
+        seenMask = size - 1;
+    }
+
+    memcpy(&hash, chunks[index].hash, sizeof(hash));
+    for(slot = hash & seenMask; seen[slot] >= 0; slot = (slot + 1) & seenMask)
+    {
+        if(memcmp(chunks[seen[slot]].hash, chunks[index].hash,
+            CHUNK_HASH_LEN) == 0 && chunks[seen[slot]].len == chunks[index].len)
+        {
+            return true;
+        }
+    }
+    seen[slot] = index;
+    ++wantCount;
+    return false;
+}
+
+/**
+ * tells the session which chunks to send.
+ *
+ * @function   send_wants
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void send_wants(int msgQId, pid_t sessionPid)
+ *
+ * @param      msgQId id of the message queue to send on.
+ * @param      sessionPid PID of the session.
+ */
+static void send_wants(int msgQId, pid_t sessionPid)
+{
+    Message wantMsg;
+    WantMsg* wants = &wantMsg.data.wantMsg;
+    long long i;
+
+    wantMsg.dataType = MSG_DATA_WANT;
+    wants->count = 0;
+    for(i = 0; i < chunkCount; ++i)
+    {
+        if(fates[i] != CHUNK_WANTED)
+        {
+            continue;
+        }
+        wants->indexes[wants->count] = i;
+        if(++wants->count == MAX_WANTS)
+        {
+            msg_send(msgQId, &wantMsg, sessionPid);
+            wants->count = 0;
+        }
+    }
+
+    /* send the last wants, and then an empty message to end them */
+    if(wants->count > 0)
+    {
+        msg_send(msgQId, &wantMsg, sessionPid);
+        wants->count = 0;
+    }
+    msg_send(msgQId, &wantMsg, sessionPid);
+}
+
+/**
+ * writes out the chunks that come from the store, up to the next one that
+ *   has to be received.
+ *
+ * @function   assemble
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void assemble(void)
+ */
+static void assemble(void)
+{
+    while(nextChunk < chunkCount && fates[nextChunk] != CHUNK_WANTED)
+    {
+        if(!read_chunk(&chunks[nextChunk]))
+        {
+            fprintf(stderr, "chunk %lld missing from the store, or damaged\n",
+                nextChunk);
+            failed = true;
+        }
+        else if(!writeOut(chunkBuf, chunks[nextChunk].len))
+        {
+            failed = true;
+        }
+        else
+        {
+            storedBytes += chunks[nextChunk].len;
+        }
+        ++nextChunk;
+    }
+}
+
+/**
+ * reads a chunk from the store into chunkBuf, and checks it.
+ *
+ * @function   read_chunk
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       a damaged chunk is removed, so the next transfer fetches it.
+ *
+ * @signature  static bool read_chunk(const ChunkRef* ref)
+ *
+ * @param      ref pointer to the chunk.
+ *
+ * @return     true if the chunk is in the store, and intact.
+ */
+static bool read_chunk(const ChunkRef* ref)
+{
+    char path[CHUNK_PATH_LEN];
+    unsigned char digest[SHA256_LEN];
+    ssize_t nRead;
+    int fd;
+
+    chunk_path(ref, path);
+    fd = openat(storeFd, path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return false;
+    }
+    nRead = read(fd, chunkBuf, ref->len);
+    close(fd);
+
+    if(nRead != (ssize_t) ref->len)
+    {
+        return false;
+    }
+    sha256(chunkBuf, ref->len, digest);
+    if(memcmp(digest, ref->hash, CHUNK_HASH_LEN) != 0)
+    {
+        unlinkat(storeFd, path, 0);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * puts the chunk in chunkBuf into the store.
+ *
+ * @function   write_chunk
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * failing to store a chunk does not fail the transfer, unless a later
+ *   repeat of the chunk counts on it.
+ *
+ * @signature  static void write_chunk(const ChunkRef* ref)
+ *
+ * @param      ref pointer to the chunk.
+ */
+static void write_chunk(const ChunkRef* ref)
+{
+    char path[CHUNK_PATH_LEN];
+    char tmpPath[CHUNK_PATH_LEN + 32];
+    int fd;
+
+    chunk_path(ref, path);
+    path[2] = '\0';
+    if(mkdirat(storeFd, path, 0755) < 0 && errno != EEXIST)
+    {
+        return;
+    }
+    path[2] = '/';
+
+    sprintf(tmpPath, "%s.%d.tmp", path, (int) getpid());
+    fd = openat(storeFd, tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0644);
+    if(fd < 0)
+    {
+        return;
+    }
+    if(write(fd, chunkBuf, ref->len) != (ssize_t) ref->len)
+    {
+        close(fd);
+        unlinkat(storeFd, tmpPath, 0);
+        return;
+    }
+    close(fd);
+    if(renameat(storeFd, tmpPath, storeFd, path) < 0)
+    {
+        unlinkat(storeFd, tmpPath, 0);
+    }
+}
+
+/**
+ * builds the path of a chunk in the store.
+ *
+ * @function   chunk_path
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void chunk_path(const ChunkRef* ref, char* path)
+ *
+ * @param      ref pointer to the chunk.
+ * @param      path buffer of CHUNK_PATH_LEN bytes to build the path in.
+ */
+static void chunk_path(const ChunkRef* ref, char* path)
+{
+    static const char hex[] = "0123456789abcdef";
+    int i;
+    int pos = 0;
+
+    for(i = 0; i < CHUNK_HASH_LEN; ++i)
+    {
+        path[pos++] = hex[ref->hash[i] >> 4];
+        path[pos++] = hex[ref->hash[i] & 0xf];
+        if(i == 0)
+        {
+            path[pos++] = '/';
+        }
+    }
+    path[pos] = '\0';
+}
@@ -0,0 +1,46 @@
+/**
+ * header file for chunkstore.c, exposing its interface.
+ *
+ * @sourceFile chunkstore.h
+ *
+ * @program    client.out
+ *
+ * @function   int chunk_store_open(const char* path, ChunkWriter writer);
+ * @function   void chunk_store_manifest(const ManifestMsg* msg, int msgQId,
+ *   pid_t sessionPid);
+ * @function   void chunk_store_data(const char* data, int len);
+ * @function   bool chunk_store_close(void);
+ * @function   void chunk_store_print_summary(FILE* file);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include "messagequeuehelper.h"
+
+/**
+ * writes the next len bytes of the file to the output; returns false if
+ *   they could not be written.
+ */
+typedef bool (*ChunkWriter)(const char* data, long long len);
+
+/**
+ * function prototypes
+ */
+int chunk_store_open(const char* path, ChunkWriter writer);
+void chunk_store_manifest(const ManifestMsg* msg, int msgQId,
+    pid_t sessionPid);
+void chunk_store_data(const char* data, int len);
+bool chunk_store_close(void);
+void chunk_store_print_summary(FILE* file);
+
+#endif
@@ -6,8 +6,34 @@
  * @program    client.out
  *
  * @function   int main (int argc , char** argv)
- * @function   static void msgq_loop(int msgQId)
- * @function   static void connect(int msgQId, int priority, char* filePath)
+ * @function   static bool validate_options(bool resume, int shardCount)
+ * @function   static void receive_loop(int msgQId)
+ * @function   static void* write_loop(void* nothing)
+ * @function   static bool handle_msg(Message* msg)
+ * @function   static bool write_all(int fd, const char* buf, size_t len)
+ * @function   static void open_output(char* path, bool resume)
+ * @function   static bool load_checkpoint(long long* offset,
+ *   uint32_t* checksum)
+ * @function   static void save_checkpoint(void)
+ * @function   static void restart_output(void)
+ * @function   static void open_delta_output(char* path)
+ * @function   static void send_signatures(void)
+ * @function   static void copy_blocks(long long index, long long count)
+ * @function   static void finish_delta_output(bool complete)
+ * @function   static void open_conditional_output(char* path)
+ * @function   static void finish_conditional_output(bool complete)
+ * @function   static void load_validator(void)
+ * @function   static void save_validator(void)
+ * @function   static bool skip_hole(long long len)
+ * @function   static void advance_output(const char* data, long long len)
+ * @function   static bool write_output(const char* data, long long len)
+ * @function   static void record_latency(Message* msg, long long now)
+ * @function   static void dump_latency(FILE* file)
+ * @function   static void* dump_on_signal(void* nothing)
+ * @function   static void connect(int msgQId, int priority, char* filePath,
+ *   int flags)
+ * @function   static void cancel(void)
+ * @function   static void await_session_pid(void)
  * @function   static void sigint_handler(int sigNum)
  * @function   static void* exit_on_char(void* nothing)
  *
@@ -24,24 +50,256 @@
  * the client program connects to the server, and requests a file to be sent to
  *   it through the message queue, and then reads the file contents from the
  *   message queue, and prints it to the screen.
+ *
+ * receiving and writing are done on separate threads, connected by a ring of
+ *   preallocated messages, so that a slow stdout does not leave the message
+ *   queue undrained, and block the session.
+ *
+ * with -f, the client follows the file like tail -f until a key is pressed,
+ *   and then reports how long appended data took to reach it.
+ *
+ * with -o, the file is written to the passed path instead of stdout, and the
+ *   progress of the transfer is recorded in a checkpoint file next to it
+ *   (<path>.ckpt) every CHECKPOINT_INTERVAL bytes, and when the client stops
+ *   early. with -r, the client picks up from the last checkpoint, and only the
+ *   bytes after it are transferred.
+ *
+ * with -d, an existing file at the output path is taken to be an older
+ *   version of the requested file. the client sends the signatures of its
+ *   blocks, and the session only sends the parts that differ; the new version
+ *   is put together in <path>.tmp, and replaces the old one when complete.
+ *
+ * with -s, runs of zeros are sent as holes, which are recreated in the output
+ *   file by seeking past them.
+ *
+ * the receive thread records how long it took to get the session's PID after
+ *   connecting, the first data after the PID, the gaps between data
+ *   messages, and how long every message was queued. the histograms are
+ *   printed to stderr on SIGUSR2, and on exit with -l.
+ *
+ * with -k, the client talks to the server on the passed message queue key,
+ *   or ftok path. with -S n, n server shards are running on that key, and
+ *   the client picks one by hashing the file path, or with -b, the one with
+ *   the least data waiting in its queue.
+ *
+ * with -c, the file is sent as content-defined chunks, and the client keeps
+ *   the ones it receives in a chunk store at the passed path; chunks that
+ *   the store already holds, from this or any other file, are not sent
+ *   again. see chunkstore.c.
+ *
+ * with -t, the requested path is a directory, and the whole tree below it is
+ *   recreated below the output path; see treeout.c. the session walks the
+ *   tree while the client writes out what it has already received.
+ *
+ * with -n, the file is cold: the session reads it without keeping it in the
+ *   page cache, and an output file is flushed and dropped from the page
+ *   cache behind the write cursor too, so copying a huge file does not push
+ *   out the hot files of other clients. an output file is treated the same
+ *   way once it grows past COLD_DEFAULT_THRESHOLD bytes; see dropbehind.c.
+ *
+ * with -g, only the lines of the file that contain the passed pattern are
+ *   sent, and with -x start:end, only the bytes from start up to end; either
+ *   may be left out. the session does the filtering, so the rest of the file
+ *   never enters the message queue; see filter.c.
+ *
+ * with -i, the file is only sent if the output does not hold its current
+ *   version already, which the session tells from the validator of the
+ *   version it last sent, kept next to the output (<path>.valid); the
+ *   answer is then a single message. a new version is put together in
+ *   <path>.tmp, and replaces the old one when complete, so readers of the
+ *   output never see it half written.
+ *
+ * with --load, the client runs as a load generator instead (see loadgen.c),
+ *   and with --replay, it plays back the requests recorded in a server's
+ *   capture log; see replay.c. with --mux, it fetches many files at once
+ *   over streams of one connection; see mux.c.
  */
 #include <string.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <math.h>
 #include "messagequeuehelper.h"
+#include "spscring.h"
+#include "loadgen.h"
+#include "replay.h"
+#include "mux.h"
+#include "histogram.h"
+#include "clockhelper.h"
+#include "checksum.h"
+#include "trace.h"
+#include "shard.h"
+#include "treeout.h"
+#include "chunkstore.h"
+#include "dropbehind.h"
 #include "stdbool.h"
 
 /* function prototypes */
-static void msgq_loop(int msgQId);
-static void connect(int msgQId, int priority, char* filePath);
+static bool validate_options(bool resume, int shardCount);
+static void receive_loop(int msgQId);
+static void* write_loop(void* nothing);
+static bool handle_msg(Message* msg);
+static bool write_all(int fd, const char* buf, size_t len);
+static void open_output(char* path, bool resume);
+static bool load_checkpoint(long long* offset, uint32_t* checksum);
+static void save_checkpoint(void);
+static void restart_output(void);
+static void open_delta_output(char* path);
+static void send_signatures(void);
+static void copy_blocks(long long index, long long count);
+static void finish_delta_output(bool complete);
+static void open_conditional_output(char* path);
+static void finish_conditional_output(bool complete);
+static void load_validator(void);
+static void save_validator(void);
+static bool skip_hole(long long len);
+static void advance_output(const char* data, long long len);
+static bool write_output(const char* data, long long len);
+static void record_latency(Message* msg, long long now);
+static void dump_latency(FILE* file);
+static void* dump_on_signal(void* nothing);
+static void connect(int msgQId, int priority, char* filePath, int flags);
+static void cancel(void);
+static void await_session_pid(void);
 static void sigint_handler(int sigNum);
 static void* exit_on_char(void* nothing);
 
 /* inter process communication globals */
 static int msgQId;
-static int sessionPid = 0;
+static volatile pid_t sessionPid = 0;
+
+/* ring connecting the receive thread to the write thread */
+static SpscRing ring;
+
+/* set once the client decides to stop before the session is done */
+static atomic_bool cancelled = false;
+
+/* set while the receive thread dequeues; only then does cancel wake it up */
+static atomic_bool receiving = true;
+
+/* how long a client cancelled before its session was known waits to hear
+ *   of the session, and how often it looks */
+#define CANCEL_PID_WAIT_NS 2000000000LL
+#define CANCEL_PID_POLL_NS 10000000LL
+
+/* flags of the connection request, and its filter */
+static int connectFlags = 0;
+static FilterSpec connectFilter;
+
+/* time from the session noticing appended data until it was received */
+static Histogram followLatency;
+
+/* latencies seen by the receive thread, and the times they are taken from */
+static Histogram connectToPid;
+static Histogram pidToFirstData;
+static Histogram dataGap;
+static Histogram queueDelay;
+static long long connectTime = 0;
+static long long pidTime = 0;
+static long long lastDataTime = 0;
+
+/* bytes written to the output between two checkpoints */
+#define CHECKPOINT_INTERVAL (1 << 20)
+
+/* where file data is written; the path is 0 when writing to stdout */
+static int outFd = STDOUT_FILENO;
+static char* outPath = 0;
+static char ckptPath[PATH_MAX];
+
+/* chunk store of a chunked transfer */
+static char* storePath = 0;
+
+/* drop-behind of an output that is kept out of the page cache */
+static DropBehind outDrop;
+static bool outCold = false;
+
+/* number of bytes of the file in the output, and their adler-32 checksum */
+static long long outOffset = 0;
+static uint32_t outChecksum = ADLER32_INIT;
+static long long lastCheckpoint = 0;
+
+/* set if the session reported an error instead of sending the whole file */
+static bool sessionFailed = false;
+
+/* bounds on the block size of a delta transfer */
+#define DELTA_MIN_BLOCK 512
+#define DELTA_MAX_BLOCK (128 << 10)
+
+/* most bytes copied from the old version at once */
+#define DELTA_COPY_LEN (64 << 10)
+
+/* most zeros written at once for a hole in a non-seekable output */
+#define ZERO_WRITE_LEN (64 << 10)
+
+/* old version of the file that a delta transfer is based on */
+static int basisFd = -1;
+static size_t blockSize = 0;
+static char deltaPath[PATH_MAX + 4];
+
+/* validator of the version in the output, and of the file as the session
+ *   found it; whether it found the output current, and where the new version
+ *   is put together */
+static char validPath[PATH_MAX + 6];
+static Validator outValidator;
+static Validator fileValidator;
+static bool gotValidator = false;
+static bool notModified = false;
+static char conditionalPath[PATH_MAX + 4];
+
+/* options that only make sense with -o, by the flags that they set */
+static const struct
+{
+    int flag;
+    const char* option;
+}
+outputOptions[] =
+{
+    {CONNECT_FLAG_RESUME, "-r"},
+    {CONNECT_FLAG_DELTA, "-d"},
+    {CONNECT_FLAG_TREE, "-t"},
+    {CONNECT_FLAG_IF_CHANGED, "-i"},
+};
+
+/* pairs of options that can not be given together, by the flags that they
+ *   set; -r is checked as CONNECT_FLAG_RESUME */
+static const struct
+{
+    int flags[2];
+    const char* options[2];
+}
+conflictingOptions[] =
+{
+    {{CONNECT_FLAG_FOLLOW, CONNECT_FLAG_DELTA}, {"-f", "-d"}},
+    {{CONNECT_FLAG_FOLLOW, CONNECT_FLAG_TREE}, {"-f", "-t"}},
+    {{CONNECT_FLAG_FOLLOW, CONNECT_FLAG_CAS}, {"-f", "-c"}},
+    {{CONNECT_FLAG_FOLLOW, CONNECT_FLAG_COLD}, {"-f", "-n"}},
+    {{CONNECT_FLAG_FOLLOW, CONNECT_FLAG_FILTER}, {"-f", "-g or -x"}},
+    {{CONNECT_FLAG_FOLLOW, CONNECT_FLAG_IF_CHANGED}, {"-f", "-i"}},
+    {{CONNECT_FLAG_RESUME, CONNECT_FLAG_DELTA}, {"-r", "-d"}},
+    {{CONNECT_FLAG_RESUME, CONNECT_FLAG_TREE}, {"-r", "-t"}},
+    {{CONNECT_FLAG_RESUME, CONNECT_FLAG_CAS}, {"-r", "-c"}},
+    {{CONNECT_FLAG_RESUME, CONNECT_FLAG_FILTER}, {"-r", "-g or -x"}},
+    {{CONNECT_FLAG_RESUME, CONNECT_FLAG_IF_CHANGED}, {"-r", "-i"}},
+    {{CONNECT_FLAG_DELTA, CONNECT_FLAG_TREE}, {"-d", "-t"}},
+    {{CONNECT_FLAG_DELTA, CONNECT_FLAG_CAS}, {"-d", "-c"}},
+    {{CONNECT_FLAG_DELTA, CONNECT_FLAG_FILTER}, {"-d", "-g or -x"}},
+    {{CONNECT_FLAG_DELTA, CONNECT_FLAG_IF_CHANGED}, {"-d", "-i"}},
+    {{CONNECT_FLAG_SPARSE, CONNECT_FLAG_TREE}, {"-s", "-t"}},
+    {{CONNECT_FLAG_SPARSE, CONNECT_FLAG_CAS}, {"-s", "-c"}},
+    {{CONNECT_FLAG_SPARSE, CONNECT_FLAG_FILTER}, {"-s", "-g or -x"}},
+    {{CONNECT_FLAG_TREE, CONNECT_FLAG_CAS}, {"-t", "-c"}},
+    {{CONNECT_FLAG_TREE, CONNECT_FLAG_COLD}, {"-t", "-n"}},
+    {{CONNECT_FLAG_TREE, CONNECT_FLAG_FILTER}, {"-t", "-g or -x"}},
+    {{CONNECT_FLAG_TREE, CONNECT_FLAG_IF_CHANGED}, {"-t", "-i"}},
+    {{CONNECT_FLAG_CAS, CONNECT_FLAG_FILTER}, {"-c", "-g or -x"}},
+    {{CONNECT_FLAG_CAS, CONNECT_FLAG_IF_CHANGED}, {"-c", "-i"}},
+    {{CONNECT_FLAG_FILTER, CONNECT_FLAG_IF_CHANGED}, {"-g or -x", "-i"}},
+};
 
 /**
  * sets up the message queue, and listens for clients to connect.
@@ -50,13 +308,27 @@ static int sessionPid = 0;
  *
  * @date       2015-02-10
  *
- * @revision   none
+ * @revision   2026-10-18 - options for following, resuming, delta & sparse
+ *   transfers, latency histograms, and server shards.
+ * @revision   2026-10-18 - directory tree transfers.
+ * @revision   2026-10-18 - chunked transfers through a chunk store.
+ * @revision   2026-10-18 - cold transfers, kept out of the page cache.
+ * @revision   2026-10-18 - replays capture logs.
+ * @revision   2026-10-18 - multiplexes many files over one connection.
+ * @revision   2026-10-18 - filters the file on the server.
+ * @revision   2026-10-18 - only fetches a file that changed.
+ * @revision   2026-10-18 - stops a session that was not heard of when the
+ *   client was cancelled, and clears the client's messages on exit.
+ * @revision   2026-10-18 - options are checked by validate_options.
  *
  * @designer   EricTsang
  *
  * @programmer EricTsang
  *
- * @note       none
+ * @note
+ *
+ * SIGUSR2 is blocked before any thread is started, so that only
+ *   dump_on_signal receives it.
  *
  * @signature  int main(int argc , char** argv)
  *
@@ -70,30 +342,271 @@ static int sessionPid = 0;
 int main(int argc , char** argv)
 {
     pthread_t exitOnCharThread;
+    pthread_t writeThread;
+    pthread_t dumpThread;
+    sigset_t dumpSignals;
+    int opt;
+    bool resume = false;
+    bool dumpOnExit = false;
+    char* keySpec = 0;
+    int shardCount = 1;
+    bool leastLoaded = false;
+    int shardQIds[MAX_SHARDS];
+    int shard;
+    char* rest;
+
+    TRACE_INIT("client");
+
+    /* run as a load generator if asked to */
+    if(argc > 1 && strcmp(argv[1], "--load") == 0)
+    {
+        return loadgen_main(argc - 1, argv + 1);
+    }
+    if(argc > 1 && strcmp(argv[1], "--replay") == 0)
+    {
+        return replay_main(argc - 1, argv + 1);
+    }
+    if(argc > 1 && strcmp(argv[1], "--mux") == 0)
+    {
+        return mux_main(argc - 1, argv + 1);
+    }
+
+    /* parse options */
+    while((opt = getopt(argc, argv, "fo:rdslk:S:btc:ng:x:i")) != -1)
+    {
+        switch(opt)
+        {
+        case 'f':
+            connectFlags |= CONNECT_FLAG_FOLLOW;
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        case 'r':
+            resume = true;
+            break;
+        case 'd':
+            connectFlags |= CONNECT_FLAG_DELTA;
+            break;
+        case 's':
+            connectFlags |= CONNECT_FLAG_SPARSE;
+            break;
+        case 'l':
+            dumpOnExit = true;
+            break;
+        case 'k':
+            keySpec = optarg;
+            break;
+        case 'S':
+            shardCount = atoi(optarg);
+            break;
+        case 'b':
+            leastLoaded = true;
+            break;
+        case 't':
+            connectFlags |= CONNECT_FLAG_TREE;
+            break;
+        case 'c':
+            connectFlags |= CONNECT_FLAG_CAS;
+            storePath = optarg;
+            break;
+        case 'n':
+            connectFlags |= CONNECT_FLAG_COLD;
+            break;
+        case 'g':
+            connectFlags |= CONNECT_FLAG_FILTER;
+            if(strlen(optarg) >= MAX_FILTER_PATTERN_LEN)
+            {
+                argc = 0;
+                break;
+            }
+            strcpy(connectFilter.pattern, optarg);
+            break;
+        case 'i':
+            connectFlags |= CONNECT_FLAG_IF_CHANGED;
+            break;
+        case 'x':
+            connectFlags |= CONNECT_FLAG_FILTER;
+            connectFilter.start = strtoll(optarg, &rest, 10);
+            if(*rest != ':')
+            {
+                argc = 0;
+                break;
+            }
+            connectFilter.end = strtoll(rest + 1, &rest, 10);
+            if(*rest != '\0' || connectFilter.start < 0
+                || connectFilter.end < 0)
+            {
+                argc = 0;
+            }
+            break;
+        default:
+            argc = 0;
+            break;
+        }
+    }
 
     /* verify command line arguments */
-    if(argc != 3)
+    if(argc - optind != 2 || !validate_options(resume, shardCount))
     {
-        printf("usage: %s [priority] [filepath]\n", argv[0]);
+        printf("usage: %s [-f | -n] [-s] [-l] [-o outpath [-r | -d | -t | -i]] "
+            "[-c storepath] [-g pattern] [-x start:end] [-k key] "
+            "[-S shards [-b]] [priority] [filepath]\n", argv[0]);
+        printf("       %s --load [options] priority:[weight:]filepath...\n",
+            argv[0]);
+        printf("       %s --replay [options] capturelog\n", argv[0]);
+        printf("       %s --mux [options] outdir priority:filepath...\n",
+            argv[0]);
         exit(0);
     }
 
     /* set signal handler */
     signal(SIGINT, sigint_handler);
 
+    /* get the message queue of the server to send the request to. */
+    if(shard_open(keySpec, shardCount, shardQIds) == 0
+        || (shard = shard_choose(shardQIds, shardCount, argv[optind + 1],
+            leastLoaded)) < 0)
+    {
+        fprintf(stderr, "no server on message queue\n");
+        exit(1);
+    }
+    msgQId = shardQIds[shard];
+
+    /* open the output, and find out where to resume from */
+    if(connectFlags & CONNECT_FLAG_TREE)
+    {
+        if(tree_out_open(outPath) < 0)
+        {
+            fprintf(stderr, "failed to open output directory: %d\n", errno);
+            exit(1);
+        }
+    }
+    else if(outPath != 0 && (connectFlags & CONNECT_FLAG_DELTA))
+    {
+        open_delta_output(outPath);
+    }
+    else if(connectFlags & CONNECT_FLAG_IF_CHANGED)
+    {
+        open_conditional_output(outPath);
+    }
+    else if(outPath != 0)
+    {
+        open_output(outPath, resume);
+    }
+    if((connectFlags & CONNECT_FLAG_CAS)
+        && chunk_store_open(storePath, write_output) < 0)
+    {
+        fprintf(stderr, "failed to open chunk store: %d\n", errno);
+        exit(1);
+    }
+
+    /* print the latency histograms on SIGUSR2 */
+    histogram_init(&connectToPid);
+    histogram_init(&pidToFirstData);
+    histogram_init(&dataGap);
+    histogram_init(&queueDelay);
+    histogram_init(&followLatency);
+    sigemptyset(&dumpSignals);
+    sigaddset(&dumpSignals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &dumpSignals, 0);
+    pthread_create(&dumpThread, NULL, dump_on_signal, 0);
+
+    /* set up the ring, and start the thread that writes its messages out */
+    if(spsc_ring_init(&ring, SPSC_RING_DEFAULT_CAPACITY) < 0)
+    {
+        fprintf(stderr, "failed to allocate message ring\n");
+        exit(1);
+    }
+    pthread_create(&writeThread, NULL, write_loop, 0);
+
     /* start exit on character thread */
     pthread_create(&exitOnCharThread, NULL, exit_on_char, 0);
 
-    /* get the message queue. */
-    get_message_queue(&msgQId);
-
     /* send connection message to server */
-    connect(msgQId, atoi(argv[1]), argv[2]);
+    connect(msgQId, atoi(argv[optind]), argv[optind + 1], connectFlags);
 
     /* get messages from server until stop */
-    msgq_loop(msgQId);
+    receive_loop(msgQId);
+    pthread_join(writeThread, 0);
+
+    /* tell the session to clean up if we stopped before it did; one that
+     *   was not heard of yet is waited for, or it would fill the queue for
+     *   a client that is gone */
+    if(atomic_load(&cancelled) && sessionPid == 0)
+    {
+        await_session_pid();
+    }
+    if(atomic_load(&cancelled) && sessionPid != 0)
+    {
+        kill(sessionPid, SIGUSR1);
+    }
+
+    /* a chunked transfer is only complete once every chunk is out */
+    if((connectFlags & CONNECT_FLAG_CAS) && !chunk_store_close())
+    {
+        sessionFailed = true;
+    }
+
+    /* flush the rest of a cold output, and drop it from the page cache */
+    if(outCold)
+    {
+        drop_behind_finish(&outDrop, outOffset);
+    }
+
+    /* keep the checkpoint only if there is something left to resume */
+    if(connectFlags & CONNECT_FLAG_TREE)
+    {
+        if(!tree_out_close() && !atomic_load(&cancelled))
+        {
+            fprintf(stderr, "tree not completely recreated\n");
+        }
+    }
+    else if(connectFlags & CONNECT_FLAG_DELTA)
+    {
+        finish_delta_output(!atomic_load(&cancelled) && !sessionFailed);
+    }
+    else if(connectFlags & CONNECT_FLAG_IF_CHANGED)
+    {
+        finish_conditional_output(!atomic_load(&cancelled) && !sessionFailed);
+    }
+    else if(outPath != 0)
+    {
+        if(atomic_load(&cancelled) || sessionFailed)
+        {
+            save_checkpoint();
+        }
+        else
+        {
+            if(ftruncate(outFd, outOffset) < 0)
+            {
+                fprintf(stderr, "failed to size output: %d\n", errno);
+            }
+            unlink(ckptPath);
+        }
+        close(outFd);
+    }
+
+    /* report on how quickly appended data arrived */
+    if(connectFlags & CONNECT_FLAG_FOLLOW)
+    {
+        histogram_print_summary(&followLatency, stderr, "follow latency");
+    }
+    if(dumpOnExit)
+    {
+        dump_latency(stderr);
+    }
+    if(dumpOnExit && (connectFlags & CONNECT_FLAG_CAS))
+    {
+        chunk_store_print_summary(stderr);
+    }
+
+    /* leave nothing of the client's type behind for a later process that
+     *   gets the same pid */
+    msg_clear_type(msgQId, getpid());
 
     /* end program... */
+    spsc_ring_destroy(&ring);
     return 0;
 }
 
@@ -104,7 +617,11 @@ int main(int argc , char** argv)
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - asks to resume from outOffset, if there is
+ *   anything in the output already, and notes when it connected.
+ * @revision   2026-10-18 - a single stream, without a window.
+ * @revision   2026-10-18 - passes on the filter.
+ * @revision   2026-10-18 - passes on the validator of the output.
  *
  * @designer   EricTsang
  *
@@ -112,7 +629,8 @@ int main(int argc , char** argv)
  *
  * @note       none
  *
- * @signature  static void connect(int msgQId, int priority, char* filePath)
+ * @signature  static void connect(int msgQId, int priority, char* filePath,
+ *   int flags)
  *
  * @param      msgQId id of the message queue to send the connect message to.
  * @param      priority priority of this client. the higher the priority, the
@@ -120,27 +638,41 @@ int main(int argc , char** argv)
  *   20.
  * @param      filePath path to file to have sent to the client through the
  *   message queue.
+ * @param      flags combination of CONNECT_FLAG_ values.
  */
-static void connect(int msgQId, int priority, char* filePath)
+static void connect(int msgQId, int priority, char* filePath, int flags)
 {
     /* construct connect message */
     Message msg;
     msg.dataType = MSG_DATA_CONNECT;
     msg.data.connectMsg.clientPid   = getpid();
+    msg.data.connectMsg.clientType  = getpid();
     msg.data.connectMsg.priority    = priority;
+    msg.data.connectMsg.flags       = flags;
+    msg.data.connectMsg.offset      = outOffset;
+    msg.data.connectMsg.prefixChecksum = outChecksum;
+    msg.data.connectMsg.streamId    = 0;
+    msg.data.connectMsg.window      = 0;
+    msg.data.connectMsg.filter      = connectFilter;
+    msg.data.connectMsg.validator   = outValidator;
+    if(outOffset > 0)
+    {
+        msg.data.connectMsg.flags |= CONNECT_FLAG_RESUME;
+    }
     strncpy(msg.data.connectMsg.filePath, filePath, strlen(filePath)+1);
 
     /* send connection message to server */
+    TRACE_INSTANT("connect sent", priority);
+    connectTime = clock_now_ns();
     msg_send(msgQId, &msg, MSGQ_SVR_T);
 }
 
 /**
- * message loop of the client, it continuously dequeues messages from the
- *   message queue, and processes them.
+ * checks that the options given on the command line can be used together.
  *
- * @function   msgq_loop
+ * @function   validate_options
  *
- * @date       2015-02-11
+ * @date       2026-10-18
  *
  * @revision   none
  *
@@ -148,52 +680,145 @@ static void connect(int msgQId, int priority, char* filePath)
  *
  * @programmer EricTsang
  *
- * @note       none
+ * @note
+ *
+ * prints what is wrong with the options to stderr; one message for each
+ *   option missing -o, and for each pair of options that conflict.
+ *
+ * @signature  static bool validate_options(bool resume, int shardCount)
+ *
+ * @param      resume true if -r was given.
+ * @param      shardCount number of shards given with -S.
+ *
+ * @return     true if the options can be used together; false otherwise.
+ */
+static bool validate_options(bool resume, int shardCount)
+{
+    int flags = connectFlags | (resume ? CONNECT_FLAG_RESUME : 0);
+    bool valid = true;
+    size_t i;
+
+    if(shardCount < 1 || shardCount > MAX_SHARDS)
+    {
+        fprintf(stderr, "-S needs 1 to %d shards\n", MAX_SHARDS);
+        valid = false;
+    }
+    for(i = 0; i < sizeof(outputOptions) / sizeof(outputOptions[0]); ++i)
+    {
+        if((flags & outputOptions[i].flag) && outPath == 0)
+        {
+            fprintf(stderr, "%s needs -o\n", outputOptions[i].option);
+            valid = false;
+        }
+    }
+    for(i = 0; i < sizeof(conflictingOptions) / sizeof(conflictingOptions[0]);
+        ++i)
+    {
+        if((flags & conflictingOptions[i].flags[0])
+            && (flags & conflictingOptions[i].flags[1]))
+        {
+            fprintf(stderr, "%s can not be used with %s\n",
+                conflictingOptions[i].options[0],
+                conflictingOptions[i].options[1]);
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+/**
+ * receive loop of the client. it continuously dequeues messages from the
+ *   message queue straight into the ring, and hands them to the write thread.
+ *
+ * @function   receive_loop
+ *
+ * @date       2015-02-11
+ *
+ * @revision   2026-10-18 - messages are handed to write_loop through the ring
+ *   instead of being processed in place.
+ * @revision   2026-10-18 - tells cancel once it stopped.
+ *
+ * @designer   EricTsang
  *
- * @signature  static void msgq_loop(int msgQId)
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * this thread does nothing but call msgrcv, so the message queue keeps being
+ *   drained while the write thread is stalled on its output. it stops after
+ *   passing on a stop message, which is either sent by the session, or by
+ *   cancel.
+ *
+ * @signature  static void receive_loop(int msgQId)
  *
  * @param      msgQId id of the message queue to dequeue from.
  */
-static void msgq_loop(int msgQId)
+static void receive_loop(int msgQId)
 {
-    static bool stopLoop = false;
+    bool stopLoop = false;
 
     while(!stopLoop)
     {
-        Message msg;
-        if(msg_recv(msgQId, &msg, getpid()) < 0)
+        Message* msg = spsc_ring_begin_push(&ring);
+        if(msg_recv(msgQId, msg, getpid()) < 0)
         {
-            stopLoop = true;
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            msg->dataType = MSG_DATA_STOPCLNT;
         }
-        switch(msg.dataType)
+        else
         {
-        case MSG_DATA_DATA:
-            printf("%.*s", msg.data.dataMsg.len, msg.data.dataMsg.data);
-            break;
-        case MSG_DATA_PRINT:
-            printf("%s", msg.data.printMsg.str);
-            break;
-        case MSG_DATA_STOPCLNT:
-            stopLoop = true;
-            break;
-        case MSG_DATA_PID:
-            sessionPid = msg.data.pidMsg.pid;
-            break;
-        default:
-            fprintf(stderr, "unknown message type!\n");
-            kill(sessionPid, SIGUSR1);
-            stopLoop = true;
-            break;
+            record_latency(msg, clock_now_ns());
         }
+        stopLoop = (msg->dataType == MSG_DATA_STOPCLNT);
+        spsc_ring_end_push(&ring);
     }
+    atomic_store(&receiving, false);
 }
 
 /**
- * interrupt handler for the client.
+ * threaded function. write loop of the client; it processes the messages
+ *   passed on by receive_loop, and writes their contents out.
  *
- * @function   sigint_handler
+ * @function   write_loop
  *
- * @date       2015-02-11
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void* write_loop(void* nothing)
+ *
+ * @param      nothing pointer to address 0
+ */
+static void* write_loop(void* nothing)
+{
+    bool stopLoop = false;
+
+    while(!stopLoop)
+    {
+        Message* msg = spsc_ring_begin_pop(&ring);
+        stopLoop = !handle_msg(msg);
+        spsc_ring_end_pop(&ring);
+    }
+
+    pthread_exit(0);
+    return nothing;
+}
+
+/**
+ * processes a single message received from the session.
+ *
+ * @function   handle_msg
+ *
+ * @date       2026-10-18
  *
  * @revision   none
  *
@@ -203,31 +828,127 @@ static void msgq_loop(int msgQId)
  *
  * @note
  *
- * the interrupt handler for the client. it sends a signal to its server process
- *   telling it that the client is terminating. this sets the session perform
- *   cleanup, and stop writing to the message queue.
+ * once the client is cancelled, data is no longer written out; messages are
+ *   only consumed until the stop message that ends the receive loop.
  *
- * @signature  static void sigint_handler(int sigNum)
+ * when writing to a file, every write is accounted for in outOffset and
+ *   outChecksum before it is checkpointed, so the checkpoint never claims
+ *   bytes that are not in the output.
  *
- * @param      sigNum signal number that is invoking this function. this will
- *   always be SIGINT.
+ * @signature  static bool handle_msg(Message* msg)
+ *
+ * @param      msg pointer to the message to process.
+ *
+ * @return     false if this was the last message; true otherwise.
  */
-static void sigint_handler(int sigNum)
+static bool handle_msg(Message* msg)
 {
-    /* send signal to session indicating to them that we are no longer */
-    kill(sessionPid, SIGUSR1);
+    static long long chunks = 0;
+    bool returnVal = true;
 
-    /* exit... */
-    exit(sigNum);
+    switch(msg->dataType)
+    {
+    case MSG_DATA_DATA:
+        if(chunks == 0)
+        {
+            TRACE_INSTANT("first byte", msg->data.dataMsg.len);
+        }
+        if(TRACE_SAMPLE(chunks++))
+        {
+            TRACE_INSTANT("chunk", chunks);
+        }
+        if((connectFlags & CONNECT_FLAG_FOLLOW) && msg->data.dataMsg.len > 0)
+        {
+            histogram_record(&followLatency,
+                clock_now_ns() - msg->data.dataMsg.eventTime);
+        }
+        if(!atomic_load(&cancelled) && (connectFlags & CONNECT_FLAG_CAS))
+        {
+            chunk_store_data(msg->data.dataMsg.data, msg->data.dataMsg.len);
+        }
+        else if(!atomic_load(&cancelled)
+            && (connectFlags & CONNECT_FLAG_TREE))
+        {
+            tree_out_data(msg->data.dataMsg.data, msg->data.dataMsg.len);
+        }
+        else if(!atomic_load(&cancelled) && write_all(outFd,
+            msg->data.dataMsg.data, msg->data.dataMsg.len))
+        {
+            advance_output(msg->data.dataMsg.data, msg->data.dataMsg.len);
+        }
+        break;
+    case MSG_DATA_MANIFEST:
+        if(!atomic_load(&cancelled))
+        {
+            chunk_store_manifest(&msg->data.manifestMsg, msgQId, sessionPid);
+        }
+        break;
+    case MSG_DATA_ENTRY:
+        if(!atomic_load(&cancelled))
+        {
+            tree_out_entry(&msg->data.entryMsg);
+        }
+        break;
+    case MSG_DATA_HOLE:
+        if(!atomic_load(&cancelled) && skip_hole(msg->data.holeMsg.len))
+        {
+            advance_output(0, msg->data.holeMsg.len);
+        }
+        break;
+    case MSG_DATA_RESUME:
+        if(msg->data.resumeMsg.offset != outOffset)
+        {
+            fprintf(stderr, "file changed; restarting transfer\n");
+            restart_output();
+        }
+        break;
+    case MSG_DATA_PRINT:
+        sessionFailed = true;
+        write_all(STDOUT_FILENO, msg->data.printMsg.str,
+            strnlen(msg->data.printMsg.str, MAX_MSG_PRNTMSGSTR_LEN));
+        break;
+    case MSG_DATA_STOPCLNT:
+        TRACE_INSTANT("stop", chunks);
+        returnVal = false;
+        break;
+    case MSG_DATA_PID:
+        sessionPid = msg->data.pidMsg.pid;
+        if(connectFlags & CONNECT_FLAG_DELTA)
+        {
+            send_signatures();
+        }
+        break;
+    case MSG_DATA_BLOCKREF:
+        if(!atomic_load(&cancelled))
+        {
+            copy_blocks(msg->data.blockRefMsg.index,
+                msg->data.blockRefMsg.count);
+        }
+        break;
+    case MSG_DATA_VALIDATOR:
+        fileValidator = msg->data.validatorMsg;
+        gotValidator = true;
+        break;
+    case MSG_DATA_NOTMODIFIED:
+        fileValidator = msg->data.validatorMsg;
+        gotValidator = true;
+        notModified = true;
+        break;
+    default:
+        fprintf(stderr, "unknown message type!\n");
+        cancel();
+        break;
+    }
+
+    return returnVal;
 }
 
 /**
- * threaded function. it makes the process exit when a character is received
- *   from stdin.
+ * writes the whole buffer to the file descriptor, retrying partial writes.
  *
- * @function   exit_on_char
+ * @function   write_all
  *
- * @date       2015-02-11
+ * @date       2026-10-18
  *
  * @revision   none
  *
@@ -235,6 +956,982 @@ static void sigint_handler(int sigNum)
  *
  * @programmer EricTsang
  *
+ * @note
+ *
+ * if the output can no longer be written to, the client is cancelled.
+ *
+ * @signature  static bool write_all(int fd, const char* buf, size_t len)
+ *
+ * @param      fd file descriptor to write to.
+ * @param      buf pointer to the first byte to write.
+ * @param      len number of bytes to write.
+ *
+ * @return     true if all bytes were written; false otherwise.
+ */
+static bool write_all(int fd, const char* buf, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t nWritten = write(fd, buf, len);
+        if(nWritten < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "write failed: %d\n", errno);
+            cancel();
+            return false;
+        }
+        buf += nWritten;
+        len -= nWritten;
+    }
+    return true;
+}
+
+/**
+ * opens the file that data is written to. when resuming, the output is cut
+ *   back to the last checkpoint, and the transfer continues from there.
+ *
+ * @function   open_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the output may hold more bytes than the checkpoint if the client died
+ *   between writing them and checkpointing; those are discarded. if there is
+ *   no usable checkpoint, the transfer starts over.
+ *
+ * @signature  static void open_output(char* path, bool resume)
+ *
+ * @param      path path of the file to write to.
+ * @param      resume true to continue from the last checkpoint.
+ */
+static void open_output(char* path, bool resume)
+{
+    struct stat st;
+
+    snprintf(ckptPath, sizeof(ckptPath), "%s.ckpt", path);
+
+    outFd = open(path, O_WRONLY | O_CREAT, 0644);
+    if(outFd < 0)
+    {
+        fprintf(stderr, "failed to open output: %d\n", errno);
+        exit(1);
+    }
+
+    if(!resume || !load_checkpoint(&outOffset, &outChecksum)
+        || fstat(outFd, &st) < 0 || st.st_size < outOffset)
+    {
+        restart_output();
+        return;
+    }
+
+    if(ftruncate(outFd, outOffset) < 0 || lseek(outFd, outOffset, SEEK_SET) < 0)
+    {
+        fprintf(stderr, "failed to resume output: %d\n", errno);
+        exit(1);
+    }
+    lastCheckpoint = outOffset;
+}
+
+/**
+ * reads the offset and checksum of the last checkpoint.
+ *
+ * @function   load_checkpoint
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool load_checkpoint(long long* offset,
+ *   uint32_t* checksum)
+ *
+ * @param      offset set to the number of bytes that were checkpointed.
+ * @param      checksum set to the adler-32 checksum of those bytes.
+ *
+ * @return     true if a checkpoint was read; false otherwise.
+ */
+static bool load_checkpoint(long long* offset, uint32_t* checksum)
+{
+    FILE* file = fopen(ckptPath, "r");
+    unsigned int adler;
+    bool returnVal;
+
+    if(file == 0)
+    {
+        return false;
+    }
+
+    returnVal = (fscanf(file, "%lld %x", offset, &adler) == 2 && *offset >= 0);
+    *checksum = adler;
+    fclose(file);
+    return returnVal;
+}
+
+/**
+ * records how much of the file is in the output, and its checksum.
+ *
+ * @function   save_checkpoint
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the checkpoint is written to a temporary file that is renamed over the old
+ *   one, so a client dying half way through leaves the previous checkpoint
+ *   intact. it protects against the client dying, not the machine; the output
+ *   is not synced to disk.
+ *
+ * the output is sized to the checkpoint first, in case it ends in a hole
+ *   that was only seeked over.
+ *
+ * @signature  static void save_checkpoint(void)
+ */
+static void save_checkpoint(void)
+{
+    char tmpPath[PATH_MAX + 4];
+    FILE* file;
+
+    if((connectFlags & CONNECT_FLAG_SPARSE) && ftruncate(outFd, outOffset) < 0)
+    {
+        fprintf(stderr, "failed to save checkpoint: %d\n", errno);
+        return;
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", ckptPath);
+    file = fopen(tmpPath, "w");
+    if(file == 0)
+    {
+        fprintf(stderr, "failed to save checkpoint: %d\n", errno);
+        return;
+    }
+
+    fprintf(file, "%lld %08x\n", outOffset, (unsigned int) outChecksum);
+    if(fclose(file) != 0 || rename(tmpPath, ckptPath) < 0)
+    {
+        fprintf(stderr, "failed to save checkpoint: %d\n", errno);
+        return;
+    }
+    lastCheckpoint = outOffset;
+}
+
+/**
+ * empties the output, so the transfer starts over from the beginning.
+ *
+ * @function   restart_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - starts the drop-behind over too.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void restart_output(void)
+ */
+static void restart_output(void)
+{
+    if(ftruncate(outFd, 0) < 0 || lseek(outFd, 0, SEEK_SET) < 0)
+    {
+        fprintf(stderr, "failed to truncate output: %d\n", errno);
+        exit(1);
+    }
+    outOffset = 0;
+    outChecksum = ADLER32_INIT;
+    lastCheckpoint = 0;
+    if(outCold)
+    {
+        drop_behind_init(&outDrop, outFd, true);
+    }
+}
+
+/**
+ * opens the old version of the file, and the temporary file that the new
+ *   version is put together in.
+ *
+ * @function   open_delta_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * if there is no old version, no signatures are sent, and the whole file is
+ *   transferred. the block size grows with the square root of the old
+ *   version's size, which keeps both the signatures and the data sent around
+ *   changes small.
+ *
+ * @signature  static void open_delta_output(char* path)
+ *
+ * @param      path path of the old version, that the new one replaces.
+ */
+static void open_delta_output(char* path)
+{
+    struct stat st;
+
+    basisFd = open(path, O_RDONLY);
+    blockSize = DELTA_MIN_BLOCK;
+    if(basisFd >= 0 && fstat(basisFd, &st) == 0)
+    {
+        blockSize = ((size_t) sqrt((double) st.st_size) + 63) & ~(size_t) 63;
+        blockSize = blockSize < DELTA_MIN_BLOCK ? DELTA_MIN_BLOCK : blockSize;
+        blockSize = blockSize > DELTA_MAX_BLOCK ? DELTA_MAX_BLOCK : blockSize;
+    }
+
+    snprintf(deltaPath, sizeof(deltaPath), "%s.tmp", path);
+    outFd = open(deltaPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(outFd < 0)
+    {
+        fprintf(stderr, "failed to open output: %d\n", errno);
+        exit(1);
+    }
+}
+
+/**
+ * sends the session the signature of every whole block of the old version.
+ *
+ * @function   send_signatures
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a trailing partial block gets no signature; its bytes are sent as data if
+ *   they are still in the file.
+ *
+ * @signature  static void send_signatures(void)
+ */
+static void send_signatures(void)
+{
+    Message sigMsg;
+    unsigned char digest[SHA256_LEN];
+    unsigned char* block = malloc(blockSize);
+    SignatureMsg* sigs = &sigMsg.data.signatureMsg;
+    ssize_t nRead = blockSize;
+
+    sigMsg.dataType = MSG_DATA_SIGNATURE;
+    sigs->blockSize = blockSize;
+    sigs->count = 0;
+
+    while(basisFd >= 0 && block != 0 && nRead == (ssize_t) blockSize)
+    {
+        nRead = read(basisFd, block, blockSize);
+        if(nRead != (ssize_t) blockSize)
+        {
+            break;
+        }
+
+        sigs->sigs[sigs->count].weak = rolling_hash(block, blockSize);
+        sha256(block, blockSize, digest);
+        memcpy(sigs->sigs[sigs->count].strong, digest, SIGNATURE_STRONG_LEN);
+        if(++sigs->count == MAX_SIGNATURES)
+        {
+            msg_send(msgQId, &sigMsg, sessionPid);
+            sigs->count = 0;
+        }
+    }
+
+    /* send the last signatures, and then an empty message to end them */
+    if(sigs->count > 0)
+    {
+        msg_send(msgQId, &sigMsg, sessionPid);
+        sigs->count = 0;
+    }
+    msg_send(msgQId, &sigMsg, sessionPid);
+    free(block);
+}
+
+/**
+ * copies a run of blocks from the old version into the output.
+ *
+ * @function   copy_blocks
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void copy_blocks(long long index, long long count)
+ *
+ * @param      index index of the first block to copy.
+ * @param      count number of blocks to copy.
+ */
+static void copy_blocks(long long index, long long count)
+{
+    static char buf[DELTA_COPY_LEN];
+    off_t offset = (off_t) index * blockSize;
+    off_t remaining = (off_t) count * blockSize;
+
+    while(remaining > 0)
+    {
+        ssize_t nRead = pread(basisFd, buf,
+            remaining < DELTA_COPY_LEN ? remaining : DELTA_COPY_LEN, offset);
+        if(nRead <= 0)
+        {
+            fprintf(stderr, "failed to read old version: %d\n", errno);
+            cancel();
+            return;
+        }
+        if(!write_all(outFd, buf, nRead))
+        {
+            return;
+        }
+        offset += nRead;
+        remaining -= nRead;
+    }
+}
+
+/**
+ * replaces the old version with the new one if the transfer completed, and
+ *   throws the new one away otherwise.
+ *
+ * @function   finish_delta_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void finish_delta_output(bool complete)
+ *
+ * @param      complete true if the whole file was received.
+ */
+static void finish_delta_output(bool complete)
+{
+    close(outFd);
+    if(basisFd >= 0)
+    {
+        close(basisFd);
+    }
+
+    if(!complete)
+    {
+        unlink(deltaPath);
+    }
+    else if(rename(deltaPath, outPath) < 0)
+    {
+        fprintf(stderr, "failed to replace output: %d\n", errno);
+    }
+}
+
+/**
+ * loads the validator of the output, and opens the temporary file that a new
+ *   version is put together in.
+ *
+ * @function   open_conditional_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the output itself is left alone, until a new version of the file is
+ *   complete.
+ *
+ * @signature  static void open_conditional_output(char* path)
+ *
+ * @param      path path of the output.
+ */
+static void open_conditional_output(char* path)
+{
+    snprintf(validPath, sizeof(validPath), "%s.valid", path);
+    load_validator();
+
+    snprintf(conditionalPath, sizeof(conditionalPath), "%s.tmp", path);
+    outFd = open(conditionalPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(outFd < 0)
+    {
+        fprintf(stderr, "failed to open output: %d\n", errno);
+        exit(1);
+    }
+}
+
+/**
+ * replaces the output with the new version if one was received completely,
+ *   and keeps the validator of the version in the output up to date.
+ *
+ * @function   finish_conditional_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the validator is only saved again if the session sent a new one; an
+ *   output that was found current is not touched.
+ *
+ * @signature  static void finish_conditional_output(bool complete)
+ *
+ * @param      complete true if the session answered the request completely.
+ */
+static void finish_conditional_output(bool complete)
+{
+    if(complete && !notModified && ftruncate(outFd, outOffset) < 0)
+    {
+        fprintf(stderr, "failed to size output: %d\n", errno);
+        complete = false;
+    }
+    close(outFd);
+
+    if(!complete || notModified)
+    {
+        unlink(conditionalPath);
+    }
+    else if(rename(conditionalPath, outPath) < 0)
+    {
+        fprintf(stderr, "failed to replace output: %d\n", errno);
+        return;
+    }
+    if(complete && (!notModified
+        || memcmp(&fileValidator, &outValidator, sizeof(Validator)) != 0))
+    {
+        save_validator();
+    }
+}
+
+/**
+ * reads the validator of the version in the output.
+ *
+ * @function   load_validator
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the validator file also holds the size & modification time of the output
+ *   when it was saved; if the output changed since, the validator is
+ *   ignored, and the file is sent again.
+ *
+ * @signature  static void load_validator(void)
+ */
+static void load_validator(void)
+{
+    char hex[2 * CHUNK_HASH_LEN + 1];
+    FILE* file = fopen(validPath, "r");
+    Validator validator;
+    struct stat st;
+    long long outMtime;
+    unsigned int byte;
+    int i;
+
+    if(file == 0)
+    {
+        return;
+    }
+    if(fscanf(file, "%lld %lld %lld %llu %64s %lld", &validator.size,
+        &validator.mtimeNs, &validator.ctimeNs, &validator.inode, hex,
+        &outMtime) != 6
+        || strlen(hex) != 2 * CHUNK_HASH_LEN || stat(outPath, &st) < 0
+        || st.st_size != validator.size
+        || st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec != outMtime)
+    {
+        fclose(file);
+        return;
+    }
+    fclose(file);
+
+    for(i = 0; i < CHUNK_HASH_LEN; ++i)
+    {
+        if(sscanf(hex + 2 * i, "%2x", &byte) != 1)
+        {
+            return;
+        }
+        validator.digest[i] = byte;
+    }
+    outValidator = validator;
+}
+
+/**
+ * records the validator of the version in the output.
+ *
+ * @function   save_validator
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the validator is written to a temporary file that is renamed over the old
+ *   one, like the checkpoint. without a validator from the session, the old
+ *   one is removed, as it no longer matches the output.
+ *
+ * @signature  static void save_validator(void)
+ */
+static void save_validator(void)
+{
+    char tmpPath[PATH_MAX + 10];
+    struct stat st;
+    FILE* file;
+    int i;
+
+    if(!gotValidator || stat(outPath, &st) < 0)
+    {
+        unlink(validPath);
+        return;
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", validPath);
+    file = fopen(tmpPath, "w");
+    if(file == 0)
+    {
+        fprintf(stderr, "failed to save validator: %d\n", errno);
+        return;
+    }
+
+    fprintf(file, "%lld %lld %lld %llu ", fileValidator.size,
+        fileValidator.mtimeNs, fileValidator.ctimeNs, fileValidator.inode);
+    for(i = 0; i < CHUNK_HASH_LEN; ++i)
+    {
+        fprintf(file, "%02x", fileValidator.digest[i]);
+    }
+    fprintf(file, " %lld\n",
+        st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec);
+    if(fclose(file) != 0 || rename(tmpPath, validPath) < 0)
+    {
+        fprintf(stderr, "failed to save validator: %d\n", errno);
+    }
+}
+
+/**
+ * puts a hole of the file into the output.
+ *
+ * @function   skip_hole
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * an output file is only seeked forward, which leaves a hole in it, since
+ *   everything after the write position was truncated away when it was
+ *   opened. other outputs, like stdout, get the zeros written out.
+ *
+ * @signature  static bool skip_hole(long long len)
+ *
+ * @param      len length of the hole.
+ *
+ * @return     true if the hole was put into the output; false otherwise.
+ */
+static bool skip_hole(long long len)
+{
+    static const char zeros[ZERO_WRITE_LEN];
+
+    if(outPath != 0 && !(connectFlags & CONNECT_FLAG_DELTA))
+    {
+        if(lseek(outFd, len, SEEK_CUR) < 0)
+        {
+            fprintf(stderr, "seek failed: %d\n", errno);
+            cancel();
+            return false;
+        }
+        return true;
+    }
+
+    while(len > 0)
+    {
+        size_t n = len < ZERO_WRITE_LEN ? len : ZERO_WRITE_LEN;
+        if(!write_all(outFd, zeros, n))
+        {
+            return false;
+        }
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * accounts for bytes that were put into an output file, and checkpoints the
+ *   transfer every CHECKPOINT_INTERVAL bytes.
+ *
+ * @function   advance_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - drops a cold output behind the write
+ *   cursor.
+ * @revision   2026-10-18 - conditional fetches are not checkpointed.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void advance_output(const char* data, long long len)
+ *
+ * @param      data pointer to the bytes that were written, or 0 for zeros.
+ * @param      len number of bytes that were written.
+ */
+static void advance_output(const char* data, long long len)
+{
+    if(outPath == 0)
+    {
+        return;
+    }
+
+    outChecksum = (data != 0) ? adler32_update(outChecksum, data, len)
+        : adler32_zeros(outChecksum, len);
+    outOffset += len;
+    if(!(connectFlags & (CONNECT_FLAG_DELTA | CONNECT_FLAG_IF_CHANGED))
+        && outOffset - lastCheckpoint >= CHECKPOINT_INTERVAL)
+    {
+        save_checkpoint();
+    }
+
+    /* keep a cold or huge output out of the page cache */
+    if(!outCold && ((connectFlags & CONNECT_FLAG_COLD)
+        || outOffset >= COLD_DEFAULT_THRESHOLD))
+    {
+        drop_behind_init(&outDrop, outFd, true);
+        outCold = true;
+    }
+    if(outCold)
+    {
+        drop_behind_update(&outDrop, outOffset);
+    }
+}
+
+/**
+ * writes the next bytes of the file to the output, and accounts for them.
+ *
+ * @function   write_output
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       nothing is written once the client is cancelled.
+ *
+ * @signature  static bool write_output(const char* data, long long len)
+ *
+ * @param      data pointer to the bytes to write.
+ * @param      len number of bytes to write.
+ *
+ * @return     true if the bytes were written; false otherwise.
+ */
+static bool write_output(const char* data, long long len)
+{
+    if(atomic_load(&cancelled) || !write_all(outFd, data, len))
+    {
+        return false;
+    }
+    advance_output(data, len);
+    return true;
+}
+
+/**
+ * records the latencies that the arrival of a message completes.
+ *
+ * @function   record_latency
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * called by the receive thread as soon as msgrcv returns, so that the time
+ *   the message waits in the ring is not counted.
+ *
+ * @signature  static void record_latency(Message* msg, long long now)
+ *
+ * @param      msg pointer to the message that was just received.
+ * @param      now monotonic time at which it was received.
+ */
+static void record_latency(Message* msg, long long now)
+{
+    histogram_record(&queueDelay, now - msg->sendTime);
+
+    if(msg->dataType == MSG_DATA_PID && pidTime == 0)
+    {
+        pidTime = now;
+        histogram_record(&connectToPid, now - connectTime);
+    }
+    else if(msg->dataType == MSG_DATA_DATA)
+    {
+        if(lastDataTime == 0)
+        {
+            histogram_record(&pidToFirstData, now - pidTime);
+        }
+        else
+        {
+            histogram_record(&dataGap, now - lastDataTime);
+        }
+        lastDataTime = now;
+    }
+}
+
+/**
+ * prints the latency histograms in the mergeable form of histogram_dump.
+ *
+ * @function   dump_latency
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void dump_latency(FILE* file)
+ *
+ * @param      file stream to print to.
+ */
+static void dump_latency(FILE* file)
+{
+    histogram_dump(&connectToPid, file, "client_connect_to_pid");
+    histogram_dump(&pidToFirstData, file, "client_pid_to_first_data");
+    histogram_dump(&dataGap, file, "client_data_gap");
+    histogram_dump(&queueDelay, file, "client_queue_delay");
+    histogram_dump(&followLatency, file, "client_follow_latency");
+    fflush(file);
+}
+
+/**
+ * threaded function. prints the latency histograms every time the process
+ *   gets SIGUSR2.
+ *
+ * @function   dump_on_signal
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the signal is taken with sigwait, so the histograms are printed from a
+ *   normal thread, rather than a signal handler.
+ *
+ * @signature  static void* dump_on_signal(void* nothing)
+ *
+ * @param      nothing pointer to address 0
+ */
+static void* dump_on_signal(void* nothing)
+{
+    sigset_t dumpSignals;
+    int sigNum;
+
+    sigemptyset(&dumpSignals);
+    sigaddset(&dumpSignals, SIGUSR2);
+    while(sigwait(&dumpSignals, &sigNum) == 0)
+    {
+        dump_latency(stderr);
+    }
+
+    return nothing;
+}
+
+/**
+ * cancels the transfer; the client stops writing output, and exits once the
+ *   receive loop has stopped.
+ *
+ * @function   cancel
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - only wakes up a receive thread that is running.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the receive thread is most likely blocked in msgrcv, so it is woken up by
+ *   enqueueing a stop message of the client's own type. main tells the
+ *   session to clean up after the threads are done.
+ *
+ * a receive thread that already stopped is not sent the stop message; main
+ *   clears whatever of the client's type is left in the queue when it exits
+ *   anyway, in case it stopped while the message was being sent.
+ *
+ * @signature  static void cancel(void)
+ */
+static void cancel(void)
+{
+    Message stopMsg;
+
+    if(!atomic_exchange(&cancelled, true) && atomic_load(&receiving))
+    {
+        stopMsg.dataType = MSG_DATA_STOPCLNT;
+        msg_send(msgQId, &stopMsg, getpid());
+    }
+}
+
+/**
+ * waits a bounded time for the pid of the session of a cancelled client.
+ *
+ * @function   await_session_pid
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * called once the threads are done, when the client was cancelled before
+ *   the session sent its pid; the request may still be queued, or the
+ *   session just forked. everything else that arrives meanwhile is dropped.
+ *   the client gives up after CANCEL_PID_WAIT_NS, in case no session was
+ *   ever started.
+ *
+ * @signature  static void await_session_pid(void)
+ */
+static void await_session_pid(void)
+{
+    long long deadline = clock_now_ns() + CANCEL_PID_WAIT_NS;
+    Message msg;
+
+    while(sessionPid == 0 && clock_now_ns() < deadline)
+    {
+        if(msg_try_recv(msgQId, &msg, getpid()) < 0)
+        {
+            clock_sleep_until_ns(clock_now_ns() + CANCEL_PID_POLL_NS);
+        }
+        else if(msg.dataType == MSG_DATA_PID)
+        {
+            sessionPid = msg.data.pidMsg.pid;
+        }
+    }
+}
+
+/**
+ * interrupt handler for the client.
+ *
+ * @function   sigint_handler
+ *
+ * @date       2015-02-11
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the interrupt handler for the client. it sends a signal to its server process
+ *   telling it that the client is terminating. this sets the session perform
+ *   cleanup, and stop writing to the message queue.
+ *
+ * @signature  static void sigint_handler(int sigNum)
+ *
+ * @param      sigNum signal number that is invoking this function. this will
+ *   always be SIGINT.
+ */
+static void sigint_handler(int sigNum)
+{
+    /* send signal to session indicating to them that we are no longer */
+    kill(sessionPid, SIGUSR1);
+
+    /* exit... */
+    exit(sigNum);
+}
+
+/**
+ * threaded function. it makes the process exit when a character is received
+ *   from stdin.
+ *
+ * @function   exit_on_char
+ *
+ * @date       2015-02-11
+ *
+ * @revision   2026-10-18 - cancels the transfer instead of raising SIGINT, so
+ *   the client shuts down through its normal exit path.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
  * @note       none
  *
  * @signature  static void* exit_on_char(void* nothing)
@@ -246,8 +1943,8 @@ static void* exit_on_char(void* nothing)
     /* wait for input */
     getchar();
 
-    /* kill ourself */
-    kill(getpid(), SIGINT);
+    /* stop the receive & write threads */
+    cancel();
 
     /* exit thread */
     pthread_exit(0);
@@ -0,0 +1,84 @@
+/**
+ * this file contains helper functions used to take timestamps, and to wait
+ *   for points in time.
+ *
+ * @sourceFile clockhelper.c
+ *
+ * @program    server.out, client.out
+ *
+ * @function   long long clock_now_ns(void)
+ * @function   void clock_sleep_until_ns(long long deadline)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * all timestamps are taken from CLOCK_MONOTONIC, which is shared by every
+ *   process on the host, so timestamps taken by the server and by the client
+ *   can be compared with each other.
+ */
+#include <errno.h>
+#include "clockhelper.h"
+
+/**
+ * returns the current time.
+ *
+ * @function   clock_now_ns
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  long long clock_now_ns(void)
+ *
+ * @return     current value of the monotonic clock in nanoseconds.
+ */
+long long clock_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NS_PER_S + now.tv_nsec;
+}
+
+/**
+ * blocks the calling thread until the monotonic clock reaches the deadline.
+ *
+ * @function   clock_sleep_until_ns
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * returns immediately if the deadline has already passed.
+ *
+ * @signature  void clock_sleep_until_ns(long long deadline)
+ *
+ * @param      deadline point in time to sleep until, as returned by
+ *   clock_now_ns.
+ */
+void clock_sleep_until_ns(long long deadline)
+{
+    struct timespec until;
+    until.tv_sec  = deadline / NS_PER_S;
+    until.tv_nsec = deadline % NS_PER_S;
+
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, 0) == EINTR);
+}
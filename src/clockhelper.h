@@ -0,0 +1,37 @@
+/**
+ * header file for clockhelper.c, exposing its interface.
+ *
+ * @sourceFile clockhelper.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   long long clock_now_ns(void);
+ * @function   void clock_sleep_until_ns(long long deadline);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef CLOCKHELPER_H
+#define CLOCKHELPER_H
+
+#include <time.h>
+
+/* handy conversion constants */
+#define NS_PER_US 1000LL
+#define NS_PER_MS 1000000LL
+#define NS_PER_S  1000000000LL
+
+/**
+ * function prototypes
+ */
+long long clock_now_ns(void);
+void clock_sleep_until_ns(long long deadline);
+
+#endif
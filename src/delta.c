@@ -0,0 +1,474 @@
+/**
+ * sends a file to a client as the differences from the client's own copy of
+ *   it, in the manner of rsync.
+ *
+ * @sourceFile delta.c
+ *
+ * @program    server.out
+ *
+ * @function   int delta_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter)
+ * @function   static int receive_signatures(int msgQId)
+ * @function   static void build_index(void)
+ * @function   static long long find_block(uint32_t weak,
+ *   const unsigned char* block, long long hint)
+ * @function   static bool strong_match(long long index,
+ *   const unsigned char* block)
+ * @function   static void flush_blocks(void)
+ * @function   static void flush_literal(const unsigned char* data,
+ *   size_t len)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the client cuts its copy into blocks, and sends the signature of every
+ *   block. the session slides a window of one block over the file, one byte
+ *   at a time, and looks the rolling hash of the window up among the
+ *   signatures. where a block matches, the client is told to copy it from its
+ *   own copy; everything else is sent as data.
+ *
+ * runs of consecutive blocks are sent as a single reference, so a file that
+ *   barely changed costs a handful of messages besides the signatures.
+ */
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "delta.h"
+#include "checksum.h"
+#include "clockhelper.h"
+#include "trace.h"
+#include "serverstats.h"
+#include "chunkctl.h"
+
+/* function prototypes */
+static int receive_signatures(int msgQId);
+static void build_index(void);
+static long long find_block(uint32_t, const unsigned char*, long long);
+static bool strong_match(long long, const unsigned char*);
+static void flush_blocks(void);
+static void flush_literal(const unsigned char*, size_t);
+
+/* where the delta is sent */
+static int queueId;
+static long destType;
+static ChunkCtl chunk;
+static int clientPriority;
+static RateLimiter* rateLimiter;
+
+/* signatures of the client's blocks, in order */
+static BlockSig* sigs = 0;
+static long long sigCount = 0;
+static size_t blockSize = 0;
+
+/* hash table of the signatures, chained through next */
+static long long* buckets = 0;
+static long long* next = 0;
+static unsigned int bucketBits = 0;
+
+/* run of blocks that is yet to be sent to the client */
+static long long runIndex = 0;
+static long long runCount = 0;
+
+/**
+ * receives the client's block signatures, and sends it what it needs to
+ *   rebuild the file from its copy.
+ *
+ * @function   delta_send
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - held to the client's rate limits.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the signatures are sent to the session's PID by the client, once it has
+ *   been told the PID. the file is mapped rather than read, so the window can
+ *   slide over it without copying.
+ *
+ * @signature  int delta_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter)
+ *
+ * @param      msgQId id of the message queue to use.
+ * @param      clientType message type that the client receives messages with.
+ * @param      fd file descriptor of the file to send, positioned at 0.
+ * @param      priority priority of the client; the size of data messages
+ *   is chosen the same way as for a plain transfer.
+ * @param      limiter pointer to the rate limiter of the client; block
+ *   references count as messages, and literal data as bytes too.
+ *
+ * @return     0 upon success; -1 if the file could not be mapped.
+ */
+int delta_send(int msgQId, long clientType, int fd, int priority,
+    RateLimiter* limiter)
+{
+    struct stat st;
+    const unsigned char* map;
+    size_t size;
+    size_t pos = 0;
+    size_t literal = 0;
+    uint32_t weak = 0;
+    long long index;
+
+    queueId = msgQId;
+    destType = clientType;
+    clientPriority = priority;
+    rateLimiter = limiter;
+    chunk_ctl_init(&chunk, msgQId, priority);
+
+    TRACE_BEGIN("receive signatures");
+    if(receive_signatures(msgQId) < 0 || fstat(fd, &st) < 0)
+    {
+        return -1;
+    }
+    TRACE_END("receive signatures");
+    size = st.st_size;
+    if(size == 0)
+    {
+        return 0;
+    }
+
+    map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+    {
+        return -1;
+    }
+    madvise((void*) map, size, MADV_SEQUENTIAL);
+    build_index();
+
+    /* slide the window over the file, looking for the client's blocks */
+    TRACE_BEGIN("delta scan");
+    if(sigCount > 0 && size >= blockSize)
+    {
+        weak = rolling_hash(map, blockSize);
+    }
+    while(sigCount > 0 && pos + blockSize <= size)
+    {
+        index = find_block(weak, map + pos, runCount > 0 && literal == pos
+            ? runIndex + runCount : -1);
+        if(index < 0)
+        {
+            /* no match; the byte leaving the window is literal data */
+            if(pos + blockSize < size)
+            {
+                weak = rolling_hash_roll(weak, map[pos], map[pos + blockSize],
+                    blockSize);
+            }
+            ++pos;
+            continue;
+        }
+
+        /* extend the pending run, or send what came before this block */
+        if(runCount > 0 && literal == pos && index == runIndex + runCount)
+        {
+            ++runCount;
+        }
+        else
+        {
+            flush_blocks();
+            flush_literal(map + literal, pos - literal);
+            runIndex = index;
+            runCount = 1;
+        }
+
+        pos += blockSize;
+        literal = pos;
+        if(pos + blockSize <= size)
+        {
+            weak = rolling_hash(map + pos, blockSize);
+        }
+    }
+
+    /* send whatever is left */
+    flush_blocks();
+    flush_literal(map + literal, size - literal);
+    TRACE_END("delta scan");
+
+    munmap((void*) map, size);
+    return 0;
+}
+
+/**
+ * receives the block signatures of the client's copy.
+ *
+ * @function   receive_signatures
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int receive_signatures(int msgQId)
+ *
+ * @param      msgQId id of the message queue to receive from.
+ *
+ * @return     0 upon success; -1 if the signatures could not be received.
+ */
+static int receive_signatures(int msgQId)
+{
+    Message msg;
+    long long capacity = 0;
+
+    for(;;)
+    {
+        if(msg_recv(msgQId, &msg, getpid()) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if(msg.dataType != MSG_DATA_SIGNATURE
+            || msg.data.signatureMsg.count == 0)
+        {
+            break;
+        }
+
+        if(sigCount + msg.data.signatureMsg.count > capacity)
+        {
+            BlockSig* grown;
+            capacity = capacity == 0 ? 1024 : capacity * 2;
+            grown = realloc(sigs, capacity * sizeof(BlockSig));
+            if(grown == 0)
+            {
+                return -1;
+            }
+            sigs = grown;
+        }
+        memcpy(sigs + sigCount, msg.data.signatureMsg.sigs,
+            msg.data.signatureMsg.count * sizeof(BlockSig));
+        sigCount += msg.data.signatureMsg.count;
+        blockSize = msg.data.signatureMsg.blockSize;
+    }
+
+    if(sigCount > 0 && blockSize == 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * builds the hash table used to look signatures up by their weak hash.
+ *
+ * @function   build_index
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the table has at least twice as many buckets as there are signatures.
+ *   blocks are inserted back to front, so the chains list them in order.
+ *
+ * @signature  static void build_index(void)
+ */
+static void build_index(void)
+{
+    long long i;
+    unsigned int bucketCount;
+
+    bucketBits = 1;
+    while(((long long) 1 << bucketBits) < sigCount * 2)
+    {
+        ++bucketBits;
+    }
+    bucketCount = 1u << bucketBits;
+
+    buckets = malloc(bucketCount * sizeof(long long));
+    next = malloc(sigCount * sizeof(long long));
+    if(buckets == 0 || next == 0)
+    {
+        sigCount = 0;
+        return;
+    }
+    memset(buckets, 0xff, bucketCount * sizeof(long long));
+
+    for(i = sigCount - 1; i >= 0; --i)
+    {
+        uint32_t bucket = (sigs[i].weak * 2654435761u) >> (32 - bucketBits);
+        next[i] = buckets[bucket];
+        buckets[bucket] = i;
+    }
+}
+
+/**
+ * finds a block of the client's copy that holds the same bytes as the
+ *   window.
+ *
+ * @function   find_block
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the hint is checked first, so that runs of unchanged blocks stay runs even
+ *   if the file has duplicate blocks. the strong hash is only computed for
+ *   windows whose weak hash matches.
+ *
+ * @signature  static long long find_block(uint32_t weak,
+ *   const unsigned char* block, long long hint)
+ *
+ * @param      weak rolling hash of the window.
+ * @param      block pointer to the first byte of the window.
+ * @param      hint index of the block to try first, or -1.
+ *
+ * @return     index of a matching block; -1 if there is none.
+ */
+static long long find_block(uint32_t weak, const unsigned char* block,
+    long long hint)
+{
+    uint32_t bucket = (weak * 2654435761u) >> (32 - bucketBits);
+    long long i;
+
+    if(hint >= 0 && hint < sigCount && sigs[hint].weak == weak
+        && strong_match(hint, block))
+    {
+        return hint;
+    }
+
+    for(i = buckets[bucket]; i >= 0; i = next[i])
+    {
+        if(sigs[i].weak == weak && strong_match(i, block))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * checks the strong hash of the window against a signature.
+ *
+ * @function   strong_match
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool strong_match(long long index,
+ *   const unsigned char* block)
+ *
+ * @param      index index of the signature to compare with.
+ * @param      block pointer to the first byte of the window.
+ *
+ * @return     true if the window has the block's strong hash.
+ */
+static bool strong_match(long long index, const unsigned char* block)
+{
+    unsigned char digest[SHA256_LEN];
+
+    sha256(block, blockSize, digest);
+    return memcmp(digest, sigs[index].strong, SIGNATURE_STRONG_LEN) == 0;
+}
+
+/**
+ * tells the client to copy the pending run of blocks from its copy.
+ *
+ * @function   flush_blocks
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - held to the rate limits.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void flush_blocks(void)
+ */
+static void flush_blocks(void)
+{
+    Message refMsg;
+
+    if(runCount == 0)
+    {
+        return;
+    }
+
+    stats_first_byte();
+    refMsg.dataType = MSG_DATA_BLOCKREF;
+    refMsg.data.blockRefMsg.index = runIndex;
+    refMsg.data.blockRefMsg.count = runCount;
+    rate_limit_wait(rateLimiter, 0);
+    msg_send(queueId, &refMsg, destType);
+    runCount = 0;
+}
+
+/**
+ * sends bytes that the client does not have as data messages.
+ *
+ * @function   flush_literal
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - held to the rate limits.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void flush_literal(const unsigned char* data,
+ *   size_t len)
+ *
+ * @param      data pointer to the first byte to send.
+ * @param      len number of bytes to send.
+ */
+static void flush_literal(const unsigned char* data, size_t len)
+{
+    Message dataMsg;
+
+    dataMsg.dataType = MSG_DATA_DATA;
+    while(len > 0)
+    {
+        stats_first_byte();
+        size_t n = len < (size_t) chunk.len ? len : (size_t) chunk.len;
+        memcpy(dataMsg.data.dataMsg.data, data, n);
+        dataMsg.data.dataMsg.len = n;
+        rate_limit_wait(rateLimiter, n);
+        dataMsg.data.dataMsg.eventTime = clock_now_ns();
+        msg_send(queueId, &dataMsg, destType);
+        chunk_ctl_sent(&chunk, clock_now_ns() - dataMsg.sendTime);
+        stats_add_bytes(clientPriority, n);
+        data += n;
+        len -= n;
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * header file for delta.c, exposing its interface.
+ *
+ * @sourceFile delta.h
+ *
+ * @program    server.out
+ *
+ * @function   int delta_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "messagequeuehelper.h"
+#include "ratelimit.h"
+
+/**
+ * function prototypes
+ */
+int delta_send(int msgQId, long clientType, int fd, int priority,
+    RateLimiter* limiter);
+
+#endif
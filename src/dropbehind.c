@@ -0,0 +1,244 @@
+/**
+ * this file keeps a file that is read or written once, front to back, from
+ *   filling the page cache, by dropping its pages behind the cursor.
+ *
+ * @sourceFile dropbehind.c
+ *
+ * @program    server.out, client.out
+ *
+ * @function   void drop_behind_init(DropBehind* drop, int fd, bool writing)
+ * @function   void drop_behind_update(DropBehind* drop, long long offset)
+ * @function   void drop_behind_finish(DropBehind* drop, long long offset)
+ * @function   int drop_behind_reopen(int fd)
+ * @function   static void drop_to(DropBehind* drop, long long offset)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a huge one-off transfer would otherwise evict the small hot files that
+ *   every other client reads, and leave the whole server slow after it.
+ *
+ * read pages are clean, and can be dropped right away. written pages can
+ *   only be dropped once they are on disk, so writeback of every window is
+ *   started as soon as it is written, and the window before it is waited
+ *   for and dropped; the disk stays busy, and the writer rarely waits.
+ *
+ * pages are dropped whole; the partial page at the cursor is left for the
+ *   next window. descriptors that are not files (pipes) make the calls
+ *   fail, which is harmless.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dropbehind.h"
+
+/* function prototypes */
+static void drop_to(DropBehind*, long long);
+
+/**
+ * starts dropping the pages of a file behind the cursor.
+ *
+ * @function   drop_behind_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - notes that readers pass a descriptor of their own.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * everything before the cursor is dropped with the first window, so a
+ *   transfer that turns cold halfway leaves nothing behind either. a file
+ *   being read is also marked sequential, doubling its readahead; the mark
+ *   is on the open file that fd refers to, and reaches every descriptor
+ *   shared with it, so a reader passes one of its own from
+ *   drop_behind_reopen.
+ *
+ * @signature  void drop_behind_init(DropBehind* drop, int fd, bool writing)
+ *
+ * @param      drop pointer to the state to initialize.
+ * @param      fd descriptor of the file.
+ * @param      writing true if the file is written; false if it is read.
+ */
+void drop_behind_init(DropBehind* drop, int fd, bool writing)
+{
+    drop->fd = fd;
+    drop->writing = writing;
+    drop->dropped = 0;
+    drop->flushed = 0;
+    if(!writing)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+}
+
+/**
+ * drops the pages behind the cursor, once a whole window of them has built
+ *   up.
+ *
+ * @function   drop_behind_update
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void drop_behind_update(DropBehind* drop, long long offset)
+ *
+ * @param      drop pointer to the state of the file.
+ * @param      offset position of the cursor.
+ */
+void drop_behind_update(DropBehind* drop, long long offset)
+{
+    if(!drop->writing)
+    {
+        if(offset - drop->dropped >= DROP_BEHIND_LEN)
+        {
+            drop_to(drop, offset);
+        }
+        return;
+    }
+
+    if(offset - drop->flushed >= DROP_BEHIND_LEN)
+    {
+        /* start writing this window out, and drop the previous one */
+        sync_file_range(drop->fd, drop->flushed, offset - drop->flushed,
+            SYNC_FILE_RANGE_WRITE);
+        if(drop->flushed > drop->dropped)
+        {
+            sync_file_range(drop->fd, drop->dropped,
+                drop->flushed - drop->dropped, SYNC_FILE_RANGE_WAIT_BEFORE
+                | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            drop_to(drop, drop->flushed);
+        }
+        drop->flushed = offset;
+    }
+}
+
+/**
+ * drops all pages up to the cursor, at the end of the transfer.
+ *
+ * @function   drop_behind_finish
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       a written file is waited for until it is on disk.
+ *
+ * @signature  void drop_behind_finish(DropBehind* drop, long long offset)
+ *
+ * @param      drop pointer to the state of the file.
+ * @param      offset position of the cursor; the end of the transfer.
+ */
+void drop_behind_finish(DropBehind* drop, long long offset)
+{
+    if(drop->writing && offset > drop->dropped)
+    {
+        sync_file_range(drop->fd, drop->dropped, offset - drop->dropped,
+            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+            | SYNC_FILE_RANGE_WAIT_AFTER);
+    }
+    if(offset > drop->dropped)
+    {
+        posix_fadvise(drop->fd, drop->dropped, offset - drop->dropped,
+            POSIX_FADV_DONTNEED);
+        drop->dropped = offset;
+    }
+    drop->flushed = offset;
+}
+
+/**
+ * gives a file a descriptor of its own, not shared with any other process.
+ *
+ * @function   drop_behind_reopen
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the file is opened again through /proc/self/fd, which finds the same file
+ *   even if its path was since renamed or removed. readahead settings of
+ *   the new descriptor then stay away from the server's open file cache,
+ *   which shares its descriptors with every session.
+ *
+ * @signature  int drop_behind_reopen(int fd)
+ *
+ * @param      fd descriptor of the file, opened for reading; closed if a
+ *   new one was opened.
+ *
+ * @return     the new descriptor; fd itself if the file could not be opened
+ *   again.
+ */
+int drop_behind_reopen(int fd)
+{
+    char path[32];
+    int privateFd;
+
+    sprintf(path, "/proc/self/fd/%d", fd);
+    if((privateFd = open(path, O_RDONLY)) < 0)
+    {
+        return fd;
+    }
+    close(fd);
+    return privateFd;
+}
+
+/**
+ * drops the whole pages between the last drop and the passed offset.
+ *
+ * @function   drop_to
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void drop_to(DropBehind* drop, long long offset)
+ *
+ * @param      drop pointer to the state of the file.
+ * @param      offset offset to drop up to; rounded down to a whole page.
+ */
+static void drop_to(DropBehind* drop, long long offset)
+{
+    long long pageSize = sysconf(_SC_PAGESIZE);
+
+    offset -= offset % pageSize;
+    if(offset > drop->dropped)
+    {
+        posix_fadvise(drop->fd, drop->dropped, offset - drop->dropped,
+            POSIX_FADV_DONTNEED);
+        drop->dropped = offset;
+    }
+}
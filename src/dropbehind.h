@@ -0,0 +1,58 @@
+/**
+ * header file for dropbehind.c, exposing its interface.
+ *
+ * @sourceFile dropbehind.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   void drop_behind_init(DropBehind* drop, int fd, bool writing);
+ * @function   void drop_behind_update(DropBehind* drop, long long offset);
+ * @function   void drop_behind_finish(DropBehind* drop, long long offset);
+ * @function   int drop_behind_reopen(int fd);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef DROPBEHIND_H
+#define DROPBEHIND_H
+
+#include <stdbool.h>
+
+/* size from which a transfer counts as cold, unless configured otherwise */
+#define COLD_DEFAULT_THRESHOLD (1LL << 30)
+
+/* bytes that are read or written between two drops of the page cache */
+#define DROP_BEHIND_LEN (8LL << 20)
+
+/**
+ * state of the page cache behind the cursor of a file that is read or
+ *   written once, front to back.
+ *
+ * everything before dropped has been dropped from the page cache. when
+ *   writing, everything before flushed has had its writeback started.
+ */
+typedef struct
+{
+    int fd;
+    bool writing;
+    long long dropped;
+    long long flushed;
+}
+DropBehind;
+
+/**
+ * function prototypes
+ */
+void drop_behind_init(DropBehind* drop, int fd, bool writing);
+void drop_behind_update(DropBehind* drop, long long offset);
+void drop_behind_finish(DropBehind* drop, long long offset);
+int drop_behind_reopen(int fd);
+
+#endif
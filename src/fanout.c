@@ -0,0 +1,867 @@
+/**
+ * serves a file to every client that asks for it at about the same time,
+ *   while reading it from disk only once.
+ *
+ * @sourceFile fanout.c
+ *
+ * @program    server.out
+ *
+ * @function   int serve_fanout(ConnectMsg* request, int fileFd)
+ * @function   static void initialize(ConnectMsg* request, int fileFd)
+ * @function   static void add_subscriber(ConnectMsg* request)
+ * @function   static void remove_subscriber(int index)
+ * @function   static void poll_control(void)
+ * @function   static void fill_replay(void)
+ * @function   static void send_round(void)
+ * @function   static bool send_chunk(Subscriber* sub, bool block)
+ * @function   static void finish_subscriber(int index)
+ * @function   static void seal(void)
+ * @function   static void bounce(ConnectMsg* request)
+ * @function   static void reject(ConnectMsg* request, char* str)
+ * @function   static void terminate_program(void)
+ * @function   static void sigusr1_handler(int sigNum, siginfo_t* info,
+ *   void* context)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the session reads the file into a replay buffer, and hands out every chunk
+ *   to all of its subscribed clients. the server forwards requests for the
+ *   same file version to the session as JOIN messages, while the start of the
+ *   file is still in the replay buffer; late joiners catch up from there.
+ *
+ * once the start of the file is overwritten, the session seals itself: it
+ *   tells the server to stop forwarding requests to it, and sends requests
+ *   that were already forwarded back to the server as CONNECT messages, to be
+ *   served by a new session.
+ *
+ * the buffer can not move past the slowest subscriber, so everyone proceeds
+ *   at about the same pace; the server only groups clients of equal priority.
+ *
+ * every subscriber is held to its own rate limits; a subscriber that is over
+ *   them is skipped like one whose messages do not fit into the queue.
+ *
+ * a file of at least the cold threshold is dropped from the page cache
+ *   behind the read cursor; late joiners catch up from the replay buffer,
+ *   not from the page cache, so nothing is lost by it.
+ */
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include "fanout.h"
+#include "session.h"
+#include "clockhelper.h"
+#include "trace.h"
+#include "serverstats.h"
+#include "chunkctl.h"
+#include "ratelimit.h"
+#include "dropbehind.h"
+#include "capture.h"
+#include "registry.h"
+
+#define MAX_STR_LEN 80
+
+/**
+ * a client being served by the session.
+ */
+typedef struct
+{
+    pid_t clientPid;
+    long clientType;
+    ChunkCtl chunk;
+    RateLimiter limiter;
+    int priority;
+    off_t offset;           /* offset of the next byte to send to the client */
+}
+Subscriber;
+
+/* function prototypes */
+static void initialize(ConnectMsg* request, int fileFd);
+static void add_subscriber(ConnectMsg* request);
+static void remove_subscriber(int index);
+static void poll_control(void);
+static void fill_replay(void);
+static void send_round(void);
+static bool send_chunk(Subscriber* sub, bool block);
+static void finish_subscriber(int index);
+static void seal(void);
+static void bounce(ConnectMsg* request);
+static void reject(ConnectMsg* request, char* str);
+static void terminate_program(void);
+static void sigusr1_handler(int sigNum, siginfo_t* info, void* context);
+
+/* global variables for inter process communication */
+static int msgQId;
+
+/* the file, and the bytes of it that were read last */
+static int fd = -1;
+static char* replay;
+static off_t readOff = 0;
+static bool eof = false;
+
+/* page cache state of the file, if it is cold */
+static bool cold = false;
+static DropBehind dropBehind;
+
+/* clients being served */
+static Subscriber subscribers[MAX_SUBSCRIBERS];
+static int subscriberCount = 0;
+
+/* whether the session still accepts JOIN messages */
+static bool sealed = false;
+static bool sealAcked = false;
+
+/* process ids of clients that have ended, written by sigusr1_handler */
+static int leavePipe[2];
+
+/**
+ * serves the requested file to the requesting client, and to every client
+ *   that joins in later.
+ *
+ * @function   serve_fanout
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - takes the file opened by the server.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int serve_fanout(ConnectMsg* request, int fileFd)
+ *
+ * @param      request pointer to the connection request of the first client.
+ * @param      fileFd descriptor of the file, opened by the server; -1 to open
+ *   the file at the requested path.
+ *
+ * @return     returns 0, normal exit return code.
+ */
+int serve_fanout(ConnectMsg* request, int fileFd)
+{
+    /* obtain system resources for the process */
+    initialize(request, fileFd);
+
+    /* serve clients until all of them are done */
+    add_subscriber(request);
+    while(subscriberCount > 0)
+    {
+        poll_control();
+        fill_replay();
+        send_round();
+    }
+
+    /* terminate program... */
+    terminate_program();
+
+    return 0;
+}
+
+/**
+ * obtains the resources needed by the session for it to function.
+ *
+ * @function   initialize
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - takes the file opened by the server.
+ * @revision   2026-10-18 - finds out whether the file is cold.
+ * @revision   2026-10-18 - reads a cold file through a descriptor of its own.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * if the file can not be opened, the first client is told so, and the
+ *   session terminates.
+ *
+ * @signature  static void initialize(ConnectMsg* request, int fileFd)
+ *
+ * @param      request pointer to the connection request of the first client.
+ * @param      fileFd descriptor of the file opened by the server; -1 if the
+ *   session has to open the requested path itself.
+ */
+static void initialize(ConnectMsg* request, int fileFd)
+{
+    char fatalstring[MAX_STR_LEN];  /* buffer used to print fatal messages */
+    struct sigaction action;
+    long long openStart;
+
+    /* get the message queue. */
+    get_message_queue(&msgQId);
+
+    /* set signal handler; it needs to know which client has ended */
+    if(pipe(leavePipe) < 0)
+    {
+        fprintf(stderr, "serve_fanout: pipe failed: %d\n", errno);
+        exit(1);
+    }
+    fcntl(leavePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(leavePipe[1], F_SETFL, O_NONBLOCK);
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = sigusr1_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, 0);
+
+    /* allocate the replay buffer */
+    replay = malloc(FANOUT_REPLAY_LEN);
+    if(replay == 0)
+    {
+        reject(request, "out of memory\n");
+        terminate_program();
+    }
+
+    /* open the file, unless the server already has */
+    fd = fileFd;
+    if(fd == -1)
+    {
+        TRACE_BEGIN("open");
+        openStart = clock_now_ns();
+        fd = open(request->filePath, O_RDONLY);
+        histogram_record(&stats_get()->openTime, clock_now_ns() - openStart);
+        TRACE_END("open");
+    }
+    if(fd == -1)
+    {
+        sprintf(fatalstring, "failed to open file: %d\n", errno);
+        reject(request, fatalstring);
+        terminate_program();
+    }
+
+    if(is_cold_file(fd))
+    {
+        cold = true;
+        fd = drop_behind_reopen(fd);
+        drop_behind_init(&dropBehind, fd, false);
+        atomic_fetch_add(&stats_get()->coldSessions, 1);
+    }
+}
+
+/**
+ * starts serving a client.
+ *
+ * @function   add_subscriber
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - sets up the rate limits of the client.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the client is sent the session's PID, and will be sent the file from the
+ *   start.
+ *
+ * @signature  static void add_subscriber(ConnectMsg* request)
+ *
+ * @param      request pointer to the connection request of the client.
+ */
+static void add_subscriber(ConnectMsg* request)
+{
+    char fatalstring[MAX_STR_LEN];  /* buffer used to print fatal messages */
+    Message pidMsg;
+    Subscriber* sub;
+
+    /* verify priority input */
+    if(request->priority < MIN_PROC_PRIO || request->priority > MAX_PROC_PRIO)
+    {
+        sprintf(fatalstring, "invalid priority; %d <= priority <= %d\n",
+            MIN_PROC_PRIO, MAX_PROC_PRIO);
+        reject(request, fatalstring);
+        return;
+    }
+
+    /* a full session stops taking clients */
+    if(subscriberCount == MAX_SUBSCRIBERS)
+    {
+        seal();
+        bounce(request);
+        return;
+    }
+
+    sub = &subscribers[subscriberCount++];
+    sub->clientPid  = request->clientPid;
+    sub->clientType = request->clientType;
+    chunk_ctl_init(&sub->chunk, msgQId, request->priority);
+    rate_limiter_init(&sub->limiter, request->clientPid, request->priority);
+    sub->priority   = request->priority;
+    sub->offset     = 0;
+    TRACE_INSTANT("subscriber added", sub->clientPid);
+
+    /* send the client the session's PID */
+    pidMsg.dataType = MSG_DATA_PID;
+    pidMsg.data.pidMsg.pid = getpid();
+    msg_send(msgQId, &pidMsg, sub->clientType);
+}
+
+/**
+ * stops serving the client, without telling it.
+ *
+ * @function   remove_subscriber
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void remove_subscriber(int index)
+ *
+ * @param      index index of the client in subscribers.
+ */
+static void remove_subscriber(int index)
+{
+    subscribers[index] = subscribers[--subscriberCount];
+}
+
+/**
+ * handles the messages sent to the session itself, and the clients that have
+ *   ended.
+ *
+ * @function   poll_control
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - records clients that left in the capture log.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * never blocks. messages of clients that have ended are cleared from the
+ *   message queue.
+ *
+ * @signature  static void poll_control(void)
+ */
+static void poll_control(void)
+{
+    Message msg;
+    pid_t leaver;
+    int i;
+
+    /* the start of the file is about to be lost; stop taking clients */
+    if(!sealed && readOff > FANOUT_REPLAY_LEN)
+    {
+        seal();
+    }
+
+    while(msg_try_recv(msgQId, &msg, getpid()) > 0)
+    {
+        switch(msg.dataType)
+        {
+        case MSG_DATA_JOIN:
+            if(sealed)
+            {
+                bounce(&msg.data.connectMsg);
+            }
+            else
+            {
+                add_subscriber(&msg.data.connectMsg);
+            }
+            break;
+        case MSG_DATA_SEALED:
+            sealAcked = true;
+            break;
+        default:
+            fprintf(stderr, "unknown message type!\n");
+            break;
+        }
+    }
+
+    while(read(leavePipe[0], &leaver, sizeof(leaver)) == sizeof(leaver))
+    {
+        for(i = subscriberCount - 1; i >= 0; --i)
+        {
+            if(subscribers[i].clientPid == leaver)
+            {
+                msg_clear_type(msgQId, subscribers[i].clientType);
+                capture_done(subscribers[i].clientType, 0,
+                    subscribers[i].offset, false);
+                remove_subscriber(i);
+            }
+        }
+    }
+}
+
+/**
+ * reads the next part of the file into the replay buffer, if there is room.
+ *
+ * @function   fill_replay
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - reads with pread, as the file offset may be shared.
+ * @revision   2026-10-18 - drops the file behind it when cold.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * there is room as long as the bytes that the slowest subscriber has not
+ *   been sent yet are not overwritten. the file is read at most
+ *   FANOUT_READ_LEN bytes ahead of the fastest subscriber, so that the start
+ *   of the file stays in the buffer for as long as possible.
+ *
+ * @signature  static void fill_replay(void)
+ */
+static void fill_replay(void)
+{
+    off_t minOffset = readOff;
+    off_t maxOffset = 0;
+    size_t room;
+    size_t pos = readOff % FANOUT_REPLAY_LEN;
+    ssize_t nRead;
+    int i;
+
+    if(eof)
+    {
+        return;
+    }
+
+    for(i = 0; i < subscriberCount; ++i)
+    {
+        if(subscribers[i].offset < minOffset)
+        {
+            minOffset = subscribers[i].offset;
+        }
+        if(subscribers[i].offset > maxOffset)
+        {
+            maxOffset = subscribers[i].offset;
+        }
+    }
+
+    if(readOff - maxOffset >= FANOUT_READ_LEN)
+    {
+        return;
+    }
+
+    room = FANOUT_REPLAY_LEN - (readOff - minOffset);
+    if(room > FANOUT_READ_LEN)
+    {
+        room = FANOUT_READ_LEN;
+    }
+    if(room > FANOUT_REPLAY_LEN - pos)
+    {
+        room = FANOUT_REPLAY_LEN - pos;
+    }
+    if(room == 0)
+    {
+        return;
+    }
+
+    TRACE_BEGIN("read");
+    nRead = pread(fd, replay + pos, room, readOff);
+    TRACE_END("read");
+    if(nRead > 0)
+    {
+        readOff += nRead;
+        if(cold)
+        {
+            drop_behind_update(&dropBehind, readOff);
+        }
+    }
+    else
+    {
+        if(nRead < 0)
+        {
+            fprintf(stderr, "serve_fanout: read failed: %d\n", errno);
+        }
+        eof = true;
+        if(cold)
+        {
+            drop_behind_finish(&dropBehind, readOff);
+        }
+    }
+}
+
+/**
+ * sends every subscriber its next chunk, skipping those whose messages do
+ *   not fit into the message queue at the moment.
+ *
+ * @function   send_round
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * if no chunk could be sent at all, the session blocks sending to the
+ *   slowest subscriber, since it is the one holding the replay buffer back.
+ *
+ * @signature  static void send_round(void)
+ */
+static void send_round(void)
+{
+    Subscriber* slowest = 0;
+    bool progress = false;
+    int i;
+
+    for(i = subscriberCount - 1; i >= 0; --i)
+    {
+        Subscriber* sub = &subscribers[i];
+        if(sub->offset < readOff)
+        {
+            progress |= send_chunk(sub, false);
+            if(slowest == 0 || sub->offset < slowest->offset)
+            {
+                slowest = sub;
+            }
+        }
+        else if(eof)
+        {
+            finish_subscriber(i);
+            progress = true;
+        }
+    }
+
+    if(!progress && slowest != 0)
+    {
+        send_chunk(slowest, true);
+    }
+}
+
+/**
+ * sends the subscriber its next chunk of the file from the replay buffer.
+ *
+ * @function   send_chunk
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - held to the rate limits of the subscriber.
+ * @revision   2026-10-18 - reports the progress to the server.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool send_chunk(Subscriber* sub, bool block)
+ *
+ * @param      sub pointer to the subscriber to send to.
+ * @param      block true to wait for room in the message queue; false to give
+ *   up if there is none.
+ *
+ * @return     true if the chunk was sent; false otherwise.
+ */
+static bool send_chunk(Subscriber* sub, bool block)
+{
+    static long long chunks = 0;
+    Message dataMsg;
+    size_t pos = sub->offset % FANOUT_REPLAY_LEN;
+    size_t len = sub->chunk.len;
+    int result;
+
+    if((off_t) len > readOff - sub->offset)
+    {
+        len = readOff - sub->offset;
+    }
+    if(len > FANOUT_REPLAY_LEN - pos)
+    {
+        len = FANOUT_REPLAY_LEN - pos;
+    }
+
+    /* a blocking send waits out the rate limits as well */
+    if(block)
+    {
+        rate_limit_wait(&sub->limiter, len);
+    }
+    else if(rate_limit_try(&sub->limiter, len) > 0)
+    {
+        return false;
+    }
+
+    dataMsg.dataType = MSG_DATA_DATA;
+    dataMsg.data.dataMsg.eventTime = clock_now_ns();
+    dataMsg.data.dataMsg.len = len;
+    memcpy(dataMsg.data.dataMsg.data, replay + pos, len);
+
+    if(chunks == 0)
+    {
+        TRACE_INSTANT("first byte", len);
+        stats_first_byte();
+    }
+    if(TRACE_SAMPLE(chunks))
+    {
+        TRACE_BEGIN(block ? "msg_send" : "msg_try_send");
+    }
+    result = block ? msg_send(msgQId, &dataMsg, sub->clientType)
+                   : msg_try_send(msgQId, &dataMsg, sub->clientType);
+    if(TRACE_SAMPLE(chunks))
+    {
+        TRACE_END(block ? "msg_send" : "msg_try_send");
+        TRACE_INSTANT("chunk", chunks);
+    }
+    if(result < 0)
+    {
+        if(errno == EIDRM || errno == EINVAL)
+        {
+            exit(1);
+        }
+        return false;
+    }
+
+    sub->offset += len;
+    chunk_ctl_sent(&sub->chunk, clock_now_ns() - dataMsg.sendTime);
+    stats_add_bytes(sub->priority, len);
+    registry_progress(subscriberCount);
+    ++chunks;
+    return true;
+}
+
+/**
+ * tells a subscriber that has been sent the whole file that it is done, and
+ *   stops serving it.
+ *
+ * @function   finish_subscriber
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - records the client in the capture log.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * like the plain session, the end of the file is marked with an empty data
+ *   message, followed by a stop message.
+ *
+ * @signature  static void finish_subscriber(int index)
+ *
+ * @param      index index of the client in subscribers.
+ */
+static void finish_subscriber(int index)
+{
+    Message msg;
+    long clientType = subscribers[index].clientType;
+
+    TRACE_INSTANT("stop", subscribers[index].clientPid);
+    msg.dataType = MSG_DATA_DATA;
+    msg.data.dataMsg.eventTime = clock_now_ns();
+    msg.data.dataMsg.len = 0;
+    msg_send(msgQId, &msg, clientType);
+
+    msg.dataType = MSG_DATA_STOPCLNT;
+    msg_send(msgQId, &msg, clientType);
+
+    capture_done(clientType, 0, subscribers[index].offset, true);
+    remove_subscriber(index);
+}
+
+/**
+ * tells the server to stop forwarding JOIN messages to this session.
+ *
+ * @function   seal
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void seal(void)
+ */
+static void seal(void)
+{
+    Message sealMsg;
+
+    if(!sealed)
+    {
+        sealed = true;
+        sealMsg.dataType = MSG_DATA_SEALED;
+        sealMsg.data.pidMsg.pid = getpid();
+        msg_send(msgQId, &sealMsg, MSGQ_SVR_T);
+    }
+}
+
+/**
+ * sends a connection request back to the server, to be served by another
+ *   session.
+ *
+ * @function   bounce
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void bounce(ConnectMsg* request)
+ *
+ * @param      request pointer to the connection request to send back.
+ */
+static void bounce(ConnectMsg* request)
+{
+    Message connectMsg;
+
+    connectMsg.dataType = MSG_DATA_CONNECT;
+    connectMsg.data.connectMsg = *request;
+    msg_send(msgQId, &connectMsg, MSGQ_SVR_T);
+}
+
+/**
+ * sends a client a fatal message, followed by a stop message.
+ *
+ * @function   reject
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - records the client in the capture log.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void reject(ConnectMsg* request, char* str)
+ *
+ * @param      request pointer to the connection request of the client.
+ * @param      str pointer to the first character of a string to send to the
+ *   client to print.
+ */
+static void reject(ConnectMsg* request, char* str)
+{
+    Message msg;
+
+    msg.dataType = MSG_DATA_PRINT;
+    sprintf(msg.data.printMsg.str, "fatal: %s", str);
+    msg_send(msgQId, &msg, request->clientType);
+
+    msg.dataType = MSG_DATA_STOPCLNT;
+    msg_send(msgQId, &msg, request->clientType);
+
+    capture_done(request->clientType, 0, 0, false);
+}
+
+/**
+ * cleans up, and terminates the process.
+ *
+ * @function   terminate_program
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the session may only exit once the server has acknowledged that it is
+ *   sealed; until then, JOIN messages may still be on their way, and they are
+ *   sent back to the server.
+ *
+ * @signature  static void terminate_program(void)
+ */
+static void terminate_program(void)
+{
+    Message msg;
+
+    seal();
+    while(!sealAcked)
+    {
+        if(msg_recv(msgQId, &msg, getpid()) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if(msg.dataType == MSG_DATA_JOIN)
+        {
+            bounce(&msg.data.connectMsg);
+        }
+        else if(msg.dataType == MSG_DATA_SEALED)
+        {
+            sealAcked = true;
+        }
+    }
+
+    /* release resources, and exit the program */
+    if(fd != -1)
+    {
+        close(fd);
+    }
+    free(replay);
+    exit(0);
+}
+
+/**
+ * handler for the SIGUSR1 signal. this signal is used to inform this process
+ *   that one of its client processes has ended.
+ *
+ * @function   sigusr1_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the process id of the sender is passed on to poll_control through a pipe,
+ *   since the subscribers can not be touched from inside the handler.
+ *
+ * @signature  static void sigusr1_handler(int sigNum, siginfo_t* info,
+ *   void* context)
+ *
+ * @param      sigNum number that indicates which signal this is. in this case,
+ *   this number will always be SIGUSR1
+ * @param      info information about the signal, including who sent it.
+ * @param      context unused.
+ */
+static void sigusr1_handler(int sigNum, siginfo_t* info, void* context)
+{
+    int savedErrno = errno;
+
+    (void) sigNum;
+    (void) context;
+    if(write(leavePipe[1], &info->si_pid, sizeof(info->si_pid)) < 0)
+    {
+        /* nothing more can be done from inside a signal handler */
+    }
+    errno = savedErrno;
+}
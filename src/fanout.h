@@ -0,0 +1,39 @@
+/**
+ * header file for fanout.c, exposing its interface.
+ *
+ * @sourceFile fanout.h
+ *
+ * @program    server.out
+ *
+ * @function   int serve_fanout(ConnectMsg* request, int fileFd);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include "messagequeuehelper.h"
+
+/* bytes at the start of the file that late joiners can catch up on */
+#define FANOUT_REPLAY_LEN (1 << 20)
+
+/* most bytes read from the file at once */
+#define FANOUT_READ_LEN (64 << 10)
+
+/* most clients that can be served by one session */
+#define MAX_SUBSCRIBERS 1024
+
+/**
+ * function prototypes
+ */
+int serve_fanout(ConnectMsg* request, int fileFd);
+
+#endif
@@ -0,0 +1,607 @@
+/**
+ * this file contains the server's cache of open files and their metadata,
+ *   which saves sessions for small, popular files from opening and looking
+ *   up the file themselves.
+ *
+ * @sourceFile fdcache.c
+ *
+ * @program    server.out
+ *
+ * @function   int fdcache_init(int capacity)
+ * @function   int fdcache_open(const char* filePath, struct stat* info)
+ * @function   static void drain_events(void)
+ * @function   static int find_entry(const char* filePath, unsigned int hash)
+ * @function   static int add_entry(const char* filePath, unsigned int hash)
+ * @function   static void remove_entry(int index)
+ * @function   static void touch_entry(int index)
+ * @function   static void unlink_lru(int index)
+ * @function   static void release_watch(int watch)
+ * @function   static unsigned int hash_path(const char* filePath)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the cache maps paths to a descriptor opened by the server, and the stat of
+ *   the file it refers to. the server looks the path of each request up
+ *   before forking its session, which inherits the descriptor. sessions read
+ *   it with pread only, because the file offset is shared by every session
+ *   that inherited the same descriptor.
+ *
+ * every cached file is watched with inotify; an entry is dropped as soon as
+ *   its file is written to, has its attributes changed, or is renamed,
+ *   replaced or deleted. the pending events are read before every lookup, so
+ *   a lookup never returns a stat older than the last change to the file.
+ *   changes to the directories leading to the file are not watched.
+ *
+ * the least recently used entry is closed when the cache is full.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include "fdcache.h"
+#include "messagequeuehelper.h"
+#include "serverstats.h"
+
+/* inotify events that make a cached entry stale */
+#define FDCACHE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+
+/**
+ * a cached file. entries are chained into hash buckets by next, and into
+ *   the LRU list by prev & newer, most recently used first.
+ */
+typedef struct
+{
+    char filePath[MAX_FILEPATH_LEN];
+    unsigned int hash;
+    int fd;
+    int watch;
+    struct stat info;
+    int next;
+    int older;
+    int newer;
+}
+CacheEntry;
+
+/* function prototypes */
+static void drain_events(void);
+static int find_entry(const char*, unsigned int);
+static int add_entry(const char*, unsigned int);
+static void remove_entry(int);
+static void touch_entry(int);
+static void unlink_lru(int);
+static void release_watch(int);
+static unsigned int hash_path(const char*);
+
+/* entries, hash buckets & free list; empty slots are chained through next */
+static CacheEntry* entries = 0;
+static int* buckets = 0;
+static int slotCount = 0;
+static unsigned int bucketMask = 0;
+static int freeList = -1;
+
+/* ends of the LRU list */
+static int newest = -1;
+static int oldest = -1;
+
+static int inotifyFd = -1;
+
+/**
+ * sets up the cache.
+ *
+ * @function   fdcache_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * raises the soft limit on open files as far as the cache needs, and shrinks
+ *   the cache if the hard limit is too low. a capacity of 0 disables the
+ *   cache.
+ *
+ * @signature  int fdcache_init(int capacity)
+ *
+ * @param      capacity most files to keep open.
+ *
+ * @return     0 upon success; -1 otherwise.
+ */
+int fdcache_init(int capacity)
+{
+    struct rlimit limit;
+    int i;
+
+    if(capacity <= 0)
+    {
+        return 0;
+    }
+
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        if(limit.rlim_cur < (rlim_t) capacity + FDCACHE_SPARE_FDS)
+        {
+            limit.rlim_cur = limit.rlim_max < (rlim_t) capacity + FDCACHE_SPARE_FDS
+                ? limit.rlim_max : (rlim_t) capacity + FDCACHE_SPARE_FDS;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+        if(limit.rlim_cur < (rlim_t) capacity + FDCACHE_SPARE_FDS)
+        {
+            capacity = limit.rlim_cur > FDCACHE_SPARE_FDS * 2
+                ? (int) limit.rlim_cur - FDCACHE_SPARE_FDS : 0;
+        }
+    }
+    if(capacity <= 0)
+    {
+        return 0;
+    }
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0)
+    {
+        return -1;
+    }
+
+    for(bucketMask = 1; bucketMask < (unsigned int) capacity * 2; bucketMask <<= 1)
+    {
+    }
+    entries = malloc(capacity * sizeof(*entries));
+    buckets = malloc(bucketMask * sizeof(*buckets));
+    if(entries == 0 || buckets == 0)
+    {
+        return -1;
+    }
+    --bucketMask;
+    slotCount = capacity;
+
+    for(i = 0; i <= (int) bucketMask; ++i)
+    {
+        buckets[i] = -1;
+    }
+    for(i = 0; i < slotCount; ++i)
+    {
+        entries[i].fd = -1;
+        entries[i].next = i + 1 < slotCount ? i + 1 : -1;
+    }
+    freeList = 0;
+    return 0;
+}
+
+/**
+ * returns an open descriptor of the file at a path, and its stat.
+ *
+ * @function   fdcache_open
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the descriptor belongs to the cache, and is closed by it once the entry is
+ *   dropped; a forked session may keep using its inherited copy. only regular
+ *   files are cached.
+ *
+ * @signature  int fdcache_open(const char* filePath, struct stat* info)
+ *
+ * @param      filePath path to the file.
+ * @param      info pointer to the stat to fill in.
+ *
+ * @return     the descriptor; -1 if the file is not cached, because it could
+ *   not be opened, is not a regular file, or the cache is disabled.
+ */
+int fdcache_open(const char* filePath, struct stat* info)
+{
+    unsigned int hash;
+    int index;
+
+    if(slotCount == 0 || strlen(filePath) >= MAX_FILEPATH_LEN)
+    {
+        return -1;
+    }
+
+    drain_events();
+
+    hash = hash_path(filePath);
+    index = find_entry(filePath, hash);
+    if(index >= 0)
+    {
+        atomic_fetch_add(&stats_get()->fdCacheHits, 1);
+    }
+    else
+    {
+        atomic_fetch_add(&stats_get()->fdCacheMisses, 1);
+        index = add_entry(filePath, hash);
+        if(index < 0)
+        {
+            return -1;
+        }
+    }
+
+    touch_entry(index);
+    *info = entries[index].info;
+    return entries[index].fd;
+}
+
+/**
+ * drops the entries whose files have changed since the last lookup.
+ *
+ * @function   drain_events
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a watch is shared by all paths that lead to the same file, so an event
+ *   drops all of them. if events were lost, every entry is dropped.
+ *
+ * @signature  static void drain_events(void)
+ */
+static void drain_events(void)
+{
+    union
+    {
+        struct inotify_event event;
+        char buf[4096];
+    }
+    events;
+    ssize_t len;
+    char* cursor;
+    int i;
+
+    while((len = read(inotifyFd, events.buf, sizeof(events.buf))) > 0)
+    {
+        for(cursor = events.buf; cursor < events.buf + len;
+            cursor += sizeof(struct inotify_event)
+            + ((struct inotify_event*) cursor)->len)
+        {
+            struct inotify_event* event = (struct inotify_event*) cursor;
+            for(i = 0; i < slotCount; ++i)
+            {
+                if(entries[i].fd != -1 && (event->mask & IN_Q_OVERFLOW
+                    || entries[i].watch == event->wd))
+                {
+                    remove_entry(i);
+                    atomic_fetch_add(&stats_get()->fdCacheInvalidations, 1);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * looks a path up in the hash buckets.
+ *
+ * @function   find_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int find_entry(const char* filePath, unsigned int hash)
+ *
+ * @param      filePath path to look up.
+ * @param      hash hash of the path.
+ *
+ * @return     index of the entry; -1 if the path is not cached.
+ */
+static int find_entry(const char* filePath, unsigned int hash)
+{
+    int index;
+
+    for(index = buckets[hash & bucketMask]; index != -1;
+        index = entries[index].next)
+    {
+        if(entries[index].hash == hash
+            && strcmp(entries[index].filePath, filePath) == 0)
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * opens a file, and adds it to the cache, dropping the least recently used
+ *   entry if the cache is full.
+ *
+ * @function   add_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the watch is added before the file is opened, so a change in between
+ *   drops the entry on the next lookup, rather than going unnoticed.
+ *
+ * @signature  static int add_entry(const char* filePath, unsigned int hash)
+ *
+ * @param      filePath path to the file.
+ * @param      hash hash of the path.
+ *
+ * @return     index of the new entry; -1 if the file can not be cached.
+ */
+static int add_entry(const char* filePath, unsigned int hash)
+{
+    CacheEntry* entry;
+    int index;
+    int watch;
+    int fd;
+
+    /* make room first, so that the watch can not be released by it */
+    if(freeList == -1)
+    {
+        remove_entry(oldest);
+    }
+
+    watch = inotify_add_watch(inotifyFd, filePath, FDCACHE_EVENTS);
+    if(watch < 0)
+    {
+        return -1;
+    }
+    fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        release_watch(watch);
+        return -1;
+    }
+
+    index = freeList;
+    entry = &entries[index];
+    freeList = entry->next;
+
+    entry->fd = fd;
+    if(fstat(fd, &entry->info) < 0 || !S_ISREG(entry->info.st_mode))
+    {
+        close(fd);
+        entry->fd = -1;
+        entry->next = freeList;
+        freeList = index;
+        release_watch(watch);
+        return -1;
+    }
+    strcpy(entry->filePath, filePath);
+    entry->hash = hash;
+    entry->watch = watch;
+    entry->next = buckets[hash & bucketMask];
+    buckets[hash & bucketMask] = index;
+    entry->older = -1;
+    entry->newer = -1;
+    if(newest == -1)
+    {
+        newest = oldest = index;
+    }
+    else
+    {
+        entry->older = newest;
+        entries[newest].newer = index;
+        newest = index;
+    }
+    return index;
+}
+
+/**
+ * closes the file of an entry, and frees it.
+ *
+ * @function   remove_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void remove_entry(int index)
+ *
+ * @param      index index of the entry.
+ */
+static void remove_entry(int index)
+{
+    CacheEntry* entry = &entries[index];
+    int* link = &buckets[entry->hash & bucketMask];
+
+    while(*link != index)
+    {
+        link = &entries[*link].next;
+    }
+    *link = entry->next;
+    unlink_lru(index);
+
+    close(entry->fd);
+    entry->fd = -1;
+    entry->next = freeList;
+    freeList = index;
+    release_watch(entry->watch);
+}
+
+/**
+ * moves an entry to the front of the LRU list.
+ *
+ * @function   touch_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void touch_entry(int index)
+ *
+ * @param      index index of the entry.
+ */
+static void touch_entry(int index)
+{
+    if(newest == index)
+    {
+        return;
+    }
+    unlink_lru(index);
+    entries[index].older = newest;
+    entries[index].newer = -1;
+    if(newest != -1)
+    {
+        entries[newest].newer = index;
+    }
+    newest = index;
+    if(oldest == -1)
+    {
+        oldest = index;
+    }
+}
+
+/**
+ * takes an entry out of the LRU list.
+ *
+ * @function   unlink_lru
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void unlink_lru(int index)
+ *
+ * @param      index index of the entry.
+ */
+static void unlink_lru(int index)
+{
+    CacheEntry* entry = &entries[index];
+
+    if(entry->older != -1)
+    {
+        entries[entry->older].newer = entry->newer;
+    }
+    else
+    {
+        oldest = entry->newer;
+    }
+    if(entry->newer != -1)
+    {
+        entries[entry->newer].older = entry->older;
+    }
+    else
+    {
+        newest = entry->older;
+    }
+    entry->older = -1;
+    entry->newer = -1;
+}
+
+/**
+ * removes an inotify watch, unless an entry still uses it.
+ *
+ * @function   release_watch
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * inotify hands out the same watch for every path leading to the same file.
+ *
+ * @signature  static void release_watch(int watch)
+ *
+ * @param      watch watch descriptor to remove.
+ */
+static void release_watch(int watch)
+{
+    bool watched = false;
+    int i;
+
+    for(i = 0; i < slotCount && !watched; ++i)
+    {
+        watched = entries[i].fd != -1 && entries[i].watch == watch;
+    }
+    if(!watched)
+    {
+        inotify_rm_watch(inotifyFd, watch);
+    }
+}
+
+/**
+ * hashes a file path with 32-bit FNV-1a.
+ *
+ * @function   hash_path
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static unsigned int hash_path(const char* filePath)
+ *
+ * @param      filePath path to hash.
+ *
+ * @return     hash of the path.
+ */
+static unsigned int hash_path(const char* filePath)
+{
+    unsigned int hash = 2166136261u;
+
+    while(*filePath != '\0')
+    {
+        hash = (hash ^ (unsigned char) *filePath++) * 16777619u;
+    }
+    return hash;
+}
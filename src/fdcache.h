@@ -0,0 +1,38 @@
+/**
+ * header file for fdcache.c, exposing its interface.
+ *
+ * @sourceFile fdcache.h
+ *
+ * @program    server.out
+ *
+ * @function   int fdcache_init(int capacity);
+ * @function   int fdcache_open(const char* filePath, struct stat* info);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef FDCACHE_H
+#define FDCACHE_H
+
+#include <sys/stat.h>
+
+/* default number of open files kept by the server */
+#define FDCACHE_DEFAULT_CAPACITY 1024
+
+/* file descriptors left over for everything else when raising the limit */
+#define FDCACHE_SPARE_FDS 64
+
+/**
+ * function prototypes
+ */
+int fdcache_init(int capacity);
+int fdcache_open(const char* filePath, struct stat* info);
+
+#endif
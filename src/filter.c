@@ -0,0 +1,521 @@
+/**
+ * sends only the part of a file that passes the filter of the request; a
+ *   range of bytes, and of them, the lines that contain a pattern.
+ *
+ * @sourceFile filter.c
+ *
+ * @program    server.out
+ *
+ * @function   int filter_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter, const FilterSpec* spec)
+ * @function   static void set_pattern(const char* pattern)
+ * @function   static void scan_lines(char* text, size_t len, bool last)
+ * @function   static const char* find_pattern(const char* hay, size_t len)
+ * @function   static void send_bytes(const char* data, size_t len)
+ * @function   static void flush_data(void)
+ * @function   static long long cpu_now_ns(void)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a client that only wants a few lines of a huge log would otherwise pull
+ *   the whole file through the message queue, and throw most of it away.
+ *   the session scans the file in blocks of FILTER_READ_LEN bytes instead,
+ *   and packs the lines that match into data messages; only whole lines are
+ *   scanned, the partial line at the end of a block is carried over to the
+ *   next.
+ *
+ * the pattern is found without looking at every line. with AVX2 or SSE2,
+ *   the first & last bytes of the pattern are compared against 32 or 16
+ *   positions at once, and only the positions where both match are compared
+ *   in full; the line around a match is then found with memchr & memrchr,
+ *   which the C library vectorizes. anchors are folded into the pattern as
+ *   the newline before or after it, so they cost nothing extra; the block is
+ *   preceded by a newline, so the first line of the range matches ^ too.
+ *
+ * the bytes scanned, and the cpu time that the session spent on them,
+ *   reading, matching & sending included, are counted in the server's
+ *   statistics, to tell the cost of filtering per gigabyte.
+ */
+#define _GNU_SOURCE
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "filter.h"
+#include "clockhelper.h"
+#include "serverstats.h"
+#include "chunkctl.h"
+
+/* function prototypes */
+static void set_pattern(const char*);
+static void scan_lines(char*, size_t, bool);
+static const char* find_pattern(const char*, size_t);
+static void send_bytes(const char*, size_t);
+static void flush_data(void);
+static long long cpu_now_ns(void);
+
+/* where the matching lines are sent */
+static int queueId;
+static long destType;
+static ChunkCtl chunk;
+static int clientPriority;
+static RateLimiter* rateLimiter;
+
+/* literal that is searched for, with the newline of each anchor in it; an
+ *   empty one passes every byte */
+static char needle[MAX_FILTER_PATTERN_LEN];
+static size_t needleLen = 0;
+static bool anchorStart = false;
+static bool anchorEnd = false;
+
+/* block of the file; a newline, the scanned bytes, and room for the newline
+ *   that the last line of the file may lack */
+static char buf[FILTER_READ_LEN + 2];
+
+/* data message that the matching lines are packed into */
+static Message dataMsg;
+
+/**
+ * sends the lines of a file that pass the filter.
+ *
+ * @function   filter_send
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a range that starts within a line scans it from there on, and one that
+ *   ends within a line scans it up to there.
+ *
+ * @signature  int filter_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter, const FilterSpec* spec)
+ *
+ * @param      msgQId id of the message queue to use.
+ * @param      clientType message type that the client receives messages with.
+ * @param      fd file descriptor of the file to scan.
+ * @param      priority priority of the client; the size of data messages
+ *   is chosen the same way as for a plain transfer.
+ * @param      limiter pointer to the rate limiter of the client.
+ * @param      spec pointer to the filter of the request.
+ *
+ * @return     0 upon success; -1 if the file could not be read.
+ */
+int filter_send(int msgQId, long clientType, int fd, int priority,
+    RateLimiter* limiter, const FilterSpec* spec)
+{
+    ServerStats* stats = stats_get();
+    struct stat st;
+    long long pos;
+    long long end;
+    long long cpuLast;
+    long long cpuNow;
+    size_t have = 0;
+
+    queueId = msgQId;
+    destType = clientType;
+    clientPriority = priority;
+    rateLimiter = limiter;
+    chunk_ctl_init(&chunk, msgQId, priority);
+    dataMsg.dataType = MSG_DATA_DATA;
+    dataMsg.data.dataMsg.len = 0;
+    set_pattern(spec->pattern);
+
+    if(fstat(fd, &st) < 0)
+    {
+        return -1;
+    }
+    end = (spec->end > 0 && spec->end < st.st_size) ? spec->end : st.st_size;
+    pos = (spec->start > 0) ? spec->start : 0;
+
+    atomic_fetch_add(&stats->filterSessions, 1);
+    cpuLast = cpu_now_ns();
+    buf[0] = '\n';
+
+    while(pos < end)
+    {
+        size_t want = FILTER_READ_LEN - have;
+        ssize_t nRead;
+        size_t len;
+        size_t scanLen;
+        char* lastLine;
+
+        if((long long) want > end - pos)
+        {
+            want = end - pos;
+        }
+        nRead = pread(fd, buf + 1 + have, want, pos);
+        if(nRead < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        /* a file that shrank ends the range where it ends now */
+        if(nRead == 0)
+        {
+            end = pos;
+        }
+        pos += nRead;
+        len = have + nRead;
+
+        /* only scan whole lines, unless it is the last of the range, or the
+         *   line fills the whole block */
+        lastLine = memrchr(buf + 1 + have, '\n', nRead);
+        if(pos >= end || (lastLine == 0 && len == FILTER_READ_LEN))
+        {
+            scanLen = len;
+        }
+        else if(lastLine != 0)
+        {
+            scanLen = lastLine + 1 - (buf + 1);
+        }
+        else
+        {
+            have = len;
+            continue;
+        }
+        scan_lines(buf + 1, scanLen, pos >= end);
+        flush_data();
+        have = len - scanLen;
+        memmove(buf + 1, buf + 1 + scanLen, have);
+
+        cpuNow = cpu_now_ns();
+        atomic_fetch_add_explicit(&stats->filterScannedBytes, scanLen,
+            memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->filterCpuNs, cpuNow - cpuLast,
+            memory_order_relaxed);
+        cpuLast = cpuNow;
+    }
+    return 0;
+}
+
+/**
+ * turns the pattern of a filter into the literal to search for.
+ *
+ * @function   set_pattern
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * ^ becomes the newline before the line, and $ the newline after it; a
+ *   pattern of just ^ or $ matches every line.
+ *
+ * @signature  static void set_pattern(const char* pattern)
+ *
+ * @param      pattern pointer to the pattern; it need not be terminated if
+ *   it is MAX_FILTER_PATTERN_LEN bytes long.
+ */
+static void set_pattern(const char* pattern)
+{
+    size_t len = strnlen(pattern, MAX_FILTER_PATTERN_LEN);
+
+    anchorStart = len > 0 && pattern[0] == '^';
+    anchorEnd = len > (anchorStart ? 1u : 0u) && pattern[len - 1] == '$';
+    needleLen = 0;
+    if(anchorStart)
+    {
+        needle[needleLen++] = '\n';
+        ++pattern;
+        --len;
+    }
+    if(anchorEnd)
+    {
+        --len;
+    }
+    memcpy(needle + needleLen, pattern, len);
+    needleLen += len;
+    if(anchorEnd)
+    {
+        needle[needleLen++] = '\n';
+    }
+}
+
+/**
+ * sends the lines among the scanned bytes that contain the pattern.
+ *
+ * @function   scan_lines
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the byte before text must be a newline, and the one after it writable; a
+ *   last line without a newline is lent one while it is matched, but sent
+ *   without it.
+ *
+ * @signature  static void scan_lines(char* text, size_t len, bool last)
+ *
+ * @param      text pointer to the first byte to scan; the start of a line.
+ * @param      len number of bytes to scan; they end with a newline, unless
+ *   last is set, or a line is longer than FILTER_READ_LEN.
+ * @param      last true if these are the last bytes of the range.
+ */
+static void scan_lines(char* text, size_t len, bool last)
+{
+    const char* end = text + len;
+    const char* hayEnd = end;
+    const char* pos = text;
+
+    if(needleLen == 0)
+    {
+        send_bytes(text, len);
+        return;
+    }
+    if(last && anchorEnd && len > 0 && end[-1] != '\n')
+    {
+        text[len] = '\n';
+        ++hayEnd;
+    }
+
+    while(pos < end)
+    {
+        const char* from = anchorStart ? pos - 1 : pos;
+        const char* match = find_pattern(from, hayEnd - from);
+        const char* lineStart;
+        const char* lineEnd;
+
+        if(match == 0)
+        {
+            break;
+        }
+
+        /* send the whole line around the match */
+        if(anchorStart)
+        {
+            lineStart = match + 1;
+        }
+        else
+        {
+            lineStart = memrchr(pos, '\n', match - pos);
+            lineStart = (lineStart != 0) ? lineStart + 1 : pos;
+        }
+        if(lineStart >= end)
+        {
+            break;
+        }
+        lineEnd = memchr(lineStart, '\n', end - lineStart);
+        lineEnd = (lineEnd != 0) ? lineEnd + 1 : end;
+        send_bytes(lineStart, lineEnd - lineStart);
+        pos = lineEnd;
+    }
+}
+
+/**
+ * finds the first occurrence of the pattern.
+ *
+ * @function   find_pattern
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * with AVX2 or SSE2, every position is first checked for the first & the
+ *   last byte of the pattern, a vector at a time, which rules out nearly all
+ *   of them; the rest, and the tail, are checked byte by byte.
+ *
+ * @signature  static const char* find_pattern(const char* hay, size_t len)
+ *
+ * @param      hay pointer to the first byte to search.
+ * @param      len number of bytes to search.
+ *
+ * @return     pointer to the first byte of the first occurrence; 0 if there
+ *   is none.
+ */
+static const char* find_pattern(const char* hay, size_t len)
+{
+    size_t last = needleLen - 1;
+    size_t i = 0;
+
+#ifdef __AVX2__
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i final = _mm256_set1_epi8(needle[last]);
+    for(; i + last + 32 <= len; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (hay + i + last));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+            _mm256_cmpeq_epi8(b, final)));
+        for(; mask != 0; mask &= mask - 1)
+        {
+            size_t at = i + __builtin_ctz(mask);
+            if(memcmp(hay + at, needle, needleLen) == 0)
+            {
+                return hay + at;
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i final = _mm_set1_epi8(needle[last]);
+    for(; i + last + 16 <= len; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*) (hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i*) (hay + i + last));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first),
+            _mm_cmpeq_epi8(b, final)));
+        for(; mask != 0; mask &= mask - 1)
+        {
+            size_t at = i + __builtin_ctz(mask);
+            if(memcmp(hay + at, needle, needleLen) == 0)
+            {
+                return hay + at;
+            }
+        }
+    }
+#endif
+
+    for(; i + needleLen <= len; ++i)
+    {
+        if(hay[i] == needle[0] && hay[i + last] == needle[last]
+            && memcmp(hay + i, needle, needleLen) == 0)
+        {
+            return hay + i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * adds bytes to the data message, sending it whenever it is full.
+ *
+ * @function   send_bytes
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void send_bytes(const char* data, size_t len)
+ *
+ * @param      data pointer to the first byte to send.
+ * @param      len number of bytes to send.
+ */
+static void send_bytes(const char* data, size_t len)
+{
+    while(len > 0)
+    {
+        size_t n = chunk.len - dataMsg.data.dataMsg.len;
+        if(n > len)
+        {
+            n = len;
+        }
+        memcpy(dataMsg.data.dataMsg.data + dataMsg.data.dataMsg.len, data, n);
+        dataMsg.data.dataMsg.len += n;
+        data += n;
+        len -= n;
+        if(dataMsg.data.dataMsg.len >= chunk.len)
+        {
+            flush_data();
+        }
+    }
+}
+
+/**
+ * sends the data message, if there is anything in it.
+ *
+ * @function   flush_data
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void flush_data(void)
+ */
+static void flush_data(void)
+{
+    int n = dataMsg.data.dataMsg.len;
+
+    if(n == 0)
+    {
+        return;
+    }
+    stats_first_byte();
+    rate_limit_wait(rateLimiter, n);
+    dataMsg.data.dataMsg.eventTime = clock_now_ns();
+    msg_send(queueId, &dataMsg, destType);
+    chunk_ctl_sent(&chunk, clock_now_ns() - dataMsg.sendTime);
+    stats_add_bytes(clientPriority, n);
+    atomic_fetch_add_explicit(&stats_get()->filterMatchedBytes, n,
+        memory_order_relaxed);
+    dataMsg.data.dataMsg.len = 0;
+}
+
+/**
+ * gets the cpu time that the process has used.
+ *
+ * @function   cpu_now_ns
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static long long cpu_now_ns(void)
+ *
+ * @return     cpu time of the process in nanoseconds.
+ */
+static long long cpu_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
@@ -0,0 +1,37 @@
+/**
+ * header file for filter.c, exposing its interface.
+ *
+ * @sourceFile filter.h
+ *
+ * @program    server.out
+ *
+ * @function   int filter_send(int msgQId, long clientType, int fd,
+ *   int priority, RateLimiter* limiter, const FilterSpec* spec);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "messagequeuehelper.h"
+#include "ratelimit.h"
+
+/* bytes of the file scanned at a time; also the longest line that is matched
+ *   as a whole */
+#define FILTER_READ_LEN (256 << 10)
+
+/**
+ * function prototypes
+ */
+int filter_send(int msgQId, long clientType, int fd, int priority,
+    RateLimiter* limiter, const FilterSpec* spec);
+
+#endif
@@ -0,0 +1,442 @@
+/**
+ * this file contains a log-linear histogram, used to record latencies, and
+ *   report their percentiles.
+ *
+ * @sourceFile histogram.c
+ *
+ * @program    server.out, client.out
+ *
+ * @function   void histogram_init(Histogram* hist)
+ * @function   void histogram_record(Histogram* hist, long long value)
+ * @function   long long histogram_percentile(Histogram* hist, double pct)
+ * @function   void histogram_print_summary(Histogram* hist, FILE* file,
+ *   const char* name)
+ * @function   void histogram_print_buckets(Histogram* hist, FILE* file)
+ * @function   void histogram_dump(Histogram* hist, FILE* file,
+ *   const char* name)
+ * @function   static int bucket_index(long long value)
+ * @function   static long long bucket_low(int index)
+ * @function   static long long bucket_high(int index)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * values below HISTOGRAM_SUB_COUNT get a bucket each. above that, each power
+ *   of two range [2^e, 2^(e+1)) is split into HISTOGRAM_SUB_COUNT buckets of
+ *   equal width, like an HDR histogram with a fixed number of significant
+ *   bits.
+ */
+#include <limits.h>
+#include "histogram.h"
+#include "clockhelper.h"
+
+/* function prototypes */
+static int bucket_index(long long value);
+static long long bucket_low(int index);
+static long long bucket_high(int index);
+
+/**
+ * empties the histogram.
+ *
+ * @function   histogram_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void histogram_init(Histogram* hist)
+ *
+ * @param      hist pointer to the histogram to initialize.
+ */
+void histogram_init(Histogram* hist)
+{
+    int i;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        atomic_init(&hist->counts[i], 0);
+    }
+    atomic_init(&hist->total, 0);
+    atomic_init(&hist->sum, 0);
+    atomic_init(&hist->min, LLONG_MAX);
+    atomic_init(&hist->max, 0);
+}
+
+/**
+ * adds a value to the histogram.
+ *
+ * @function   histogram_record
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * negative values (e.g. from timestamps taken out of order) are recorded as
+ *   zero.
+ *
+ * @signature  void histogram_record(Histogram* hist, long long value)
+ *
+ * @param      hist pointer to the histogram to record into.
+ * @param      value value to record.
+ */
+void histogram_record(Histogram* hist, long long value)
+{
+    long long seen;
+
+    if(value < 0)
+    {
+        value = 0;
+    }
+
+    atomic_fetch_add_explicit(&hist->counts[bucket_index(value)], 1,
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum, value, memory_order_relaxed);
+
+    seen = atomic_load_explicit(&hist->min, memory_order_relaxed);
+    while(value < seen && !atomic_compare_exchange_weak_explicit(&hist->min,
+        &seen, value, memory_order_relaxed, memory_order_relaxed));
+
+    seen = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while(value > seen && !atomic_compare_exchange_weak_explicit(&hist->max,
+        &seen, value, memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * returns the value below which the passed percentage of recorded values
+ *   fall.
+ *
+ * @function   histogram_percentile
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the result is the upper bound of the bucket that holds the percentile,
+ *   clamped to the largest recorded value, so it never under-reports.
+ *
+ * @signature  long long histogram_percentile(Histogram* hist, double pct)
+ *
+ * @param      hist pointer to the histogram to query.
+ * @param      pct percentile to look up, between 0 and 100.
+ *
+ * @return     value at the percentile; 0 if the histogram is empty.
+ */
+long long histogram_percentile(Histogram* hist, double pct)
+{
+    unsigned long long total = atomic_load(&hist->total);
+    unsigned long long rank = (unsigned long long) (total * pct / 100.0 + 0.5);
+    unsigned long long seen = 0;
+    long long max = atomic_load(&hist->max);
+    int i;
+
+    if(total == 0)
+    {
+        return 0;
+    }
+    if(rank < 1)
+    {
+        rank = 1;
+    }
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += atomic_load_explicit(&hist->counts[i], memory_order_relaxed);
+        if(seen >= rank)
+        {
+            return bucket_high(i) < max ? bucket_high(i) : max;
+        }
+    }
+
+    return max;
+}
+
+/**
+ * prints a one line summary of the histogram, in microseconds.
+ *
+ * @function   histogram_print_summary
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void histogram_print_summary(Histogram* hist, FILE* file,
+ *   const char* name)
+ *
+ * @param      hist pointer to the histogram to print; values in nanoseconds.
+ * @param      file stream to print to.
+ * @param      name label printed in front of the summary.
+ */
+void histogram_print_summary(Histogram* hist, FILE* file, const char* name)
+{
+    unsigned long long total = atomic_load(&hist->total);
+    double us = NS_PER_US;
+
+    if(total == 0)
+    {
+        fprintf(file, "%s: count=0\n", name);
+        return;
+    }
+
+    fprintf(file, "%s: count=%llu min=%.1fus mean=%.1fus p50=%.1fus "
+        "p90=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n", name, total,
+        atomic_load(&hist->min) / us,
+        (double) atomic_load(&hist->sum) / total / us,
+        histogram_percentile(hist, 50.0) / us,
+        histogram_percentile(hist, 90.0) / us,
+        histogram_percentile(hist, 99.0) / us,
+        histogram_percentile(hist, 99.9) / us,
+        atomic_load(&hist->max) / us);
+}
+
+/**
+ * prints the distribution of the histogram, one line per power of two, in
+ *   microseconds.
+ *
+ * @function   histogram_print_buckets
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * ranges with no values before the first, or after the last recorded value
+ *   are left out.
+ *
+ * @signature  void histogram_print_buckets(Histogram* hist, FILE* file)
+ *
+ * @param      hist pointer to the histogram to print; values in nanoseconds.
+ * @param      file stream to print to.
+ */
+void histogram_print_buckets(Histogram* hist, FILE* file)
+{
+    unsigned long long total = atomic_load(&hist->total);
+    unsigned long long seen = 0;
+    double us = NS_PER_US;
+    int first;
+    int i;
+
+    if(total == 0)
+    {
+        return;
+    }
+
+    /* find the first power of two range holding any values */
+    for(first = 0; atomic_load(&hist->counts[first]) == 0; ++first);
+    first -= first % HISTOGRAM_SUB_COUNT;
+
+    for(i = first; i < HISTOGRAM_BUCKETS && seen < total;
+        i += HISTOGRAM_SUB_COUNT)
+    {
+        unsigned long long count = 0;
+        int j;
+
+        for(j = i; j < i + HISTOGRAM_SUB_COUNT; ++j)
+        {
+            count += atomic_load(&hist->counts[j]);
+        }
+        seen += count;
+
+        fprintf(file, "  [%12.1fus, %12.1fus] %10llu %6.2f%%\n",
+            bucket_low(i) / us, bucket_high(i + HISTOGRAM_SUB_COUNT - 1) / us,
+            count, 100.0 * seen / total);
+    }
+}
+
+/**
+ * prints the histogram on a single line, in a form that dumps of the same
+ *   histogram from other processes or runs can be merged with.
+ *
+ * @function   histogram_dump
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the line is
+ *
+ *   histogram <name> count=<n> sum=<ns> min=<ns> max=<ns> p50=<ns> p99=<ns>
+ *     p999=<ns> buckets=<low>:<count>,...
+ *
+ * where every non-empty bucket is listed by the lowest value it counts. the
+ *   bucket layout is fixed, so merging dumps is a matter of adding up the
+ *   counts of equal buckets; the percentiles are only there to be read.
+ *
+ * @signature  void histogram_dump(Histogram* hist, FILE* file,
+ *   const char* name)
+ *
+ * @param      hist pointer to the histogram to print; values in nanoseconds.
+ * @param      file stream to print to.
+ * @param      name name of the histogram; it should not contain spaces.
+ */
+void histogram_dump(Histogram* hist, FILE* file, const char* name)
+{
+    unsigned long long total = atomic_load(&hist->total);
+    char separator = '=';
+    int i;
+
+    fprintf(file, "histogram %s count=%llu sum=%llu min=%lld max=%lld "
+        "p50=%lld p99=%lld p999=%lld buckets", name, total,
+        atomic_load(&hist->sum), total ? atomic_load(&hist->min) : 0,
+        total ? atomic_load(&hist->max) : 0,
+        histogram_percentile(hist, 50.0), histogram_percentile(hist, 99.0),
+        histogram_percentile(hist, 99.9));
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        unsigned long long count = atomic_load(&hist->counts[i]);
+        if(count > 0)
+        {
+            fprintf(file, "%c%lld:%llu", separator, bucket_low(i), count);
+            separator = ',';
+        }
+    }
+    if(separator == '=')
+    {
+        fputc('=', file);
+    }
+    fputc('\n', file);
+}
+
+/**
+ * maps a value onto the index of the bucket that counts it.
+ *
+ * @function   bucket_index
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int bucket_index(long long value)
+ *
+ * @param      value non-negative value to map.
+ *
+ * @return     index of the bucket for the value.
+ */
+static int bucket_index(long long value)
+{
+    int exponent;
+
+    if(value < HISTOGRAM_SUB_COUNT)
+    {
+        return (int) value;
+    }
+
+    exponent = 63 - __builtin_clzll((unsigned long long) value);
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT
+        + (int) ((value >> (exponent - HISTOGRAM_SUB_BITS))
+        - HISTOGRAM_SUB_COUNT);
+}
+
+/**
+ * returns the smallest value counted by the bucket.
+ *
+ * @function   bucket_low
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static long long bucket_low(int index)
+ *
+ * @param      index index of the bucket.
+ *
+ * @return     smallest value that maps onto the bucket.
+ */
+static long long bucket_low(int index)
+{
+    int shift = index / HISTOGRAM_SUB_COUNT - 1;
+
+    if(shift < 0)
+    {
+        return index;
+    }
+    return (long long) (HISTOGRAM_SUB_COUNT + index % HISTOGRAM_SUB_COUNT)
+        << shift;
+}
+
+/**
+ * returns the largest value counted by the bucket.
+ *
+ * @function   bucket_high
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static long long bucket_high(int index)
+ *
+ * @param      index index of the bucket.
+ *
+ * @return     largest value that maps onto the bucket.
+ */
+static long long bucket_high(int index)
+{
+    int shift = index / HISTOGRAM_SUB_COUNT - 1;
+
+    if(shift < 0)
+    {
+        return index;
+    }
+    return bucket_low(index) + (1LL << shift) - 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * header file for histogram.c, exposing its interface.
+ *
+ * @sourceFile histogram.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   void histogram_init(Histogram* hist);
+ * @function   void histogram_record(Histogram* hist, long long value);
+ * @function   long long histogram_percentile(Histogram* hist, double pct);
+ * @function   void histogram_print_summary(Histogram* hist, FILE* file,
+ *   const char* name);
+ * @function   void histogram_print_buckets(Histogram* hist, FILE* file);
+ * @function   void histogram_dump(Histogram* hist, FILE* file,
+ *   const char* name);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+/**
+ * every power of two range of values is split into this many linear buckets,
+ *   so a recorded value is off by at most 1/32nd (about 3%).
+ */
+#define HISTOGRAM_SUB_BITS  5
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS   (HISTOGRAM_SUB_COUNT * (64 - HISTOGRAM_SUB_BITS + 1))
+
+/**
+ * log-linear histogram of non-negative values, usually durations in
+ *   nanoseconds. recording is lock-free, so any number of threads may record
+ *   into the same histogram at once.
+ */
+typedef struct
+{
+    _Atomic unsigned long long counts[HISTOGRAM_BUCKETS];
+    _Atomic unsigned long long total;
+    _Atomic unsigned long long sum;
+    _Atomic long long min;
+    _Atomic long long max;
+}
+Histogram;
+
+/**
+ * function prototypes
+ */
+void histogram_init(Histogram* hist);
+void histogram_record(Histogram* hist, long long value);
+long long histogram_percentile(Histogram* hist, double pct);
+void histogram_print_summary(Histogram* hist, FILE* file, const char* name);
+void histogram_print_buckets(Histogram* hist, FILE* file);
+void histogram_dump(Histogram* hist, FILE* file, const char* name);
+
+#endif
@@ -0,0 +1,968 @@
+/**
+ * load generator mode of the client program. it simulates many logical
+ *   clients inside a single process, and reports on how the server copes.
+ *
+ * @sourceFile loadgen.c
+ *
+ * @program    client.out
+ *
+ * @function   int loadgen_main(int argc, char** argv)
+ * @function   void loadgen_init_report(LoadReport* report, bool checksum)
+ * @function   int loadgen_add_tag(LoadReport* report, const char* name)
+ * @function   void loadgen_run(LoadConfig* config, LoadSource source,
+ *   void* sourceCtx, LoadReport* report)
+ * @function   void loadgen_print_report(LoadReport* report, FILE* file)
+ * @function   static bool parse_mix(char* arg, LoadMix* mix)
+ * @function   static bool poisson_next(void* sourceCtx, LoadRequest* req)
+ * @function   static void* client_loop(void* arg)
+ * @function   static bool next_pending(LoadClient* client, LoadRequest* req)
+ * @function   static void run_request(LoadClient* client, LoadRequest* req)
+ * @function   static void wait_for_idle(long long deadline)
+ * @function   static void abort_clients(void)
+ * @function   static void sigint_handler(int sigNum)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the load is open loop: requests arrive on their own schedule, whether or
+ *   not earlier ones have finished. when all logical clients are busy, new
+ *   requests wait for one to become free, and that wait is counted as part of
+ *   their latency, so a saturated server shows up as growing latencies
+ *   instead of a quietly reduced arrival rate.
+ *
+ * each logical client receives its messages with a message type of its own,
+ *   made of the process id in the low bits, and the client's number above
+ *   them.
+ */
+#include <string.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <ctype.h>
+#include <stdatomic.h>
+#include "loadgen.h"
+#include "clockhelper.h"
+#include "checksum.h"
+#include "shard.h"
+
+/* default parameters of a --load run */
+#define DEFAULT_CLIENTS  16
+#define DEFAULT_RATE     10.0
+#define DEFAULT_DURATION 10
+#define DEFAULT_GRACE    10
+
+/* most file & priority combinations in a mix */
+#define MAX_LOAD_MIX MAX_LOAD_TAGS
+
+/* how often wait_for_idle checks on the logical clients */
+#define IDLE_POLL_NS (10 * NS_PER_MS)
+
+/**
+ * one entry of the request mix; requests are made for the file with the
+ *   priority, in proportion to the weight.
+ */
+typedef struct
+{
+    int priority;
+    unsigned int weight;
+    char filePath[MAX_FILEPATH_LEN];
+}
+LoadMix;
+
+/**
+ * state of the poisson arrival process used by --load.
+ */
+typedef struct
+{
+    double rate;
+    int mixCount;
+    unsigned int totalWeight;
+    unsigned short rng[3];
+    long long next;
+    LoadMix mix[MAX_LOAD_MIX];
+}
+PoissonSource;
+
+/**
+ * a logical client; a thread that issues one request at a time.
+ */
+typedef struct
+{
+    long type;
+    pthread_t thread;
+    volatile int queueId;   /* queue of the shard serving the request */
+    volatile pid_t sessionPid;
+    atomic_bool busy;
+    atomic_bool aborted;
+}
+LoadClient;
+
+/* function prototypes */
+static bool parse_mix(char* arg, LoadMix* mix);
+static bool poisson_next(void* sourceCtx, LoadRequest* req);
+static void* client_loop(void* arg);
+static bool next_pending(LoadClient* client, LoadRequest* req);
+static void run_request(LoadClient* client, LoadRequest* req);
+static void wait_for_idle(long long deadline);
+static void abort_clients(void);
+static void sigint_handler(int sigNum);
+
+/* inter process communication globals */
+static int shardQIds[MAX_SHARDS];
+static int shardCount;
+static bool shardByLoad;
+
+/* state of the current run */
+static LoadReport* runReport;
+static LoadClient* clients;
+static int clientCount;
+static long long runStart;
+
+/* requests waiting for a free logical client */
+static LoadRequest* pending;
+static unsigned int pendingHead;
+static unsigned int pendingTail;
+static bool dispatchDone;
+static bool stopping;
+static pthread_mutex_t pendingLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pendingCond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * entry point of client.out --load. parses the command line, generates a
+ *   poisson arrival stream of requests from the mix, and prints the report.
+ *
+ * @function   loadgen_main
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * argv[0] is expected to be the "--load" argument, so that getopt skips it
+ *   like a program name.
+ *
+ * @signature  int loadgen_main(int argc, char** argv)
+ *
+ * @param      argc number of arguments, starting at "--load".
+ * @param      argv arguments, starting at "--load".
+ *
+ * @return     return code, indication the nature of process termination.
+ */
+int loadgen_main(int argc, char** argv)
+{
+    static PoissonSource source;
+    static LoadReport report;
+    LoadConfig config;
+    long seed = (long) getpid();
+    int opt;
+    int i;
+
+    config.clients  = DEFAULT_CLIENTS;
+    config.duration = DEFAULT_DURATION * NS_PER_S;
+    config.grace    = DEFAULT_GRACE * NS_PER_S;
+    config.checksum = false;
+    config.keySpec  = 0;
+    config.shards   = 1;
+    config.leastLoaded = false;
+    source.rate     = DEFAULT_RATE;
+
+    while((opt = getopt(argc, argv, "n:r:d:g:s:ck:S:b")) != -1)
+    {
+        switch(opt)
+        {
+        case 'n':
+            config.clients = atoi(optarg);
+            break;
+        case 'r':
+            source.rate = atof(optarg);
+            break;
+        case 'd':
+            config.duration = (long long) (atof(optarg) * NS_PER_S);
+            break;
+        case 'g':
+            config.grace = (long long) (atof(optarg) * NS_PER_S);
+            break;
+        case 's':
+            seed = atol(optarg);
+            break;
+        case 'c':
+            config.checksum = true;
+            break;
+        case 'k':
+            config.keySpec = optarg;
+            break;
+        case 'S':
+            config.shards = atoi(optarg);
+            break;
+        case 'b':
+            config.leastLoaded = true;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    /* verify command line arguments */
+    if(optind >= argc || argc - optind > MAX_LOAD_MIX || config.clients < 1
+        || source.rate <= 0 || config.shards < 1 || config.shards > MAX_SHARDS)
+    {
+        printf("usage: client.out --load [-n clients] [-r requests/s] "
+            "[-d seconds] [-g grace seconds] [-s seed] [-c] [-k key] "
+            "[-S shards [-b]] priority:[weight:]filepath...\n");
+        exit(0);
+    }
+
+    /* parse the request mix */
+    loadgen_init_report(&report, config.checksum);
+    source.mixCount = 0;
+    source.totalWeight = 0;
+    for(i = optind; i < argc; ++i)
+    {
+        LoadMix* mix = &source.mix[source.mixCount++];
+        if(!parse_mix(argv[i], mix))
+        {
+            fprintf(stderr, "bad mix entry: %s\n", argv[i]);
+            exit(1);
+        }
+        source.totalWeight += mix->weight;
+        loadgen_add_tag(&report, argv[i]);
+    }
+
+    /* seed the arrival process */
+    source.rng[0] = 0x330e;
+    source.rng[1] = (unsigned short) seed;
+    source.rng[2] = (unsigned short) (seed >> 16);
+    source.next = 0;
+
+    /* run the load & report on it */
+    loadgen_run(&config, poisson_next, &source, &report);
+    loadgen_print_report(&report, stdout);
+
+    return 0;
+}
+
+/**
+ * resets the report, ready to be filled by loadgen_run.
+ *
+ * @function   loadgen_init_report
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void loadgen_init_report(LoadReport* report, bool checksum)
+ *
+ * @param      report pointer to the report to initialize.
+ * @param      checksum true if the run checksums its output.
+ */
+void loadgen_init_report(LoadReport* report, bool checksum)
+{
+    pthread_mutex_init(&report->lock, 0);
+    report->elapsed   = 0;
+    report->scheduled = 0;
+    report->completed = 0;
+    report->failed    = 0;
+    report->dropped   = 0;
+    report->unstarted = 0;
+    report->aborted   = 0;
+    report->bytes     = 0;
+    report->checksum  = checksum;
+    report->tagCount  = 0;
+    histogram_init(&report->latency);
+    histogram_init(&report->service);
+    histogram_init(&report->firstByte);
+    histogram_init(&report->wait);
+}
+
+/**
+ * adds a request class to the report.
+ *
+ * @function   loadgen_add_tag
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int loadgen_add_tag(LoadReport* report, const char* name)
+ *
+ * @param      report pointer to the report to add the class to.
+ * @param      name name the class is reported under.
+ *
+ * @return     tag to give the requests of the class; -1 if the report can
+ *   not hold any more classes.
+ */
+int loadgen_add_tag(LoadReport* report, const char* name)
+{
+    LoadTagReport* tag;
+
+    if(report->tagCount >= MAX_LOAD_TAGS)
+    {
+        return -1;
+    }
+
+    tag = &report->tags[report->tagCount];
+    snprintf(tag->name, sizeof(tag->name), "%s", name);
+    tag->completed   = 0;
+    tag->failed      = 0;
+    tag->bytes       = 0;
+    tag->checksumSet = false;
+    tag->checksum    = 0;
+    tag->mismatches  = 0;
+    histogram_init(&tag->latency);
+
+    return report->tagCount++;
+}
+
+/**
+ * issues the requests produced by the source with the configured number of
+ *   logical clients, and records the results into the report.
+ *
+ * @function   loadgen_run
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the calling thread dispatches the requests at their arrival times. once
+ *   the source runs dry, or the duration is over, outstanding requests get
+ *   the grace period to finish; after that, requests that never started are
+ *   counted as unstarted, and ones still in progress are aborted.
+ *
+ * @signature  void loadgen_run(LoadConfig* config, LoadSource source,
+ *   void* sourceCtx, LoadReport* report)
+ *
+ * @param      config parameters of the run.
+ * @param      source function producing the requests to issue.
+ * @param      sourceCtx state passed to source.
+ * @param      report pointer to the report to record results into.
+ */
+void loadgen_run(LoadConfig* config, LoadSource source, void* sourceCtx,
+    LoadReport* report)
+{
+    LoadRequest req;
+    int i;
+
+    runReport = report;
+    clientCount = config->clients;
+
+    /* get the message queues of the server shards. */
+    shardCount = config->shards;
+    shardByLoad = config->leastLoaded;
+    if(shard_open(config->keySpec, shardCount, shardQIds) == 0)
+    {
+        fprintf(stderr, "no server on message queue\n");
+        exit(1);
+    }
+
+    /* allocate the logical clients and the pending request queue */
+    clients = calloc(clientCount, sizeof(LoadClient));
+    pending = malloc(MAX_LOAD_PENDING * sizeof(LoadRequest));
+    if(clients == 0 || pending == 0)
+    {
+        fprintf(stderr, "failed to allocate load generator state\n");
+        exit(1);
+    }
+    pendingHead = pendingTail = 0;
+    dispatchDone = stopping = false;
+
+    /* sessions of the logical clients are told to clean up on interrupt */
+    signal(SIGINT, sigint_handler);
+
+    /* start the logical clients */
+    for(i = 0; i < clientCount; ++i)
+    {
+        clients[i].type = ((long) (i + 1) << 32) | getpid();
+        clients[i].queueId = -1;
+        clients[i].sessionPid = 0;
+        atomic_init(&clients[i].busy, false);
+        atomic_init(&clients[i].aborted, false);
+        pthread_create(&clients[i].thread, 0, client_loop, &clients[i]);
+    }
+
+    /* dispatch requests at their arrival times */
+    runStart = clock_now_ns();
+    while(source(sourceCtx, &req) && req.arrival <= config->duration)
+    {
+        clock_sleep_until_ns(runStart + req.arrival);
+
+        pthread_mutex_lock(&pendingLock);
+        ++report->scheduled;
+        if(pendingTail - pendingHead < MAX_LOAD_PENDING)
+        {
+            pending[pendingTail++ % MAX_LOAD_PENDING] = req;
+            pthread_cond_signal(&pendingCond);
+        }
+        else
+        {
+            ++report->dropped;
+        }
+        pthread_mutex_unlock(&pendingLock);
+    }
+
+    /* let outstanding requests finish, then stop the logical clients */
+    pthread_mutex_lock(&pendingLock);
+    dispatchDone = true;
+    pthread_cond_broadcast(&pendingCond);
+    pthread_mutex_unlock(&pendingLock);
+
+    wait_for_idle(clock_now_ns() + config->grace);
+    abort_clients();
+
+    for(i = 0; i < clientCount; ++i)
+    {
+        pthread_join(clients[i].thread, 0);
+        if(clients[i].queueId >= 0)
+        {
+            msg_clear_type(clients[i].queueId, clients[i].type);
+        }
+    }
+    report->elapsed = clock_now_ns() - runStart;
+
+    signal(SIGINT, SIG_DFL);
+    free(pending);
+    free(clients);
+}
+
+/**
+ * prints the report of a run.
+ *
+ * @function   loadgen_print_report
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void loadgen_print_report(LoadReport* report, FILE* file)
+ *
+ * @param      report pointer to the report to print.
+ * @param      file stream to print to.
+ */
+void loadgen_print_report(LoadReport* report, FILE* file)
+{
+    double seconds = (double) report->elapsed / NS_PER_S;
+    int i;
+
+    fprintf(file, "requests: scheduled=%llu completed=%llu failed=%llu "
+        "dropped=%llu unstarted=%llu aborted=%llu\n", report->scheduled,
+        report->completed, report->failed, report->dropped,
+        report->unstarted, report->aborted);
+    fprintf(file, "elapsed: %.3fs offered=%.1freq/s achieved=%.1freq/s "
+        "throughput=%.3fMB/s\n", seconds, report->scheduled / seconds,
+        report->completed / seconds, report->bytes / seconds / 1e6);
+
+    histogram_print_summary(&report->latency, file, "latency");
+    histogram_print_buckets(&report->latency, file);
+    histogram_print_summary(&report->firstByte, file, "first byte");
+    histogram_print_summary(&report->service, file, "service");
+    histogram_print_summary(&report->wait, file, "client wait");
+
+    for(i = 0; i < report->tagCount; ++i)
+    {
+        LoadTagReport* tag = &report->tags[i];
+        fprintf(file, "class %s: completed=%llu failed=%llu bytes=%llu "
+            "p50=%.1fus p99=%.1fus", tag->name, tag->completed, tag->failed,
+            tag->bytes,
+            histogram_percentile(&tag->latency, 50.0) / (double) NS_PER_US,
+            histogram_percentile(&tag->latency, 99.0) / (double) NS_PER_US);
+        if(report->checksum)
+        {
+            fprintf(file, " adler32=%08x mismatches=%llu", tag->checksum,
+                tag->mismatches);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+/**
+ * parses a request mix entry of the form priority:[weight:]filepath.
+ *
+ * @function   parse_mix
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the weight defaults to 1. a second field is only taken as the weight if it
+ *   is all digits, and followed by another field.
+ *
+ * @signature  static bool parse_mix(char* arg, LoadMix* mix)
+ *
+ * @param      arg mix entry to parse.
+ * @param      mix pointer to the structure to parse it into.
+ *
+ * @return     true if the entry is well formed; false otherwise.
+ */
+static bool parse_mix(char* arg, LoadMix* mix)
+{
+    char* path = strchr(arg, ':');
+    char* rest;
+
+    if(path == 0)
+    {
+        return false;
+    }
+    mix->priority = atoi(arg);
+    mix->weight = 1;
+    ++path;
+
+    /* look for the optional weight */
+    rest = strchr(path, ':');
+    if(rest != 0 && rest != path)
+    {
+        char* digit = path;
+        while(digit < rest && isdigit((unsigned char) *digit))
+        {
+            ++digit;
+        }
+        if(digit == rest)
+        {
+            mix->weight = (unsigned int) atoi(path);
+            path = rest + 1;
+        }
+    }
+
+    if(mix->weight == 0 || strlen(path) == 0
+        || strlen(path) >= MAX_FILEPATH_LEN)
+    {
+        return false;
+    }
+    strcpy(mix->filePath, path);
+    return true;
+}
+
+/**
+ * request source of --load; produces requests with exponentially
+ *   distributed gaps between them, picking each from the mix by weight.
+ *
+ * @function   poisson_next
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool poisson_next(void* sourceCtx, LoadRequest* req)
+ *
+ * @param      sourceCtx pointer to the PoissonSource.
+ * @param      req pointer to the request to fill in.
+ *
+ * @return     true; the arrival process never runs dry.
+ */
+static bool poisson_next(void* sourceCtx, LoadRequest* req)
+{
+    PoissonSource* source = sourceCtx;
+    unsigned int pick;
+    int i;
+
+    source->next += (long long) (-log(1.0 - erand48(source->rng))
+        / source->rate * NS_PER_S);
+
+    pick = (unsigned int) (erand48(source->rng) * source->totalWeight);
+    for(i = 0; i < source->mixCount - 1; ++i)
+    {
+        if(pick < source->mix[i].weight)
+        {
+            break;
+        }
+        pick -= source->mix[i].weight;
+    }
+
+    req->arrival  = source->next;
+    req->priority = source->mix[i].priority;
+    req->tag      = i;
+    strcpy(req->filePath, source->mix[i].filePath);
+    return true;
+}
+
+/**
+ * threaded function. main loop of a logical client; it issues pending
+ *   requests one at a time until the run is over.
+ *
+ * @function   client_loop
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void* client_loop(void* arg)
+ *
+ * @param      arg pointer to the LoadClient this thread runs.
+ */
+static void* client_loop(void* arg)
+{
+    LoadClient* client = arg;
+    LoadRequest req;
+
+    while(next_pending(client, &req))
+    {
+        run_request(client, &req);
+        atomic_store(&client->busy, false);
+    }
+
+    pthread_exit(0);
+    return 0;
+}
+
+/**
+ * takes the oldest pending request, blocking until there is one.
+ *
+ * @function   next_pending
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the logical client is marked busy while the queue is still locked, so that
+ *   wait_for_idle never sees a request that is neither pending nor busy.
+ *
+ * @signature  static bool next_pending(LoadClient* client, LoadRequest* req)
+ *
+ * @param      client pointer to the logical client taking the request.
+ * @param      req pointer to the request to copy the pending request into.
+ *
+ * @return     true if a request was taken; false if the run is over.
+ */
+static bool next_pending(LoadClient* client, LoadRequest* req)
+{
+    bool taken = false;
+
+    pthread_mutex_lock(&pendingLock);
+    while(!stopping && pendingHead == pendingTail && !dispatchDone)
+    {
+        pthread_cond_wait(&pendingCond, &pendingLock);
+    }
+    if(!stopping && pendingHead != pendingTail)
+    {
+        *req = pending[pendingHead++ % MAX_LOAD_PENDING];
+        atomic_store(&client->busy, true);
+        taken = true;
+    }
+    pthread_mutex_unlock(&pendingLock);
+
+    return taken;
+}
+
+/**
+ * issues a single request, consumes its response, and records the result.
+ *
+ * @function   run_request
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - a single stream, without a window.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a request fails if the session sends a print message, which it only does
+ *   when something went wrong.
+ *
+ * @signature  static void run_request(LoadClient* client, LoadRequest* req)
+ *
+ * @param      client pointer to the logical client issuing the request.
+ * @param      req pointer to the request to issue.
+ */
+static void run_request(LoadClient* client, LoadRequest* req)
+{
+    Message msg;
+    long long arrival = runStart + req->arrival;
+    long long connected;
+    long long firstByte = 0;
+    unsigned long long bytes = 0;
+    uint32_t adler = ADLER32_INIT;
+    bool failed = false;
+    bool stopLoop = false;
+    LoadTagReport* tag = &runReport->tags[req->tag];
+
+    client->sessionPid = 0;
+    client->queueId = shardQIds[shard_choose(shardQIds, shardCount,
+        req->filePath, shardByLoad)];
+
+    /* send connection message to server */
+    msg.dataType = MSG_DATA_CONNECT;
+    msg.data.connectMsg.clientPid  = getpid();
+    msg.data.connectMsg.clientType = client->type;
+    msg.data.connectMsg.priority   = req->priority;
+    msg.data.connectMsg.flags      = 0;
+    msg.data.connectMsg.streamId   = 0;
+    msg.data.connectMsg.window     = 0;
+    strcpy(msg.data.connectMsg.filePath, req->filePath);
+    connected = clock_now_ns();
+    msg_send(client->queueId, &msg, MSGQ_SVR_T);
+
+    /* get messages from the session until stop */
+    while(!stopLoop)
+    {
+        if(msg_recv(client->queueId, &msg, client->type) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+        switch(msg.dataType)
+        {
+        case MSG_DATA_DATA:
+            if(firstByte == 0)
+            {
+                firstByte = clock_now_ns();
+            }
+            bytes += msg.data.dataMsg.len;
+            if(runReport->checksum)
+            {
+                adler = adler32_update(adler, msg.data.dataMsg.data,
+                    msg.data.dataMsg.len);
+            }
+            break;
+        case MSG_DATA_PID:
+            client->sessionPid = msg.data.pidMsg.pid;
+            break;
+        case MSG_DATA_STOPCLNT:
+            stopLoop = true;
+            break;
+        default:
+            failed = true;
+            break;
+        }
+    }
+
+    /* an aborted request is neither a success nor a failure */
+    if(atomic_load(&client->aborted))
+    {
+        if(client->sessionPid != 0)
+        {
+            kill(client->sessionPid, SIGUSR1);
+        }
+        pthread_mutex_lock(&runReport->lock);
+        ++runReport->aborted;
+        pthread_mutex_unlock(&runReport->lock);
+        return;
+    }
+
+    /* record the result */
+    if(!failed)
+    {
+        long long done = clock_now_ns();
+        histogram_record(&runReport->latency, done - arrival);
+        histogram_record(&runReport->service, done - connected);
+        histogram_record(&runReport->firstByte, firstByte - arrival);
+        histogram_record(&runReport->wait, connected - arrival);
+        histogram_record(&tag->latency, done - arrival);
+    }
+
+    pthread_mutex_lock(&runReport->lock);
+    if(failed)
+    {
+        ++runReport->failed;
+        ++tag->failed;
+    }
+    else
+    {
+        ++runReport->completed;
+        ++tag->completed;
+        runReport->bytes += bytes;
+        tag->bytes += bytes;
+        if(runReport->checksum && !tag->checksumSet)
+        {
+            tag->checksum = adler;
+            tag->checksumSet = true;
+        }
+        else if(runReport->checksum && tag->checksum != adler)
+        {
+            ++tag->mismatches;
+        }
+    }
+    pthread_mutex_unlock(&runReport->lock);
+}
+
+/**
+ * blocks until no requests are pending or in progress, or until the
+ *   deadline passes.
+ *
+ * @function   wait_for_idle
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void wait_for_idle(long long deadline)
+ *
+ * @param      deadline point in time to give up waiting at.
+ */
+static void wait_for_idle(long long deadline)
+{
+    bool idle = false;
+
+    while(!idle && clock_now_ns() < deadline)
+    {
+        int i;
+
+        pthread_mutex_lock(&pendingLock);
+        idle = (pendingHead == pendingTail);
+        pthread_mutex_unlock(&pendingLock);
+
+        for(i = 0; idle && i < clientCount; ++i)
+        {
+            idle = !atomic_load(&clients[i].busy);
+        }
+
+        if(!idle)
+        {
+            clock_sleep_until_ns(clock_now_ns() + IDLE_POLL_NS);
+        }
+    }
+}
+
+/**
+ * stops all logical clients; pending requests are dropped, and requests in
+ *   progress are aborted.
+ *
+ * @function   abort_clients
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a busy logical client is blocked in msgrcv, so it is woken up with a stop
+ *   message of its own type; it then tells its session to clean up. stop
+ *   messages that arrive after their client went idle are cleared by
+ *   loadgen_run.
+ *
+ * @signature  static void abort_clients(void)
+ */
+static void abort_clients(void)
+{
+    Message stopMsg;
+    int i;
+
+    pthread_mutex_lock(&pendingLock);
+    stopping = true;
+    runReport->unstarted += pendingTail - pendingHead;
+    pendingHead = pendingTail;
+    pthread_cond_broadcast(&pendingCond);
+    pthread_mutex_unlock(&pendingLock);
+
+    stopMsg.dataType = MSG_DATA_STOPCLNT;
+    for(i = 0; i < clientCount; ++i)
+    {
+        if(atomic_load(&clients[i].busy))
+        {
+            atomic_store(&clients[i].aborted, true);
+            msg_send(clients[i].queueId, &stopMsg, clients[i].type);
+        }
+    }
+}
+
+/**
+ * interrupt handler of the load generator. it tells the sessions of all
+ *   logical clients to clean up, and exits.
+ *
+ * @function   sigint_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void sigint_handler(int sigNum)
+ *
+ * @param      sigNum signal number that is invoking this function. this will
+ *   always be SIGINT.
+ */
+static void sigint_handler(int sigNum)
+{
+    int i;
+
+    for(i = 0; i < clientCount; ++i)
+    {
+        if(clients[i].sessionPid != 0)
+        {
+            kill(clients[i].sessionPid, SIGUSR1);
+        }
+    }
+
+    exit(sigNum);
+}
@@ -0,0 +1,124 @@
+/**
+ * header file for loadgen.c, exposing its interface.
+ *
+ * @sourceFile loadgen.h
+ *
+ * @program    client.out
+ *
+ * @function   int loadgen_main(int argc, char** argv);
+ * @function   void loadgen_init_report(LoadReport* report, bool checksum);
+ * @function   int loadgen_add_tag(LoadReport* report, const char* name);
+ * @function   void loadgen_run(LoadConfig* config, LoadSource source,
+ *   void* sourceCtx, LoadReport* report);
+ * @function   void loadgen_print_report(LoadReport* report, FILE* file);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "messagequeuehelper.h"
+#include "histogram.h"
+
+/* most request classes (e.g. file & priority mixes) that are reported on */
+#define MAX_LOAD_TAGS 32
+
+/* most requests that may be waiting for a free logical client */
+#define MAX_LOAD_PENDING 65536
+
+/**
+ * a single request issued by the load generator.
+ */
+typedef struct
+{
+    long long arrival;      /* ns after the start of the run to issue it at */
+    int priority;
+    int tag;                /* request class it is reported under */
+    char filePath[MAX_FILEPATH_LEN];
+}
+LoadRequest;
+
+/**
+ * produces the requests of a run, in order of arrival. returns false when
+ *   there are no more requests.
+ */
+typedef bool (*LoadSource)(void* sourceCtx, LoadRequest* req);
+
+/**
+ * parameters of a load generator run.
+ */
+typedef struct
+{
+    int clients;            /* number of logical clients in the process */
+    long long duration;     /* no requests arrive after this many ns */
+    long long grace;        /* ns to wait for outstanding requests after */
+    bool checksum;          /* checksum output instead of discarding it */
+    const char* keySpec;    /* message queue key of the server; 0 for default */
+    int shards;             /* number of server shards on the key */
+    bool leastLoaded;       /* pick shards by load instead of by file path */
+}
+LoadConfig;
+
+/**
+ * results for a single request class.
+ */
+typedef struct
+{
+    char name[MAX_FILEPATH_LEN + 16];
+    unsigned long long completed;
+    unsigned long long failed;
+    unsigned long long bytes;
+    bool checksumSet;
+    uint32_t checksum;      /* checksum of the first completed request */
+    unsigned long long mismatches;
+    Histogram latency;
+}
+LoadTagReport;
+
+/**
+ * results of a load generator run.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    long long elapsed;
+    unsigned long long scheduled;
+    unsigned long long completed;
+    unsigned long long failed;
+    unsigned long long dropped;
+    unsigned long long unstarted;
+    unsigned long long aborted;
+    unsigned long long bytes;
+    bool checksum;
+    Histogram latency;      /* arrival to last byte */
+    Histogram service;      /* connect message to last byte */
+    Histogram firstByte;    /* arrival to first byte */
+    Histogram wait;         /* arrival to connect message */
+    int tagCount;
+    LoadTagReport tags[MAX_LOAD_TAGS];
+}
+LoadReport;
+
+/**
+ * function prototypes
+ */
+int loadgen_main(int argc, char** argv);
+void loadgen_init_report(LoadReport* report, bool checksum);
+int loadgen_add_tag(LoadReport* report, const char* name);
+void loadgen_run(LoadConfig* config, LoadSource source, void* sourceCtx,
+    LoadReport* report);
+void loadgen_print_report(LoadReport* report, FILE* file);
+
+#endif
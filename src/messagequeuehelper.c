@@ -6,12 +6,18 @@
  *
  * @program    server.out, client.out
  *
+ * @function   void set_message_queue_key(key_t key)
  * @function   void make_message_queue(int* msgQId)
  * @function   int get_message_queue(int* msgQId)
  * @function   int remove_message_queue(int msgQId)
- * @function   int msg_recv(int msgQId, Message* msg, int msgType)
- * @function   int msg_send(int msgQId, Message* msg, int msgType)
- * @function   void msg_clear_type(int msgQId, int msgType)
+ * @function   int msg_recv(int msgQId, Message* msg, long msgType)
+ * @function   int msg_send(int msgQId, Message* msg, long msgType)
+ * @function   int msg_try_recv(int msgQId, Message* msg, long msgType)
+ * @function   int msg_try_send(int msgQId, Message* msg, long msgType)
+ * @function   void msg_clear_type(int msgQId, long msgType)
+ * @function   size_t msg_payload_len(Message* msg)
+ * @function   void msg_set_stream(int streamId)
+ * @function   static bool queue_is_stale(int msgQId)
  *
  * @date       2015-02-11
  *
@@ -23,7 +29,46 @@
  *
  * @note       none
  */
+#include <signal.h>
+#include <string.h>
 #include "messagequeuehelper.h"
+#include "clockhelper.h"
+
+/* function prototypes */
+static bool queue_is_stale(int);
+
+/* key of the message queue that make_ & get_message_queue use */
+static key_t queueKey = MSGQ_KEY;
+
+/* stream that msg_send & msg_try_send stamp messages with */
+static int sendStream = 0;
+
+/**
+ * sets the key of the message queue that make_message_queue creates, and
+ *   get_message_queue looks up.
+ *
+ * @function   set_message_queue_key
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * processes forked afterwards, like sessions, inherit the key.
+ *
+ * @signature  void set_message_queue_key(key_t key)
+ *
+ * @param      key key of the message queue; MSGQ_KEY by default.
+ */
+void set_message_queue_key(key_t key)
+{
+    queueKey = key;
+}
 
 /**
  * gets a new message queue from the operating system.
@@ -32,7 +77,8 @@
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - uses the configured key, and replaces a stale
+ *   queue left behind by a crashed server.
  *
  * @designer   EricTsang
  *
@@ -41,7 +87,8 @@
  * @note
  *
  * upon failure, the function exits the process, and prints an error message to
- *   the screen.
+ *   the screen. a queue that already exists under the key is only replaced if
+ *   it is stale; see queue_is_stale.
  *
  * upon success, the value at the address of msgQId is set to the id of the
  *   message queue.
@@ -53,9 +100,30 @@
  */
 void make_message_queue(int* msgQId)
 {
-    int msggetResult = msgget((key_t) MSGQ_KEY, 0644 | IPC_CREAT | IPC_EXCL);
+    int msggetResult = msgget(queueKey, 0644 | IPC_CREAT | IPC_EXCL);
+    if(msggetResult < 0 && errno == EEXIST)
+    {
+        int staleId = msgget(queueKey, 0);
+        if(staleId >= 0 && queue_is_stale(staleId)
+            && msgctl(staleId, IPC_RMID, 0) == 0)
+        {
+            fprintf(stderr, "removed stale message queue %#x\n",
+                (unsigned int) queueKey);
+            msggetResult = msgget(queueKey, 0644 | IPC_CREAT | IPC_EXCL);
+        }
+        else
+        {
+            errno = EEXIST;
+        }
+    }
     if(msggetResult >= 0)
     {
+        /* pass an empty message through the queue, so that the kernel
+         *   records this process as its last sender & receiver, and the queue
+         *   does not look stale before anyone else uses it */
+        long claim = getpid();
+        msgsnd(msggetResult, &claim, 0, 0);
+        msgrcv(msggetResult, &claim, 0, getpid(), IPC_NOWAIT);
         *msgQId = msggetResult;
     }
     else
@@ -73,7 +141,7 @@ void make_message_queue(int* msgQId)
  *
  * @date       2015-02-10
  *
- * @revision   none
+ * @revision   2026-10-18 - uses the configured key.
  *
  * @designer   Eric Tsang
  *
@@ -93,7 +161,7 @@ void make_message_queue(int* msgQId)
  */
 void get_message_queue(int* msgQId)
 {
-    int msggetResult = msgget((key_t) MSGQ_KEY, 0);
+    int msggetResult = msgget(queueKey, 0);
     if(msggetResult >= 0)
     {
         *msgQId = msggetResult;
@@ -141,7 +209,8 @@ void remove_message_queue(int msgQId)
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - being interrupted by a signal is not reported as
+ *   an error.
  *
  * @designer   EricTsang
  *
@@ -149,7 +218,7 @@ void remove_message_queue(int msgQId)
  *
  * @note       none
  *
- * @signature  int msg_recv(int msgQId, Message* msg, int msgType)
+ * @signature  int msg_recv(int msgQId, Message* msg, long msgType)
  *
  * @param      msgQId id of the message queue to write messages to
  * @param      msg pointer to a Message structure to write the read message into
@@ -158,11 +227,11 @@ void remove_message_queue(int msgQId)
  * @return     number of bytes read from the message queue, -1; if an error
  *   occurs
  */
-int msg_recv(int msgQId, Message* msg, int msgType)
+int msg_recv(int msgQId, Message* msg, long msgType)
 {
-    int msgLen = sizeof(Message);
+    int msgLen = MSG_PAYLOAD_LEN;
     int returnValue = msgrcv(msgQId, msg, msgLen, msgType, 0);
-    if(returnValue == -1)
+    if(returnValue == -1 && errno != EINTR)
     {
         fprintf(stderr, "msg_recv failed: %d\n", errno);
     }
@@ -176,6 +245,43 @@ int msg_recv(int msgQId, Message* msg, int msgType)
  *
  * @date       2015-02-11
  *
+ * @revision   2026-10-18 - stamps the message with its send time, and only
+ *   sends the part of it that is used.
+ * @revision   2026-10-18 - stamps the message with the stream of the process.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the send time is taken before the call, so a message that waited for room
+ *   in a full queue counts that wait as part of its delay.
+ *
+ * @signature  int msg_send(int msgQId, Message* msg, long msgType)
+ *
+ * @param      msgQId id of the message queue to send the message to.
+ * @param      msg pointer to a message structure to write to the message queue.
+ * @param      msgType type of the message.
+ *
+ * @return     0 if the message was sent successfully; false otherwise.
+ */
+int msg_send(int msgQId, Message* msg, long msgType)
+{
+    msg->msgType = msgType;
+    msg->sendTime = clock_now_ns();
+    msg->streamId = sendStream;
+    return msgsnd(msgQId, msg, msg_payload_len(msg), 0);
+}
+
+/**
+ * reads a message from the message queue into the passed message pointer if
+ *   there is one, without blocking.
+ *
+ * @function   msg_try_recv
+ *
+ * @date       2026-10-18
+ *
  * @revision   none
  *
  * @designer   EricTsang
@@ -184,18 +290,80 @@ int msg_recv(int msgQId, Message* msg, int msgType)
  *
  * @note       none
  *
- * @signature  int msg_send(int msgQId, Message* msg, int msgType)
+ * @signature  int msg_try_recv(int msgQId, Message* msg, long msgType)
+ *
+ * @param      msgQId id of the message queue to read messages from
+ * @param      msg pointer to a Message structure to write the read message into
+ * @param      msgType type of message to read from the message queue
+ *
+ * @return     number of bytes read from the message queue, -1; if there is no
+ *   such message (errno is ENOMSG), or an error occurs
+ */
+int msg_try_recv(int msgQId, Message* msg, long msgType)
+{
+    return msgrcv(msgQId, msg, MSG_PAYLOAD_LEN, msgType, IPC_NOWAIT);
+}
+
+/**
+ * writes the referenced message to the message queue if there is room for
+ *   it, without blocking.
+ *
+ * @function   msg_try_send
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - stamps the message with the stream of the process.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int msg_try_send(int msgQId, Message* msg, long msgType)
  *
  * @param      msgQId id of the message queue to send the message to.
  * @param      msg pointer to a message structure to write to the message queue.
  * @param      msgType type of the message.
  *
- * @return     0 if the message was sent successfully; false otherwise.
+ * @return     0 if the message was sent successfully; -1 if the queue is full
+ *   (errno is EAGAIN), or an error occurs.
  */
-int msg_send(int msgQId, Message* msg, int msgType)
+int msg_try_send(int msgQId, Message* msg, long msgType)
 {
     msg->msgType = msgType;
-    return msgsnd(msgQId, msg, sizeof(Message), 0);
+    msg->sendTime = clock_now_ns();
+    msg->streamId = sendStream;
+    return msgsnd(msgQId, msg, msg_payload_len(msg), IPC_NOWAIT);
+}
+
+/**
+ * sets the stream that the messages sent by this process belong to.
+ *
+ * @function   msg_set_stream
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a session serving one of many requests that a client has outstanding on
+ *   the same message type sets the stream of the request, so the client can
+ *   tell their messages apart.
+ *
+ * @signature  void msg_set_stream(int streamId)
+ *
+ * @param      streamId stream of the messages sent from now on; 0 by
+ *   default.
+ */
+void msg_set_stream(int streamId)
+{
+    sendStream = streamId;
 }
 
 /**
@@ -205,7 +373,8 @@ int msg_send(int msgQId, Message* msg, int msgType)
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - returns once no message of the type is left,
+ *   instead of blocking for the next one.
  *
  * @designer   EricTsang
  *
@@ -213,16 +382,135 @@ int msg_send(int msgQId, Message* msg, int msgType)
  *
  * @note       none
  *
- * @signature  void msg_clear_type(int msgQId, int msgType)
+ * @signature  void msg_clear_type(int msgQId, long msgType)
  *
  * @param      msgQId id of the message queue to clear
  * @param      msgType type of message to clear from the message queue
  */
-void msg_clear_type(int msgQId, int msgType)
+void msg_clear_type(int msgQId, long msgType)
 {
     Message msg;
-    int msgLen = sizeof(Message);
+    int msgLen = MSG_PAYLOAD_LEN;
 
     /* read messages from the message queue, until they're all gone */
-    while(msgrcv(msgQId, &msg, msgLen, msgType, 0) > 0);
+    while(msgrcv(msgQId, &msg, msgLen, msgType, IPC_NOWAIT) > 0);
+}
+
+/**
+ * returns how much of the passed message msgsnd needs to copy.
+ *
+ * @function   msg_payload_len
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a message is cut off after the member of MsgData that its dataType uses,
+ *   and a data message after its last byte of data, so that small messages
+ *   take up little room in the queue; the union is as large as the largest
+ *   data message. an entry message is cut off after the end of its path,
+ *   and manifest & want messages after their last element.
+ *
+ * @signature  size_t msg_payload_len(Message* msg)
+ *
+ * @param      msg pointer to the message to send.
+ *
+ * @return     number of bytes after the message type field to send.
+ */
+size_t msg_payload_len(Message* msg)
+{
+    size_t header = offsetof(Message, data) - sizeof(long);
+
+    switch(msg->dataType)
+    {
+    case MSG_DATA_DATA:
+        return MSG_DATA_HEADER_LEN + msg->data.dataMsg.len;
+    case MSG_DATA_CONNECT:
+    case MSG_DATA_JOIN:
+        return header + sizeof(ConnectMsg);
+    case MSG_DATA_PRINT:
+        return header + sizeof(PrintMsg);
+    case MSG_DATA_PID:
+    case MSG_DATA_SEALED:
+        return header + sizeof(PidMsg);
+    case MSG_DATA_RESUME:
+        return header + sizeof(ResumeMsg);
+    case MSG_DATA_CREDIT:
+        return header + sizeof(CreditMsg);
+    case MSG_DATA_VALIDATOR:
+    case MSG_DATA_NOTMODIFIED:
+        return header + sizeof(Validator);
+    case MSG_DATA_SIGNATURE:
+        return header + sizeof(SignatureMsg);
+    case MSG_DATA_BLOCKREF:
+        return header + sizeof(BlockRefMsg);
+    case MSG_DATA_HOLE:
+        return header + sizeof(HoleMsg);
+    case MSG_DATA_ENTRY:
+        return offsetof(Message, data.entryMsg.path) - sizeof(long)
+            + strnlen(msg->data.entryMsg.path, MAX_ENTRY_PATH_LEN - 1) + 1;
+    case MSG_DATA_MANIFEST:
+        return header + offsetof(ManifestMsg, chunks)
+            + msg->data.manifestMsg.count * sizeof(ChunkRef);
+    case MSG_DATA_WANT:
+        return header + offsetof(WantMsg, indexes)
+            + msg->data.wantMsg.count * sizeof(unsigned int);
+    default:
+        return header;
+    }
+}
+
+/**
+ * tells whether the identified message queue was left behind by processes
+ *   that are all gone.
+ *
+ * @function   queue_is_stale
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the kernel remembers the last process to send to, and to receive from
+ *   each queue. the server receives from its queue all the time, and its
+ *   sessions send to it, so if neither of those processes is alive, nothing
+ *   is serving the queue anymore.
+ *
+ * @signature  static bool queue_is_stale(int msgQId)
+ *
+ * @param      msgQId id of the message queue to check.
+ *
+ * @return     true if the queue is stale; false if it is in use, or could not
+ *   be checked.
+ */
+static bool queue_is_stale(int msgQId)
+{
+    struct msqid_ds queue;
+
+    if(msgctl(msgQId, IPC_STAT, &queue) < 0)
+    {
+        return false;
+    }
+    if(queue.msg_lrpid != 0 && (kill(queue.msg_lrpid, 0) == 0
+        || errno != ESRCH))
+    {
+        return false;
+    }
+    if(queue.msg_lspid != 0 && (kill(queue.msg_lspid, 0) == 0
+        || errno != ESRCH))
+    {
+        return false;
+    }
+    return true;
 }
@@ -5,13 +5,18 @@
  *
  * @program    server.out, client.out
  *
+ * @function   void set_message_queue_key(key_t key);
  * @function   void get_message_queue(int* msgQId);
  * @function   void make_message_queue(int* msgQId);
  * @function   void remove_message_queue(int msgQId);
- * @function   int msg_recv(int msgQId, Message* msg, int msgType);
- * @function   int msg_send(int msgQId, Message* msg, int msgType);
+ * @function   int msg_recv(int msgQId, Message* msg, long msgType);
+ * @function   int msg_send(int msgQId, Message* msg, long msgType);
+ * @function   int msg_try_recv(int msgQId, Message* msg, long msgType);
+ * @function   int msg_try_send(int msgQId, Message* msg, long msgType);
  * @function   int send_print_msg(int msgQId, void* str, int msgType);
- * @function   void msg_clear_type(int msgQId, int msgType);
+ * @function   void msg_clear_type(int msgQId, long msgType);
+ * @function   size_t msg_payload_len(Message* msg);
+ * @function   void msg_set_stream(int streamId);
  *
  * @date       2015-02-11
  *
@@ -34,14 +39,36 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
 
-/* message queue creation parameters */
+/* message queue creation parameters; MSGQ_KEY is the default key, which
+ *   set_message_queue_key overrides */
 #define MSGQ_KEY 8012
 
 /* message constants */
 #define MAX_MSG_PRNTMSGSTR_LEN 1024
-#define MAX_MSG_DATAMSGDATA_LEN 255
+#define MAX_MSG_DATAMSGDATA_LEN 4064
 #define MAX_FILEPATH_LEN 255
+#define MAX_SIGNATURES 64
+#define SIGNATURE_STRONG_LEN 8
+#define MAX_ENTRY_PATH_LEN 2048
+#define MAX_MANIFEST_CHUNKS 100
+#define MAX_WANTS 1000
+#define CHUNK_HASH_LEN 32
+#define MAX_CHUNK_LEN (64 << 10)
+#define MAX_FILTER_PATTERN_LEN 128
+
+/* connection request flags */
+#define CONNECT_FLAG_FOLLOW 0x01    /* keep sending data appended to the file */
+#define CONNECT_FLAG_RESUME 0x02    /* continue an interrupted transfer */
+#define CONNECT_FLAG_DELTA  0x04    /* only send what the client's copy lacks */
+#define CONNECT_FLAG_SPARSE 0x08    /* send runs of zeros as holes */
+#define CONNECT_FLAG_TREE   0x10    /* send the directory tree at the path */
+#define CONNECT_FLAG_CAS    0x20    /* only send chunks the client's store lacks */
+#define CONNECT_FLAG_COLD   0x40    /* keep the file out of the page cache */
+#define CONNECT_FLAG_FILTER 0x80    /* only send what passes the filter */
+#define CONNECT_FLAG_IF_CHANGED 0x100 /* only send a version the client lacks */
 
 /* constant message types */
 #define MSGQ_SVR_T    1
@@ -53,16 +80,89 @@
 #define MSG_DATA_PRINT    2
 #define MSG_DATA_DATA     3
 #define MSG_DATA_PID      4
+#define MSG_DATA_JOIN     5
+#define MSG_DATA_SEALED   6
+#define MSG_DATA_RESUME   7
+#define MSG_DATA_SIGNATURE 8
+#define MSG_DATA_BLOCKREF 9
+#define MSG_DATA_HOLE     10
+#define MSG_DATA_ENTRY    11
+#define MSG_DATA_MANIFEST 12
+#define MSG_DATA_WANT     13
+#define MSG_DATA_CREDIT   14
+#define MSG_DATA_VALIDATOR 15
+#define MSG_DATA_NOTMODIFIED 16
+
+/**
+ * filter that a session applies to the file before sending it, asked for
+ *   with CONNECT_FLAG_FILTER.
+ *
+ * only the bytes from start up to end are read; an end of 0 reads to the end
+ *   of the file. if pattern is not empty, only the lines within them that
+ *   contain it are sent. a pattern starting with ^ only matches at the start
+ *   of a line, and one ending with $ only at its end; it is otherwise taken
+ *   literally.
+ */
+typedef struct
+{
+    long long start;
+    long long end;
+    char pattern[MAX_FILTER_PATTERN_LEN];
+}
+FilterSpec;
+
+/**
+ * identifies a version of a file; its size, its modification & change times
+ *   in nanoseconds, its inode, and the sha-256 digest of its content, all
+ *   zeros if unknown.
+ */
+typedef struct
+{
+    long long size;
+    long long mtimeNs;
+    long long ctimeNs;
+    unsigned long long inode;
+    unsigned char digest[CHUNK_HASH_LEN];
+}
+Validator;
 
 /**
  * payload of message sent to the server on the message queue, with message type
  *   1. it contains information about what the client, like its process id, what
  *   file it wants read to it, and with what priority client it is.
+ *
+ * clientType is the message type that the session sends its messages to the
+ *   client with. a plain client uses its process id; a process that simulates
+ *   many clients gives each of them a type of its own.
+ *
+ * flags is a combination of CONNECT_FLAG_ values, asking for special
+ *   treatment of the request.
+ *
+ * when resuming, offset is the number of bytes that the client already has,
+ *   and prefixChecksum is their adler-32 checksum.
+ *
+ * a client that has many requests outstanding on the same message type gives
+ *   each of them a streamId of its own, other than 0; every message that the
+ *   session sends carries it. window is the number of data messages that the
+ *   session may send ahead of the credits that the client hands back; 0 does
+ *   not limit it.
+ *
+ * filter is only looked at when flags include CONNECT_FLAG_FILTER, and
+ *   validator, the version of the file that the client already has, when
+ *   they include CONNECT_FLAG_IF_CHANGED.
  */
 typedef struct
 {
     pid_t clientPid;
+    long clientType;
     int priority;
+    int flags;
+    long long offset;
+    unsigned int prefixChecksum;
+    int streamId;
+    int window;
+    FilterSpec filter;
+    Validator validator;
     char filePath[MAX_FILEPATH_LEN];
 }
 ConnectMsg;
@@ -81,9 +181,13 @@ PrintMsg;
  * payload of the message sent to the client process on the message queue. it
  *   contains data that needs to be print onto the client's screen. this is
  *   necessary because unlike printMsg, the data here may contain nulls.
+ *
+ * eventTime is the monotonic time in nanoseconds at which the session found
+ *   the data; for a followed file, when it was told that the file grew.
  */
 typedef struct
 {
+    long long eventTime;
     int len;
     char data[MAX_MSG_DATAMSGDATA_LEN];
 }
@@ -101,6 +205,150 @@ typedef struct
 }
 PidMsg;
 
+/**
+ * this is a message sent from the session to a client that asked to resume a
+ *   transfer, before any data. it holds the offset that the data will start
+ *   at; the requested one if the client's bytes match the file, 0 otherwise.
+ */
+typedef struct
+{
+    long long offset;
+}
+ResumeMsg;
+
+/**
+ * signature of one block of the client's copy of a file; a rolling weak hash,
+ *   and the start of the block's sha-256 digest.
+ */
+typedef struct
+{
+    uint32_t weak;
+    unsigned char strong[SIGNATURE_STRONG_LEN];
+}
+BlockSig;
+
+/**
+ * this is a message sent from a client that asked for a delta transfer to its
+ *   session, after it learns the session's PID. it holds the signatures of
+ *   the next count blocks of the client's copy, in order; a message with a
+ *   count of 0 ends the signatures.
+ */
+typedef struct
+{
+    int blockSize;
+    int count;
+    BlockSig sigs[MAX_SIGNATURES];
+}
+SignatureMsg;
+
+/**
+ * this is a message sent from the session to a client during a delta
+ *   transfer, telling it to copy count blocks of its own copy, starting at
+ *   block index, into the output.
+ */
+typedef struct
+{
+    long long index;
+    long long count;
+}
+BlockRefMsg;
+
+/**
+ * this is a message sent from the session to a client that asked for a sparse
+ *   transfer, in place of len zero bytes of the file; either a hole in it, or
+ *   data that is all zeros.
+ */
+typedef struct
+{
+    long long len;
+}
+HoleMsg;
+
+/**
+ * this is a message sent from the session to a client that asked for a
+ *   directory tree, once for every entry of the tree below the requested
+ *   directory. path is relative to that directory, and a directory's entry
+ *   comes before the entries inside it.
+ *
+ * a regular file's entry is followed by data messages holding exactly size
+ *   bytes, and a symbolic link's by data messages holding its target; other
+ *   entries are followed by none. mode is the st_mode of the entry, and
+ *   mtime its modification time, in seconds.
+ */
+typedef struct
+{
+    unsigned int mode;
+    long long size;
+    long long mtime;
+    char path[MAX_ENTRY_PATH_LEN];
+}
+EntryMsg;
+
+/**
+ * a content-defined chunk of a file; the sha-256 digest of its bytes, and
+ *   how many there are, at most MAX_CHUNK_LEN.
+ */
+typedef struct
+{
+    unsigned char hash[CHUNK_HASH_LEN];
+    unsigned int len;
+}
+ChunkRef;
+
+/**
+ * this is a message sent from the session to a client that asked for a
+ *   chunked transfer, before any data. it holds the next count chunks of the
+ *   file, in order; a message with a count of 0 ends the manifest.
+ */
+typedef struct
+{
+    int count;
+    ChunkRef chunks[MAX_MANIFEST_CHUNKS];
+}
+ManifestMsg;
+
+/**
+ * this is a message sent from a client to its session in reply to the
+ *   manifest. it holds the indexes of count more chunks that the client's
+ *   store lacks, in increasing order; a message with a count of 0 ends them.
+ *   the session then sends the bytes of those chunks, one after the other,
+ *   as data messages.
+ */
+typedef struct
+{
+    int count;
+    unsigned int indexes[MAX_WANTS];
+}
+WantMsg;
+
+/**
+ * this is a message sent from a client that asked for a window to its
+ *   session. it allows the session to send count more data messages.
+ */
+typedef struct
+{
+    int count;
+}
+CreditMsg;
+
+/**
+ * VALIDATOR & NOTMODIFIED messages carry a Validator, and are sent from the
+ *   session to a client that asked for the file only if it changed; the
+ *   first before the data of a version that the client lacks, and the second
+ *   instead of the data, when the file still holds the client's version; it
+ *   may have been written again since, so its validator is sent along.
+ */
+
+/**
+ * JOIN messages carry a ConnectMsg, and are forwarded by the server to a
+ *   session that is already reading the requested file, asking it to serve
+ *   that client as well.
+ *
+ * SEALED messages carry a PidMsg. a session sends one to the server when it
+ *   stops accepting JOIN messages, and the server echoes it back to the
+ *   session once it has stopped forwarding them.
+ */
+
 /**
  * payload of each message.
  */
@@ -110,29 +358,64 @@ typedef union
     PrintMsg printMsg;
     DataMsg dataMsg;
     PidMsg pidMsg;
+    ResumeMsg resumeMsg;
+    SignatureMsg signatureMsg;
+    BlockRefMsg blockRefMsg;
+    HoleMsg holeMsg;
+    EntryMsg entryMsg;
+    ManifestMsg manifestMsg;
+    WantMsg wantMsg;
+    CreditMsg creditMsg;
+    Validator validatorMsg;
 }
 MsgData;
 
 /**
  * the message structure that's passed around through the message queue.
+ *
+ * sendTime is the monotonic time in nanoseconds at which the message was
+ *   sent, and streamId the stream of the request that it belongs to; 0 if the
+ *   client only has the one. both are set by msg_send & msg_try_send.
  */
 typedef struct
 {
     long msgType;
+    long long sendTime;
     char dataType;
+    int streamId;
     MsgData data;
 }
 Message;
 
+/**
+ * size of the part of a Message that msgsnd & msgrcv copy; everything after
+ *   the leading message type field. messages are received into a buffer of
+ *   this size, but sent with only as much of it as they use; see
+ *   msg_payload_len.
+ */
+#define MSG_PAYLOAD_LEN (sizeof(Message) - sizeof(long))
+
+/**
+ * offset of the data of a data message in the part that msgsnd copies; a
+ *   data message is sent as this header followed by its len bytes of data.
+ */
+#define MSG_DATA_HEADER_LEN \
+    (offsetof(Message, data.dataMsg.data) - sizeof(long))
+
 /**
  * function prototypes
  */
+void set_message_queue_key(key_t key);
 void get_message_queue(int* msgQId);
 void make_message_queue(int* msgQId);
 void remove_message_queue(int msgQId);
-int msg_recv(int msgQId, Message* msg, int msgType);
-int msg_send(int msgQId, Message* msg, int msgType);
+int msg_recv(int msgQId, Message* msg, long msgType);
+int msg_send(int msgQId, Message* msg, long msgType);
+int msg_try_recv(int msgQId, Message* msg, long msgType);
+int msg_try_send(int msgQId, Message* msg, long msgType);
 int send_print_msg(int msgQId, void* str, int msgType);
-void msg_clear_type(int msgQId, int msgType);
+void msg_clear_type(int msgQId, long msgType);
+size_t msg_payload_len(Message* msg);
+void msg_set_stream(int streamId);
 
 #endif
@@ -0,0 +1,719 @@
+/**
+ * this file contains the metrics endpoint of the server; a thread that
+ *   samples the message queue, and serves the samples together with the
+ *   shared statistics in prometheus text format.
+ *
+ * @sourceFile metrics.c
+ *
+ * @program    server.out
+ *
+ * @function   int metrics_start(int msgQId, const char* socketPath, int port,
+ *   int sampleMs)
+ * @function   void metrics_close_in_child(void)
+ * @function   int metrics_fd(void)
+ * @function   void metrics_attach(int fd)
+ * @function   static int listen_unix(const char* socketPath)
+ * @function   static int listen_loopback(int port)
+ * @function   static void* metrics_loop(void* nothing)
+ * @function   static void sample_queue(void)
+ * @function   static void serve_scrape(int conn)
+ * @function   static int format_metrics(char* buf, size_t len)
+ * @function   static int format_latency(char* buf, size_t len,
+ *   Histogram* hist, const char* name)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the endpoint speaks just enough HTTP for prometheus, or curl, to scrape it;
+ *   every connection gets the metrics, whatever it asks for. on a UNIX
+ *   socket, scrape it with
+ *
+ *   curl --unix-socket <path> http://localhost/metrics
+ *
+ * the thread does not allocate memory or take locks, since the server forks
+ *   sessions while it runs, and it has every signal blocked, so that they
+ *   keep interrupting the server's main loop instead.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "metrics.h"
+#include "messagequeuehelper.h"
+#include "serverstats.h"
+#include "clockhelper.h"
+#include "numa.h"
+
+/* size of the buffer that a scrape is formatted into */
+#define METRICS_BUF_LEN (16 << 10)
+
+/* function prototypes */
+static int listen_unix(const char*);
+static int listen_loopback(int);
+static void* metrics_loop(void*);
+static void sample_queue(void);
+static void serve_scrape(int);
+static int format_metrics(char*, size_t);
+static int format_latency(char*, size_t, Histogram*, const char*);
+
+/* endpoint settings */
+static int queueId;
+static int listenFd = -1;
+static int sampleInterval = METRICS_DEFAULT_SAMPLE_MS;
+
+/* latest sample of the message queue, and what was seen since the last
+ *   scrape */
+static struct msqid_ds lastSample;
+static unsigned long peakBytes = 0;
+static unsigned long long sampleCount = 0;
+static unsigned long long saturatedCount = 0;
+
+/**
+ * opens the metrics endpoint, and starts the thread that samples the queue
+ *   and serves scrapes.
+ *
+ * @function   metrics_start
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - serves on a socket taken over with metrics_attach.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * exactly one of socketPath & port is used; the socket path if it is set.
+ *   the loopback port only listens on 127.0.0.1. a socket taken over from
+ *   the server that exec'd this one is served on instead, without binding
+ *   again; its sessions may still hold the old socket.
+ *
+ * @signature  int metrics_start(int msgQId, const char* socketPath, int port,
+ *   int sampleMs)
+ *
+ * @param      msgQId id of the message queue to sample.
+ * @param      socketPath path of the UNIX socket to listen on, or 0.
+ * @param      port loopback TCP port to listen on, if socketPath is 0.
+ * @param      sampleMs milliseconds between two samples of the queue.
+ *
+ * @return     0 upon success; -1 if the endpoint could not be opened.
+ */
+int metrics_start(int msgQId, const char* socketPath, int port, int sampleMs)
+{
+    pthread_t thread;
+    sigset_t allSignals;
+    sigset_t oldSignals;
+    int result;
+
+    queueId = msgQId;
+    sampleInterval = sampleMs > 0 ? sampleMs : METRICS_DEFAULT_SAMPLE_MS;
+    if(listenFd < 0)
+    {
+        listenFd = socketPath ? listen_unix(socketPath)
+            : listen_loopback(port);
+    }
+    if(listenFd < 0)
+    {
+        return -1;
+    }
+    sample_queue();
+
+    /* the thread inherits the blocked signals */
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_BLOCK, &allSignals, &oldSignals);
+    result = pthread_create(&thread, 0, metrics_loop, 0);
+    pthread_sigmask(SIG_SETMASK, &oldSignals, 0);
+    if(result != 0)
+    {
+        errno = result;
+        close(listenFd);
+        return -1;
+    }
+
+    pthread_detach(thread);
+    return 0;
+}
+
+/**
+ * closes the listening socket of the metrics endpoint in a forked session.
+ *
+ * @function   metrics_close_in_child
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the socket is close-on-exec, but that does not apply across fork; a
+ *   session that kept it would hold the port or path until it ended, and a
+ *   server started again, or exec'd on SIGUSR1, could not listen there. the
+ *   metrics thread is not forked along, so nothing else uses the socket in
+ *   the session.
+ *
+ * @signature  void metrics_close_in_child(void)
+ */
+void metrics_close_in_child(void)
+{
+    if(listenFd >= 0)
+    {
+        close(listenFd);
+        listenFd = -1;
+    }
+}
+
+/**
+ * returns the listening socket of the metrics endpoint.
+ *
+ * @function   metrics_fd
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int metrics_fd(void)
+ *
+ * @return     the listening socket; -1 if metrics are not served.
+ */
+int metrics_fd(void)
+{
+    return listenFd;
+}
+
+/**
+ * takes over the listening socket of the server that exec'd this one.
+ *
+ * @function   metrics_attach
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       the socket is made close-on-exec again.
+ *
+ * @signature  void metrics_attach(int fd)
+ *
+ * @param      fd listening socket, as returned by metrics_fd.
+ */
+void metrics_attach(int fd)
+{
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    listenFd = fd;
+}
+
+/**
+ * listens on a UNIX socket, replacing whatever was at its path.
+ *
+ * @function   listen_unix
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int listen_unix(const char* socketPath)
+ *
+ * @param      socketPath path to bind the socket to.
+ *
+ * @return     the listening socket; -1 upon failure.
+ */
+static int listen_unix(const char* socketPath)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if(strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    unlink(socketPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+    {
+        return -1;
+    }
+    if(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0
+        || listen(fd, 16) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * listens on a TCP port of the loopback interface.
+ *
+ * @function   listen_loopback
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int listen_loopback(int port)
+ *
+ * @param      port port to listen on.
+ *
+ * @return     the listening socket; -1 upon failure.
+ */
+static int listen_loopback(int port)
+{
+    struct sockaddr_in addr;
+    int reuse = 1;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+    {
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0
+        || listen(fd, 16) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * threaded function. samples the queue every sampleInterval milliseconds,
+ *   and serves scrapes in between.
+ *
+ * @function   metrics_loop
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void* metrics_loop(void* nothing)
+ *
+ * @param      nothing pointer to address 0
+ */
+static void* metrics_loop(void* nothing)
+{
+    struct pollfd pfd;
+    long long nextSample = clock_now_ns() + sampleInterval * NS_PER_MS;
+
+    pfd.fd = listenFd;
+    pfd.events = POLLIN;
+
+    for(;;)
+    {
+        long long now = clock_now_ns();
+        int timeout = 0;
+
+        if(now >= nextSample)
+        {
+            sample_queue();
+            nextSample += sampleInterval * NS_PER_MS;
+            if(nextSample <= now)
+            {
+                nextSample = now + sampleInterval * NS_PER_MS;
+            }
+        }
+        timeout = (int) ((nextSample - now + NS_PER_MS - 1) / NS_PER_MS);
+
+        if(poll(&pfd, 1, timeout) > 0)
+        {
+            int conn = accept4(listenFd, 0, 0, SOCK_CLOEXEC);
+            if(conn >= 0)
+            {
+                serve_scrape(conn);
+                close(conn);
+            }
+        }
+    }
+
+    return nothing;
+}
+
+/**
+ * takes a sample of the message queue's usage.
+ *
+ * @function   sample_queue
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void sample_queue(void)
+ */
+static void sample_queue(void)
+{
+    if(msgctl(queueId, IPC_STAT, &lastSample) < 0)
+    {
+        return;
+    }
+
+    ++sampleCount;
+    if(lastSample.__msg_cbytes > peakBytes)
+    {
+        peakBytes = lastSample.__msg_cbytes;
+    }
+    if(lastSample.__msg_cbytes * 100
+        >= lastSample.msg_qbytes * METRICS_SATURATED_PCT)
+    {
+        ++saturatedCount;
+    }
+}
+
+/**
+ * answers a single scrape.
+ *
+ * @function   serve_scrape
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the request is read, but not looked at. the peak queue usage restarts
+ *   from the current usage after every scrape.
+ *
+ * @signature  static void serve_scrape(int conn)
+ *
+ * @param      conn connection to the scraper.
+ */
+static void serve_scrape(int conn)
+{
+    static char body[METRICS_BUF_LEN];
+    static char request[1024];
+    char header[128];
+    struct pollfd pfd;
+    int bodyLen;
+    int headerLen;
+
+    /* give the scraper a moment to send its request */
+    pfd.fd = conn;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, 100) > 0 && read(conn, request, sizeof(request)) < 0)
+    {
+        return;
+    }
+
+    bodyLen = format_metrics(body, sizeof(body));
+    headerLen = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %d\r\n\r\n", bodyLen);
+
+    if(write(conn, header, headerLen) == headerLen)
+    {
+        const char* pos = body;
+        while(bodyLen > 0)
+        {
+            ssize_t nWritten = write(conn, pos, bodyLen);
+            if(nWritten <= 0)
+            {
+                break;
+            }
+            pos += nWritten;
+            bodyLen -= nWritten;
+        }
+    }
+    peakBytes = lastSample.__msg_cbytes;
+}
+
+/**
+ * formats all metrics in prometheus text format.
+ *
+ * @function   format_metrics
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - counters of the open file cache.
+ * @revision   2026-10-18 - time held back by the rate limits.
+ * @revision   2026-10-18 - work done by filtering sessions.
+ * @revision   2026-10-18 - outcomes of conditional requests.
+ * @revision   2026-10-18 - sessions & bytes of each NUMA node.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int format_metrics(char* buf, size_t len)
+ *
+ * @param      buf buffer to format into.
+ * @param      len size of the buffer.
+ *
+ * @return     number of bytes formatted.
+ */
+static int format_metrics(char* buf, size_t len)
+{
+    ServerStats* stats = stats_get();
+    size_t pos = 0;
+    int priority;
+    int node;
+
+#define APPEND(...) \
+    if(pos < len) \
+    { \
+        pos += snprintf(buf + pos, len - pos, __VA_ARGS__); \
+    }
+
+    APPEND("# HELP msgq_messages Messages in the queue.\n"
+        "# TYPE msgq_messages gauge\n"
+        "msgq_messages %lu\n", (unsigned long) lastSample.msg_qnum);
+    APPEND("# HELP msgq_bytes Bytes in the queue.\n"
+        "# TYPE msgq_bytes gauge\n"
+        "msgq_bytes %lu\n", (unsigned long) lastSample.__msg_cbytes);
+    APPEND("# HELP msgq_capacity_bytes Most bytes the queue holds "
+        "(msg_qbytes).\n"
+        "# TYPE msgq_capacity_bytes gauge\n"
+        "msgq_capacity_bytes %lu\n", (unsigned long) lastSample.msg_qbytes);
+    APPEND("# HELP msgq_peak_bytes Most bytes in the queue in any sample "
+        "since the last scrape.\n"
+        "# TYPE msgq_peak_bytes gauge\n"
+        "msgq_peak_bytes %lu\n", peakBytes);
+    APPEND("# HELP msgq_samples_total Samples taken of the queue.\n"
+        "# TYPE msgq_samples_total counter\n"
+        "msgq_samples_total %llu\n", sampleCount);
+    APPEND("# HELP msgq_saturated_samples_total Samples in which the queue "
+        "was at least %d%% full.\n"
+        "# TYPE msgq_saturated_samples_total counter\n"
+        "msgq_saturated_samples_total %llu\n", METRICS_SATURATED_PCT,
+        saturatedCount);
+
+    APPEND("# HELP msgq_active_sessions Sessions serving clients.\n"
+        "# TYPE msgq_active_sessions gauge\n"
+        "msgq_active_sessions %d\n", atomic_load(&stats->activeSessions));
+    APPEND("# HELP msgq_sessions_started_total Sessions started.\n"
+        "# TYPE msgq_sessions_started_total counter\n"
+        "msgq_sessions_started_total %llu\n",
+        atomic_load(&stats->sessionsStarted));
+
+    APPEND("# HELP msgq_fd_cache_lookups_total Lookups in the server's cache "
+        "of open files.\n"
+        "# TYPE msgq_fd_cache_lookups_total counter\n"
+        "msgq_fd_cache_lookups_total{result=\"hit\"} %llu\n"
+        "msgq_fd_cache_lookups_total{result=\"miss\"} %llu\n",
+        atomic_load(&stats->fdCacheHits), atomic_load(&stats->fdCacheMisses));
+    APPEND("# HELP msgq_fd_cache_invalidations_total Cached files dropped "
+        "because they changed.\n"
+        "# TYPE msgq_fd_cache_invalidations_total counter\n"
+        "msgq_fd_cache_invalidations_total %llu\n",
+        atomic_load(&stats->fdCacheInvalidations));
+    APPEND("# HELP msgq_cold_sessions_total Sessions that dropped their file "
+        "from the page cache behind them.\n"
+        "# TYPE msgq_cold_sessions_total counter\n"
+        "msgq_cold_sessions_total %llu\n",
+        atomic_load(&stats->coldSessions));
+    APPEND("# HELP msgq_filter_sessions_total Sessions that only sent the "
+        "lines of their file that passed a filter.\n"
+        "# TYPE msgq_filter_sessions_total counter\n"
+        "msgq_filter_sessions_total %llu\n",
+        atomic_load(&stats->filterSessions));
+    APPEND("# HELP msgq_filter_bytes_total File bytes scanned by filters, "
+        "and sent because they matched.\n"
+        "# TYPE msgq_filter_bytes_total counter\n"
+        "msgq_filter_bytes_total{result=\"scanned\"} %llu\n"
+        "msgq_filter_bytes_total{result=\"matched\"} %llu\n",
+        atomic_load(&stats->filterScannedBytes),
+        atomic_load(&stats->filterMatchedBytes));
+    APPEND("# HELP msgq_filter_cpu_seconds_total Cpu time that sessions "
+        "spent filtering.\n"
+        "# TYPE msgq_filter_cpu_seconds_total counter\n"
+        "msgq_filter_cpu_seconds_total %.6f\n",
+        atomic_load(&stats->filterCpuNs) / 1e9);
+    APPEND("# HELP msgq_filter_cpu_seconds_per_gigabyte Cpu time spent "
+        "filtering per gigabyte scanned, since the server started.\n"
+        "# TYPE msgq_filter_cpu_seconds_per_gigabyte gauge\n"
+        "msgq_filter_cpu_seconds_per_gigabyte %.6f\n",
+        atomic_load(&stats->filterScannedBytes) == 0 ? 0.0
+        : atomic_load(&stats->filterCpuNs)
+        / (double) atomic_load(&stats->filterScannedBytes));
+    APPEND("# HELP msgq_conditional_requests_total Requests for a file only "
+        "if it changed, by whether the client's version was current.\n"
+        "# TYPE msgq_conditional_requests_total counter\n"
+        "msgq_conditional_requests_total{result=\"not_modified\"} %llu\n"
+        "msgq_conditional_requests_total{result=\"modified\"} %llu\n",
+        atomic_load(&stats->conditionalCurrent),
+        atomic_load(&stats->conditionalChanged));
+    APPEND("# HELP msgq_digests_computed_total Versions of files hashed to "
+        "answer conditional requests.\n"
+        "# TYPE msgq_digests_computed_total counter\n"
+        "msgq_digests_computed_total %llu\n",
+        atomic_load(&stats->digestsComputed));
+
+    APPEND("# HELP msgq_sent_bytes_total File bytes sent to clients.\n"
+        "# TYPE msgq_sent_bytes_total counter\n");
+    for(priority = MIN_PROC_PRIO; priority <= MAX_PROC_PRIO; ++priority)
+    {
+        APPEND("msgq_sent_bytes_total{priority=\"%d\"} %llu\n", priority,
+            atomic_load(&stats->bytesSent[priority]));
+    }
+
+    APPEND("# HELP msgq_throttled_seconds_total Time that sends were held "
+        "back by the rate limits.\n"
+        "# TYPE msgq_throttled_seconds_total counter\n");
+    for(priority = MIN_PROC_PRIO; priority <= MAX_PROC_PRIO; ++priority)
+    {
+        APPEND("msgq_throttled_seconds_total{priority=\"%d\"} %.6f\n",
+            priority, atomic_load(&stats->throttledNs[priority]) / 1e9);
+    }
+
+    APPEND("# HELP msgq_numa_sessions_total Sessions placed on each NUMA "
+        "node.\n"
+        "# TYPE msgq_numa_sessions_total counter\n");
+    for(node = 0; node < numa_node_count(); ++node)
+    {
+        APPEND("msgq_numa_sessions_total{node=\"%d\"} %llu\n", node,
+            atomic_load(&stats->nodeSessions[node]));
+    }
+    APPEND("# HELP msgq_numa_sent_bytes_total File bytes sent by the sessions "
+        "on each NUMA node.\n"
+        "# TYPE msgq_numa_sent_bytes_total counter\n");
+    for(node = 0; node < numa_node_count(); ++node)
+    {
+        APPEND("msgq_numa_sent_bytes_total{node=\"%d\"} %llu\n", node,
+            atomic_load(&stats->nodeBytes[node]));
+    }
+    APPEND("# HELP msgq_numa_unplaced_sessions_total Sessions for which no "
+        "NUMA node could be told.\n"
+        "# TYPE msgq_numa_unplaced_sessions_total counter\n"
+        "msgq_numa_unplaced_sessions_total %llu\n",
+        atomic_load(&stats->unplacedSessions));
+
+    APPEND("# HELP msgq_latency_seconds Latencies of the server & sessions.\n"
+        "# TYPE msgq_latency_seconds summary\n");
+    if(pos < len)
+    {
+        pos += format_latency(buf + pos, len - pos, &stats->connectDelay,
+            "connect_queue_delay");
+    }
+    if(pos < len)
+    {
+        pos += format_latency(buf + pos, len - pos, &stats->forkDelay,
+            "fork_delay");
+    }
+    if(pos < len)
+    {
+        pos += format_latency(buf + pos, len - pos, &stats->openTime,
+            "open_time");
+    }
+    if(pos < len)
+    {
+        pos += format_latency(buf + pos, len - pos, &stats->firstByte,
+            "time_to_first_byte");
+    }
+
+#undef APPEND
+
+    return pos < len ? (int) pos : (int) len - 1;
+}
+
+/**
+ * formats one latency histogram as a prometheus summary.
+ *
+ * @function   format_latency
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int format_latency(char* buf, size_t len,
+ *   Histogram* hist, const char* name)
+ *
+ * @param      buf buffer to format into.
+ * @param      len size of the buffer.
+ * @param      hist pointer to the histogram; values in nanoseconds.
+ * @param      name value of the name label.
+ *
+ * @return     number of bytes formatted, as snprintf.
+ */
+static int format_latency(char* buf, size_t len, Histogram* hist,
+    const char* name)
+{
+    double s = NS_PER_S;
+
+    return snprintf(buf, len,
+        "msgq_latency_seconds{name=\"%s\",quantile=\"0.5\"} %.9f\n"
+        "msgq_latency_seconds{name=\"%s\",quantile=\"0.99\"} %.9f\n"
+        "msgq_latency_seconds{name=\"%s\",quantile=\"0.999\"} %.9f\n"
+        "msgq_latency_seconds_sum{name=\"%s\"} %.9f\n"
+        "msgq_latency_seconds_count{name=\"%s\"} %llu\n",
+        name, histogram_percentile(hist, 50.0) / s,
+        name, histogram_percentile(hist, 99.0) / s,
+        name, histogram_percentile(hist, 99.9) / s,
+        name, atomic_load(&hist->sum) / s,
+        name, atomic_load(&hist->total));
+}
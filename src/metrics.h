@@ -0,0 +1,41 @@
+/**
+ * header file for metrics.c, exposing its interface.
+ *
+ * @sourceFile metrics.h
+ *
+ * @program    server.out
+ *
+ * @function   int metrics_start(int msgQId, const char* socketPath, int port,
+ *   int sampleMs);
+ * @function   void metrics_close_in_child(void);
+ * @function   int metrics_fd(void);
+ * @function   void metrics_attach(int fd);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+/* default time between two samples of the message queue */
+#define METRICS_DEFAULT_SAMPLE_MS 100
+
+/* share of msg_qbytes in use at which the queue counts as saturated */
+#define METRICS_SATURATED_PCT 90
+
+/**
+ * function prototypes
+ */
+int metrics_start(int msgQId, const char* socketPath, int port, int sampleMs);
+void metrics_close_in_child(void);
+int metrics_fd(void);
+void metrics_attach(int fd);
+
+#endif
@@ -0,0 +1,715 @@
+/**
+ * multiplexing mode of the client program. it fetches many files at once
+ *   through one client process and one message type, and writes each of
+ *   them to a file of its own.
+ *
+ * @sourceFile mux.c
+ *
+ * @program    client.out
+ *
+ * @function   int mux_main(int argc, char** argv)
+ * @function   static bool parse_stream(char* arg, const char* outDir,
+ *   int index)
+ * @function   static bool open_streams(int maxOpen)
+ * @function   static void handle_msg(Message* msg)
+ * @function   static void close_stream(MuxStream* stream, bool completed)
+ * @function   static void send_credit(MuxStream* stream)
+ * @function   static void send_owed_credits(void)
+ * @function   static void print_summary(long long elapsed, FILE* file)
+ * @function   static void sigint_handler(int sigNum)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * every file is requested as a stream of its own, numbered from 1, with its
+ *   own priority, and is served by a session of its own, which stamps its
+ *   messages with the stream. they all arrive on the client's process id,
+ *   interleaved, and are routed to the output of their stream by a single
+ *   receive loop, so the client pays for one process and one blocking
+ *   receive however many files it has outstanding. with -n, only that many
+ *   streams are open at once, and the next one is requested as soon as one
+ *   is through.
+ *
+ * every stream is held to a window of data messages (-w); its session only
+ *   sends that many ahead of the credits that the client hands back, one
+ *   for every data message written out, in batches of half a window. a fast
+ *   stream therefore cannot fill the queue while the client is busy with
+ *   the others, and a high priority stream is not stuck behind the backlog
+ *   of a low priority one.
+ *
+ * the queue may be full of data for this very client, so requests and
+ *   credits are only sent if there is room for them; while some could not
+ *   be, the queue is polled instead of waited on, and they are sent again
+ *   in between the messages received.
+ *
+ * requests are plain reads, so a stream that asks for the same file as
+ *   another client is still served by a session of its own. the server's
+ *   shards are not supported, as all streams have to arrive on one queue.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "mux.h"
+#include "messagequeuehelper.h"
+#include "clockhelper.h"
+#include "shard.h"
+
+/* default parameters of a --mux run */
+#define DEFAULT_WINDOW 8
+#define DEFAULT_OPEN   4
+
+/* time that sessions are given to go away when the client is interrupted */
+#define MUX_ABORT_WAIT_NS (NS_PER_S)
+
+/* time between polls of the queue while sends are waiting for room */
+#define MUX_POLL_NS 1000000L
+
+/* states of a stream */
+#define MUX_PENDING 0           /* not requested yet */
+#define MUX_OPEN    1           /* requested, and not through yet */
+#define MUX_DONE    2           /* the whole file was written out */
+#define MUX_FAILED  3           /* the session failed, or the output did */
+
+/**
+ * a file requested over its own stream, and where it is written to.
+ */
+typedef struct
+{
+    char filePath[MAX_FILEPATH_LEN];
+    char outPath[PATH_MAX];
+    int priority;
+    int state;
+    int fd;
+    pid_t sessionPid;
+    int unacked;            /* data messages written out without a credit */
+    bool owed;              /* the credits did not fit in the queue */
+    bool fatal;             /* the session reported that it failed */
+    long long bytes;
+    long long connectTime;
+    long long doneTime;
+}
+MuxStream;
+
+/* function prototypes */
+static bool parse_stream(char*, const char*, int);
+static bool open_streams(int);
+static void handle_msg(Message*);
+static void close_stream(MuxStream*, bool);
+static void send_credit(MuxStream*);
+static void send_owed_credits(void);
+static void print_summary(long long, FILE*);
+static void sigint_handler(int);
+
+/* inter process communication globals */
+static int msgQId;
+
+/* the streams, the next one to request, and how many are open */
+static MuxStream* streams;
+static int streamCount;
+static int nextStream = 0;
+static int openCount = 0;
+
+/* window of every stream, and how many credits are handed back at once */
+static int window = DEFAULT_WINDOW;
+static int creditBatch;
+
+/* number of streams whose credits are waiting for room in the queue */
+static int owedCount = 0;
+
+/**
+ * entry point of client.out --mux. requests every file over a stream of its
+ *   own, writes them out as their data arrives, and prints a summary.
+ *
+ * @function   mux_main
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * argv[0] is expected to be the "--mux" argument, so that getopt skips it
+ *   like a program name.
+ *
+ * @signature  int mux_main(int argc, char** argv)
+ *
+ * @param      argc number of arguments, starting at "--mux".
+ * @param      argv arguments, starting at "--mux".
+ *
+ * @return     return code; 0 if every file was fetched, 1 otherwise.
+ */
+int mux_main(int argc, char** argv)
+{
+    Message msg;
+    struct timespec poll = {0, MUX_POLL_NS};
+    char* keySpec = 0;
+    char* outDir;
+    int maxOpen = DEFAULT_OPEN;
+    long long start;
+    bool waiting;
+    int result;
+    int failed = 0;
+    int opt;
+    int i;
+
+    while((opt = getopt(argc, argv, "w:n:k:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'w':
+            window = atoi(optarg);
+            break;
+        case 'n':
+            maxOpen = atoi(optarg);
+            break;
+        case 'k':
+            keySpec = optarg;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    /* verify command line arguments */
+    if(argc - optind < 2 || window < 0 || maxOpen < 1)
+    {
+        printf("usage: client.out --mux [-w window] [-n streams] [-k key] "
+            "outdir priority:filepath...\n");
+        exit(0);
+    }
+    creditBatch = (window / 2 > 0) ? window / 2 : 1;
+
+    /* parse the streams; each is written to the directory under its name */
+    outDir = argv[optind++];
+    if(mkdir(outDir, 0755) < 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "mkdir failed: %d\n", errno);
+        exit(1);
+    }
+    streamCount = argc - optind;
+    streams = calloc(streamCount, sizeof(MuxStream));
+    if(streams == 0)
+    {
+        fprintf(stderr, "calloc failed: %d\n", errno);
+        exit(1);
+    }
+    for(i = 0; i < streamCount; ++i)
+    {
+        if(!parse_stream(argv[optind + i], outDir, i))
+        {
+            fprintf(stderr, "bad stream: %s\n", argv[optind + i]);
+            exit(1);
+        }
+    }
+
+    /* get the message queue of the server to send the requests to */
+    if(shard_open(keySpec, 1, &msgQId) == 0)
+    {
+        fprintf(stderr, "no server on message queue\n");
+        exit(1);
+    }
+    signal(SIGINT, sigint_handler);
+
+    /* route the messages of the open streams until all are through */
+    start = clock_now_ns();
+    waiting = open_streams(maxOpen);
+    while(openCount > 0 || waiting)
+    {
+        result = waiting ? msg_try_recv(msgQId, &msg, getpid())
+            : msg_recv(msgQId, &msg, getpid());
+        if(result >= 0)
+        {
+            handle_msg(&msg);
+        }
+        else if(errno == ENOMSG)
+        {
+            nanosleep(&poll, 0);
+        }
+        else if(errno != EINTR)
+        {
+            break;
+        }
+        send_owed_credits();
+        waiting = open_streams(maxOpen) || owedCount > 0;
+    }
+
+    /* drop whatever the sessions of failed streams sent after all */
+    msg_clear_type(msgQId, getpid());
+
+    print_summary(clock_now_ns() - start, stdout);
+    for(i = 0; i < streamCount; ++i)
+    {
+        failed += (streams[i].state != MUX_DONE);
+    }
+    free(streams);
+    return (failed == 0) ? 0 : 1;
+}
+
+/**
+ * parses a stream argument of the form priority:filepath.
+ *
+ * @function   parse_stream
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - rejects a stream written to the same output as an
+ *   earlier one, naming both.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the output is named after the last component of the path, so files of
+ *   the same name from different directories, like /a/x and /b/x, would be
+ *   written into one output, interleaved by chunk; the second of them is
+ *   rejected. so is a path ending in . or .., which names no file.
+ *
+ * @signature  static bool parse_stream(char* arg, const char* outDir,
+ *   int index)
+ *
+ * @param      arg the argument.
+ * @param      outDir directory to write the output to.
+ * @param      index index of the stream to fill in; the streams before it
+ *   are already parsed.
+ *
+ * @return     true if the argument is valid; false otherwise.
+ */
+static bool parse_stream(char* arg, const char* outDir, int index)
+{
+    MuxStream* stream = &streams[index];
+    char* path = strchr(arg, ':');
+    char* name;
+    int i;
+
+    if(path == 0)
+    {
+        return false;
+    }
+    ++path;
+    name = strrchr(path, '/');
+    name = (name != 0) ? name + 1 : path;
+    if(strlen(path) >= MAX_FILEPATH_LEN || strlen(name) == 0
+        || strcmp(name, ".") == 0 || strcmp(name, "..") == 0
+        || snprintf(stream->outPath, sizeof(stream->outPath), "%s/%s",
+        outDir, name) >= (int) sizeof(stream->outPath))
+    {
+        return false;
+    }
+    for(i = 0; i < index; ++i)
+    {
+        if(strcmp(streams[i].outPath, stream->outPath) == 0)
+        {
+            fprintf(stderr, "streams %s and %s would both be written to %s\n",
+                streams[i].filePath, path, stream->outPath);
+            return false;
+        }
+    }
+
+    strcpy(stream->filePath, path);
+    stream->priority = atoi(arg);
+    stream->state = MUX_PENDING;
+    stream->fd = -1;
+    return true;
+}
+
+/**
+ * requests pending streams, until as many as allowed are open.
+ *
+ * @function   open_streams
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a stream whose output can not be created fails without being requested.
+ *   a request that does not fit in the queue is sent again on the next
+ *   call.
+ *
+ * @signature  static bool open_streams(int maxOpen)
+ *
+ * @param      maxOpen most streams open at once.
+ *
+ * @return     true if a stream is waiting for room in the queue to be
+ *   requested; false otherwise.
+ */
+static bool open_streams(int maxOpen)
+{
+    Message msg;
+
+    while(openCount < maxOpen && nextStream < streamCount)
+    {
+        MuxStream* stream = &streams[nextStream];
+
+        if(stream->fd < 0)
+        {
+            stream->fd = open(stream->outPath, O_WRONLY | O_CREAT | O_TRUNC,
+                0644);
+        }
+        if(stream->fd < 0)
+        {
+            fprintf(stderr, "open failed: %d (%s)\n", errno,
+                stream->outPath);
+            stream->state = MUX_FAILED;
+            ++nextStream;
+            continue;
+        }
+
+        msg.dataType = MSG_DATA_CONNECT;
+        msg.data.connectMsg.clientPid  = getpid();
+        msg.data.connectMsg.clientType = getpid();
+        msg.data.connectMsg.priority   = stream->priority;
+        msg.data.connectMsg.flags      = 0;
+        msg.data.connectMsg.streamId   = nextStream + 1;
+        msg.data.connectMsg.window     = window;
+        strcpy(msg.data.connectMsg.filePath, stream->filePath);
+
+        stream->connectTime = clock_now_ns();
+        if(msg_try_send(msgQId, &msg, MSGQ_SVR_T) < 0)
+        {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        stream->state = MUX_OPEN;
+        ++openCount;
+        ++nextStream;
+    }
+    return false;
+}
+
+/**
+ * routes a message to the stream it belongs to.
+ *
+ * @function   handle_msg
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * messages of streams that are not open are left over from an earlier
+ *   client with the same process id, and are dropped. a stream whose output
+ *   can not be written fails, and its session is told to stop.
+ *
+ * @signature  static void handle_msg(Message* msg)
+ *
+ * @param      msg pointer to the received message.
+ */
+static void handle_msg(Message* msg)
+{
+    MuxStream* stream;
+    ssize_t nWritten;
+    int len;
+    int done = 0;
+
+    if(msg->streamId < 1 || msg->streamId > streamCount
+        || streams[msg->streamId - 1].state != MUX_OPEN)
+    {
+        return;
+    }
+    stream = &streams[msg->streamId - 1];
+
+    switch(msg->dataType)
+    {
+    case MSG_DATA_PID:
+        stream->sessionPid = msg->data.pidMsg.pid;
+        break;
+    case MSG_DATA_DATA:
+        len = msg->data.dataMsg.len;
+        while(done < len)
+        {
+            nWritten = write(stream->fd, msg->data.dataMsg.data + done,
+                len - done);
+            if(nWritten < 0 && errno != EINTR)
+            {
+                fprintf(stderr, "write failed: %d (%s)\n", errno,
+                    stream->outPath);
+                if(stream->sessionPid != 0)
+                {
+                    kill(stream->sessionPid, SIGUSR1);
+                }
+                close_stream(stream, false);
+                return;
+            }
+            done += (nWritten > 0) ? nWritten : 0;
+        }
+        stream->bytes += len;
+        if(len > 0 && ++stream->unacked >= creditBatch && window > 0)
+        {
+            send_credit(stream);
+        }
+        break;
+    case MSG_DATA_PRINT:
+        fprintf(stderr, "stream %d: %s", msg->streamId,
+            msg->data.printMsg.str);
+        if(strncmp(msg->data.printMsg.str, "fatal", 5) == 0)
+        {
+            stream->fatal = true;
+        }
+        break;
+    case MSG_DATA_STOPCLNT:
+        close_stream(stream, !stream->fatal);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * closes the output of a stream that is through.
+ *
+ * @function   close_stream
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * credits that the session did not take before it ended are cleared from
+ *   the queue; the session is gone once its stop message arrived, and no
+ *   more are sent to it afterwards.
+ *
+ * @signature  static void close_stream(MuxStream* stream, bool completed)
+ *
+ * @param      stream pointer to the stream.
+ * @param      completed true if the whole file was written out; false if the
+ *   stream failed.
+ */
+static void close_stream(MuxStream* stream, bool completed)
+{
+    close(stream->fd);
+    stream->fd = -1;
+    stream->doneTime = clock_now_ns();
+    if(stream->owed)
+    {
+        stream->owed = false;
+        --owedCount;
+    }
+    stream->state = completed ? MUX_DONE : MUX_FAILED;
+    if(window > 0 && stream->sessionPid != 0)
+    {
+        msg_clear_type(msgQId, stream->sessionPid);
+    }
+    --openCount;
+}
+
+/**
+ * hands the credits for the data written out back to the session of a
+ *   stream.
+ *
+ * @function   send_credit
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * credits that do not fit in the queue are owed, and handed back by
+ *   send_owed_credits, together with any written out in the meantime.
+ *
+ * @signature  static void send_credit(MuxStream* stream)
+ *
+ * @param      stream pointer to the stream.
+ */
+static void send_credit(MuxStream* stream)
+{
+    Message msg;
+
+    if(stream->owed)
+    {
+        return;
+    }
+
+    msg.dataType = MSG_DATA_CREDIT;
+    msg.data.creditMsg.count = stream->unacked;
+    if(msg_try_send(msgQId, &msg, stream->sessionPid) < 0)
+    {
+        stream->owed = true;
+        ++owedCount;
+        return;
+    }
+    stream->unacked = 0;
+}
+
+/**
+ * tries again to hand back the credits that did not fit in the queue.
+ *
+ * @function   send_owed_credits
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void send_owed_credits(void)
+ */
+static void send_owed_credits(void)
+{
+    int i;
+
+    for(i = 0; i < nextStream && owedCount > 0; ++i)
+    {
+        if(streams[i].owed)
+        {
+            streams[i].owed = false;
+            --owedCount;
+            send_credit(&streams[i]);
+        }
+    }
+}
+
+/**
+ * prints how every stream went, and the totals.
+ *
+ * @function   print_summary
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void print_summary(long long elapsed, FILE* file)
+ *
+ * @param      elapsed nanoseconds from the first request until the last
+ *   stream was through.
+ * @param      file file to print to.
+ */
+static void print_summary(long long elapsed, FILE* file)
+{
+    static const char* states[] = {"pending", "open", "done", "failed"};
+    long long bytes = 0;
+    int done = 0;
+    int i;
+
+    fprintf(file, "%6s %8s %14s %10s %-7s %s\n", "stream", "priority",
+        "bytes", "seconds", "state", "path");
+    for(i = 0; i < streamCount; ++i)
+    {
+        MuxStream* stream = &streams[i];
+        double seconds = (stream->doneTime > stream->connectTime)
+            ? (double) (stream->doneTime - stream->connectTime) / NS_PER_S
+            : 0.0;
+
+        fprintf(file, "%6d %8d %14lld %10.3f %-7s %s\n", i + 1,
+            stream->priority, stream->bytes, seconds, states[stream->state],
+            stream->filePath);
+        bytes += stream->bytes;
+        done += (stream->state == MUX_DONE);
+    }
+    fprintf(file, "streams: %d done, %d not\n", done, streamCount - done);
+    fprintf(file, "bytes: %lld in %.3f s (%.1f MB/s)\n", bytes,
+        (double) elapsed / NS_PER_S, (elapsed > 0)
+        ? (double) bytes / (1 << 20) / ((double) elapsed / NS_PER_S) : 0.0);
+}
+
+/**
+ * interrupt handler of the multiplexing client. it tells the sessions of
+ *   all open streams to clean up, clears their messages, and exits.
+ *
+ * @function   sigint_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the sessions leave the messages of a client with many streams to it, so
+ *   they are cleared here once the sessions are gone, or have had
+ *   MUX_ABORT_WAIT_NS to go.
+ *
+ * @signature  static void sigint_handler(int sigNum)
+ *
+ * @param      sigNum number of the signal; SIGINT.
+ */
+static void sigint_handler(int sigNum)
+{
+    struct timespec delay = {0, 10000000};
+    long long deadline = clock_now_ns() + MUX_ABORT_WAIT_NS;
+    bool alive = true;
+    int i;
+
+    for(i = 0; i < nextStream; ++i)
+    {
+        if(streams[i].state == MUX_OPEN && streams[i].sessionPid != 0)
+        {
+            kill(streams[i].sessionPid, SIGUSR1);
+        }
+    }
+    while(alive && clock_now_ns() < deadline)
+    {
+        alive = false;
+        for(i = 0; i < nextStream; ++i)
+        {
+            if(streams[i].state == MUX_OPEN && streams[i].sessionPid != 0
+                && kill(streams[i].sessionPid, 0) == 0)
+            {
+                alive = true;
+            }
+        }
+        nanosleep(&delay, 0);
+    }
+
+    for(i = 0; i < nextStream; ++i)
+    {
+        if(streams[i].state == MUX_OPEN && streams[i].sessionPid != 0)
+        {
+            msg_clear_type(msgQId, streams[i].sessionPid);
+        }
+    }
+    msg_clear_type(msgQId, getpid());
+
+    exit(sigNum);
+}
@@ -0,0 +1,28 @@
+/**
+ * header file for mux.c, exposing its interface.
+ *
+ * @sourceFile mux.h
+ *
+ * @program    client.out
+ *
+ * @function   int mux_main(int argc, char** argv);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef MUX_H
+#define MUX_H
+
+/**
+ * function prototypes
+ */
+int mux_main(int argc, char** argv);
+
+#endif
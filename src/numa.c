@@ -0,0 +1,581 @@
+/**
+ * places sessions, and the buffers that they allocate, on the NUMA node of
+ *   the client that they serve, or of the file that they send.
+ *
+ * @sourceFile numa.c
+ *
+ * @program    server.out
+ *
+ * @function   int numa_init(int policy)
+ * @function   int numa_policy_of(const char* name)
+ * @function   bool numa_parse_cpus(char* list, cpu_set_t* cpus)
+ * @function   int numa_node_count(void)
+ * @function   int numa_place(const ConnectMsg* request, int fd)
+ * @function   int numa_vote(const int* status, int count, int nodes)
+ * @function   int numa_node_of_file(int fd)
+ * @function   static int node_of_client(pid_t clientPid)
+ * @function   static int node_of_cpu(int cpu)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * on a machine with more than one node, a session that runs on one node and
+ *   copies a file cached on another, into a message queue read by a client
+ *   on a third, pays for the interconnect on every byte. placing the session
+ *   on the node that holds the file keeps its reads local; placing it on the
+ *   node of the client keeps the messages, which the kernel allocates for
+ *   the sender, close to their reader.
+ *
+ * the node of the client is that of the CPU that it last ran on, which the
+ *   kernel reports in /proc/<pid>/stat. the node of the file is that of most
+ *   of its pages in the page cache, sampled evenly over the file; only the
+ *   pages that are cached are faulted in to find out, so nothing is read
+ *   from disk.
+ *
+ * a placed session is pinned to the CPUs of its node, within the affinity
+ *   that it inherited, and prefers the memory of its node for everything it
+ *   allocates from then on. the preference is not binding; the session still
+ *   gets memory from other nodes when its own runs out.
+ *
+ * the node topology is read from sysfs, and the placement made with the raw
+ *   system calls, so the server does not depend on libnuma. on a machine with
+ *   a single node, sessions are left alone.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "numa.h"
+
+/* function prototypes */
+static int node_of_client(pid_t);
+static int node_of_cpu(int);
+
+/* how sessions are placed */
+static int placePolicy = NUMA_POLICY_OFF;
+
+/* CPUs of each node, and the number of nodes that have any */
+static cpu_set_t nodeCpus[NUMA_MAX_NODES];
+static int nodeCount = 0;
+
+/**
+ * reads the node topology, and sets how sessions are placed.
+ *
+ * @function   numa_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * must be called before any session is forked. nodes past NUMA_MAX_NODES
+ *   are left out, and so are the sessions that would be placed on them.
+ *
+ * @signature  int numa_init(int policy)
+ *
+ * @param      policy one of the NUMA_POLICY values.
+ *
+ * @return     number of nodes; 0 if the topology could not be read.
+ */
+int numa_init(int policy)
+{
+    char path[64];
+    char list[256];
+    FILE* file;
+    int node;
+
+    placePolicy = policy;
+    nodeCount = 0;
+    for(node = 0; node < NUMA_MAX_NODES; ++node)
+    {
+        CPU_ZERO(&nodeCpus[node]);
+        sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+        if((file = fopen(path, "r")) == 0)
+        {
+            continue;
+        }
+        if(fgets(list, sizeof(list), file) != 0)
+        {
+            list[strcspn(list, "\n")] = '\0';
+            if(numa_parse_cpus(list, &nodeCpus[node]))
+            {
+                nodeCount = node + 1;
+            }
+        }
+        fclose(file);
+    }
+    return nodeCount;
+}
+
+/**
+ * looks up a placement policy by name.
+ *
+ * @function   numa_policy_of
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int numa_policy_of(const char* name)
+ *
+ * @param      name off, client, file or auto.
+ *
+ * @return     the NUMA_POLICY value; -1 if the name is unknown.
+ */
+int numa_policy_of(const char* name)
+{
+    if(strcmp(name, "off") == 0)
+    {
+        return NUMA_POLICY_OFF;
+    }
+    if(strcmp(name, "client") == 0)
+    {
+        return NUMA_POLICY_CLIENT;
+    }
+    if(strcmp(name, "file") == 0)
+    {
+        return NUMA_POLICY_FILE;
+    }
+    if(strcmp(name, "auto") == 0)
+    {
+        return NUMA_POLICY_AUTO;
+    }
+    return -1;
+}
+
+/**
+ * parses a list of CPUs, like 0-3,8.
+ *
+ * @function   numa_parse_cpus
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - moved here from server.c, to read the CPUs of
+ *   the nodes as well.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  bool numa_parse_cpus(char* list, cpu_set_t* cpus)
+ *
+ * @param      list comma separated CPU numbers & ranges.
+ * @param      cpus pointer to the set to fill in.
+ *
+ * @return     true if the list was valid; false otherwise.
+ */
+bool numa_parse_cpus(char* list, cpu_set_t* cpus)
+{
+    CPU_ZERO(cpus);
+
+    while(*list != '\0')
+    {
+        char* end;
+        long first = strtol(list, &end, 10);
+        long last = first;
+
+        if(end == list)
+        {
+            return false;
+        }
+        if(*end == '-')
+        {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+            if(end == list)
+            {
+                return false;
+            }
+        }
+        if(first < 0 || last < first || last >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        for(; first <= last; ++first)
+        {
+            CPU_SET(first, cpus);
+        }
+
+        if(*end == ',')
+        {
+            ++end;
+        }
+        else if(*end != '\0')
+        {
+            return false;
+        }
+        list = end;
+    }
+    return CPU_COUNT(cpus) > 0;
+}
+
+/**
+ * tells how many nodes sessions may be placed on.
+ *
+ * @function   numa_node_count
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int numa_node_count(void)
+ *
+ * @return     number of nodes; 0 before numa_init.
+ */
+int numa_node_count(void)
+{
+    return nodeCount;
+}
+
+/**
+ * places the calling session on the node of its client or its file,
+ *   according to the policy.
+ *
+ * @function   numa_place
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * called by a session right after it is forked, before it allocates its
+ *   buffers. the file policy falls back to leaving the session alone if
+ *   none of the file is cached; the auto policy falls back to the node of
+ *   the client.
+ *
+ * the session is counted as placed on its node, or as unplaced if no node
+ *   could be told; nothing is counted when placement is off, or there is
+ *   only one node.
+ *
+ * @signature  int numa_place(const ConnectMsg* request, int fd)
+ *
+ * @param      request CONNECT message that the session serves.
+ * @param      fd descriptor of the requested file; -1 to open it by path.
+ *
+ * @return     node that the session was placed on; -1 if it was not placed.
+ */
+int numa_place(const ConnectMsg* request, int fd)
+{
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long)) + 1];
+    cpu_set_t allowed;
+    int node = -1;
+
+    if(placePolicy == NUMA_POLICY_OFF || nodeCount < 2)
+    {
+        return -1;
+    }
+
+    if(placePolicy == NUMA_POLICY_FILE || placePolicy == NUMA_POLICY_AUTO)
+    {
+        if(fd >= 0)
+        {
+            node = numa_node_of_file(fd);
+        }
+        else if((fd = open(request->filePath, O_RDONLY)) >= 0)
+        {
+            node = numa_node_of_file(fd);
+            close(fd);
+        }
+    }
+    if(placePolicy == NUMA_POLICY_CLIENT
+        || (placePolicy == NUMA_POLICY_AUTO && node < 0))
+    {
+        node = node_of_client(request->clientPid);
+    }
+    if(node < 0)
+    {
+        atomic_fetch_add(&stats_get()->unplacedSessions, 1);
+        return -1;
+    }
+
+    /* run on the node, unless that leaves no CPU that the server allows */
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        CPU_AND(&allowed, &allowed, &nodeCpus[node]);
+        if(CPU_COUNT(&allowed) > 0
+            && sched_setaffinity(0, sizeof(allowed), &allowed) < 0)
+        {
+            fprintf(stderr, "sched_setaffinity failed: %d\n", errno);
+        }
+    }
+
+    /* and allocate from it */
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] |=
+        1UL << (node % (8 * sizeof(unsigned long)));
+    if(syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+        sizeof(mask) * 8) < 0)
+    {
+        fprintf(stderr, "set_mempolicy failed: %d\n", errno);
+    }
+
+    stats_set_node(node);
+    return node;
+}
+
+/**
+ * finds the node that most of a sample of pages are on.
+ *
+ * @function   numa_vote
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the status is that filled in by move_pages; a negative error, like
+ *   -EFAULT or -ENOENT for a page that is not mapped, or a node past the
+ *   last one, does not vote. a tie goes to the lowest node.
+ *
+ * @signature  int numa_vote(const int* status, int count, int nodes)
+ *
+ * @param      status node, or negative error, of each page.
+ * @param      count number of pages in status.
+ * @param      nodes number of nodes that may win, up to NUMA_MAX_NODES.
+ *
+ * @return     node of most of the pages; -1 if none of them voted.
+ */
+int numa_vote(const int* status, int count, int nodes)
+{
+    int votes[NUMA_MAX_NODES];
+    int node = -1;
+    int i;
+
+    memset(votes, 0, sizeof(votes));
+    for(i = 0; i < count; ++i)
+    {
+        if(status[i] >= 0 && status[i] < nodes && status[i] < NUMA_MAX_NODES)
+        {
+            ++votes[status[i]];
+        }
+    }
+    for(i = 0; i < nodes && i < NUMA_MAX_NODES; ++i)
+    {
+        if(votes[i] > 0 && (node < 0 || votes[i] > votes[node]))
+        {
+            node = i;
+        }
+    }
+    return node;
+}
+
+/**
+ * finds the node that holds most of a file's pages in the page cache.
+ *
+ * @function   numa_node_of_file
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - leaves out the pages that move_pages can not
+ *   report, and is no longer static, to be checked by numatest.c.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * up to NUMA_SAMPLE_PAGES pages are sampled, evenly spread over the file.
+ *   move_pages only reports pages mapped into the caller, so those that
+ *   mincore tells are cached are faulted in; a minor fault on a cached page
+ *   reads nothing from disk. a page evicted in between is reported as an
+ *   error by move_pages, and does not vote.
+ *
+ * @signature  int numa_node_of_file(int fd)
+ *
+ * @param      fd descriptor of the file.
+ *
+ * @return     node of most of the cached pages sampled; -1 if none of them
+ *   is cached, or the file is not a regular one.
+ */
+int numa_node_of_file(int fd)
+{
+    void* pages[NUMA_SAMPLE_PAGES];
+    int status[NUMA_SAMPLE_PAGES];
+    long pageSize = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    unsigned char resident;
+    long long filePages;
+    long long step;
+    char* map;
+    int count = 0;
+    int node = -1;
+    int i;
+
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        return -1;
+    }
+    map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    /* sample the cached pages, and fault them in */
+    filePages = (st.st_size + pageSize - 1) / pageSize;
+    step = filePages > NUMA_SAMPLE_PAGES ? filePages / NUMA_SAMPLE_PAGES : 1;
+    for(i = 0; i < NUMA_SAMPLE_PAGES && i * step < filePages; ++i)
+    {
+        char* page = map + i * step * pageSize;
+
+        if(mincore(page, pageSize, &resident) == 0 && (resident & 1))
+        {
+            (void) *(volatile char*) page;
+            pages[count++] = page;
+        }
+    }
+
+    /* and let the nodes that hold them vote */
+    if(count > 0
+        && syscall(SYS_move_pages, 0, count, pages, 0, status, 0) == 0)
+    {
+        node = numa_vote(status, count, nodeCount);
+    }
+
+    munmap(map, st.st_size);
+    return node;
+}
+
+/**
+ * finds the node of the CPU that a client last ran on.
+ *
+ * @function   node_of_client
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the CPU is the 39th field of /proc/<pid>/stat. the fields are counted from
+ *   the end of the command name, which may hold spaces and parentheses of
+ *   its own.
+ *
+ * @signature  static int node_of_client(pid_t clientPid)
+ *
+ * @param      clientPid process id of the client.
+ *
+ * @return     node of the client; -1 if it could not be told.
+ */
+static int node_of_client(pid_t clientPid)
+{
+    char path[64];
+    char line[1024];
+    FILE* file;
+    char* field;
+    int cpu;
+    int i;
+
+    sprintf(path, "/proc/%d/stat", (int) clientPid);
+    if((file = fopen(path, "r")) == 0)
+    {
+        return -1;
+    }
+    field = fgets(line, sizeof(line), file);
+    fclose(file);
+    if(field == 0 || (field = strrchr(line, ')')) == 0)
+    {
+        return -1;
+    }
+
+    /* field 2 ends at the parenthesis; skip to the start of field 39 */
+    for(i = 2; i < 39 && field != 0; ++i)
+    {
+        if((field = strchr(field + 1, ' ')) != 0)
+        {
+            ++field;
+        }
+    }
+    if(field == 0 || sscanf(field, "%d", &cpu) != 1)
+    {
+        return -1;
+    }
+    return node_of_cpu(cpu);
+}
+
+/**
+ * finds the node of a CPU.
+ *
+ * @function   node_of_cpu
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int node_of_cpu(int cpu)
+ *
+ * @param      cpu CPU number.
+ *
+ * @return     node of the CPU; -1 if it is on none of the nodes read.
+ */
+static int node_of_cpu(int cpu)
+{
+    int node;
+
+    if(cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return -1;
+    }
+    for(node = 0; node < nodeCount; ++node)
+    {
+        if(CPU_ISSET(cpu, &nodeCpus[node]))
+        {
+            return node;
+        }
+    }
+    return -1;
+}
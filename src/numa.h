@@ -0,0 +1,55 @@
+/**
+ * header file for numa.c, exposing its interface.
+ *
+ * @sourceFile numa.h
+ *
+ * @program    server.out
+ *
+ * @function   int numa_init(int policy);
+ * @function   int numa_policy_of(const char* name);
+ * @function   bool numa_parse_cpus(char* list, cpu_set_t* cpus);
+ * @function   int numa_node_count(void);
+ * @function   int numa_place(const ConnectMsg* request, int fd);
+ * @function   int numa_vote(const int* status, int count, int nodes);
+ * @function   int numa_node_of_file(int fd);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       cpu_set_t needs _GNU_SOURCE to be defined by the includer.
+ */
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <sched.h>
+#include "messagequeuehelper.h"
+#include "serverstats.h"
+
+/* most pages of a file looked at to find the node that caches it */
+#define NUMA_SAMPLE_PAGES 64
+
+/* where sessions are placed; nowhere in particular, on the node of the
+ *   client's CPU, on the node that caches most of the file, or on the node
+ *   of the file if it is cached, and of the client otherwise */
+#define NUMA_POLICY_OFF    0
+#define NUMA_POLICY_CLIENT 1
+#define NUMA_POLICY_FILE   2
+#define NUMA_POLICY_AUTO   3
+
+/**
+ * function prototypes
+ */
+int numa_init(int policy);
+int numa_policy_of(const char* name);
+bool numa_parse_cpus(char* list, cpu_set_t* cpus);
+int numa_node_count(void);
+int numa_place(const ConnectMsg* request, int fd);
+int numa_vote(const int* status, int count, int nodes);
+int numa_node_of_file(int fd);
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * checks the node voting of numa.c on made up move_pages results, so that
+ *   the placement on machines with many nodes is tried on any machine, and
+ *   that the node of a file cached on this one is found.
+ *
+ * @sourceFile numatest.c
+ *
+ * @program    numatest.out
+ *
+ * @function   int main(void)
+ * @function   static bool check(const char* name, const int* status,
+ *   int count, int nodes, int expected)
+ * @function   static bool check_file(void)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * built and run by make check; prints each check that fails, and exits with
+ *   a non-zero status if any did.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "numa.h"
+
+/* function prototypes */
+static bool check(const char*, const int*, int, int, int);
+static bool check_file(void);
+
+/* size of the file whose node is looked for */
+#define CACHED_FILE_LEN (1 << 20)
+
+/**
+ * runs the checks.
+ *
+ * @function   main
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int main(void)
+ *
+ * @return     0 if every check passed; 1 otherwise.
+ */
+int main(void)
+{
+    const int majority[] = {1, 0, 1, 2, 1, 0};
+    const int tie[] = {2, 1, 1, 2};
+    const int unmapped[] = {-ENOENT, -EFAULT, -ENOENT};
+    const int someUnmapped[] = {-ENOENT, 3, -EFAULT, 0, 3, -ENOENT, -ENOENT};
+    const int pastLast[] = {5, 5, 5, 1};
+    bool passed = true;
+
+    passed &= check("majority", majority, 6, 4, 1);
+    passed &= check("tie", tie, 4, 4, 1);
+    passed &= check("unmapped", unmapped, 3, 4, -1);
+    passed &= check("some unmapped", someUnmapped, 7, 4, 3);
+    passed &= check("past last node", pastLast, 4, 2, 1);
+    passed &= check("no pages", majority, 0, 4, -1);
+    passed &= check("last of many nodes", (const int[]) {NUMA_MAX_NODES - 1},
+        1, NUMA_MAX_NODES, NUMA_MAX_NODES - 1);
+
+    printf("numa_vote %s\n", passed ? "passed" : "FAILED");
+
+    if(!check_file())
+    {
+        passed = false;
+    }
+    return passed ? 0 : 1;
+}
+
+/**
+ * checks the node voted for by a sample of pages.
+ *
+ * @function   check
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool check(const char* name, const int* status,
+ *   int count, int nodes, int expected)
+ *
+ * @param      name name of the check, printed if it fails.
+ * @param      status node, or negative error, of each page.
+ * @param      count number of pages in status.
+ * @param      nodes number of nodes.
+ * @param      expected node that should win; -1 for none.
+ *
+ * @return     true if numa_vote picked the expected node; false otherwise.
+ */
+static bool check(const char* name, const int* status, int count, int nodes,
+    int expected)
+{
+    int node = numa_vote(status, count, nodes);
+
+    if(node != expected)
+    {
+        printf("%s: got node %d, expected %d\n", name, node, expected);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * checks that the node of a file that was just written, and so is cached,
+ *   is found.
+ *
+ * @function   check_file
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the file should be on one of the nodes read from sysfs; on a machine with
+ *   a single node, on node 0. the check is skipped if the topology could not
+ *   be read.
+ *
+ * @signature  static bool check_file(void)
+ *
+ * @return     true if the check passed or was skipped; false otherwise.
+ */
+static bool check_file(void)
+{
+    char path[] = "/tmp/numatestXXXXXX";
+    char* data;
+    int nodes = numa_init(NUMA_POLICY_OFF);
+    int node = -1;
+    int fd;
+
+    if(nodes < 1)
+    {
+        printf("numa_node_of_file skipped; no nodes in sysfs\n");
+        return true;
+    }
+    if((fd = mkstemp(path)) < 0)
+    {
+        fprintf(stderr, "mkstemp failed: %d\n", errno);
+        return false;
+    }
+    if((data = malloc(CACHED_FILE_LEN)) != 0)
+    {
+        memset(data, 'x', CACHED_FILE_LEN);
+        if(write(fd, data, CACHED_FILE_LEN) == CACHED_FILE_LEN)
+        {
+            node = numa_node_of_file(fd);
+        }
+        free(data);
+    }
+    close(fd);
+    unlink(path);
+
+    if(node < 0 || node >= nodes || (nodes == 1 && node != 0))
+    {
+        printf("numa_node_of_file FAILED; got node %d of %d\n", node, nodes);
+        return false;
+    }
+    printf("numa_node_of_file passed; node %d of %d\n", node, nodes);
+    return true;
+}
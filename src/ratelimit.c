@@ -0,0 +1,934 @@
+/**
+ * this file contains the bandwidth limits of the server: token buckets per
+ *   client process, per user, and per priority, shared by all sessions.
+ *
+ * @sourceFile ratelimit.c
+ *
+ * @program    server.out
+ *
+ * @function   int rate_limit_init(void)
+ * @function   int rate_limit_attach(int fd)
+ * @function   int rate_limit_fd(void)
+ * @function   int rate_limit_load(const char* path)
+ * @function   void rate_limiter_init(RateLimiter* limiter, pid_t clientPid,
+ *   int priority)
+ * @function   long long rate_limit_try(RateLimiter* limiter, int bytes)
+ * @function   void rate_limit_wait(RateLimiter* limiter, int bytes)
+ * @function   void rate_limit_set_window(RateLimiter* limiter, int msgQId,
+ *   int window)
+ * @function   static void wait_for_credit(RateLimiter* limiter)
+ * @function   static void resolve(RateLimiter* limiter)
+ * @function   static RateBucket* find_bucket(long long owner)
+ * @function   static long long cell_wait(_Atomic long long* tat,
+ *   long long cost, long long rate, long long burst, long long now)
+ * @function   static void cell_charge(_Atomic long long* tat, long long cost,
+ *   long long rate, long long now)
+ * @function   static bool parse_rule(char* line, RateRule* rule)
+ * @function   static bool parse_amount(char* text, long long* amount)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the limits file holds one rule per line; blank lines, and lines starting
+ *   with # are ignored:
+ *
+ *     scope id bytes/s msgs/s [burst_bytes [burst_msgs]]
+ *
+ * scope is pid, uid or priority, and id is a number, or * for every id that
+ *   has no rule of its own. amounts may end in K, M or G (powers of 1024),
+ *   up to 8G, and a rate of 0 is not limited. bursts default to a tenth of a second's
+ *   worth, but never less than one data message.
+ *
+ * the rules and buckets live in a shared mapping set up by the server before
+ *   forking any session. sessions look their rules up when they start, and
+ *   again whenever the server reloads the file, so running transfers pick up
+ *   new limits. every rule with the id of a client gets a bucket of its own;
+ *   sessions serving the same client, user or priority draw from the same
+ *   bucket.
+ *
+ * a send is held back until every bucket of the client has room for it, and
+ *   then charged to all of them. the buckets are updated lock-free; racing
+ *   sessions may overshoot a burst by a message.
+ *
+ * a client that multiplexes many requests over one message type gives each
+ *   of them a window, so that one fast stream cannot fill the queue while
+ *   the client is busy with the others. sends of data are then also held
+ *   back until the client has handed back a credit for them.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ratelimit.h"
+#include "messagequeuehelper.h"
+#include "clockhelper.h"
+#include "serverstats.h"
+
+#define MAX_LINE_LEN 256
+
+/* buckets probed for a client before giving up on limiting it */
+#define RATE_MAX_PROBES 64
+
+/* largest rate or burst; cell_wait and cell_charge multiply them into
+ *   nanoseconds, which must fit a long long */
+#define RATE_MAX_AMOUNT (LLONG_MAX / 1000000000LL)
+
+/* function prototypes */
+static void wait_for_credit(RateLimiter*);
+static void resolve(RateLimiter*);
+static RateBucket* find_bucket(long long);
+static long long cell_wait(_Atomic long long*, long long, long long,
+    long long, long long);
+static void cell_charge(_Atomic long long*, long long, long long, long long);
+static bool parse_rule(char*, RateRule*);
+static bool parse_amount(char*, long long*);
+
+/* limits shared with the sessions, and the memfd behind them */
+static RateTable* table = 0;
+static int tableFd = -1;
+
+/**
+ * sets up the shared limits, with no rules.
+ *
+ * @function   rate_limit_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       must be called before any session is forked.
+ *
+ * @signature  int rate_limit_init(void)
+ *
+ * @return     0 upon success; -1 if the shared memory could not be mapped.
+ */
+int rate_limit_init(void)
+{
+    int fd = memfd_create("ratelimit", MFD_CLOEXEC);
+
+    if(fd < 0 || ftruncate(fd, sizeof(RateTable)) < 0
+        || rate_limit_attach(fd) < 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * maps limits set up by rate_limit_init, possibly in an earlier server.
+ *
+ * @function   rate_limit_attach
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       the memfd is rejected if its size differs from a RateTable.
+ *
+ * @signature  int rate_limit_attach(int fd)
+ *
+ * @param      fd memfd holding the limits.
+ *
+ * @return     0 upon success; -1 if the memfd could not be mapped.
+ */
+int rate_limit_attach(int fd)
+{
+    struct stat st;
+    void* mem;
+
+    if(fstat(fd, &st) < 0 || st.st_size != sizeof(RateTable))
+    {
+        return -1;
+    }
+    mem = mmap(0, sizeof(RateTable), PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd, 0);
+    if(mem == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    table = mem;
+    tableFd = fd;
+    return 0;
+}
+
+/**
+ * returns the memfd behind the shared limits.
+ *
+ * @function   rate_limit_fd
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int rate_limit_fd(void)
+ *
+ * @return     the memfd; -1 if the limits are not set up.
+ */
+int rate_limit_fd(void)
+{
+    return tableFd;
+}
+
+/**
+ * reads the limits file, and replaces the rules with its own.
+ *
+ * @function   rate_limit_load
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a file with a bad line, or too many rules, is rejected as a whole, and the
+ *   rules in force are kept. the buckets are kept as well, so reloading does
+ *   not hand out a new burst.
+ *
+ * @signature  int rate_limit_load(const char* path)
+ *
+ * @param      path path to the limits file.
+ *
+ * @return     number of rules loaded; -1 if the file could not be read, or
+ *   was rejected.
+ */
+int rate_limit_load(const char* path)
+{
+    static RateRule rules[RATE_MAX_RULES];
+    char line[MAX_LINE_LEN];
+    int ruleCount = 0;
+    int lineNum = 0;
+    FILE* file = fopen(path, "r");
+
+    if(file == 0)
+    {
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), file) != 0)
+    {
+        char* text = line + strspn(line, " \t");
+        ++lineNum;
+        if(*text == '#' || *text == '\n' || *text == '\0')
+        {
+            continue;
+        }
+        if(ruleCount == RATE_MAX_RULES || !parse_rule(text, &rules[ruleCount]))
+        {
+            fprintf(stderr, "%s:%d: bad rate limit\n", path, lineNum);
+            fclose(file);
+            errno = EINVAL;
+            return -1;
+        }
+        ++ruleCount;
+    }
+    fclose(file);
+
+    /* sessions retry reading the rules while generation is odd */
+    atomic_fetch_add(&table->generation, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    memcpy(table->rules, rules, ruleCount * sizeof(*rules));
+    table->ruleCount = ruleCount;
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_fetch_add(&table->generation, 1);
+    return ruleCount;
+}
+
+/**
+ * sets up the limiter of a client.
+ *
+ * @function   rate_limiter_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - no window.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the user of the client is the owner of its /proc entry; a client that has
+ *   already gone is not held to any user rule.
+ *
+ * @signature  void rate_limiter_init(RateLimiter* limiter, pid_t clientPid,
+ *   int priority)
+ *
+ * @param      limiter pointer to the limiter to set up.
+ * @param      clientPid process id of the client.
+ * @param      priority priority that the client is served at.
+ */
+void rate_limiter_init(RateLimiter* limiter, pid_t clientPid, int priority)
+{
+    char procPath[32];
+    struct stat st;
+
+    sprintf(procPath, "/proc/%d", (int) clientPid);
+    limiter->pid = clientPid;
+    limiter->uid = stat(procPath, &st) == 0 ? st.st_uid : (uid_t) -1;
+    limiter->priority = priority;
+    limiter->ruleCount = 0;
+    limiter->generation = 1;
+    limiter->window = 0;
+    limiter->credits = 0;
+    if(table != 0)
+    {
+        resolve(limiter);
+    }
+}
+
+/**
+ * charges a send to the client's buckets, if they all have room for it.
+ *
+ * @function   rate_limit_try
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       every send counts as one message, whatever its size.
+ *
+ * @signature  long long rate_limit_try(RateLimiter* limiter, int bytes)
+ *
+ * @param      limiter pointer to the limiter of the client.
+ * @param      bytes number of file bytes to send.
+ *
+ * @return     0 if the send was charged, and may go ahead; otherwise the
+ *   number of nanoseconds until it may.
+ */
+long long rate_limit_try(RateLimiter* limiter, int bytes)
+{
+    long long now;
+    long long wait = 0;
+    int i;
+
+    if(table == 0)
+    {
+        return 0;
+    }
+    if(atomic_load_explicit(&table->generation, memory_order_acquire)
+        != limiter->generation)
+    {
+        resolve(limiter);
+    }
+    if(limiter->ruleCount == 0)
+    {
+        return 0;
+    }
+
+    now = clock_now_ns();
+    for(i = 0; i < limiter->ruleCount; ++i)
+    {
+        RateRule* rule = &limiter->rules[i];
+        RateBucket* bucket = limiter->buckets[i];
+        long long cellWait;
+
+        if(atomic_load(&bucket->owner) != limiter->owners[i])
+        {
+            /* taken over while this client was idle */
+            resolve(limiter);
+            return rate_limit_try(limiter, bytes);
+        }
+        cellWait = cell_wait(&bucket->byteTat, bytes, rule->bytesPerSec,
+            rule->burstBytes, now);
+        wait = cellWait > wait ? cellWait : wait;
+        cellWait = cell_wait(&bucket->msgTat, 1, rule->msgsPerSec,
+            rule->burstMsgs, now);
+        wait = cellWait > wait ? cellWait : wait;
+    }
+    if(wait > 0)
+    {
+        return wait;
+    }
+
+    for(i = 0; i < limiter->ruleCount; ++i)
+    {
+        RateRule* rule = &limiter->rules[i];
+        cell_charge(&limiter->buckets[i]->byteTat, bytes, rule->bytesPerSec,
+            now);
+        cell_charge(&limiter->buckets[i]->msgTat, 1, rule->msgsPerSec, now);
+    }
+    return 0;
+}
+
+/**
+ * blocks until the client's buckets have room for a send, and charges it.
+ *
+ * @function   rate_limit_wait
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - waits for a credit before sending data within a
+ *   window.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the time spent waiting for the buckets is added to the throttle
+ *   statistics; the time spent waiting for credits is not, as it is the
+ *   client that is slow.
+ *
+ * @signature  void rate_limit_wait(RateLimiter* limiter, int bytes)
+ *
+ * @param      limiter pointer to the limiter of the client.
+ * @param      bytes number of file bytes to send.
+ */
+void rate_limit_wait(RateLimiter* limiter, int bytes)
+{
+    long long wait;
+    long long start;
+    struct timespec delay;
+
+    if(bytes > 0 && limiter->window > 0)
+    {
+        if(limiter->credits == 0)
+        {
+            wait_for_credit(limiter);
+        }
+        --limiter->credits;
+    }
+
+    wait = rate_limit_try(limiter, bytes);
+    if(wait == 0)
+    {
+        return;
+    }
+
+    start = clock_now_ns();
+    do
+    {
+        delay.tv_sec = wait / 1000000000LL;
+        delay.tv_nsec = wait % 1000000000LL;
+        nanosleep(&delay, 0);
+    }
+    while((wait = rate_limit_try(limiter, bytes)) > 0);
+    stats_add_throttle(limiter->priority, clock_now_ns() - start);
+}
+
+/**
+ * holds the sends of data to the client to a window.
+ *
+ * @function   rate_limit_set_window
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       the window starts out open.
+ *
+ * @signature  void rate_limit_set_window(RateLimiter* limiter, int msgQId,
+ *   int window)
+ *
+ * @param      limiter pointer to the limiter of the client.
+ * @param      msgQId id of the message queue that the credits arrive on.
+ * @param      window number of data messages that may be sent ahead of the
+ *   credits; 0 does not limit them.
+ */
+void rate_limit_set_window(RateLimiter* limiter, int msgQId, int window)
+{
+    limiter->msgQId = msgQId;
+    limiter->window = window;
+    limiter->credits = window;
+}
+
+/**
+ * blocks until the client hands back credits.
+ *
+ * @function   wait_for_credit
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * credits are sent to the process id of the session. a session that does
+ *   not take any other messages from its client while sending data waits on
+ *   them here; anything else is dropped. if the queue can no longer be read,
+ *   the window is lifted, and the send fails on its own.
+ *
+ * @signature  static void wait_for_credit(RateLimiter* limiter)
+ *
+ * @param      limiter pointer to the limiter of the client.
+ */
+static void wait_for_credit(RateLimiter* limiter)
+{
+    Message msg;
+
+    while(limiter->credits <= 0)
+    {
+        if(msg_recv(limiter->msgQId, &msg, getpid()) < 0)
+        {
+            if(errno != EINTR)
+            {
+                limiter->window = 0;
+                return;
+            }
+            continue;
+        }
+        if(msg.dataType == MSG_DATA_CREDIT)
+        {
+            limiter->credits += msg.data.creditMsg.count;
+        }
+        else
+        {
+            fprintf(stderr, "unexpected message while waiting for credit: "
+                "%d\n", msg.dataType);
+        }
+    }
+}
+
+/**
+ * looks up the rules that apply to the client, and their buckets.
+ *
+ * @function   resolve
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a rule for the exact id wins over a * rule of the same scope. if no bucket
+ *   is left for a rule, the client is not held to it.
+ *
+ * @signature  static void resolve(RateLimiter* limiter)
+ *
+ * @param      limiter pointer to the limiter of the client.
+ */
+static void resolve(RateLimiter* limiter)
+{
+    static RateRule rules[RATE_MAX_RULES];
+    RateRule* chosen[RATE_SCOPES];
+    long ids[RATE_SCOPES];
+    unsigned int generation;
+    int ruleCount;
+    int scope;
+    int i;
+
+    /* copy the rules, retrying if the server rewrote them meanwhile */
+    do
+    {
+        while((generation = atomic_load(&table->generation)) & 1)
+        {
+            sched_yield();
+        }
+        ruleCount = table->ruleCount;
+        memcpy(rules, table->rules, ruleCount * sizeof(*rules));
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+    while(atomic_load(&table->generation) != generation);
+
+    /* an unknown user is -2, which matches no rule */
+    ids[RATE_SCOPE_PID] = limiter->pid;
+    ids[RATE_SCOPE_UID] = limiter->uid == (uid_t) -1 ? -2 : (long) limiter->uid;
+    ids[RATE_SCOPE_PRIORITY] = limiter->priority;
+    memset(chosen, 0, sizeof(chosen));
+    for(i = 0; i < ruleCount; ++i)
+    {
+        RateRule* rule = &rules[i];
+        if(rule->id == ids[rule->scope]
+            || (rule->id == RATE_ANY_ID && ids[rule->scope] != -2
+            && (chosen[rule->scope] == 0
+            || chosen[rule->scope]->id == RATE_ANY_ID)))
+        {
+            chosen[rule->scope] = rule;
+        }
+    }
+
+    limiter->generation = generation;
+    limiter->ruleCount = 0;
+    for(scope = 0; scope < RATE_SCOPES; ++scope)
+    {
+        long long owner = ((long long) (scope + 1) << 40)
+            | (ids[scope] & 0xffffffffffLL);
+        RateBucket* bucket;
+
+        if(chosen[scope] == 0 || (chosen[scope]->bytesPerSec == 0
+            && chosen[scope]->msgsPerSec == 0)
+            || (bucket = find_bucket(owner)) == 0)
+        {
+            continue;
+        }
+        limiter->rules[limiter->ruleCount] = *chosen[scope];
+        limiter->buckets[limiter->ruleCount] = bucket;
+        limiter->owners[limiter->ruleCount] = owner;
+        ++limiter->ruleCount;
+    }
+}
+
+/**
+ * finds the bucket of a client, user or priority, claiming a free or idle
+ *   one if it has none yet.
+ *
+ * @function   find_bucket
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * buckets are probed linearly from the hash of the owner. a bucket claimed
+ *   from an idle owner starts out full.
+ *
+ * @signature  static RateBucket* find_bucket(long long owner)
+ *
+ * @param      owner scope & id that the bucket belongs to.
+ *
+ * @return     pointer to the bucket; 0 if none could be found or claimed.
+ */
+static RateBucket* find_bucket(long long owner)
+{
+    unsigned int start = ((unsigned long long) owner * 0x9e3779b97f4a7c15ULL)
+        >> 32;
+    long long idleSince = clock_now_ns() - RATE_BUCKET_IDLE_NS;
+    RateBucket* idle = 0;
+    long long idleOwner = 0;
+    int probe;
+
+    for(probe = 0; probe < RATE_MAX_PROBES; ++probe)
+    {
+        RateBucket* bucket =
+            &table->buckets[(start + probe) % RATE_MAX_BUCKETS];
+        long long current = atomic_load(&bucket->owner);
+
+        if(current == owner)
+        {
+            return bucket;
+        }
+        if(current == 0)
+        {
+            if(atomic_compare_exchange_strong(&bucket->owner, &current,
+                owner))
+            {
+                return bucket;
+            }
+            if(current == owner)
+            {
+                return bucket;
+            }
+        }
+        if(idle == 0 && atomic_load(&bucket->byteTat) < idleSince
+            && atomic_load(&bucket->msgTat) < idleSince)
+        {
+            idle = bucket;
+            idleOwner = current;
+        }
+    }
+
+    if(idle != 0
+        && atomic_compare_exchange_strong(&idle->owner, &idleOwner, owner))
+    {
+        atomic_store(&idle->byteTat, 0);
+        atomic_store(&idle->msgTat, 0);
+        return idle;
+    }
+    return 0;
+}
+
+/**
+ * works out how long a send has to wait for room in a cell of a bucket.
+ *
+ * @function   cell_wait
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the send fits if, after adding its cost to the theoretical arrival time,
+ *   that time is at most a burst ahead of now.
+ *
+ * @signature  static long long cell_wait(_Atomic long long* tat,
+ *   long long cost, long long rate, long long burst, long long now)
+ *
+ * @param      tat theoretical arrival time of the cell.
+ * @param      cost units that the send costs.
+ * @param      rate units per second; 0 for no limit.
+ * @param      burst units that may be sent at once.
+ * @param      now current time.
+ *
+ * @return     0 if the send fits; nanoseconds until it fits otherwise.
+ */
+static long long cell_wait(_Atomic long long* tat, long long cost,
+    long long rate, long long burst, long long now)
+{
+    long long start;
+    long long wait;
+
+    if(rate == 0)
+    {
+        return 0;
+    }
+    start = atomic_load(tat);
+    start = start > now ? start : now;
+    wait = start + (cost - burst) * 1000000000LL / rate - now;
+    return wait > 0 ? wait : 0;
+}
+
+/**
+ * adds the cost of a send to a cell of a bucket.
+ *
+ * @function   cell_charge
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void cell_charge(_Atomic long long* tat, long long cost,
+ *   long long rate, long long now)
+ *
+ * @param      tat theoretical arrival time of the cell.
+ * @param      cost units that the send costs.
+ * @param      rate units per second; 0 for no limit.
+ * @param      now current time.
+ */
+static void cell_charge(_Atomic long long* tat, long long cost,
+    long long rate, long long now)
+{
+    long long current;
+    long long next;
+
+    if(rate == 0)
+    {
+        return;
+    }
+    current = atomic_load(tat);
+    do
+    {
+        next = (current > now ? current : now) + cost * 1000000000LL / rate;
+    }
+    while(!atomic_compare_exchange_weak(tat, &current, next));
+}
+
+/**
+ * parses a line of the limits file.
+ *
+ * @function   parse_rule
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       the defaults of the bursts are filled in.
+ *
+ * @signature  static bool parse_rule(char* line, RateRule* rule)
+ *
+ * @param      line the line, without leading blanks.
+ * @param      rule pointer to the rule to fill in.
+ *
+ * @return     true if the line is a valid rule; false otherwise.
+ */
+static bool parse_rule(char* line, RateRule* rule)
+{
+    char* fields[6];
+    char* end;
+    int fieldCount = 0;
+    char* field = strtok(line, " \t\n");
+
+    while(field != 0 && fieldCount < 6)
+    {
+        fields[fieldCount++] = field;
+        field = strtok(0, " \t\n");
+    }
+    if(field != 0 || fieldCount < 4)
+    {
+        return false;
+    }
+
+    if(strcmp(fields[0], "pid") == 0)
+    {
+        rule->scope = RATE_SCOPE_PID;
+    }
+    else if(strcmp(fields[0], "uid") == 0)
+    {
+        rule->scope = RATE_SCOPE_UID;
+    }
+    else if(strcmp(fields[0], "priority") == 0)
+    {
+        rule->scope = RATE_SCOPE_PRIORITY;
+    }
+    else
+    {
+        return false;
+    }
+
+    if(strcmp(fields[1], "*") == 0)
+    {
+        rule->id = RATE_ANY_ID;
+    }
+    else
+    {
+        rule->id = strtol(fields[1], &end, 10);
+        if(*end != '\0' || rule->id < 0)
+        {
+            return false;
+        }
+    }
+
+    rule->burstBytes = 0;
+    rule->burstMsgs = 0;
+    if(!parse_amount(fields[2], &rule->bytesPerSec)
+        || !parse_amount(fields[3], &rule->msgsPerSec)
+        || (fieldCount > 4 && !parse_amount(fields[4], &rule->burstBytes))
+        || (fieldCount > 5 && !parse_amount(fields[5], &rule->burstMsgs)))
+    {
+        return false;
+    }
+
+    /* a burst smaller than a message would never let it through */
+    if(fieldCount < 5)
+    {
+        rule->burstBytes = rule->bytesPerSec / 10;
+    }
+    if(rule->burstBytes < MAX_MSG_DATAMSGDATA_LEN)
+    {
+        rule->burstBytes = MAX_MSG_DATAMSGDATA_LEN;
+    }
+    if(fieldCount < 6)
+    {
+        rule->burstMsgs = rule->msgsPerSec / 10;
+    }
+    if(rule->burstMsgs < 1)
+    {
+        rule->burstMsgs = 1;
+    }
+    return true;
+}
+
+/**
+ * parses an amount, like 512, 64K or 10M.
+ *
+ * @function   parse_amount
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - rejects amounts above RATE_MAX_AMOUNT.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * amounts above RATE_MAX_AMOUNT, about 8G, are rejected, as their time in
+ *   nanoseconds would overflow.
+ *
+ * @signature  static bool parse_amount(char* text, long long* amount)
+ *
+ * @param      text the amount.
+ * @param      amount pointer to the amount to set.
+ *
+ * @return     true if the amount is valid; false otherwise.
+ */
+static bool parse_amount(char* text, long long* amount)
+{
+    char* end;
+    long long value;
+    int shift = 0;
+
+    errno = 0;
+    value = strtoll(text, &end, 10);
+
+    switch(*end)
+    {
+    case 'K':
+        shift = 10;
+        break;
+    case 'M':
+        shift = 20;
+        break;
+    case 'G':
+        shift = 30;
+        break;
+    case '\0':
+        break;
+    default:
+        return false;
+    }
+    if(end == text || value < 0 || errno == ERANGE
+        || value > RATE_MAX_AMOUNT >> shift || (shift != 0 && end[1] != '\0'))
+    {
+        return false;
+    }
+
+    *amount = value << shift;
+    return true;
+}
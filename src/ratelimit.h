@@ -0,0 +1,132 @@
+/**
+ * header file for ratelimit.c, exposing its interface.
+ *
+ * @sourceFile ratelimit.h
+ *
+ * @program    server.out
+ *
+ * @function   int rate_limit_init(void);
+ * @function   int rate_limit_attach(int fd);
+ * @function   int rate_limit_fd(void);
+ * @function   int rate_limit_load(const char* path);
+ * @function   void rate_limiter_init(RateLimiter* limiter, pid_t clientPid,
+ *   int priority);
+ * @function   long long rate_limit_try(RateLimiter* limiter, int bytes);
+ * @function   void rate_limit_wait(RateLimiter* limiter, int bytes);
+ * @function   void rate_limit_set_window(RateLimiter* limiter, int msgQId,
+ *   int window);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+
+/* most rules in a limits file */
+#define RATE_MAX_RULES 64
+
+/* most clients, users & priorities being limited at once */
+#define RATE_MAX_BUCKETS 4096
+
+/* time after which an unused bucket may be taken over by another client */
+#define RATE_BUCKET_IDLE_NS (10LL * 1000000000LL)
+
+/* id of a rule that applies to each id without a rule of its own */
+#define RATE_ANY_ID -1L
+
+/* what a rule limits; a client is held to one rule of each scope */
+#define RATE_SCOPE_PID      0
+#define RATE_SCOPE_UID      1
+#define RATE_SCOPE_PRIORITY 2
+#define RATE_SCOPES         3
+
+/**
+ * a line of the limits file. rates of 0 are not limited. the bursts are how
+ *   far a client may get ahead of the rate after being idle.
+ */
+typedef struct
+{
+    int scope;
+    long id;
+    long long bytesPerSec;
+    long long msgsPerSec;
+    long long burstBytes;
+    long long burstMsgs;
+}
+RateRule;
+
+/**
+ * token bucket shared by every session sending to the same client, user or
+ *   priority, kept as the theoretical arrival times of the generic cell rate
+ *   algorithm: the bucket is empty until then, and full once it is more than
+ *   a burst in the past.
+ */
+typedef struct
+{
+    _Atomic long long owner;
+    _Atomic long long byteTat;
+    _Atomic long long msgTat;
+}
+RateBucket;
+
+/**
+ * limits shared by the server and all of its sessions. generation is odd
+ *   while the server is rewriting the rules.
+ */
+typedef struct
+{
+    _Atomic unsigned int generation;
+    int ruleCount;
+    RateRule rules[RATE_MAX_RULES];
+    RateBucket buckets[RATE_MAX_BUCKETS];
+}
+RateTable;
+
+/**
+ * the rules that a session holds one of its clients to, and their buckets;
+ *   looked up again whenever the rules are reloaded.
+ *
+ * a client may also hold the session to a window of data messages, which it
+ *   opens up again by sending credits on the message queue to the session's
+ *   process id. credits is how many more the session may send; a window of 0
+ *   does not limit them.
+ */
+typedef struct
+{
+    pid_t pid;
+    uid_t uid;
+    int priority;
+    unsigned int generation;
+    int ruleCount;
+    RateRule rules[RATE_SCOPES];
+    RateBucket* buckets[RATE_SCOPES];
+    long long owners[RATE_SCOPES];
+    int msgQId;
+    int window;
+    int credits;
+}
+RateLimiter;
+
+/**
+ * function prototypes
+ */
+int rate_limit_init(void);
+int rate_limit_attach(int fd);
+int rate_limit_fd(void);
+int rate_limit_load(const char* path);
+void rate_limiter_init(RateLimiter* limiter, pid_t clientPid, int priority);
+long long rate_limit_try(RateLimiter* limiter, int bytes);
+void rate_limit_wait(RateLimiter* limiter, int bytes);
+void rate_limit_set_window(RateLimiter* limiter, int msgQId, int window);
+
+#endif
@@ -0,0 +1,639 @@
+/**
+ * this file keeps track of the session processes started by the server, and
+ *   which of them are reading a file that new clients can join in on.
+ *
+ * @sourceFile registry.c
+ *
+ * @program    server.out
+ *
+ * @function   bool file_key_of(const char* filePath, int priority,
+ *   FileKey* key)
+ * @function   bool file_key_from(const struct stat* info, int priority,
+ *   FileKey* key)
+ * @function   void registry_add(pid_t pid, FileKey* key)
+ * @function   pid_t registry_find_joinable(FileKey* key)
+ * @function   void registry_seal(pid_t pid)
+ * @function   void registry_reap(void)
+ * @function   int registry_count(void)
+ * @function   int registry_save(int fd)
+ * @function   int registry_load(int fd)
+ * @function   int registry_init(int slots)
+ * @function   void registry_progress(int subscribers)
+ * @function   static bool file_key_equal(FileKey* a, FileKey* b)
+ * @function   static void remove_entry(pid_t pid)
+ * @function   static int claim_slot(pid_t pid)
+ * @function   static bool is_progressing(const SessionEntry* entry)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a joinable session may stop making progress; its client may be gone
+ *   without it knowing, or too slow to keep up. clients that joined it would
+ *   wait on it as well, so every joinable session reports its progress into
+ *   a slot of a table shared with the server, and the server only sends new
+ *   clients to sessions that still have subscribers, and sent them something
+ *   within REGISTRY_STALL_NS. the rest get a session of their own.
+ *
+ * the table is set up by the server before it forks any session. a server
+ *   that exec'd itself on SIGUSR1 starts over with an empty one, which the
+ *   sessions of the old server do not report into; they stall in its eyes,
+ *   and are no longer joined.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "registry.h"
+#include "clockhelper.h"
+
+/**
+ * the progress of a joinable session, as last reported by it.
+ */
+typedef struct
+{
+    _Atomic pid_t pid;              /* 0 while the slot is free */
+    _Atomic int subscribers;
+    _Atomic long long progressTime; /* when it last sent a client anything */
+}
+ProgressSlot;
+
+/* function prototypes */
+static bool file_key_equal(FileKey* a, FileKey* b);
+static void remove_entry(pid_t pid);
+static int claim_slot(pid_t pid);
+static bool is_progressing(const SessionEntry* entry);
+
+/* registered sessions, in no particular order */
+static SessionEntry* entries = 0;
+static int entryCount = 0;
+static int entryCapacity = 0;
+
+/* progress of the joinable sessions, shared with them; 0 if not set up */
+static ProgressSlot* progress = 0;
+static int progressSlots = 0;
+
+/* slot that the calling session reports into; -1 until it is found */
+static int ownSlot = -1;
+
+/**
+ * looks up the key identifying the current version of a file.
+ *
+ * @function   file_key_of
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - split into file_key_from.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * only regular files get a key; anything else can not be read once for many
+ *   clients.
+ *
+ * @signature  bool file_key_of(const char* filePath, int priority,
+ *   FileKey* key)
+ *
+ * @param      filePath path to the file.
+ * @param      priority priority the file is going to be read with.
+ * @param      key pointer to the key to fill in.
+ *
+ * @return     true if the key was filled in; false otherwise.
+ */
+bool file_key_of(const char* filePath, int priority, FileKey* key)
+{
+    struct stat info;
+
+    return stat(filePath, &info) == 0 && file_key_from(&info, priority, key);
+}
+
+/**
+ * makes the key identifying the version of a file from its stat.
+ *
+ * @function   file_key_from
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       see file_key_of.
+ *
+ * @signature  bool file_key_from(const struct stat* info, int priority,
+ *   FileKey* key)
+ *
+ * @param      info stat of the file.
+ * @param      priority priority the file is going to be read with.
+ * @param      key pointer to the key to fill in.
+ *
+ * @return     true if the key was filled in; false otherwise.
+ */
+bool file_key_from(const struct stat* info, int priority, FileKey* key)
+{
+    if(!S_ISREG(info->st_mode))
+    {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->dev      = info->st_dev;
+    key->ino      = info->st_ino;
+    key->mtime    = info->st_mtim;
+    key->size     = info->st_size;
+    key->priority = priority;
+    return true;
+}
+
+/**
+ * registers a newly started session.
+ *
+ * @function   registry_add
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - gives a joinable session a progress slot.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void registry_add(pid_t pid, FileKey* key)
+ *
+ * @param      pid process id of the session.
+ * @param      key pointer to the key of the file that clients may join the
+ *   session on; 0 if the session can not be joined.
+ */
+void registry_add(pid_t pid, FileKey* key)
+{
+    SessionEntry* entry;
+
+    if(entryCount == entryCapacity)
+    {
+        int capacity = entryCapacity == 0 ? 64 : entryCapacity * 2;
+        SessionEntry* grown = realloc(entries, capacity * sizeof(*entries));
+        if(grown == 0)
+        {
+            fprintf(stderr, "registry_add failed: out of memory\n");
+            return;
+        }
+        entries = grown;
+        entryCapacity = capacity;
+    }
+
+    entry = &entries[entryCount++];
+    entry->pid = pid;
+    entry->joinable = (key != 0);
+    entry->slot = -1;
+    if(key != 0)
+    {
+        entry->key = *key;
+        entry->slot = claim_slot(pid);
+    }
+}
+
+/**
+ * finds a session that is reading the identified file, and still accepts
+ *   clients joining it.
+ *
+ * @function   registry_find_joinable
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - skips sessions that stopped making progress.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       a session without a progress slot is never joined.
+ *
+ * @signature  pid_t registry_find_joinable(FileKey* key)
+ *
+ * @param      key pointer to the key of the file.
+ *
+ * @return     process id of the session; 0 if there is none.
+ */
+pid_t registry_find_joinable(FileKey* key)
+{
+    int i;
+
+    for(i = 0; i < entryCount; ++i)
+    {
+        if(entries[i].joinable && file_key_equal(&entries[i].key, key)
+            && is_progressing(&entries[i]))
+        {
+            return entries[i].pid;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * marks the session as no longer accepting clients joining it.
+ *
+ * @function   registry_seal
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void registry_seal(pid_t pid)
+ *
+ * @param      pid process id of the session.
+ */
+void registry_seal(pid_t pid)
+{
+    int i;
+
+    for(i = 0; i < entryCount; ++i)
+    {
+        if(entries[i].pid == pid)
+        {
+            entries[i].joinable = false;
+        }
+    }
+}
+
+/**
+ * collects the exit status of sessions that have ended, and forgets them.
+ *
+ * @function   registry_reap
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * never blocks. this also keeps ended sessions from lingering as zombies.
+ *
+ * @signature  void registry_reap(void)
+ */
+void registry_reap(void)
+{
+    pid_t pid;
+
+    while((pid = waitpid(-1, 0, WNOHANG)) > 0)
+    {
+        remove_entry(pid);
+    }
+}
+
+/**
+ * returns the number of registered sessions.
+ *
+ * @function   registry_count
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int registry_count(void)
+ *
+ * @return     number of sessions that have not been reaped yet.
+ */
+int registry_count(void)
+{
+    return entryCount;
+}
+
+/**
+ * writes the registered sessions to a file, for a new server to pick up.
+ *
+ * @function   registry_save
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the entries are written as they are in memory, behind their count, so
+ *   they can only be read back by a server built with the same SessionEntry.
+ *
+ * @signature  int registry_save(int fd)
+ *
+ * @param      fd file descriptor to write the registry to.
+ *
+ * @return     0 upon success; -1 if the registry could not be written.
+ */
+int registry_save(int fd)
+{
+    size_t len = entryCount * sizeof(*entries);
+
+    if(write(fd, &entryCount, sizeof(entryCount)) != sizeof(entryCount)
+        || (len > 0 && write(fd, entries, len) != (ssize_t) len))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * adds the sessions written by registry_save to the registry.
+ *
+ * @function   registry_load
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int registry_load(int fd)
+ *
+ * @param      fd file descriptor to read the registry from.
+ *
+ * @return     0 upon success; -1 if the registry could not be read.
+ */
+int registry_load(int fd)
+{
+    SessionEntry entry;
+    int count;
+
+    if(read(fd, &count, sizeof(count)) != sizeof(count))
+    {
+        return -1;
+    }
+    while(count-- > 0)
+    {
+        if(read(fd, &entry, sizeof(entry)) != sizeof(entry))
+        {
+            return -1;
+        }
+        registry_add(entry.pid, entry.joinable ? &entry.key : 0);
+    }
+    return 0;
+}
+
+/**
+ * sets up the table that joinable sessions report their progress into.
+ *
+ * @function   registry_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * must be called before any session is forked, or registered. without the
+ *   table, no session is ever joined.
+ *
+ * @signature  int registry_init(int slots)
+ *
+ * @param      slots most joinable sessions to follow at once.
+ *
+ * @return     0 upon success; -1 if the shared memory could not be mapped.
+ */
+int registry_init(int slots)
+{
+    void* mem = mmap(0, slots * sizeof(ProgressSlot), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if(mem == MAP_FAILED)
+    {
+        return -1;
+    }
+    progress = mem;
+    progressSlots = slots;
+    return 0;
+}
+
+/**
+ * reports that the calling session just sent a client some of the file.
+ *
+ * @function   registry_progress
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * called by joinable sessions. the session looks for its slot until the
+ *   server has registered it; reports made before that are lost, but the
+ *   server counts a new session as progressing anyway.
+ *
+ * @signature  void registry_progress(int subscribers)
+ *
+ * @param      subscribers number of clients that the session serves.
+ */
+void registry_progress(int subscribers)
+{
+    pid_t self;
+    int i;
+
+    if(ownSlot < 0)
+    {
+        self = getpid();
+        for(i = 0; i < progressSlots && ownSlot < 0; ++i)
+        {
+            if(atomic_load(&progress[i].pid) == self)
+            {
+                ownSlot = i;
+            }
+        }
+        if(ownSlot < 0)
+        {
+            return;
+        }
+    }
+    atomic_store(&progress[ownSlot].subscribers, subscribers);
+    atomic_store(&progress[ownSlot].progressTime, clock_now_ns());
+}
+
+/**
+ * compares two file keys.
+ *
+ * @function   file_key_equal
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool file_key_equal(FileKey* a, FileKey* b)
+ *
+ * @param      a pointer to a key.
+ * @param      b pointer to the other key.
+ *
+ * @return     true if both keys identify the same file version & priority.
+ */
+static bool file_key_equal(FileKey* a, FileKey* b)
+{
+    return a->dev == b->dev && a->ino == b->ino
+        && a->mtime.tv_sec == b->mtime.tv_sec
+        && a->mtime.tv_nsec == b->mtime.tv_nsec
+        && a->size == b->size && a->priority == b->priority;
+}
+
+/**
+ * forgets the session.
+ *
+ * @function   remove_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - frees the progress slot of the session.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void remove_entry(pid_t pid)
+ *
+ * @param      pid process id of the session.
+ */
+static void remove_entry(pid_t pid)
+{
+    int i;
+
+    for(i = 0; i < entryCount; ++i)
+    {
+        if(entries[i].pid == pid)
+        {
+            if(entries[i].slot >= 0)
+            {
+                atomic_store(&progress[entries[i].slot].pid, 0);
+            }
+            entries[i] = entries[--entryCount];
+            return;
+        }
+    }
+}
+
+/**
+ * finds a free progress slot for a joinable session.
+ *
+ * @function   claim_slot
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the session starts out with one subscriber, and as having just made
+ *   progress. the pid is set last, so the session only finds the slot once
+ *   the rest of it is filled in.
+ *
+ * @signature  static int claim_slot(pid_t pid)
+ *
+ * @param      pid process id of the session.
+ *
+ * @return     index of the slot; -1 if there is none free.
+ */
+static int claim_slot(pid_t pid)
+{
+    int i;
+
+    for(i = 0; i < progressSlots; ++i)
+    {
+        if(atomic_load(&progress[i].pid) == 0)
+        {
+            atomic_store(&progress[i].subscribers, 1);
+            atomic_store(&progress[i].progressTime, clock_now_ns());
+            atomic_store(&progress[i].pid, pid);
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * tells whether a joinable session is still making progress.
+ *
+ * @function   is_progressing
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool is_progressing(const SessionEntry* entry)
+ *
+ * @param      entry pointer to the entry of the session.
+ *
+ * @return     true if the session has subscribers, and sent one of them
+ *   something within REGISTRY_STALL_NS; false otherwise.
+ */
+static bool is_progressing(const SessionEntry* entry)
+{
+    ProgressSlot* slot;
+
+    if(entry->slot < 0)
+    {
+        return false;
+    }
+    slot = &progress[entry->slot];
+    return atomic_load(&slot->subscribers) > 0
+        && clock_now_ns() - atomic_load(&slot->progressTime)
+            < REGISTRY_STALL_NS;
+}
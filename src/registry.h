@@ -0,0 +1,88 @@
+/**
+ * header file for registry.c, exposing its interface.
+ *
+ * @sourceFile registry.h
+ *
+ * @program    server.out
+ *
+ * @function   bool file_key_of(const char* filePath, int priority,
+ *   FileKey* key);
+ * @function   bool file_key_from(const struct stat* info, int priority,
+ *   FileKey* key);
+ * @function   void registry_add(pid_t pid, FileKey* key);
+ * @function   pid_t registry_find_joinable(FileKey* key);
+ * @function   void registry_seal(pid_t pid);
+ * @function   void registry_reap(void);
+ * @function   int registry_count(void);
+ * @function   int registry_save(int fd);
+ * @function   int registry_load(int fd);
+ * @function   int registry_init(int slots);
+ * @function   void registry_progress(int subscribers);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/* number of joinable sessions whose progress the server can follow */
+#define REGISTRY_PROGRESS_SLOTS 1024
+
+/* how long a joinable session may go without sending anything before new
+ *   clients are no longer sent to it */
+#define REGISTRY_STALL_NS 1000000000LL
+
+/**
+ * identifies a version of a file, as read with a priority. two requests with
+ *   equal keys can be served by the same read of the file.
+ */
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    off_t size;
+    int priority;
+}
+FileKey;
+
+/**
+ * a session process started by the server.
+ */
+typedef struct
+{
+    pid_t pid;
+    bool joinable;          /* true while the session accepts JOIN messages */
+    int slot;               /* progress slot of the session; -1 if none */
+    FileKey key;
+}
+SessionEntry;
+
+/**
+ * function prototypes
+ */
+bool file_key_of(const char* filePath, int priority, FileKey* key);
+bool file_key_from(const struct stat* info, int priority, FileKey* key);
+void registry_add(pid_t pid, FileKey* key);
+pid_t registry_find_joinable(FileKey* key);
+void registry_seal(pid_t pid);
+void registry_reap(void);
+int registry_count(void);
+int registry_save(int fd);
+int registry_load(int fd);
+int registry_init(int slots);
+void registry_progress(int subscribers);
+
+#endif
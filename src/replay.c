@@ -0,0 +1,908 @@
+/**
+ * replay mode of the client program. it plays the requests in a capture log
+ *   back against a server, with their recorded timing, and reports how the
+ *   server fared compared to the one that the log was captured on.
+ *
+ * @sourceFile replay.c
+ *
+ * @program    client.out
+ *
+ * @function   int replay_main(int argc, char** argv)
+ * @function   static char* load_log(const char* path, size_t* len)
+ * @function   static long long parse_log(char* log, size_t len,
+ *   ReplayEntry** entries)
+ * @function   static bool make_files(ReplayEntry* entries, long long count,
+ *   const char* dir)
+ * @function   static bool write_synthetic(const char* path, long long size,
+ *   uint64_t seed)
+ * @function   static int peak_concurrency(ReplayEntry* entries,
+ *   long long count)
+ * @function   static int compare_times(const void* a, const void* b)
+ * @function   static uint64_t hash_bytes(const char* data, size_t len)
+ * @function   static bool replay_next(void* sourceCtx, LoadRequest* req)
+ * @function   static void print_comparison(ReplaySource* source,
+ *   LoadReport* report, FILE* file)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the log is written by a server started with -R; see capture.c. every
+ *   request is issued at the time the server received it, relative to the
+ *   first one, divided by the speed (-x), through the load generator's
+ *   logical clients; see loadgen.c.
+ *
+ * with -D, every file of the log is replaced by a synthetic one of the
+ *   recorded size in the passed directory, filled with pseudo-random bytes,
+ *   so that a log from production can be replayed on a test machine that
+ *   does not have its files. synthetic files are kept, and reused by later
+ *   replays if their size is right. requests for files that could not be
+ *   stat'd are made for a file that does not exist, and fail the same way.
+ *
+ * requests are replayed as plain reads; the log does not hold what the
+ *   client of a delta, chunked or resumed transfer already had. followed
+ *   files are left out, as they only end when their client lets go.
+ *
+ * after the load generator's report, the recorded requests are reported on
+ *   the same way, and the replay is compared to them: throughput against the
+ *   recorded bytes over the recorded span, shortened by the speed, and
+ *   service latency (connect to last byte) against the time from the server
+ *   receiving a request until its session was through. replaying one log
+ *   against two builds compares the builds with each other.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "replay.h"
+#include "loadgen.h"
+#include "capture.h"
+#include "clockhelper.h"
+#include "shard.h"
+
+/* default parameters of a --replay run */
+#define DEFAULT_MIN_CLIENTS 16
+#define DEFAULT_MAX_CLIENTS 1024
+#define DEFAULT_GRACE       10
+
+/* bytes written to a synthetic file at a time */
+#define SYNTHETIC_WRITE_LEN (1 << 16)
+
+/**
+ * a recorded request, and how its session went.
+ */
+typedef struct
+{
+    long long time;         /* when the server received the request */
+    long long size;         /* size of the file; -1 if it could not be stat'd */
+    long long doneTime;     /* when the session was through with it */
+    long long bytes;        /* bytes that the session sent */
+    long clientType;
+    int streamId;
+    int priority;
+    int flags;
+    bool ended;             /* a DONE or FAILED record was found */
+    bool completed;         /* the record was DONE */
+    int file;               /* synthetic file it is replayed with; -1 if none */
+    const char* path;       /* requested path, within the loaded log */
+    int pathLen;
+}
+ReplayEntry;
+
+/**
+ * state of the request source of --replay.
+ */
+typedef struct
+{
+    ReplayEntry* entries;
+    long long count;
+    long long next;
+    double speed;
+    const char* dir;        /* directory of the synthetic files; 0 for none */
+    int tags[256];          /* tag of the requests of every priority */
+}
+ReplaySource;
+
+/* function prototypes */
+static char* load_log(const char*, size_t*);
+static long long parse_log(char*, size_t, ReplayEntry**);
+static bool make_files(ReplayEntry*, long long, const char*);
+static bool write_synthetic(const char*, long long, uint64_t);
+static int peak_concurrency(ReplayEntry*, long long);
+static int compare_times(const void*, const void*);
+static uint64_t hash_bytes(const char*, size_t);
+static bool replay_next(void*, LoadRequest*);
+static void print_comparison(ReplaySource*, LoadReport*, FILE*);
+
+/**
+ * entry point of client.out --replay. loads the capture log, prepares the
+ *   synthetic files, replays the requests and prints the reports.
+ *
+ * @function   replay_main
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * unless set with -n, there are twice as many logical clients as requests
+ *   were ever in progress at once in the log, times the speed, so that a
+ *   server as fast as the recorded one never has requests wait for a
+ *   client.
+ *
+ * @signature  int replay_main(int argc, char** argv)
+ *
+ * @param      argc number of arguments, starting at "--replay".
+ * @param      argv arguments, starting at "--replay".
+ *
+ * @return     return code, indication the nature of process termination.
+ */
+int replay_main(int argc, char** argv)
+{
+    static ReplaySource source;
+    static LoadReport report;
+    LoadConfig config;
+    ReplayEntry* last;
+    char* log;
+    size_t len;
+    char name[32];
+    int opt;
+    int i;
+
+    config.clients  = 0;
+    config.grace    = DEFAULT_GRACE * NS_PER_S;
+    config.checksum = false;
+    config.keySpec  = 0;
+    config.shards   = 1;
+    config.leastLoaded = false;
+    source.speed    = 1.0;
+    source.dir      = 0;
+
+    while((opt = getopt(argc, argv, "n:x:D:g:k:S:b")) != -1)
+    {
+        switch(opt)
+        {
+        case 'n':
+            config.clients = atoi(optarg);
+            break;
+        case 'x':
+            source.speed = atof(optarg);
+            break;
+        case 'D':
+            source.dir = optarg;
+            break;
+        case 'g':
+            config.grace = (long long) (atof(optarg) * NS_PER_S);
+            break;
+        case 'k':
+            config.keySpec = optarg;
+            break;
+        case 'S':
+            config.shards = atoi(optarg);
+            break;
+        case 'b':
+            config.leastLoaded = true;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    /* verify command line arguments */
+    if(argc - optind != 1 || config.clients < 0 || source.speed <= 0
+        || config.shards < 1 || config.shards > MAX_SHARDS)
+    {
+        printf("usage: client.out --replay [-n clients] [-x speed] "
+            "[-D dir] [-g grace seconds] [-k key] [-S shards [-b]] "
+            "capturelog\n");
+        exit(0);
+    }
+
+    /* load the requests of the log */
+    log = load_log(argv[optind], &len);
+    if(log == 0)
+    {
+        fprintf(stderr, "failed to read capture log: %d\n", errno);
+        exit(1);
+    }
+    source.count = parse_log(log, len, &source.entries);
+    if(source.count < 0)
+    {
+        fprintf(stderr, "not a capture log: %s\n", argv[optind]);
+        exit(1);
+    }
+    if(source.count == 0)
+    {
+        fprintf(stderr, "no requests in capture log\n");
+        exit(1);
+    }
+    if(source.dir != 0 && !make_files(source.entries, source.count,
+        source.dir))
+    {
+        fprintf(stderr, "failed to make synthetic files: %d\n", errno);
+        exit(1);
+    }
+
+    /* report on every priority separately */
+    loadgen_init_report(&report, false);
+    for(i = 0; i < 256; ++i)
+    {
+        source.tags[i] = -1;
+    }
+    for(i = 0; i < source.count; ++i)
+    {
+        int priority = source.entries[i].priority & 0xff;
+        if(source.tags[priority] < 0)
+        {
+            sprintf(name, "priority %d", priority);
+            source.tags[priority] = loadgen_add_tag(&report, name);
+        }
+    }
+
+    /* size the run after the log */
+    if(config.clients == 0)
+    {
+        config.clients = (int) ceil(2.0 * peak_concurrency(source.entries,
+            source.count) * (source.speed > 1.0 ? source.speed : 1.0));
+        if(config.clients < DEFAULT_MIN_CLIENTS)
+        {
+            config.clients = DEFAULT_MIN_CLIENTS;
+        }
+        if(config.clients > DEFAULT_MAX_CLIENTS)
+        {
+            config.clients = DEFAULT_MAX_CLIENTS;
+        }
+    }
+    last = &source.entries[source.count - 1];
+    config.duration = (long long) ((last->time - source.entries[0].time)
+        / source.speed) + 1;
+
+    /* replay the requests & report on them */
+    source.next = 0;
+    loadgen_run(&config, replay_next, &source, &report);
+    loadgen_print_report(&report, stdout);
+    print_comparison(&source, &report, stdout);
+
+    free(source.entries);
+    free(log);
+    return 0;
+}
+
+/**
+ * reads a whole capture log into memory.
+ *
+ * @function   load_log
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static char* load_log(const char* path, size_t* len)
+ *
+ * @param      path path of the log.
+ * @param      len set to the length of the log.
+ *
+ * @return     the log, to be freed by the caller; 0 if it could not be read.
+ */
+static char* load_log(const char* path, size_t* len)
+{
+    struct stat st;
+    char* log;
+    size_t got = 0;
+    ssize_t n;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return 0;
+    }
+    if(fstat(fd, &st) < 0 || (log = malloc(st.st_size + 1)) == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    /* the server may still be appending; the size at the start is read */
+    while(got < (size_t) st.st_size
+        && (n = read(fd, log + got, st.st_size - got)) > 0)
+    {
+        got += n;
+    }
+    close(fd);
+
+    *len = got;
+    return log;
+}
+
+/**
+ * turns the records of a capture log into requests.
+ *
+ * @function   parse_log
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - tells the streams of a client apart.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the records of a request are tied together by the client's message type,
+ *   and its stream, which clients may use again once their request is
+ *   through. the streams of a multiplexing client are replayed as requests
+ *   of their own. a CONNECT
+ *   for a client whose last request is still going is a request sent back
+ *   by a sealed fanout session, and is not a request of its own. a record
+ *   cut short at the end of the log is left out.
+ *
+ * @signature  static long long parse_log(char* log, size_t len,
+ *   ReplayEntry** entries)
+ *
+ * @param      log the log, loaded into memory.
+ * @param      len length of the log.
+ * @param      entries set to the requests, in order of arrival; to be freed
+ *   by the caller.
+ *
+ * @return     number of requests; -1 if the log is not a capture log, or
+ *   they could not be kept.
+ */
+static long long parse_log(char* log, size_t len, ReplayEntry** entries)
+{
+    CaptureRecord rec;
+    ReplayEntry* entry;
+    long long* byType;
+    long long count = 0;
+    size_t capacity = 1;
+    size_t offset = CAPTURE_MAGIC_LEN;
+    size_t slot;
+
+    if(len < CAPTURE_MAGIC_LEN
+        || memcmp(log, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0)
+    {
+        return -1;
+    }
+
+    /* room for every record to be a request, and a table of their types */
+    while(capacity < 2 * (len / sizeof(CaptureRecord) + 1))
+    {
+        capacity <<= 1;
+    }
+    *entries = malloc((len / sizeof(CaptureRecord) + 1)
+        * sizeof(ReplayEntry));
+    byType = malloc(capacity * sizeof(long long));
+    if(*entries == 0 || byType == 0)
+    {
+        free(*entries);
+        free(byType);
+        return -1;
+    }
+    memset(byType, 0xff, capacity * sizeof(long long));
+
+    while(offset + sizeof(CaptureRecord) <= len)
+    {
+        memcpy(&rec, log + offset, sizeof(rec));
+        if(rec.len < sizeof(CaptureRecord) || offset + rec.len > len)
+        {
+            break;
+        }
+
+        /* find the last request of the client on the stream */
+        slot = (hash_bytes((char*) &rec.clientType, sizeof(rec.clientType))
+            ^ hash_bytes((char*) &rec.streamId, sizeof(rec.streamId)))
+            & (capacity - 1);
+        while(byType[slot] >= 0
+            && ((*entries)[byType[slot]].clientType != rec.clientType
+            || (*entries)[byType[slot]].streamId != rec.streamId))
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        entry = (byType[slot] >= 0) ? &(*entries)[byType[slot]] : 0;
+
+        if(rec.kind == CAPTURE_CONNECT && (entry == 0 || entry->ended)
+            && !(rec.flags & CONNECT_FLAG_FOLLOW))
+        {
+            entry = &(*entries)[count];
+            entry->time       = rec.time;
+            entry->size       = rec.value;
+            entry->doneTime   = 0;
+            entry->bytes      = 0;
+            entry->clientType = rec.clientType;
+            entry->streamId   = rec.streamId;
+            entry->priority   = rec.priority;
+            entry->flags      = rec.flags;
+            entry->ended      = false;
+            entry->completed  = false;
+            entry->file       = -1;
+            entry->path       = log + offset + sizeof(CaptureRecord);
+            entry->pathLen    = rec.len - sizeof(CaptureRecord);
+            byType[slot] = count++;
+        }
+        else if(rec.kind != CAPTURE_CONNECT && entry != 0 && !entry->ended)
+        {
+            entry->doneTime  = rec.time;
+            entry->bytes     = rec.value;
+            entry->ended     = true;
+            entry->completed = (rec.kind == CAPTURE_DONE);
+        }
+        offset += rec.len;
+    }
+
+    free(byType);
+    return count;
+}
+
+/**
+ * assigns every file of the log a synthetic file of the same size, and
+ *   writes the ones that do not exist yet.
+ *
+ * @function   make_files
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a file that changed size during the capture gets a synthetic file for
+ *   every size, so that every request reads as much as it did.
+ *
+ * @signature  static bool make_files(ReplayEntry* entries, long long count,
+ *   const char* dir)
+ *
+ * @param      entries the requests of the log.
+ * @param      count number of requests.
+ * @param      dir directory to keep the synthetic files in.
+ *
+ * @return     true upon success; false if a file could not be written.
+ */
+static bool make_files(ReplayEntry* entries, long long count,
+    const char* dir)
+{
+    char path[MAX_FILEPATH_LEN];
+    long long* byFile;
+    size_t capacity = 1;
+    size_t slot;
+    int files = 0;
+    long long i;
+
+    if(mkdir(dir, 0755) < 0 && errno != EEXIST)
+    {
+        return false;
+    }
+
+    while(capacity < 2 * (size_t) count)
+    {
+        capacity <<= 1;
+    }
+    byFile = malloc(capacity * sizeof(long long));
+    if(byFile == 0)
+    {
+        return false;
+    }
+    memset(byFile, 0xff, capacity * sizeof(long long));
+
+    for(i = 0; i < count; ++i)
+    {
+        ReplayEntry* entry = &entries[i];
+        ReplayEntry* other;
+
+        if(entry->size < 0)
+        {
+            continue;
+        }
+
+        /* requests for the same path & size share a file */
+        slot = (hash_bytes(entry->path, entry->pathLen) ^ entry->size)
+            & (capacity - 1);
+        while(byFile[slot] >= 0)
+        {
+            other = &entries[byFile[slot]];
+            if(other->size == entry->size && other->pathLen == entry->pathLen
+                && memcmp(other->path, entry->path, entry->pathLen) == 0)
+            {
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if(byFile[slot] >= 0)
+        {
+            entry->file = entries[byFile[slot]].file;
+            continue;
+        }
+
+        entry->file = files++;
+        byFile[slot] = i;
+        snprintf(path, sizeof(path), "%s/%d.bin", dir, entry->file);
+        if(!write_synthetic(path, entry->size, entry->file + 1))
+        {
+            free(byFile);
+            return false;
+        }
+    }
+
+    free(byFile);
+    return true;
+}
+
+/**
+ * writes a synthetic file of pseudo-random bytes, unless one of the right
+ *   size is already there.
+ *
+ * @function   write_synthetic
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the bytes come from xorshift64, so that runs of zeros do not make sparse
+ *   files, and files of the same size differ.
+ *
+ * @signature  static bool write_synthetic(const char* path, long long size,
+ *   uint64_t seed)
+ *
+ * @param      path path of the file.
+ * @param      size size of the file.
+ * @param      seed seed of the bytes; must not be 0.
+ *
+ * @return     true upon success; false if the file could not be written.
+ */
+static bool write_synthetic(const char* path, long long size, uint64_t seed)
+{
+    uint64_t block[SYNTHETIC_WRITE_LEN / sizeof(uint64_t)];
+    struct stat st;
+    long long left = size;
+    size_t n;
+    size_t i;
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if(fd < 0 || fstat(fd, &st) < 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    if(st.st_size == size)
+    {
+        close(fd);
+        return true;
+    }
+
+    while(left > 0)
+    {
+        for(i = 0; i < sizeof(block) / sizeof(uint64_t); ++i)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            block[i] = seed;
+        }
+        n = left < (long long) sizeof(block) ? (size_t) left : sizeof(block);
+        if(write(fd, block, n) != (ssize_t) n)
+        {
+            close(fd);
+            return false;
+        }
+        left -= n;
+    }
+
+    if(ftruncate(fd, size) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+/**
+ * finds the most requests that were in progress at once in the log.
+ *
+ * @function   peak_concurrency
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a request that never ended counts as in progress until the end of the
+ *   log.
+ *
+ * @signature  static int peak_concurrency(ReplayEntry* entries,
+ *   long long count)
+ *
+ * @param      entries the requests of the log.
+ * @param      count number of requests.
+ *
+ * @return     the most requests in progress at once; 1 if it could not be
+ *   worked out.
+ */
+static int peak_concurrency(ReplayEntry* entries, long long count)
+{
+    long long* ends = malloc(count * sizeof(long long));
+    long long i;
+    long long done = 0;
+    int peak = 1;
+
+    if(ends == 0)
+    {
+        return 1;
+    }
+    for(i = 0; i < count; ++i)
+    {
+        ends[i] = entries[i].ended ? entries[i].doneTime : LLONG_MAX;
+    }
+    qsort(ends, count, sizeof(long long), compare_times);
+
+    /* requests arrive in order; count the ones that did not end before */
+    for(i = 0; i < count; ++i)
+    {
+        while(done < count && ends[done] <= entries[i].time)
+        {
+            ++done;
+        }
+        if(i + 1 - done > peak)
+        {
+            peak = (int) (i + 1 - done);
+        }
+    }
+
+    free(ends);
+    return peak;
+}
+
+/**
+ * compares two points in time, for qsort.
+ *
+ * @function   compare_times
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int compare_times(const void* a, const void* b)
+ *
+ * @param      a pointer to the first long long.
+ * @param      b pointer to the second long long.
+ *
+ * @return     less than, equal to, or greater than 0 as a is before, at, or
+ *   after b.
+ */
+static int compare_times(const void* a, const void* b)
+{
+    long long x = *(const long long*) a;
+    long long y = *(const long long*) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * hashes bytes with 64 bit fnv-1a.
+ *
+ * @function   hash_bytes
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static uint64_t hash_bytes(const char* data, size_t len)
+ *
+ * @param      data pointer to the first byte.
+ * @param      len number of bytes.
+ *
+ * @return     hash of the bytes.
+ */
+static uint64_t hash_bytes(const char* data, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for(i = 0; i < len; ++i)
+    {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * request source of --replay; produces the requests of the log, at their
+ *   recorded times divided by the speed.
+ *
+ * @function   replay_next
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool replay_next(void* sourceCtx, LoadRequest* req)
+ *
+ * @param      sourceCtx pointer to the ReplaySource.
+ * @param      req pointer to the request to fill in.
+ *
+ * @return     true if a request was produced; false at the end of the log.
+ */
+static bool replay_next(void* sourceCtx, LoadRequest* req)
+{
+    ReplaySource* source = sourceCtx;
+    ReplayEntry* entry;
+    int len;
+
+    if(source->next >= source->count)
+    {
+        return false;
+    }
+    entry = &source->entries[source->next++];
+
+    req->arrival  = (long long) ((entry->time - source->entries[0].time)
+        / source->speed);
+    req->priority = entry->priority;
+    req->tag      = source->tags[entry->priority & 0xff];
+
+    if(source->dir == 0)
+    {
+        len = entry->pathLen < MAX_FILEPATH_LEN - 1 ? entry->pathLen
+            : MAX_FILEPATH_LEN - 1;
+        memcpy(req->filePath, entry->path, len);
+        req->filePath[len] = 0;
+    }
+    else if(entry->file >= 0)
+    {
+        snprintf(req->filePath, MAX_FILEPATH_LEN, "%s/%d.bin", source->dir,
+            entry->file);
+    }
+    else
+    {
+        snprintf(req->filePath, MAX_FILEPATH_LEN, "%s/missing", source->dir);
+    }
+    return true;
+}
+
+/**
+ * reports on the recorded requests, and compares the replay to them.
+ *
+ * @function   print_comparison
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the ratios are replayed over recorded; above 1 is more throughput, or
+ *   longer latency, than recorded.
+ *
+ * @signature  static void print_comparison(ReplaySource* source,
+ *   LoadReport* report, FILE* file)
+ *
+ * @param      source pointer to the ReplaySource holding the log.
+ * @param      report pointer to the report of the replay.
+ * @param      file stream to print to.
+ */
+static void print_comparison(ReplaySource* source, LoadReport* report,
+    FILE* file)
+{
+    static Histogram recorded;
+    unsigned long long completed = 0;
+    unsigned long long failed = 0;
+    unsigned long long unfinished = 0;
+    unsigned long long bytes = 0;
+    long long first = source->entries[0].time;
+    long long end = source->entries[source->count - 1].time;
+    double span;
+    double recordedRate;
+    double replayedRate;
+    long long p50;
+    long long p99;
+    long long i;
+
+    histogram_init(&recorded);
+    for(i = 0; i < source->count; ++i)
+    {
+        ReplayEntry* entry = &source->entries[i];
+        if(!entry->ended)
+        {
+            ++unfinished;
+            continue;
+        }
+        if(entry->doneTime > end)
+        {
+            end = entry->doneTime;
+        }
+        if(entry->completed)
+        {
+            ++completed;
+            bytes += entry->bytes;
+            histogram_record(&recorded, entry->doneTime - entry->time);
+        }
+        else
+        {
+            ++failed;
+        }
+    }
+
+    span = (end - first) / source->speed / NS_PER_S;
+    recordedRate = span > 0 ? bytes / span / 1e6 : 0;
+    replayedRate = report->elapsed > 0
+        ? report->bytes / ((double) report->elapsed / NS_PER_S) / 1e6 : 0;
+
+    fprintf(file, "recorded: requests=%lld completed=%llu failed=%llu "
+        "unfinished=%llu span=%.3fs throughput=%.3fMB/s\n", source->count,
+        completed, failed, unfinished, span, recordedRate);
+    histogram_print_summary(&recorded, file, "recorded service");
+
+    fprintf(file, "replayed/recorded: throughput=x%.3f",
+        recordedRate > 0 ? replayedRate / recordedRate : 0);
+    p50 = histogram_percentile(&recorded, 50.0);
+    p99 = histogram_percentile(&recorded, 99.0);
+    if(p50 > 0 && p99 > 0 && report->completed > 0)
+    {
+        fprintf(file, " service p50=x%.3f p99=x%.3f",
+            (double) histogram_percentile(&report->service, 50.0) / p50,
+            (double) histogram_percentile(&report->service, 99.0) / p99);
+    }
+    fprintf(file, "\n");
+}
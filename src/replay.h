@@ -0,0 +1,28 @@
+/**
+ * header file for replay.c, exposing its interface.
+ *
+ * @sourceFile replay.h
+ *
+ * @program    client.out
+ *
+ * @function   int replay_main(int argc, char** argv);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/**
+ * function prototypes
+ */
+int replay_main(int argc, char** argv);
+
+#endif
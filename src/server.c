@@ -5,11 +5,22 @@
  *
  * @program    server.out
  *
- * @function   int main(void)
+ * @function   int main(int argc, char** argv)
  * @function   static int sigint_handler(int sigNum)
  * @function   static void msgq_read_loop(int msgQId)
  * @function   static bool parse_msgq_msg(Message* msg)
  * @function   static void handle_connect_msg(ConnectMsg* connectMsg)
+ * @function   static void handle_sealed_msg(PidMsg* pidMsg)
+ * @function   static pid_t start_session(ConnectMsg* connectMsg, bool fanout,
+ *   int fileFd)
+ * @function   static void sigusr2_handler(int sigNum)
+ * @function   static void sigchld_handler(int sigNum)
+ * @function   static void reap_sessions(void)
+ * @function   static void print_usage(char* progName)
+ * @function   static void sigusr1_handler(int sigNum)
+ * @function   static void upgrade_server(void)
+ * @function   static void sighup_handler(int sigNum)
+ * @function   static void load_limits(void)
  *
  * @date       2015-02-11
  *
@@ -23,7 +34,44 @@
  *
  * the server waits for clients to connect, and parses their request, and
  *   transfers the files contents to the server.
+ *
+ * concurrent requests for the same version of a file are served by a single
+ *   session, which reads the file once for all of them.
+ *
+ * the server and its sessions record latencies into shared histograms, which
+ *   are printed to stderr on exit, and whenever the server gets SIGUSR2.
+ *
+ * when started with -m or -p, the server also serves metrics in prometheus
+ *   text format on a UNIX socket, or a loopback port; see metrics.c.
+ *
+ * several servers can run side by side as shards, each on a message queue
+ *   of its own (-k & -s), and pinned to cores of its own (-c); see shard.c.
+ *
+ * on SIGUSR1, the server execs the binary it was started from in its own
+ *   place, handing over the message queue, the statistics and the sessions
+ *   without dropping a request; see upgrade.c.
+ *
+ * the server keeps the files it serves open, along with their stat, so that
+ *   requests for small, popular files skip the path lookup & open; see
+ *   fdcache.c.
+ *
+ * when started with -L, the server holds clients to the rate limits in the
+ *   given file, and reads it again on SIGHUP; see ratelimit.c.
+ *
+ * files of at least the cold threshold (-C) are read by their sessions
+ *   without filling the page cache, so that a huge one-off transfer does not
+ *   evict the files that every other client reads; see dropbehind.c.
+ *
+ * when started with -R, the server records every request, and how its
+ *   session went, in a capture log that client.out --replay plays back
+ *   against another server; see capture.c.
+ *
+ * on a machine with several NUMA nodes, every session is placed on the node
+ *   of the file that it sends, or of the client that it serves (-N); see
+ *   numa.c.
  */
+#define _GNU_SOURCE
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -36,8 +84,23 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <fcntl.h>
+#include <limits.h>
 #include "messagequeuehelper.h"
 #include "session.h"
+#include "fanout.h"
+#include "registry.h"
+#include "trace.h"
+#include "serverstats.h"
+#include "clockhelper.h"
+#include "metrics.h"
+#include "shard.h"
+#include "upgrade.h"
+#include "fdcache.h"
+#include "ratelimit.h"
+#include "dropbehind.h"
+#include "capture.h"
+#include "validator.h"
+#include "numa.h"
 
 /* typedefs */
 typedef void (*sighandler_t)(int);
@@ -47,6 +110,16 @@ static void sigint_handler(int);
 static int msgq_read_loop(int);
 static bool parse_msgq_msg(Message*);
 static void handle_connect_msg(ConnectMsg*);
+static void handle_sealed_msg(PidMsg*);
+static void sigusr2_handler(int);
+static void sigchld_handler(int);
+static void reap_sessions(void);
+static void print_usage(char*);
+static void sigusr1_handler(int);
+static void upgrade_server(void);
+static void sighup_handler(int);
+static void load_limits(void);
+static pid_t start_session(ConnectMsg*, bool, int);
 
 /**
  * message queue id used by the server.
@@ -54,6 +127,26 @@ static void handle_connect_msg(ConnectMsg*);
 static int msgQId;
 static sighandler_t previousSigHandler;
 
+/* set by SIGUSR2, asking for the statistics to be printed */
+static volatile sig_atomic_t dumpRequested = 0;
+
+/* set by SIGCHLD, telling the server that sessions have ended */
+static volatile sig_atomic_t childExited = 0;
+
+/* when the last session was forked; inherited by the session */
+static long long forkTime = 0;
+
+/* set by SIGUSR1, asking the server to exec a new binary in its place */
+static volatile sig_atomic_t upgradeRequested = 0;
+
+/* binary and arguments that the server was started with; exec'd on SIGUSR1 */
+static char exePath[PATH_MAX];
+static char** upgradeArgv;
+
+/* file holding the rate limits, and whether SIGHUP asked to read it again */
+static char* limitsPath = 0;
+static volatile sig_atomic_t reloadRequested = 0;
+
 /**
  * sets up the message queue, and listens for clients to connect.
  *
@@ -61,33 +154,282 @@ static sighandler_t previousSigHandler;
  *
  * @date       2015-02-10
  *
- * @revision   none
+ * @revision   2026-10-18 - sets up the shared statistics, SIGUSR2, the
+ *   metrics endpoint, the queue key, and the CPU affinity.
+ * @revision   2026-10-18 - takes over a running server when exec'd by it.
+ * @revision   2026-10-18 - sets up the open file cache.
+ * @revision   2026-10-18 - sets up the rate limits.
+ * @revision   2026-10-18 - sets the cold threshold.
+ * @revision   2026-10-18 - opens the capture log.
+ * @revision   2026-10-18 - sets up the cache of file digests.
+ * @revision   2026-10-18 - sets up the NUMA placement of sessions.
+ * @revision   2026-10-18 - sets up the progress table of the registry.
+ * @revision   2026-10-18 - an upgraded server never removes the queue.
  *
  * @designer   EricTsang
  *
  * @programmer EricTsang
  *
- * @note       none
+ * @note
+ *
+ * options: -m path serves metrics on a UNIX socket at path, -p port serves
+ *   them on a loopback TCP port, and -i ms sets how often the message queue
+ *   is sampled for them.
+ *
+ * -k key sets the key of the message queue, as a number or an ftok path,
+ *   and -s n makes the server shard n of that key. -c cpus pins the server,
+ *   and the sessions it forks, to a list of CPUs like 0-3,8.
  *
- * @signature  int main(void)
+ * -F n sets how many files the server keeps open for its sessions; 0 turns
+ *   the cache off.
+ *
+ * -L path holds clients to the rate limits in a file, which is read again
+ *   whenever the server gets SIGHUP.
+ *
+ * -C bytes sets the size from which files are read without keeping them in
+ *   the page cache; 0 leaves it to the clients to ask for that.
+ *
+ * -R path records the requests, and how they went, in a capture log at
+ *   path; an existing log is appended to.
+ *
+ * -N policy places sessions on the NUMA node of their client (client), of
+ *   their file, if it is cached (file), of either, preferring the file
+ *   (auto, the default), or nowhere in particular (off).
+ *
+ * -U fd is only passed by a server exec'ing itself on SIGUSR1; the new
+ *   server reads the state of the old one from fd, instead of creating the
+ *   message queue and the statistics. as the sessions of the old server
+ *   still use the queue, the new server does not remove it when it fails to
+ *   set up; it serves without the rate limits file, or without metrics,
+ *   instead.
+ *
+ * @signature  int main(int argc, char** argv)
+ *
+ * @param      argc number of command line arguments
+ * @param      argv array of command line arguments
  *
  * @return     return code, indication the nature of process termination.
  */
-int main(void)
+int main(int argc, char** argv)
 {
     int exitCode;
+    struct sigaction action;
+    char* metricsPath = 0;
+    int metricsPort = 0;
+    int sampleMs = METRICS_DEFAULT_SAMPLE_MS;
+    char* keySpec = 0;
+    int shard = 0;
+    cpu_set_t cpus;
+    bool pinned = false;
+    key_t key;
+    int stateFd = -1;
+    int cacheSize = FDCACHE_DEFAULT_CAPACITY;
+    long long coldThreshold = COLD_DEFAULT_THRESHOLD;
+    char* capturePath = 0;
+    int numaPolicy = NUMA_POLICY_AUTO;
+    int opt;
+    int i;
+    int n = 0;
+
+    /* remember how the server was started, for upgrade_server; the path is
+     *   resolved now, as the binary may be replaced by the time it is used */
+    if(readlink("/proc/self/exe", exePath, sizeof(exePath) - 1) < 0)
+    {
+        strcpy(exePath, argv[0]);
+    }
+    upgradeArgv = malloc((argc + 3) * sizeof(char*));
+    for(i = 0; i < argc; ++i)
+    {
+        if(strcmp(argv[i], UPGRADE_OPTION) == 0)
+        {
+            ++i;
+            continue;
+        }
+        upgradeArgv[n++] = argv[i];
+    }
+    upgradeArgv[n] = 0;
+
+    /* parse command line options */
+    while((opt = getopt(argc, argv, "m:p:i:k:s:c:F:L:U:C:R:N:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'F':
+            cacheSize = atoi(optarg);
+            break;
+        case 'L':
+            limitsPath = optarg;
+            break;
+        case 'C':
+            coldThreshold = atoll(optarg);
+            break;
+        case 'R':
+            capturePath = optarg;
+            break;
+        case 'N':
+            numaPolicy = numa_policy_of(optarg);
+            break;
+        case 'U':
+            stateFd = atoi(optarg);
+            break;
+        case 'm':
+            metricsPath = optarg;
+            break;
+        case 'p':
+            metricsPort = atoi(optarg);
+            break;
+        case 'i':
+            sampleMs = atoi(optarg);
+            break;
+        case 'k':
+            keySpec = optarg;
+            break;
+        case 's':
+            shard = atoi(optarg);
+            break;
+        case 'c':
+            if(!numa_parse_cpus(optarg, &cpus))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            pinned = true;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(optind != argc || metricsPort < 0 || metricsPort > 65535
+        || sampleMs <= 0 || shard < 0 || shard >= MAX_SHARDS
+        || cacheSize < 0 || coldThreshold < 0 || numaPolicy < 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if(shard_key(keySpec, shard, &key) < 0)
+    {
+        fprintf(stderr, "shard_key failed: %d\n", errno);
+        exit(1);
+    }
+    set_message_queue_key(key);
+    set_cold_threshold(coldThreshold);
+    if(capturePath != 0 && capture_open(capturePath) < 0)
+    {
+        fprintf(stderr, "capture_open failed: %d\n", errno);
+        exit(1);
+    }
+
+    /* sessions inherit the affinity */
+    if(pinned && sched_setaffinity(0, sizeof(cpus), &cpus) < 0)
+    {
+        fprintf(stderr, "sched_setaffinity failed: %d\n", errno);
+        exit(1);
+    }
+
+    TRACE_INIT("server");
 
     /* set up signal handler to remove IPC. */
     previousSigHandler = signal(SIGINT, sigint_handler);
 
-    /* create the message queue. */
-    make_message_queue(&msgQId);
+    /* sessions taken over below are registered into it */
+    if(registry_init(REGISTRY_PROGRESS_SLOTS) < 0)
+    {
+        fprintf(stderr, "registry_init failed: %d\n", errno);
+    }
+
+    if(stateFd >= 0)
+    {
+        /* take over the message queue, statistics & sessions of the server
+         *   that exec'd this one */
+        if(upgrade_load(stateFd, &msgQId) < 0)
+        {
+            /* no shared memory at all; the queue is left to the sessions,
+             *   and goes stale once they are done */
+            fprintf(stderr, "upgrade_load failed: %d\n", errno);
+            exit(1);
+        }
+        printf("upgraded; serving message queue %#x\n", (unsigned int) key);
+        fflush(stdout);
+    }
+    else
+    {
+        /* create the message queue. */
+        make_message_queue(&msgQId);
+        printf("serving message queue %#x\n", (unsigned int) key);
+        fflush(stdout);
+
+        /* set up the statistics & limits before any session shares them */
+        if(stats_init() < 0)
+        {
+            fprintf(stderr, "stats_init failed: %d\n", errno);
+            remove_message_queue(msgQId);
+            exit(1);
+        }
+        if(rate_limit_init() < 0)
+        {
+            fprintf(stderr, "rate_limit_init failed: %d\n", errno);
+            remove_message_queue(msgQId);
+            exit(1);
+        }
+    }
+    if(limitsPath != 0 && rate_limit_load(limitsPath) < 0)
+    {
+        fprintf(stderr, "rate_limit_load failed: %d\n", errno);
+        if(stateFd < 0)
+        {
+            remove_message_queue(msgQId);
+            exit(1);
+        }
+    }
+
+    if(fdcache_init(cacheSize) < 0)
+    {
+        fprintf(stderr, "fdcache_init failed: %d\n", errno);
+    }
+    if(validator_cache_init(VALIDATOR_CACHE_SLOTS) < 0)
+    {
+        fprintf(stderr, "validator_cache_init failed: %d\n", errno);
+    }
+    numa_init(numaPolicy);
+
+    /* print statistics on SIGUSR2, and reap sessions on SIGCHLD; msgrcv is
+     *   never restarted, so either one wakes up the main loop */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sigusr2_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, 0);
+    action.sa_handler = sigchld_handler;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, 0);
+    action.sa_handler = sigusr1_handler;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, 0);
+    action.sa_handler = sighup_handler;
+    sigaction(SIGHUP, &action, 0);
+
+    /* sessions that ended while the old server exec'd this one */
+    reap_sessions();
+
+    /* serve metrics, if asked to */
+    if((metricsPath != 0 || metricsPort != 0)
+        && metrics_start(msgQId, metricsPath, metricsPort, sampleMs) < 0)
+    {
+        fprintf(stderr, "metrics_start failed: %d\n", errno);
+        if(stateFd < 0)
+        {
+            remove_message_queue(msgQId);
+            exit(1);
+        }
+    }
 
     /* execute main loop of the server. */
     exitCode = msgq_read_loop(msgQId);
 
     /* remove message queue. */
     remove_message_queue(msgQId);
+    stats_dump(stderr);
 
     /* end program... */
     return exitCode;
@@ -119,9 +461,267 @@ int main(void)
 static void sigint_handler(int sigNum)
 {
     remove_message_queue(msgQId);
+    stats_dump(stderr);
     exit(sigNum);
 }
 
+/**
+ * handler for the SIGUSR2 signal, which asks the server to print its
+ *   statistics.
+ *
+ * @function   sigusr2_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the statistics are printed by msgq_read_loop, once msgrcv has been
+ *   interrupted, rather than from the handler.
+ *
+ * @signature  static void sigusr2_handler(int sigNum)
+ *
+ * @param      sigNum number of the signal; always SIGUSR2.
+ */
+static void sigusr2_handler(int sigNum)
+{
+    dumpRequested = (sigNum == SIGUSR2);
+}
+
+/**
+ * signal handler for SIGCHLD; tells the main loop that sessions have ended.
+ *
+ * @function   sigchld_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void sigchld_handler(int sigNum)
+ *
+ * @param      sigNum type of signal received
+ */
+static void sigchld_handler(int sigNum)
+{
+    childExited = (sigNum == SIGCHLD);
+}
+
+/**
+ * reaps the sessions that have ended, and publishes how many are left.
+ *
+ * @function   reap_sessions
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void reap_sessions(void)
+ */
+static void reap_sessions(void)
+{
+    childExited = 0;
+    registry_reap();
+    stats_set_sessions(registry_count());
+}
+
+/**
+ * handler for the SIGHUP signal, which asks the server to read its rate
+ *   limits again.
+ *
+ * @function   sighup_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       the limits are read by msgq_read_loop, like the statistics.
+ *
+ * @signature  static void sighup_handler(int sigNum)
+ *
+ * @param      sigNum number of the signal; always SIGHUP.
+ */
+static void sighup_handler(int sigNum)
+{
+    reloadRequested = (sigNum == SIGHUP);
+}
+
+/**
+ * reads the rate limits again, keeping the ones in force if the file is
+ *   bad.
+ *
+ * @function   load_limits
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       running sessions pick the new limits up with their next send.
+ *
+ * @signature  static void load_limits(void)
+ */
+static void load_limits(void)
+{
+    int ruleCount;
+
+    reloadRequested = 0;
+    if(limitsPath == 0)
+    {
+        return;
+    }
+
+    ruleCount = rate_limit_load(limitsPath);
+    if(ruleCount < 0)
+    {
+        fprintf(stderr, "rate_limit_load failed: %d\n", errno);
+        return;
+    }
+    printf("loaded %d rate limits from %s\n", ruleCount, limitsPath);
+    fflush(stdout);
+}
+
+/**
+ * prints the usage of the server.
+ *
+ * @function   print_usage
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void print_usage(char* progName)
+ *
+ * @param      progName name of the program, as it was invoked.
+ */
+static void print_usage(char* progName)
+{
+    fprintf(stderr, "usage: %s [-k key | -k ftokpath] [-s shard] [-c cpus] "
+        "[-m socketpath | -p port] [-i sample_ms] [-F cached_files] "
+        "[-L limitsfile] [-C cold_bytes] [-R capturelog] "
+        "[-N off|client|file|auto]\n", progName);
+}
+
+/**
+ * handler for the SIGUSR1 signal, which asks the server to exec a new binary
+ *   in its place.
+ *
+ * @function   sigusr1_handler
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the exec is done by msgq_read_loop, between two messages.
+ *
+ * @signature  static void sigusr1_handler(int sigNum)
+ *
+ * @param      sigNum number of the signal; always SIGUSR1.
+ */
+static void sigusr1_handler(int sigNum)
+{
+    upgradeRequested = (sigNum == SIGUSR1);
+}
+
+/**
+ * execs the binary that the server was started from in place of the server,
+ *   handing over its state.
+ *
+ * @function   upgrade_server
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - makes everything it handed over close-on-exec
+ *   again if the exec fails.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the process id stays the same, so clients keep sending to the same
+ *   message queue, and sessions keep running as children of the server.
+ *
+ * only returns if the exec failed, in which case the old server carries on.
+ *
+ * @signature  static void upgrade_server(void)
+ */
+static void upgrade_server(void)
+{
+    char fdString[16];
+    int stateFd;
+    int n;
+
+    upgradeRequested = 0;
+
+    stateFd = upgrade_save(msgQId);
+    if(stateFd < 0)
+    {
+        fprintf(stderr, "upgrade_save failed: %d\n", errno);
+        return;
+    }
+
+    /* append -U fd to the original arguments */
+    sprintf(fdString, "%d", stateFd);
+    for(n = 0; upgradeArgv[n] != 0; ++n)
+    {
+    }
+    upgradeArgv[n] = UPGRADE_OPTION;
+    upgradeArgv[n + 1] = fdString;
+    upgradeArgv[n + 2] = 0;
+
+    printf("upgrading to %s\n", exePath);
+    fflush(stdout);
+    fflush(stderr);
+    execv(exePath, upgradeArgv);
+
+    fprintf(stderr, "execv failed: %d\n", errno);
+    upgradeArgv[n] = 0;
+    fcntl(stats_fd(), F_SETFD, FD_CLOEXEC);
+    fcntl(rate_limit_fd(), F_SETFD, FD_CLOEXEC);
+    if(metrics_fd() >= 0)
+    {
+        fcntl(metrics_fd(), F_SETFD, FD_CLOEXEC);
+    }
+    close(stateFd);
+}
+
 /**
  * blocking function. this is the loop that reads from the message queue, and
  *   passes them on to handler functions.
@@ -130,7 +730,11 @@ static void sigint_handler(int sigNum)
  *
  * @date       2015-02-10
  *
- * @revision   none
+ * @revision   2026-10-18 - a signal interrupting msgrcv no longer ends the
+ *   loop; pending statistics requests, and ended sessions are handled
+ *   instead.
+ * @revision   2026-10-18 - execs a new server binary on SIGUSR1.
+ * @revision   2026-10-18 - reloads the rate limits on SIGHUP.
  *
  * @designer   Eric Tsang
  *
@@ -156,13 +760,31 @@ static int msgq_read_loop(int msgQId)
         case 0:     /* handle EOF */
             breakMsgLoop = true;
             break;
-        case -1:    /* handle error */
-            breakMsgLoop = true;
+        case -1:    /* handle error, or a signal */
+            breakMsgLoop = (errno != EINTR);
             break;
         default:    /* handle message */
             breakMsgLoop = !parse_msgq_msg(&msg);
             break;
         }
+
+        if(dumpRequested)
+        {
+            dumpRequested = 0;
+            stats_dump(stderr);
+        }
+        if(childExited)
+        {
+            reap_sessions();
+        }
+        if(upgradeRequested)
+        {
+            upgrade_server();
+        }
+        if(reloadRequested)
+        {
+            load_limits();
+        }
     }
 
     return 0;
@@ -200,9 +822,14 @@ static bool parse_msgq_msg(Message* msg)
     switch(msg->dataType)
     {
     case MSG_DATA_CONNECT:  /* handle connection message */
+        stats_mark_connect(msg->sendTime);
         handle_connect_msg(&msg->data.connectMsg);
         returnVal = true;
         break;
+    case MSG_DATA_SEALED:   /* handle session no longer accepting joins */
+        handle_sealed_msg(&msg->data.pidMsg);
+        returnVal = true;
+        break;
     default:                /* handle any other kind of message */
         fprintf(stderr, "unknown message type!\n");
         returnVal = false;
@@ -219,7 +846,11 @@ static bool parse_msgq_msg(Message* msg)
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - requests for a file that a session is already
+ *   reading are forwarded to that session.
+ * @revision   2026-10-18 - looks the file up in the open file cache.
+ * @revision   2026-10-18 - records the request in the capture log.
+ * @revision   2026-10-18 - does not share multiplexed requests.
  *
  * @designer   EricTsang
  *
@@ -230,32 +861,189 @@ static bool parse_msgq_msg(Message* msg)
  * this function handles a connection request message by starting a new process
  *   that will be used to serve the client.
  *
+ * if a session that can still be joined is reading the same version of the
+ *   file with the same priority, the request is forwarded to it as a JOIN
+ *   message instead. only plain requests, without any flags, are shared;
+ *   the streams of a multiplexing client are not, as a fanout session only
+ *   sends on stream 0, and does not take credits.
+ *
  * @signature  static void handle_connect_msg(ConnectMsg* connectMsg)
  *
  * @param      connectMsg pointer to the received ConnectMsg structure
  */
 static void handle_connect_msg(ConnectMsg* connectMsg)
 {
+    FileKey key;
+    pid_t sessionPid;
+    struct stat info;
+    long long openStart;
+    int fileFd;
+
+    TRACE_INSTANT("connect received", connectMsg->clientPid);
+
+    /* forget sessions that have ended, so requests aren't sent to them */
+    reap_sessions();
+
+    /* the cached stat saves looking the path up again for the key */
+    openStart = clock_now_ns();
+    fileFd = fdcache_open(connectMsg->filePath, &info);
+    if(fileFd != -1)
+    {
+        histogram_record(&stats_get()->openTime, clock_now_ns() - openStart);
+    }
+    capture_connect(connectMsg, (fileFd != -1) ? &info : 0);
+
+    if(connectMsg->flags == 0 && connectMsg->streamId == 0 && (fileFd != -1
+        ? file_key_from(&info, connectMsg->priority, &key)
+        : file_key_of(connectMsg->filePath, connectMsg->priority, &key)))
+    {
+        sessionPid = registry_find_joinable(&key);
+        if(sessionPid != 0)
+        {
+            Message joinMsg;
+            joinMsg.dataType = MSG_DATA_JOIN;
+            joinMsg.data.connectMsg = *connectMsg;
+            while(msg_send(msgQId, &joinMsg, sessionPid) < 0 && errno == EINTR)
+            {
+                /* interrupted by a signal before the message was queued */
+            }
+            printf("clientType %ld joined session %d\n",
+                connectMsg->clientType, sessionPid);
+            fflush(stdout);
+        }
+        else if((sessionPid = start_session(connectMsg, true, fileFd)) > 0)
+        {
+            registry_add(sessionPid, &key);
+        }
+    }
+    else if((sessionPid = start_session(connectMsg, false, fileFd)) > 0)
+    {
+        registry_add(sessionPid, 0);
+    }
+    stats_set_sessions(registry_count());
+}
+
+/**
+ * handles a session telling the server that it no longer accepts JOIN
+ *   messages.
+ *
+ * @function   handle_sealed_msg
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the message is echoed back to the session, so that it knows no more JOIN
+ *   messages are on their way to it.
+ *
+ * @signature  static void handle_sealed_msg(PidMsg* pidMsg)
+ *
+ * @param      pidMsg pointer to the received message, holding the process id
+ *   of the session.
+ */
+static void handle_sealed_msg(PidMsg* pidMsg)
+{
+    Message ackMsg;
+
+    registry_seal(pidMsg->pid);
+
+    ackMsg.dataType = MSG_DATA_SEALED;
+    ackMsg.data.pidMsg = *pidMsg;
+    while(msg_send(msgQId, &ackMsg, pidMsg->pid) < 0 && errno == EINTR)
+    {
+        /* interrupted by a signal before the message was queued */
+    }
+}
+
+/**
+ * starts a new process to serve the client.
+ *
+ * @function   start_session
+ *
+ * @date       2015-02-11
+ *
+ * @revision   2026-10-18 - split out of handle_connect_msg.
+ * @revision   2026-10-18 - passes on the file opened by the server.
+ * @revision   2026-10-18 - places the session on a NUMA node.
+ * @revision   2026-10-18 - closes the metrics socket in the session.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static pid_t start_session(ConnectMsg* connectMsg, bool fanout,
+ *   int fileFd)
+ *
+ * @param      connectMsg pointer to the received ConnectMsg structure
+ * @param      fanout true if the session should accept other clients joining
+ *   it; false otherwise.
+ * @param      fileFd descriptor of the file, inherited by the session; -1 if
+ *   the session has to open the file itself.
+ *
+ * @return     process id of the new session; -1 if it could not be started.
+ */
+static pid_t start_session(ConnectMsg* connectMsg, bool fanout, int fileFd)
+{
+    pid_t pid;
+
+    TRACE_BEGIN("fork");
+    forkTime = clock_now_ns();
+    pid = fork();
+
+    if(pid < 0)
+    {
+        fprintf(stderr, "fork failed: %d\n", errno);
+    }
+    if(pid != 0)
+    {
+        TRACE_END("fork");
+    }
+
     /* create a new process to serve the client */
-    if(fork() == 0)
+    if(pid == 0)
     {
         int returnValue;
 
-        /* reset signal handler */
+        TRACE_CHILD(fanout ? "fanout session" : "session");
+        TRACE_INSTANT("forked", connectMsg->clientPid);
+        histogram_record(&stats_get()->forkDelay, clock_now_ns() - forkTime);
+
+        /* reset signal handlers; statistics are only printed by the server */
         signal(SIGINT, previousSigHandler);
+        signal(SIGUSR1, SIG_IGN);
+        signal(SIGUSR2, SIG_IGN);
+        signal(SIGHUP, SIG_IGN);
+        signal(SIGCHLD, SIG_DFL);
+
+        /* only the server serves metrics */
+        metrics_close_in_child();
+
+        /* move to the node of the file or client before allocating */
+        numa_place(connectMsg, fileFd);
 
         /* print connection request */
         printf("connectMsg:\n");
         printf("    clientPid: %d\n", connectMsg->clientPid);
+        printf("    clientType: %ld\n", connectMsg->clientType);
         printf("    priority: %d\n", connectMsg->priority);
+        printf("    flags: %#x\n", connectMsg->flags);
         printf("    filePath: %s\n", connectMsg->filePath);
 
         /* handle connection request */
-        returnValue = serve_client(
-            connectMsg->clientPid,
-            connectMsg->priority,
-            connectMsg->filePath);
+        returnValue = fanout
+            ? serve_fanout(connectMsg, fileFd)
+            : serve_client(connectMsg, fileFd);
 
         exit(returnValue);
     }
+
+    return pid;
 }
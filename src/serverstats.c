@@ -0,0 +1,451 @@
+/**
+ * this file contains the statistics that the server and its sessions record
+ *   into, and report.
+ *
+ * @sourceFile serverstats.c
+ *
+ * @program    server.out
+ *
+ * @function   int stats_init(void)
+ * @function   int stats_attach(int fd)
+ * @function   int stats_fd(void)
+ * @function   ServerStats* stats_get(void)
+ * @function   void stats_mark_connect(long long sendTime)
+ * @function   void stats_first_byte(void)
+ * @function   void stats_dump(FILE* file)
+ * @function   void stats_add_bytes(int priority, long long bytes)
+ * @function   void stats_set_sessions(int activeSessions)
+ * @function   void stats_add_throttle(int priority, long long ns)
+ * @function   long long stats_session_bytes(void)
+ * @function   void stats_set_node(int node)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the statistics live in a shared mapping that the server sets up before
+ *   forking any session, so every session records into the same histograms
+ *   as the server, and the server reports on all of them. recording is
+ *   lock-free, which works across processes as well as threads.
+ *
+ * the mapping is backed by a memfd, so that a server upgrading itself can
+ *   pass it on to the new server, along with the sessions still using it.
+ */
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "serverstats.h"
+#include "clockhelper.h"
+
+/* statistics shared with the sessions, and the memfd behind them */
+static ServerStats* stats = 0;
+static int statsFd = -1;
+
+/* when the CONNECT that this session serves was sent; inherited on fork */
+static long long connectTime = 0;
+static bool firstByteSent = false;
+
+/* file bytes sent by this session, for its capture record */
+static long long sessionBytes = 0;
+
+/* NUMA node that this session was placed on; -1 if none */
+static int sessionNode = -1;
+
+/**
+ * sets up the shared statistics.
+ *
+ * @function   stats_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - backed by a memfd.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * must be called before any session is forked. a new memfd is zero-filled,
+ *   which leaves every counter at zero.
+ *
+ * @signature  int stats_init(void)
+ *
+ * @return     0 upon success; -1 if the shared memory could not be mapped.
+ */
+int stats_init(void)
+{
+    int fd = memfd_create("serverstats", MFD_CLOEXEC);
+
+    if(fd < 0 || ftruncate(fd, sizeof(ServerStats)) < 0
+        || stats_attach(fd) < 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    histogram_init(&stats->connectDelay);
+    histogram_init(&stats->forkDelay);
+    histogram_init(&stats->openTime);
+    histogram_init(&stats->firstByte);
+    return 0;
+}
+
+/**
+ * maps statistics set up by stats_init, possibly in an earlier server.
+ *
+ * @function   stats_attach
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the memfd must hold a ServerStats of the same layout; it is rejected if
+ *   its size differs.
+ *
+ * @signature  int stats_attach(int fd)
+ *
+ * @param      fd memfd holding the statistics.
+ *
+ * @return     0 upon success; -1 if the memfd could not be mapped.
+ */
+int stats_attach(int fd)
+{
+    struct stat st;
+    void* mem;
+
+    if(fstat(fd, &st) < 0 || st.st_size != sizeof(ServerStats))
+    {
+        return -1;
+    }
+    mem = mmap(0, sizeof(ServerStats), PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd, 0);
+    if(mem == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    stats = mem;
+    statsFd = fd;
+    return 0;
+}
+
+/**
+ * returns the memfd behind the shared statistics.
+ *
+ * @function   stats_fd
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int stats_fd(void)
+ *
+ * @return     file descriptor of the memfd; -1 before stats_init.
+ */
+int stats_fd(void)
+{
+    return statsFd;
+}
+
+/**
+ * returns the shared statistics.
+ *
+ * @function   stats_get
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  ServerStats* stats_get(void)
+ *
+ * @return     pointer to the shared statistics.
+ */
+ServerStats* stats_get(void)
+{
+    return stats;
+}
+
+/**
+ * remembers when the CONNECT message being handled was sent, and records how
+ *   long it was queued.
+ *
+ * @function   stats_mark_connect
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a session forked to serve the request inherits the send time, and uses it
+ *   for stats_first_byte.
+ *
+ * @signature  void stats_mark_connect(long long sendTime)
+ *
+ * @param      sendTime sendTime of the CONNECT message.
+ */
+void stats_mark_connect(long long sendTime)
+{
+    connectTime = sendTime;
+    histogram_record(&stats->connectDelay, clock_now_ns() - sendTime);
+}
+
+/**
+ * records the time to first byte of the session's client, the first time it
+ *   is called in the session.
+ *
+ * @function   stats_first_byte
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * clients that join a session later are not counted.
+ *
+ * @signature  void stats_first_byte(void)
+ */
+void stats_first_byte(void)
+{
+    if(!firstByteSent)
+    {
+        firstByteSent = true;
+        histogram_record(&stats->firstByte, clock_now_ns() - connectTime);
+    }
+}
+
+/**
+ * prints all statistics in the mergeable form of histogram_dump.
+ *
+ * @function   stats_dump
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - work done by filtering sessions.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * once a session has filtered its file, the filter counters follow on a line
+ *   of their own,
+ *
+ *   filter sessions=<n> scanned=<bytes> matched=<bytes> cpu=<ns>
+ *     cpu_per_gb=<ns>
+ *
+ *   which add up the same way, except for the cost per gigabyte scanned.
+ *
+ * @signature  void stats_dump(FILE* file)
+ *
+ * @param      file stream to print to.
+ */
+void stats_dump(FILE* file)
+{
+    histogram_dump(&stats->connectDelay, file, "server_connect_queue_delay");
+    histogram_dump(&stats->forkDelay, file, "server_fork_delay");
+    histogram_dump(&stats->openTime, file, "server_open_time");
+    histogram_dump(&stats->firstByte, file, "server_time_to_first_byte");
+    if(atomic_load(&stats->filterSessions) > 0)
+    {
+        unsigned long long scanned = atomic_load(&stats->filterScannedBytes);
+        unsigned long long cpuNs = atomic_load(&stats->filterCpuNs);
+        fprintf(file, "filter sessions=%llu scanned=%llu matched=%llu "
+            "cpu=%llu cpu_per_gb=%.0f\n", atomic_load(&stats->filterSessions),
+            scanned, atomic_load(&stats->filterMatchedBytes), cpuNs,
+            scanned > 0 ? cpuNs * 1e9 / scanned : 0.0);
+    }
+    fflush(file);
+}
+
+/**
+ * counts file bytes sent by the calling session.
+ *
+ * @function   stats_add_bytes
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - also counts the bytes of the session alone.
+ * @revision   2026-10-18 - and the bytes sent from the session's NUMA node.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void stats_add_bytes(int priority, long long bytes)
+ *
+ * @param      priority process priority that the bytes were sent at.
+ * @param      bytes number of bytes sent.
+ */
+void stats_add_bytes(int priority, long long bytes)
+{
+    sessionBytes += bytes;
+    if(priority >= MIN_PROC_PRIO && priority <= MAX_PROC_PRIO)
+    {
+        atomic_fetch_add_explicit(&stats->bytesSent[priority], bytes,
+            memory_order_relaxed);
+    }
+    if(sessionNode >= 0)
+    {
+        atomic_fetch_add_explicit(&stats->nodeBytes[sessionNode], bytes,
+            memory_order_relaxed);
+    }
+}
+
+/**
+ * publishes the number of sessions that the server is running.
+ *
+ * @function   stats_set_sessions
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * called by the server after it forked or reaped sessions; a rise in the
+ *   number also counts towards the sessions started.
+ *
+ * @signature  void stats_set_sessions(int activeSessions)
+ *
+ * @param      activeSessions number of sessions running.
+ */
+void stats_set_sessions(int activeSessions)
+{
+    int previous = atomic_exchange(&stats->activeSessions, activeSessions);
+
+    if(activeSessions > previous)
+    {
+        atomic_fetch_add(&stats->sessionsStarted, activeSessions - previous);
+    }
+}
+
+/**
+ * adds to the time that sends were held back by the rate limits.
+ *
+ * @function   stats_add_throttle
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void stats_add_throttle(int priority, long long ns)
+ *
+ * @param      priority process priority of the held back client.
+ * @param      ns nanoseconds that the client was held back for.
+ */
+void stats_add_throttle(int priority, long long ns)
+{
+    if(priority >= MIN_PROC_PRIO && priority <= MAX_PROC_PRIO)
+    {
+        atomic_fetch_add_explicit(&stats->throttledNs[priority], ns,
+            memory_order_relaxed);
+    }
+}
+
+/**
+ * tells how many file bytes the calling session has sent.
+ *
+ * @function   stats_session_bytes
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       a fanout session counts the bytes of all of its clients.
+ *
+ * @signature  long long stats_session_bytes(void)
+ *
+ * @return     number of bytes passed to stats_add_bytes by this process.
+ */
+long long stats_session_bytes(void)
+{
+    return sessionBytes;
+}
+
+/**
+ * records the NUMA node that the calling session was placed on.
+ *
+ * @function   stats_set_node
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the bytes that the session sends from then on are counted for the node as
+ *   well.
+ *
+ * @signature  void stats_set_node(int node)
+ *
+ * @param      node node that the session runs on, below NUMA_MAX_NODES.
+ */
+void stats_set_node(int node)
+{
+    if(node >= 0 && node < NUMA_MAX_NODES)
+    {
+        sessionNode = node;
+        atomic_fetch_add(&stats->nodeSessions[node], 1);
+    }
+}
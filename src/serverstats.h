@@ -0,0 +1,114 @@
+/**
+ * header file for serverstats.c, exposing its interface.
+ *
+ * @sourceFile serverstats.h
+ *
+ * @program    server.out
+ *
+ * @function   int stats_init(void);
+ * @function   int stats_attach(int fd);
+ * @function   int stats_fd(void);
+ * @function   ServerStats* stats_get(void);
+ * @function   void stats_mark_connect(long long sendTime);
+ * @function   void stats_first_byte(void);
+ * @function   void stats_dump(FILE* file);
+ * @function   void stats_add_bytes(int priority, long long bytes);
+ * @function   void stats_set_sessions(int activeSessions);
+ * @function   void stats_add_throttle(int priority, long long ns);
+ * @function   long long stats_session_bytes(void);
+ * @function   void stats_set_node(int node);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef SERVERSTATS_H
+#define SERVERSTATS_H
+
+#include <stdio.h>
+#include "histogram.h"
+#include "session.h"
+
+/* most NUMA nodes that sessions are placed on, and counted for; see numa.c */
+#define NUMA_MAX_NODES 16
+
+/**
+ * statistics shared by the server and all of its sessions. latencies are in
+ *   nanoseconds.
+ *
+ * connectDelay is the time a CONNECT message spent in the queue, forkDelay
+ *   the time from the server calling fork until the session runs, openTime
+ *   the time a session, or the server's file cache takes to open the file,
+ *   and firstByte the time from the client sending CONNECT until its
+ *   session sent the first data.
+ *
+ * bytesSent counts the file bytes sent at each process priority, and
+ *   activeSessions is kept up to date by the server as it forks and reaps
+ *   sessions. the fdCache counters are kept by fdcache.c. throttledNs is the
+ *   time that sessions held back sends to stay within the rate limits, at
+ *   each process priority. coldSessions counts the sessions that kept their
+ *   file out of the page cache.
+ *
+ * filterSessions counts the sessions that filtered their file, and the other
+ *   filter counters are kept by them; the bytes they scanned, the bytes of
+ *   the lines that they sent, and the cpu time that they took.
+ *
+ * of the requests for a file only if it changed, conditionalCurrent counts
+ *   those where the client's version was current, and conditionalChanged the
+ *   rest. digestsComputed counts the versions of files that were hashed for
+ *   them; see validator.c.
+ *
+ * nodeSessions counts the sessions placed on each NUMA node, and nodeBytes
+ *   the file bytes that they sent. unplacedSessions counts the sessions for
+ *   which no node could be told; see numa.c.
+ */
+typedef struct
+{
+    Histogram connectDelay;
+    Histogram forkDelay;
+    Histogram openTime;
+    Histogram firstByte;
+    _Atomic unsigned long long bytesSent[MAX_PROC_PRIO + 1];
+    _Atomic unsigned long long sessionsStarted;
+    _Atomic int activeSessions;
+    _Atomic unsigned long long fdCacheHits;
+    _Atomic unsigned long long fdCacheMisses;
+    _Atomic unsigned long long fdCacheInvalidations;
+    _Atomic unsigned long long throttledNs[MAX_PROC_PRIO + 1];
+    _Atomic unsigned long long coldSessions;
+    _Atomic unsigned long long filterSessions;
+    _Atomic unsigned long long filterScannedBytes;
+    _Atomic unsigned long long filterMatchedBytes;
+    _Atomic unsigned long long filterCpuNs;
+    _Atomic unsigned long long conditionalCurrent;
+    _Atomic unsigned long long conditionalChanged;
+    _Atomic unsigned long long digestsComputed;
+    _Atomic unsigned long long nodeSessions[NUMA_MAX_NODES];
+    _Atomic unsigned long long nodeBytes[NUMA_MAX_NODES];
+    _Atomic unsigned long long unplacedSessions;
+}
+ServerStats;
+
+/**
+ * function prototypes
+ */
+int stats_init(void);
+int stats_attach(int fd);
+int stats_fd(void);
+ServerStats* stats_get(void);
+void stats_mark_connect(long long sendTime);
+void stats_first_byte(void);
+void stats_dump(FILE* file);
+void stats_add_bytes(int priority, long long bytes);
+void stats_set_sessions(int activeSessions);
+void stats_add_throttle(int priority, long long ns);
+long long stats_session_bytes(void);
+void stats_set_node(int node);
+
+#endif
@@ -5,14 +5,23 @@
  *
  * @program    server.out
  *
- * @function   static int serve_client(pid_t clntPid, int priority, char*
- *   filePath)
+ * @function   int serve_client(ConnectMsg* request, int fileFd)
+ * @function   void set_cold_threshold(long long bytes)
+ * @function   bool is_cold_file(int fd)
  * @function   static int set_process_priority(int priority)
  * @function   static void sigusr1_handler(int sigNum)
  * @function   static void fatal(char* str)
- * @function   static void initialize(int clntPid, int priority, char* filePath)
+ * @function   static void initialize(long clntType, int priority, char*
+ *   filePath, int fileFd)
  * @function   static void terminate_program(bool clientPresent)
- * @function   static void read_loop(void)
+ * @function   static void read_loop(int priority, bool follow)
+ * @function   static void start_follow(char* filePath)
+ * @function   static long long wait_for_growth(void)
+ * @function   static bool reopen_file(void)
+ * @function   static void resume_from(long long offset, uint32_t checksum)
+ * @function   static void sparse_loop(int priority)
+ * @function   static void send_hole(long long* len)
+ * @function   static bool is_all_zero(const char* buf, size_t len)
  *
  * @date       2015-02-11
  *
@@ -22,25 +31,129 @@
  *
  * @programmer EricTsang
  *
- * @note       none
+ * @note
+ *
+ * in follow mode, the session does not stop at the end of the file. it waits
+ *   on inotify for the file to be written to, and sends the new bytes as they
+ *   appear. if the file is moved away or deleted (e.g. rotated), whatever was
+ *   still written to it is sent, and the session continues with the new file
+ *   at the same path once it exists.
+ *
+ * a resumed transfer starts where the client left off, as long as the bytes
+ *   it already has still match the start of the file.
+ *
+ * a delta transfer only sends the parts of the file that the client's own
+ *   copy lacks; see delta.c.
+ *
+ * a chunked transfer only sends the content-defined chunks of the file that
+ *   the client's chunk store lacks; see cas.c.
+ *
+ * a tree transfer sends every entry below the requested directory, while a
+ *   pool of threads walks it; see treewalk.c.
+ *
+ * a filtered transfer only sends a range of the file, or the lines of it
+ *   that contain a pattern; see filter.c.
+ *
+ * a conditional request is answered with a single message, and no data, if
+ *   the client already has the current version of the file; see
+ *   validator.c.
+ *
+ * a sparse transfer skips the holes of the file, and data that is all zeros,
+ *   and sends their length instead, so its cost follows the allocated data
+ *   rather than the size of the file.
+ *
+ * the file may have been opened by the server (see fdcache.c), in which case
+ *   its offset is shared with other sessions; it is only ever read with
+ *   pread, at the session's own readOffset.
+ *
+ * a cold transfer, asked for by the client, or of a file of at least the
+ *   cold threshold, drops the file's pages from the page cache behind the
+ *   read cursor, so that it does not evict the hot files of other clients;
+ *   see dropbehind.c. only plain & sparse reads do; delta & chunked
+ *   transfers map the file, and followed files are hot by nature.
+ *
+ * every message sent to the client is held back as long as needed to keep
+ *   the client within its rate limits; see ratelimit.c.
+ *
+ * a client may have many requests outstanding on the same message type,
+ *   each served by a session of its own; the messages of each carry the
+ *   stream of its request, and the data is held to the window that the
+ *   client asked for.
  */
+#define _GNU_SOURCE
+#include <sys/inotify.h>
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "session.h"
+#include "clockhelper.h"
+#include "checksum.h"
+#include "delta.h"
+#include "treewalk.h"
+#include "cas.h"
+#include "filter.h"
+#include "validator.h"
+#include "dropbehind.h"
+#include "trace.h"
+#include "serverstats.h"
+#include "chunkctl.h"
+#include "ratelimit.h"
+#include "capture.h"
 
 #define MAX_STR_LEN 80
 
+/* bytes read at a time while checking the prefix of a resumed transfer */
+#define RESUME_READ_LEN (64 << 10)
+
+/* bytes read at a time by a sparse transfer */
+#define SPARSE_READ_LEN (64 << 10)
+
+/* inotify events that wake up a following session */
+#define FOLLOW_FILE_EVENTS (IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF)
+#define FOLLOW_DIR_EVENTS  (IN_CREATE | IN_MOVED_TO)
+
 /* function prototypes */
 static void sigusr1_handler(int sigNum);
 static void fatal(char* str);
-static void initialize(int clntPid, int priority, char* filePath);
+static void initialize(long clntType, int priority, char* filePath,
+    int fileFd);
 static void terminate_program(bool clientPresent);
-static void read_loop(int);
+static void read_loop(int, bool);
+static void start_follow(char*);
+static long long wait_for_growth(void);
+static bool reopen_file(void);
+static void resume_from(long long, uint32_t);
+static void sparse_loop(int);
+static void send_hole(long long*);
+static bool is_all_zero(const char*, size_t);
 
 /* global variables for inter process communication */
-static pid_t clientPid = 0;
+static long clientType = 0;
+static int streamId = 0;
 static int msgQId;
 
-/* file descriptor to read to the client process */
+/* file descriptor to read to the client process, and where to read next */
 static int fd;
+static off_t readOffset = 0;
+
+/* rate limits that the client is held to */
+static RateLimiter limiter;
+
+/* set by fatal, so the capture log tells the failure apart */
+static bool failed = false;
+
+/* size from which a transfer is cold, and the page cache state of one */
+static long long coldThreshold = COLD_DEFAULT_THRESHOLD;
+static bool cold = false;
+static DropBehind dropBehind;
+
+/* inotify state of a following session */
+static int inotifyFd = -1;
+static int fileWatch = -1;
+static int dirWatch = -1;
+static bool rotated = false;
+static char followPath[MAX_FILEPATH_LEN];
 
 /**
  * takes care of the client process.
@@ -49,7 +162,16 @@ static int fd;
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - delta & sparse transfers.
+ * @revision   2026-10-18 - takes the file opened by the server.
+ * @revision   2026-10-18 - sets up the rate limits of the client.
+ * @revision   2026-10-18 - directory tree transfers.
+ * @revision   2026-10-18 - chunked transfers.
+ * @revision   2026-10-18 - cold transfers.
+ * @revision   2026-10-18 - streams of a multiplexing client.
+ * @revision   2026-10-18 - filtered transfers.
+ * @revision   2026-10-18 - conditional requests.
+ * @revision   2026-10-18 - reads a cold file through a descriptor of its own.
  *
  * @designer   EricTsang
  *
@@ -61,22 +183,109 @@ static int fd;
  *   process's priority to the passed one then writes the contents of the file
  *   to the message queue for the client process to read.
  *
- * @signature  static int serve_client(pid_t clntPid, int priority, char*
- *   filePath)
+ * @signature  int serve_client(ConnectMsg* request, int fileFd)
  *
- * @param      clntPid process id of the child process
- * @param      priority priority of this client object
- * @param      filePath path to file to send to client through IPC
+ * @param      request pointer to the connection request of the client; holds
+ *   the message type that the client receives messages with, the priority of
+ *   the client, and the path to file to send to client through IPC
+ * @param      fileFd descriptor of the file, opened by the server; -1 to open
+ *   the file at the requested path.
  *
  * @return     returns 0, normal exit return code.
  */
-int serve_client(pid_t clntPid, int priority, char* filePath)
+int serve_client(ConnectMsg* request, int fileFd)
 {
+    bool follow = (request->flags & CONNECT_FLAG_FOLLOW) != 0;
+    char fatalstring[MAX_STR_LEN];
+
+    /* every message to the client belongs to the stream of the request */
+    streamId = request->streamId;
+    msg_set_stream(streamId);
+
     /* obtain system resources for the process */
-    initialize(clntPid, priority, filePath);
+    initialize(request->clientType, request->priority, request->filePath,
+        fileFd);
+    rate_limiter_init(&limiter, request->clientPid, request->priority);
+    if(request->window > 0)
+    {
+        rate_limit_set_window(&limiter, msgQId, request->window);
+    }
+    if(request->flags & CONNECT_FLAG_IF_CHANGED)
+    {
+        int current = validator_check(msgQId, clientType, fd,
+            &request->validator, &limiter);
+        if(current < 0)
+        {
+            sprintf(fatalstring, "conditional request failed: %d\n", errno);
+            fatal(fatalstring);
+        }
+        if(current > 0)
+        {
+            terminate_program(true);
+        }
+    }
+    if(request->flags & CONNECT_FLAG_DELTA)
+    {
+        if(delta_send(msgQId, clientType, fd, request->priority, &limiter) < 0)
+        {
+            sprintf(fatalstring, "delta transfer failed: %d\n", errno);
+            fatal(fatalstring);
+        }
+        terminate_program(true);
+    }
+    if(request->flags & CONNECT_FLAG_CAS)
+    {
+        if(cas_send(msgQId, clientType, fd, request->priority, &limiter) < 0)
+        {
+            sprintf(fatalstring, "chunked transfer failed: %d\n", errno);
+            fatal(fatalstring);
+        }
+        terminate_program(true);
+    }
+    if(request->flags & CONNECT_FLAG_TREE)
+    {
+        if(tree_send(msgQId, clientType, fd, request->priority, &limiter) < 0)
+        {
+            sprintf(fatalstring, "tree transfer failed: %d\n", errno);
+            fatal(fatalstring);
+        }
+        terminate_program(true);
+    }
+    if(request->flags & CONNECT_FLAG_FILTER)
+    {
+        if(filter_send(msgQId, clientType, fd, request->priority, &limiter,
+            &request->filter) < 0)
+        {
+            sprintf(fatalstring, "filtered transfer failed: %d\n", errno);
+            fatal(fatalstring);
+        }
+        terminate_program(true);
+    }
+    if(!follow && ((request->flags & CONNECT_FLAG_COLD) || is_cold_file(fd)))
+    {
+        cold = true;
+        fd = drop_behind_reopen(fd);
+        drop_behind_init(&dropBehind, fd, false);
+        atomic_fetch_add(&stats_get()->coldSessions, 1);
+    }
+    if(request->flags & CONNECT_FLAG_RESUME)
+    {
+        resume_from(request->offset, request->prefixChecksum);
+    }
+    if(follow)
+    {
+        start_follow(request->filePath);
+    }
 
-    /* do the read loop */
-    read_loop(priority);
+    /* do the read loop; a followed file is always read byte by byte */
+    if((request->flags & CONNECT_FLAG_SPARSE) && !follow)
+    {
+        sparse_loop(request->priority);
+    }
+    else
+    {
+        read_loop(request->priority, follow);
+    }
 
     /* terminate program... */
     terminate_program(true);
@@ -84,6 +293,61 @@ int serve_client(pid_t clntPid, int priority, char* filePath)
     return 0;
 }
 
+/**
+ * sets the size from which transfers are cold.
+ *
+ * @function   set_cold_threshold
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       sessions forked afterwards inherit the threshold.
+ *
+ * @signature  void set_cold_threshold(long long bytes)
+ *
+ * @param      bytes size in bytes from which a file is read without
+ *   keeping it in the page cache; 0 to only do so when a client asks.
+ */
+void set_cold_threshold(long long bytes)
+{
+    coldThreshold = bytes;
+}
+
+/**
+ * tells whether a file is big enough to be read without keeping it in the
+ *   page cache.
+ *
+ * @function   is_cold_file
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  bool is_cold_file(int fd)
+ *
+ * @param      fd descriptor of the file.
+ *
+ * @return     true if the file is at least the cold threshold in size.
+ */
+bool is_cold_file(int fd)
+{
+    struct stat st;
+
+    return coldThreshold > 0 && fstat(fd, &st) == 0
+        && st.st_size >= coldThreshold;
+}
+
 /**
  * obtains the resources needed by the session for it to function.
  *
@@ -91,7 +355,7 @@ int serve_client(pid_t clntPid, int priority, char* filePath)
  *
  * @date       2015-02-12
  *
- * @revision   none
+ * @revision   2026-10-18 - takes the file opened by the server.
  *
  * @designer   EricTsang
  *
@@ -99,19 +363,25 @@ int serve_client(pid_t clntPid, int priority, char* filePath)
  *
  * @note       none
  *
- * @signature  static void initialize(int clntPid, int priority, char* filePath)
+ * @signature  static void initialize(long clntType, int priority, char*
+ *   filePath, int fileFd)
  *
- * @param      clntPid process id of the session's client process
+ * @param      clntType message type that the session's client receives
+ *   messages with
+ * @param      fileFd descriptor of the file opened by the server; -1 if the
+ *   session has to open filePath itself.
  */
-static void initialize(int clntPid, int priority, char* filePath)
+static void initialize(long clntType, int priority, char* filePath,
+    int fileFd)
 {
     Message pidMsg;         /* used to send client the PID of this process */
     char fatalstring[MAX_STR_LEN];  /* buffer used to print fatal messages */
+    long long openStart;
 
     pidMsg.dataType  = MSG_DATA_PID;
 
-    /* initialize global client PID */
-    clientPid = clntPid;
+    /* initialize global client message type */
+    clientType = clntType;
 
     /* set signal handler */
     signal(SIGUSR1, sigusr1_handler);
@@ -127,8 +397,16 @@ static void initialize(int clntPid, int priority, char* filePath)
         fatal(fatalstring);
     }
 
-    /* open the file */
-    fd = open(filePath, 0);
+    /* open the file, unless the server already has */
+    fd = fileFd;
+    if(fd == -1)
+    {
+        TRACE_BEGIN("open");
+        openStart = clock_now_ns();
+        fd = open(filePath, 0);
+        histogram_record(&stats_get()->openTime, clock_now_ns() - openStart);
+        TRACE_END("open");
+    }
     if(fd == -1)
     {
         sprintf(fatalstring, "failed to open file: %d\n", errno);
@@ -137,7 +415,7 @@ static void initialize(int clntPid, int priority, char* filePath)
 
     /* send the client the session's PID */
     pidMsg.data.pidMsg.pid = getpid();
-    msg_send(msgQId, &pidMsg, clientPid);
+    msg_send(msgQId, &pidMsg, clientType);
 }
 
 /**
@@ -148,38 +426,557 @@ static void initialize(int clntPid, int priority, char* filePath)
  *
  * @date       2015-02-12
  *
- * @revision   none
+ * @revision   2026-10-18 - follow mode, and chunks sized by chunkctl.
+ * @revision   2026-10-18 - reads with pread.
+ * @revision   2026-10-18 - held to the rate limits.
+ * @revision   2026-10-18 - drops the file behind it when cold.
  *
  * @designer   EricTsang
  *
  * @programmer EricTsang
  *
- * @note       none
+ * @note
  *
- * @signature  static void read_loop(void)
+ * when following, reaching the end of the file waits for it to grow instead
+ *   of ending the loop, so the loop only ends when the client goes away.
+ *
+ * @signature  static void read_loop(int priority, bool follow)
  *
  * @param      priority of the client
+ * @param      follow true to keep sending data appended to the file.
  */
-static void read_loop(int priority)
+static void read_loop(int priority, bool follow)
 {
-    size_t nRead;       /* bytes read from file per read */
+    ssize_t nRead;      /* bytes read from file per read */
     Message dataMsg;    /* used to send file data to client */
+    ChunkCtl chunk;     /* sizes the reads */
+    long long eventTime = clock_now_ns();
+    long long chunks = 0;
 
     /* initialize message types */
     dataMsg.dataType = MSG_DATA_DATA;
+    chunk_ctl_init(&chunk, msgQId, priority);
 
     /* read from the file & send to client in a loop */
     do
     {
         /* read contents from the file & prepare message to send to client. */
-        nRead = read(fd, dataMsg.data.dataMsg.data,
-            MAX_MSG_DATAMSGDATA_LEN/priority);
+        if(TRACE_SAMPLE(chunks))
+        {
+            TRACE_BEGIN("read");
+        }
+        nRead = pread(fd, dataMsg.data.dataMsg.data, chunk.len, readOffset);
+        if(TRACE_SAMPLE(chunks))
+        {
+            TRACE_END("read");
+        }
+        if(nRead < 0)
+        {
+            nRead = 0;
+            follow = false;
+        }
+        readOffset += nRead;
+        if(cold)
+        {
+            drop_behind_update(&dropBehind, readOffset);
+        }
+
+        /* at the end of a followed file, wait for more instead */
+        if(nRead == 0 && follow)
+        {
+            eventTime = wait_for_growth();
+            continue;
+        }
+
+        rate_limit_wait(&limiter, nRead);
         dataMsg.data.dataMsg.len = nRead;
+        dataMsg.data.dataMsg.eventTime = follow ? eventTime : clock_now_ns();
 
         /* send the message to the client, and exit on error. */
-        msg_send(msgQId, &dataMsg, clientPid);
+        if(chunks == 0)
+        {
+            TRACE_INSTANT("first byte", nRead);
+            stats_first_byte();
+        }
+        if(TRACE_SAMPLE(chunks))
+        {
+            TRACE_BEGIN("msg_send");
+        }
+        msg_send(msgQId, &dataMsg, clientType);
+        chunk_ctl_sent(&chunk, clock_now_ns() - dataMsg.sendTime);
+        stats_add_bytes(priority, nRead);
+        if(TRACE_SAMPLE(chunks))
+        {
+            TRACE_END("msg_send");
+            TRACE_INSTANT("chunk", chunks);
+        }
+        ++chunks;
+    }
+    while(nRead > 0 || follow);
+
+    if(cold)
+    {
+        drop_behind_finish(&dropBehind, readOffset);
+    }
+}
+
+/**
+ * sets up the inotify watch used to follow the file.
+ *
+ * @function   start_follow
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void start_follow(char* filePath)
+ *
+ * @param      filePath path to the file to follow; the session keeps
+ *   following this path when the file is rotated.
+ */
+static void start_follow(char* filePath)
+{
+    char fatalstring[MAX_STR_LEN];  /* buffer used to print fatal messages */
+
+    strncpy(followPath, filePath, MAX_FILEPATH_LEN - 1);
+    followPath[MAX_FILEPATH_LEN - 1] = 0;
+
+    inotifyFd = inotify_init1(IN_CLOEXEC);
+    if(inotifyFd != -1)
+    {
+        fileWatch = inotify_add_watch(inotifyFd, followPath,
+            FOLLOW_FILE_EVENTS);
+    }
+    if(inotifyFd == -1 || fileWatch == -1)
+    {
+        sprintf(fatalstring, "failed to watch file: %d\n", errno);
+        fatal(fatalstring);
+    }
+}
+
+/**
+ * blocks until there may be more to read from fd.
+ *
+ * @function   wait_for_growth
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - compares against readOffset, rather than the file offset.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * returns when the file has been written to, when it was truncated (fd is
+ *   rewound), or when it was replaced by a new file at the same path (fd is
+ *   the new file). a rotated file is only replaced on the call after it was
+ *   found to be rotated, so that the caller first reads the rest of it.
+ *
+ * @signature  static long long wait_for_growth(void)
+ *
+ * @return     time at which the session was told about the new data.
+ */
+static long long wait_for_growth(void)
+{
+    union
+    {
+        struct inotify_event event;
+        char buf[4096];
+    }
+    events;
+    ssize_t len;
+    char* cursor;
+    bool grown = false;
+    bool modified;
+    struct stat info;
+
+    if(rotated && reopen_file())
+    {
+        return clock_now_ns();
+    }
+
+    while(!grown)
+    {
+        len = read(inotifyFd, events.buf, sizeof(events.buf));
+        if(len <= 0)
+        {
+            if(len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            fatal("failed to read inotify events\n");
+        }
+
+        modified = false;
+        for(cursor = events.buf; cursor < events.buf + len;
+            cursor += sizeof(struct inotify_event)
+            + ((struct inotify_event*) cursor)->len)
+        {
+            struct inotify_event* event = (struct inotify_event*) cursor;
+            if(event->wd == fileWatch)
+            {
+                rotated |= (event->mask
+                    & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) != 0;
+                modified |= (event->mask & IN_MODIFY) != 0;
+            }
+        }
+
+        /* a rotated file is replaced once the rest of it has been read */
+        grown = modified || (rotated && reopen_file());
+    }
+
+    /* start over if the file was truncated */
+    if(!rotated && fstat(fd, &info) == 0 && info.st_size < readOffset)
+    {
+        readOffset = 0;
+    }
+
+    return clock_now_ns();
+}
+
+/**
+ * replaces fd with the file that is now at the followed path.
+ *
+ * @function   reopen_file
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - resets readOffset.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * if there is no file at the path yet, the directory holding it is watched,
+ *   so that wait_for_growth wakes up when one is created.
+ *
+ * @signature  static bool reopen_file(void)
+ *
+ * @return     true if fd was replaced; false if there is no file yet.
+ */
+static bool reopen_file(void)
+{
+    char dirPath[MAX_FILEPATH_LEN];
+    char* slash;
+    int newFd = open(followPath, O_RDONLY);
+
+    if(newFd == -1)
+    {
+        if(dirWatch == -1)
+        {
+            strcpy(dirPath, followPath);
+            slash = strrchr(dirPath, '/');
+            if(slash == 0)
+            {
+                strcpy(dirPath, ".");
+            }
+            else
+            {
+                slash[slash == dirPath ? 1 : 0] = 0;
+            }
+            dirWatch = inotify_add_watch(inotifyFd, dirPath,
+                FOLLOW_DIR_EVENTS);
+        }
+        return false;
+    }
+
+    /* swap the watches over to the new file */
+    inotify_rm_watch(inotifyFd, fileWatch);
+    fileWatch = inotify_add_watch(inotifyFd, followPath, FOLLOW_FILE_EVENTS);
+    if(dirWatch != -1)
+    {
+        inotify_rm_watch(inotifyFd, dirWatch);
+        dirWatch = -1;
+    }
+
+    close(fd);
+    fd = newFd;
+    readOffset = 0;
+    rotated = false;
+    return true;
+}
+
+/**
+ * sets readOffset where the client wants to resume the transfer, if the bytes
+ *   the client already has match the start of the file, and tells the client
+ *   where the data is going to start.
+ *
+ * @function   resume_from
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - reads with pread, and sets readOffset.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * checking the prefix reads it from disk, but does not send any of it. if the
+ *   file is shorter than the offset, or its prefix no longer matches, the
+ *   transfer starts over from the beginning.
+ *
+ * @signature  static void resume_from(long long offset, uint32_t checksum)
+ *
+ * @param      offset number of bytes that the client already has.
+ * @param      checksum adler-32 checksum of the bytes the client has.
+ */
+static void resume_from(long long offset, uint32_t checksum)
+{
+    static char buf[RESUME_READ_LEN];
+    Message resumeMsg;
+    long long remaining = offset;
+    uint32_t adler = ADLER32_INIT;
+    ssize_t nRead = 1;
+
+    posix_fadvise(fd, 0, offset, POSIX_FADV_SEQUENTIAL);
+    while(remaining > 0 && nRead > 0)
+    {
+        nRead = pread(fd, buf,
+            remaining < RESUME_READ_LEN ? remaining : RESUME_READ_LEN,
+            offset - remaining);
+        if(nRead > 0)
+        {
+            adler = adler32_update(adler, buf, nRead);
+            remaining -= nRead;
+        }
+    }
+
+    if(remaining != 0 || adler != checksum)
+    {
+        offset = 0;
+    }
+    readOffset = offset;
+
+    resumeMsg.dataType = MSG_DATA_RESUME;
+    resumeMsg.data.resumeMsg.offset = offset;
+    msg_send(msgQId, &resumeMsg, clientType);
+}
+
+/**
+ * sends the file from the current offset, skipping its holes and runs of
+ *   zeros.
+ *
+ * @function   sparse_loop
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - starts at readOffset.
+ * @revision   2026-10-18 - held to the rate limits.
+ * @revision   2026-10-18 - drops the file behind it when cold.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the file is walked with SEEK_DATA & SEEK_HOLE, so holes are never read.
+ *   within data, every chunk that would be sent is checked for zeros, which
+ *   also catches preallocated or zero-filled blocks. consecutive holes and
+ *   zero chunks are sent as a single hole.
+ *
+ * on file systems without hole support, the whole file is reported as data,
+ *   and only the zero-scan applies.
+ *
+ * @signature  static void sparse_loop(int priority)
+ *
+ * @param      priority of the client
+ */
+static void sparse_loop(int priority)
+{
+    static char buf[SPARSE_READ_LEN];
+    Message dataMsg;
+    struct stat st;
+    ChunkCtl chunk;
+    long long hole = 0;
+    long long chunks = 0;
+    off_t pos = readOffset;
+    off_t size;
+
+    if(fstat(fd, &st) < 0)
+    {
+        return;
+    }
+    size = st.st_size;
+    dataMsg.dataType = MSG_DATA_DATA;
+    chunk_ctl_init(&chunk, msgQId, priority);
+
+    while(pos < size)
+    {
+        /* skip to the next data, counting the hole before it */
+        off_t dataStart = lseek(fd, pos, SEEK_DATA);
+        off_t dataEnd;
+        if(dataStart < 0)
+        {
+            dataStart = (errno == ENXIO) ? size : pos;
+        }
+        hole += dataStart - pos;
+        pos = dataStart;
+
+        dataEnd = lseek(fd, pos, SEEK_HOLE);
+        if(dataEnd < 0 || dataEnd > size)
+        {
+            dataEnd = size;
+        }
+
+        /* send the data, leaving out chunks of zeros */
+        while(pos < dataEnd)
+        {
+            ssize_t nRead = pread(fd, buf, dataEnd - pos < SPARSE_READ_LEN
+                ? dataEnd - pos : SPARSE_READ_LEN, pos);
+            ssize_t off;
+            int len;
+            if(nRead <= 0)
+            {
+                size = pos;
+                break;
+            }
+
+            for(off = 0; off < nRead; off += len)
+            {
+                len = nRead - off < chunk.len ? nRead - off : chunk.len;
+                if(is_all_zero(buf + off, len))
+                {
+                    hole += len;
+                    continue;
+                }
+
+                send_hole(&hole);
+                rate_limit_wait(&limiter, len);
+                memcpy(dataMsg.data.dataMsg.data, buf + off, len);
+                dataMsg.data.dataMsg.len = len;
+                dataMsg.data.dataMsg.eventTime = clock_now_ns();
+                if(chunks == 0)
+                {
+                    TRACE_INSTANT("first byte", len);
+                    stats_first_byte();
+                }
+                if(TRACE_SAMPLE(chunks))
+                {
+                    TRACE_BEGIN("msg_send");
+                }
+                msg_send(msgQId, &dataMsg, clientType);
+                chunk_ctl_sent(&chunk, clock_now_ns() - dataMsg.sendTime);
+                stats_add_bytes(priority, len);
+                if(TRACE_SAMPLE(chunks))
+                {
+                    TRACE_END("msg_send");
+                    TRACE_INSTANT("chunk", chunks);
+                }
+                ++chunks;
+            }
+            pos += nRead;
+            if(cold)
+            {
+                drop_behind_update(&dropBehind, pos);
+            }
+        }
+    }
+
+    send_hole(&hole);
+    if(cold)
+    {
+        drop_behind_finish(&dropBehind, pos);
     }
-    while(nRead > 0);
+}
+
+/**
+ * tells the client about the pending hole, if there is one.
+ *
+ * @function   send_hole
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - held to the rate limits.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void send_hole(long long* len)
+ *
+ * @param      len length of the pending hole; reset to 0 once it is sent.
+ */
+static void send_hole(long long* len)
+{
+    Message holeMsg;
+
+    if(*len == 0)
+    {
+        return;
+    }
+
+    holeMsg.dataType = MSG_DATA_HOLE;
+    holeMsg.data.holeMsg.len = *len;
+    rate_limit_wait(&limiter, 0);
+    msg_send(msgQId, &holeMsg, clientType);
+    *len = 0;
+}
+
+/**
+ * checks whether a buffer holds nothing but zeros.
+ *
+ * @function   is_all_zero
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * with SSE2, the buffer is or-ed together 16 bytes at a time, and only tested
+ *   once at the end, since data that is not zero is usually found right away
+ *   anyway; the tail is checked byte by byte.
+ *
+ * @signature  static bool is_all_zero(const char* buf, size_t len)
+ *
+ * @param      buf pointer to the first byte to check.
+ * @param      len number of bytes to check.
+ *
+ * @return     true if every byte is zero; false otherwise.
+ */
+static bool is_all_zero(const char* buf, size_t len)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    for(; i + 16 <= len; i += 16)
+    {
+        acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i*) (buf + i)));
+    }
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xffff)
+    {
+        return false;
+    }
+#endif
+
+    for(; i < len; ++i)
+    {
+        if(buf[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 /**
@@ -189,7 +986,9 @@ static void read_loop(int priority)
  *
  * @date       2015-02-12
  *
- * @revision   none
+ * @revision   2026-10-18 - records the end of the session in the capture
+ *   log.
+ * @revision   2026-10-18 - leaves the messages of a multiplexing client to it.
  *
  * @designer   EricTsang
  *
@@ -204,7 +1003,9 @@ static void read_loop(int priority)
  *   the message queue.
  *
  * if the client process is no longer present, then the session will clear all
- *   messages of its type, release its resources and terminate.
+ *   messages of its type, release its resources and terminate. the messages
+ *   of a client with many streams are left for it to clear, as they are not
+ *   all from this session.
  *
  * @signature  static void terminate_program(bool clientPresent)
  *
@@ -213,6 +1014,10 @@ static void read_loop(int priority)
  */
 static void terminate_program(bool clientPresent)
 {
+    TRACE_INSTANT("stop", clientPresent);
+    capture_done(clientType, streamId, stats_session_bytes(),
+        clientPresent && !failed);
+
     /**
      * if the client is present, send stop message; clear all messages of the
      *   client type otherwise.
@@ -224,15 +1029,15 @@ static void terminate_program(bool clientPresent)
          */
         Message stopMsg;
         stopMsg.dataType = MSG_DATA_STOPCLNT;
-        msg_send(msgQId, &stopMsg, clientPid);
+        msg_send(msgQId, &stopMsg, clientType);
     }
-    else
+    else if(streamId == 0)
     {
         /**
          * clear all messages for the client, so message queue isn't littered
          *   with stuff.
          */
-        msg_clear_type(msgQId, clientPid);
+        msg_clear_type(msgQId, clientType);
     }
 
     /* release resources, and exit the program */
@@ -276,7 +1081,7 @@ static void sigusr1_handler(int sigNum)
  *
  * @date       2015-02-11
  *
- * @revision   none
+ * @revision   2026-10-18 - marks the session as failed.
  *
  * @designer   EricTsang
  *
@@ -294,10 +1099,11 @@ static void fatal(char* str)
     /* declare and initialize a print & stop message structures */
     Message prntMsg;
     prntMsg.dataType = MSG_DATA_PRINT;
+    failed = true;
 
     /* send a print message as well as an stop message to the client */
     sprintf(prntMsg.data.printMsg.str, "fatal: %s", str);
-    msg_send(msgQId, &prntMsg, clientPid);
+    msg_send(msgQId, &prntMsg, clientType);
 
     /* terminate program... */
     terminate_program(true);
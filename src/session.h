@@ -5,7 +5,9 @@
  *
  * @program    server.out
  *
- * @function   int serve_client(pid_t clientPid, int priority, char* filePath);
+ * @function   int serve_client(ConnectMsg* request, int fileFd);
+ * @function   void set_cold_threshold(long long bytes);
+ * @function   bool is_cold_file(int fd);
  *
  * @date       2015-02-11
  *
@@ -34,4 +36,6 @@
 #define MIN_PROC_PRIO 1
 #define MAX_PROC_PRIO 20
 
-int serve_client(pid_t clientPid, int priority, char* filePath);
+int serve_client(ConnectMsg* request, int fileFd);
+void set_cold_threshold(long long bytes);
+bool is_cold_file(int fd);
@@ -0,0 +1,228 @@
+/**
+ * this file contains the helpers used to run several isolated servers on a
+ *   host, each on a message queue of its own, and to pick one of them for a
+ *   request.
+ *
+ * @sourceFile shard.c
+ *
+ * @program    server.out, client.out
+ *
+ * @function   int shard_key(const char* keySpec, int shard, key_t* key)
+ * @function   int shard_open(const char* keySpec, int shardCount,
+ *   int* msgQIds)
+ * @function   int shard_choose(int* msgQIds, int shardCount,
+ *   const char* filePath, bool leastLoaded)
+ * @function   static unsigned int hash_path(const char* filePath)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a key spec is either a number, in any base that strtol accepts, or the path
+ *   of an existing file for ftok. the shards of a numeric spec use
+ *   consecutive keys starting at it; the shards of a path use consecutive
+ *   ftok project ids.
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/msg.h>
+#include "shard.h"
+#include "messagequeuehelper.h"
+
+/* function prototypes */
+static unsigned int hash_path(const char*);
+
+/**
+ * works out the message queue key of a shard.
+ *
+ * @function   shard_key
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int shard_key(const char* keySpec, int shard, key_t* key)
+ *
+ * @param      keySpec key spec of shard 0; 0 for MSGQ_KEY.
+ * @param      shard index of the shard.
+ * @param      key pointer to the key to set.
+ *
+ * @return     0 upon success; -1 if the spec is not a number, and ftok
+ *   failed on it.
+ */
+int shard_key(const char* keySpec, int shard, key_t* key)
+{
+    char* end;
+    long number;
+
+    if(keySpec == 0)
+    {
+        *key = MSGQ_KEY + shard;
+        return 0;
+    }
+
+    number = strtol(keySpec, &end, 0);
+    if(*keySpec != '\0' && *end == '\0')
+    {
+        *key = (key_t) (number + shard);
+        return 0;
+    }
+
+    *key = ftok(keySpec, SHARD_FTOK_PROJ + shard);
+    return *key == (key_t) -1 ? -1 : 0;
+}
+
+/**
+ * looks up the message queues of all shards.
+ *
+ * @function   shard_open
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * shards without a server are set to -1, and are never chosen.
+ *
+ * @signature  int shard_open(const char* keySpec, int shardCount,
+ *   int* msgQIds)
+ *
+ * @param      keySpec key spec of shard 0; 0 for MSGQ_KEY.
+ * @param      shardCount number of shards, at most MAX_SHARDS.
+ * @param      msgQIds array of shardCount message queue ids to set.
+ *
+ * @return     number of shards that have a server.
+ */
+int shard_open(const char* keySpec, int shardCount, int* msgQIds)
+{
+    int found = 0;
+    int i;
+
+    for(i = 0; i < shardCount; ++i)
+    {
+        key_t key;
+        msgQIds[i] = shard_key(keySpec, i, &key) < 0 ? -1 : msgget(key, 0);
+        if(msgQIds[i] >= 0)
+        {
+            ++found;
+        }
+    }
+    return found;
+}
+
+/**
+ * chooses the shard to send a request for the passed file to.
+ *
+ * @function   shard_choose
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * by default, the shard is chosen by hashing the path, so requests for the
+ *   same file go to the same server, where they can share a session. when
+ *   leastLoaded is set, the shard with the fewest bytes waiting in its queue
+ *   is chosen instead, starting the search at the hashed shard, so that
+ *   ties still keep a file on one server. shards without a server are
+ *   skipped either way, and shards whose load can not be read are only
+ *   chosen if there is nothing else.
+ *
+ * @signature  int shard_choose(int* msgQIds, int shardCount,
+ *   const char* filePath, bool leastLoaded)
+ *
+ * @param      msgQIds message queue ids of the shards, as set by shard_open.
+ * @param      shardCount number of shards.
+ * @param      filePath path of the requested file.
+ * @param      leastLoaded true to choose by load; false to choose by path.
+ *
+ * @return     index of the chosen shard; -1 if no shard has a server, as
+ *   far as shard_open could tell.
+ */
+int shard_choose(int* msgQIds, int shardCount, const char* filePath,
+    bool leastLoaded)
+{
+    unsigned int start = hash_path(filePath) % shardCount;
+    unsigned long bestBytes = 0;
+    int best = -1;
+    int i;
+
+    for(i = 0; i < shardCount; ++i)
+    {
+        int shard = (start + i) % shardCount;
+        struct msqid_ds queue;
+
+        if(msgQIds[shard] < 0)
+        {
+            continue;
+        }
+        if(!leastLoaded)
+        {
+            return shard;
+        }
+        if(msgctl(msgQIds[shard], IPC_STAT, &queue) < 0)
+        {
+            queue.__msg_cbytes = (unsigned long) -1;
+        }
+        if(best < 0 || queue.__msg_cbytes < bestBytes)
+        {
+            best = shard;
+            bestBytes = queue.__msg_cbytes;
+        }
+    }
+    return best;
+}
+
+/**
+ * hashes a file path with 32-bit FNV-1a.
+ *
+ * @function   hash_path
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static unsigned int hash_path(const char* filePath)
+ *
+ * @param      filePath null terminated path to hash.
+ *
+ * @return     hash of the path.
+ */
+static unsigned int hash_path(const char* filePath)
+{
+    unsigned int hash = 2166136261u;
+
+    while(*filePath != '\0')
+    {
+        hash = (hash ^ (unsigned char) *filePath++) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,45 @@
+/**
+ * header file for shard.c, exposing its interface.
+ *
+ * @sourceFile shard.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   int shard_key(const char* keySpec, int shard, key_t* key);
+ * @function   int shard_open(const char* keySpec, int shardCount,
+ *   int* msgQIds);
+ * @function   int shard_choose(int* msgQIds, int shardCount,
+ *   const char* filePath, bool leastLoaded);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+/* most server shards that a client chooses between */
+#define MAX_SHARDS 64
+
+/* ftok project id of shard 0; shard n uses SHARD_FTOK_PROJ + n */
+#define SHARD_FTOK_PROJ 'M'
+
+/**
+ * function prototypes
+ */
+int shard_key(const char* keySpec, int shard, key_t* key);
+int shard_open(const char* keySpec, int shardCount, int* msgQIds);
+int shard_choose(int* msgQIds, int shardCount, const char* filePath,
+    bool leastLoaded);
+
+#endif
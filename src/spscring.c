@@ -0,0 +1,320 @@
+/**
+ * this file contains a lock-free single-producer / single-consumer ring of
+ *   preallocated messages, used to hand messages between two threads without
+ *   copying them, or taking a lock.
+ *
+ * @sourceFile spscring.c
+ *
+ * @program    client.out
+ *
+ * @function   int spsc_ring_init(SpscRing* ring, unsigned int capacity)
+ * @function   void spsc_ring_destroy(SpscRing* ring)
+ * @function   Message* spsc_ring_begin_push(SpscRing* ring)
+ * @function   void spsc_ring_end_push(SpscRing* ring)
+ * @function   Message* spsc_ring_begin_pop(SpscRing* ring)
+ * @function   void spsc_ring_end_pop(SpscRing* ring)
+ * @function   static void wait_while_equal(_Atomic unsigned int* index,
+ *   unsigned int seen, _Atomic int* parked)
+ * @function   static void wake_if_parked(_Atomic unsigned int* index,
+ *   _Atomic int* parked)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the producer fills a slot in place (e.g. by calling msgrcv straight into
+ *   it), and then publishes it by advancing head. the consumer processes the
+ *   slot in place, and then releases it by advancing tail.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "spscring.h"
+
+/* number of times a side polls the other side's index before parking */
+#define SPIN_LIMIT 1024
+
+/* function prototypes */
+static void wait_while_equal(_Atomic unsigned int*, unsigned int,
+    _Atomic int*);
+static void wake_if_parked(_Atomic unsigned int*, _Atomic int*);
+
+/**
+ * allocates the slots of the ring, and resets its indices.
+ *
+ * @function   spsc_ring_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the capacity is rounded up to the next power of two, so that indices can be
+ *   mapped onto slots with a mask.
+ *
+ * @signature  int spsc_ring_init(SpscRing* ring, unsigned int capacity)
+ *
+ * @param      ring pointer to the ring to initialize.
+ * @param      capacity minimum number of slots in the ring.
+ *
+ * @return     0 upon success; -1 if the slots could not be allocated.
+ */
+int spsc_ring_init(SpscRing* ring, unsigned int capacity)
+{
+    unsigned int slotCount = 1;
+
+    while(slotCount < capacity)
+    {
+        slotCount <<= 1;
+    }
+
+    ring->slots = malloc(slotCount * sizeof(Message));
+    if(ring->slots == 0)
+    {
+        return -1;
+    }
+
+    ring->mask = slotCount - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->producerParked, 0);
+    atomic_init(&ring->consumerParked, 0);
+    return 0;
+}
+
+/**
+ * releases the slots of the ring.
+ *
+ * @function   spsc_ring_destroy
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void spsc_ring_destroy(SpscRing* ring)
+ *
+ * @param      ring pointer to the ring to destroy.
+ */
+void spsc_ring_destroy(SpscRing* ring)
+{
+    free(ring->slots);
+    ring->slots = 0;
+}
+
+/**
+ * producer side. blocks until a slot is free, and returns it.
+ *
+ * @function   spsc_ring_begin_push
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the returned slot is invisible to the consumer until spsc_ring_end_push is
+ *   called. calling this function twice without publishing returns the same
+ *   slot.
+ *
+ * @signature  Message* spsc_ring_begin_push(SpscRing* ring)
+ *
+ * @param      ring pointer to the ring to push into.
+ *
+ * @return     pointer to the slot that the producer may fill.
+ */
+Message* spsc_ring_begin_push(SpscRing* ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    while(head - tail > ring->mask)
+    {
+        wait_while_equal(&ring->tail, tail, &ring->producerParked);
+        tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    }
+
+    return &ring->slots[head & ring->mask];
+}
+
+/**
+ * producer side. publishes the slot returned by spsc_ring_begin_push.
+ *
+ * @function   spsc_ring_end_push
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void spsc_ring_end_push(SpscRing* ring)
+ *
+ * @param      ring pointer to the ring to publish the slot in.
+ */
+void spsc_ring_end_push(SpscRing* ring)
+{
+    atomic_fetch_add(&ring->head, 1);
+    wake_if_parked(&ring->head, &ring->consumerParked);
+}
+
+/**
+ * consumer side. blocks until a slot has been published, and returns it.
+ *
+ * @function   spsc_ring_begin_pop
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  Message* spsc_ring_begin_pop(SpscRing* ring)
+ *
+ * @param      ring pointer to the ring to pop from.
+ *
+ * @return     pointer to the oldest published slot.
+ */
+Message* spsc_ring_begin_pop(SpscRing* ring)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    while(atomic_load_explicit(&ring->head, memory_order_acquire) == tail)
+    {
+        wait_while_equal(&ring->head, tail, &ring->consumerParked);
+    }
+
+    return &ring->slots[tail & ring->mask];
+}
+
+/**
+ * consumer side. hands the slot returned by spsc_ring_begin_pop back to the
+ *   producer.
+ *
+ * @function   spsc_ring_end_pop
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void spsc_ring_end_pop(SpscRing* ring)
+ *
+ * @param      ring pointer to the ring to release the slot to.
+ */
+void spsc_ring_end_pop(SpscRing* ring)
+{
+    atomic_fetch_add(&ring->tail, 1);
+    wake_if_parked(&ring->tail, &ring->producerParked);
+}
+
+/**
+ * blocks the calling thread until the index no longer holds the seen value.
+ *
+ * @function   wait_while_equal
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * polls for a while first, since the other side is usually just about to
+ *   move. the parked flag is raised before the index is checked a last time,
+ *   so a concurrent wake_if_parked either sees the flag, or the futex wait
+ *   sees the new index; the wakeup can not be lost.
+ *
+ * @signature  static void wait_while_equal(_Atomic unsigned int* index,
+ *   unsigned int seen, _Atomic int* parked)
+ *
+ * @param      index index owned by the other side of the ring.
+ * @param      seen value of the index that the caller can not proceed with.
+ * @param      parked flag telling the other side that this side is asleep.
+ */
+static void wait_while_equal(_Atomic unsigned int* index, unsigned int seen,
+    _Atomic int* parked)
+{
+    int spins;
+
+    for(spins = 0; spins < SPIN_LIMIT; ++spins)
+    {
+        if(atomic_load_explicit(index, memory_order_acquire) != seen)
+        {
+            return;
+        }
+    }
+
+    atomic_store(parked, 1);
+    while(atomic_load(index) == seen)
+    {
+        syscall(SYS_futex, (void*) index, FUTEX_WAIT_PRIVATE, seen, 0, 0, 0);
+    }
+    atomic_store(parked, 0);
+}
+
+/**
+ * wakes the other side of the ring if it is parked on the passed index.
+ *
+ * @function   wake_if_parked
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void wake_if_parked(_Atomic unsigned int* index,
+ *   _Atomic int* parked)
+ *
+ * @param      index index that was just moved by the calling side.
+ * @param      parked flag raised by the other side when it is asleep.
+ */
+static void wake_if_parked(_Atomic unsigned int* index, _Atomic int* parked)
+{
+    if(atomic_load(parked))
+    {
+        syscall(SYS_futex, (void*) index, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+    }
+}
@@ -0,0 +1,63 @@
+/**
+ * header file for spscring.c, exposing its interface.
+ *
+ * @sourceFile spscring.h
+ *
+ * @program    client.out
+ *
+ * @function   int spsc_ring_init(SpscRing* ring, unsigned int capacity);
+ * @function   void spsc_ring_destroy(SpscRing* ring);
+ * @function   Message* spsc_ring_begin_push(SpscRing* ring);
+ * @function   void spsc_ring_end_push(SpscRing* ring);
+ * @function   Message* spsc_ring_begin_pop(SpscRing* ring);
+ * @function   void spsc_ring_end_pop(SpscRing* ring);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stdatomic.h>
+#include "messagequeuehelper.h"
+
+/* default number of preallocated message slots in a ring */
+#define SPSC_RING_DEFAULT_CAPACITY 256
+
+/**
+ * lock-free single-producer / single-consumer ring of preallocated messages.
+ *
+ * the producer owns head, and the consumer owns tail; each side only ever
+ *   reads the other side's index. a side that finds the ring full (producer)
+ *   or empty (consumer) spins briefly, and then parks itself on a futex until
+ *   the other side moves its index.
+ */
+typedef struct
+{
+    Message* slots;
+    unsigned int mask;
+    _Atomic unsigned int head;
+    _Atomic unsigned int tail;
+    _Atomic int producerParked;
+    _Atomic int consumerParked;
+}
+SpscRing;
+
+/**
+ * function prototypes
+ */
+int spsc_ring_init(SpscRing* ring, unsigned int capacity);
+void spsc_ring_destroy(SpscRing* ring);
+Message* spsc_ring_begin_push(SpscRing* ring);
+void spsc_ring_end_push(SpscRing* ring);
+Message* spsc_ring_begin_pop(SpscRing* ring);
+void spsc_ring_end_pop(SpscRing* ring);
+
+#endif
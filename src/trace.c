@@ -0,0 +1,235 @@
+/**
+ * this file contains a per-process ring of timestamped events, that is
+ *   written out as a chrome trace when the process exits.
+ *
+ * @sourceFile trace.c
+ *
+ * @program    server.out, client.out
+ *
+ * @function   void trace_init(const char* processName)
+ * @function   void trace_child(const char* processName)
+ * @function   void trace_record(const char* name, char phase, long long arg)
+ * @function   void trace_flush(void)
+ * @function   static int current_tid(void)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * recording an event claims a slot with a single atomic increment, and fills
+ *   it in; there is no lock, and no system call besides the vdso clock. when
+ *   the ring wraps, the oldest events are overwritten.
+ *
+ * every process writes its events to $TRACE_DIR/trace-<pid>.json (/tmp by
+ *   default) on exit. the files share the monotonic clock, so they line up
+ *   when loaded into perfetto together, or merged with
+ *   jq -s '{traceEvents: map(.traceEvents) | add}' trace-*.json
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include "trace.h"
+#include "clockhelper.h"
+
+/**
+ * a recorded event. phase is a chrome trace phase; B, E or i.
+ */
+typedef struct
+{
+    long long time;
+    long long arg;
+    const char* name;
+    int tid;
+    char phase;
+}
+TraceEvent;
+
+/* function prototypes */
+static int current_tid(void);
+
+/* events of this process */
+static TraceEvent ring[TRACE_RING_LEN];
+static _Atomic unsigned long long ringHead = 0;
+static const char* ringProcess = "";
+
+/* thread id of the calling thread, looked up once per thread */
+static _Thread_local int cachedTid = 0;
+
+/**
+ * starts tracing the process, and arranges for the trace to be written out
+ *   when it exits.
+ *
+ * @function   trace_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  void trace_init(const char* processName)
+ *
+ * @param      processName name that the process is shown with.
+ */
+void trace_init(const char* processName)
+{
+    ringProcess = processName;
+    atexit(trace_flush);
+}
+
+/**
+ * starts a new trace in a child process that was just forked.
+ *
+ * @function   trace_child
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the child inherits the parent's events, and its exit handler; the events
+ *   are dropped, so they are not written out twice.
+ *
+ * @signature  void trace_child(const char* processName)
+ *
+ * @param      processName name that the child is shown with.
+ */
+void trace_child(const char* processName)
+{
+    ringProcess = processName;
+    atomic_store(&ringHead, 0);
+    cachedTid = 0;
+}
+
+/**
+ * records an event.
+ *
+ * @function   trace_record
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * safe to call from any thread of the process.
+ *
+ * @signature  void trace_record(const char* name, char phase, long long arg)
+ *
+ * @param      name name of the event; a string literal.
+ * @param      phase chrome trace phase of the event.
+ * @param      arg value shown with the event.
+ */
+void trace_record(const char* name, char phase, long long arg)
+{
+    unsigned long long index = atomic_fetch_add_explicit(&ringHead, 1,
+        memory_order_relaxed);
+    TraceEvent* event = &ring[index & (TRACE_RING_LEN - 1)];
+
+    event->time = clock_now_ns();
+    event->arg = arg;
+    event->name = name;
+    event->tid = current_tid();
+    event->phase = phase;
+}
+
+/**
+ * writes the recorded events out as a chrome trace.
+ *
+ * @function   trace_flush
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * meant to run at exit, when no other thread is recording anymore.
+ *
+ * @signature  void trace_flush(void)
+ */
+void trace_flush(void)
+{
+    char path[256];
+    const char* dir = getenv("TRACE_DIR");
+    unsigned long long head = atomic_load(&ringHead);
+    unsigned long long first = head > TRACE_RING_LEN ? head - TRACE_RING_LEN : 0;
+    unsigned long long i;
+    FILE* file;
+
+    snprintf(path, sizeof(path), "%s/trace-%d.json", dir ? dir : "/tmp",
+        getpid());
+    file = fopen(path, "w");
+    if(file == 0)
+    {
+        return;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+        "\"args\":{\"name\":\"%s\"}}", getpid(), ringProcess);
+    for(i = first; i < head; ++i)
+    {
+        TraceEvent* event = &ring[i & (TRACE_RING_LEN - 1)];
+        fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03lld,"
+            "\"pid\":%d,\"tid\":%d%s,\"args\":{\"value\":%lld}}",
+            event->name, event->phase, event->time / NS_PER_US,
+            event->time % NS_PER_US, getpid(), event->tid,
+            event->phase == 'i' ? ",\"s\":\"t\"" : "", event->arg);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+}
+
+/**
+ * returns the kernel's id of the calling thread.
+ *
+ * @function   current_tid
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static int current_tid(void)
+ *
+ * @return     thread id of the calling thread.
+ */
+static int current_tid(void)
+{
+    if(cachedTid == 0)
+    {
+        cachedTid = syscall(SYS_gettid);
+    }
+    return cachedTid;
+}
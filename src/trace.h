@@ -0,0 +1,68 @@
+/**
+ * header file for trace.c, exposing its interface.
+ *
+ * @sourceFile trace.h
+ *
+ * @program    server.out, client.out
+ *
+ * @function   void trace_init(const char* processName);
+ * @function   void trace_child(const char* processName);
+ * @function   void trace_record(const char* name, char phase, long long arg);
+ * @function   void trace_flush(void);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * tracing is compiled in with -DTRACE (make TRACE=1). without it, the TRACE_
+ *   macros expand to nothing, and trace.c is not linked.
+ *
+ * event names must be string literals, since only the pointer is recorded.
+ *
+ * TRACE_SAMPLE(count) is true for every TRACE_CHUNK_INTERVAL-th count, so hot
+ *   loops can trace a sample of their iterations.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+/* number of events kept per process; older events are overwritten */
+#define TRACE_RING_LEN (1 << 16)
+
+/* a chunk event is recorded for every this many chunks sent */
+#define TRACE_CHUNK_INTERVAL 1024
+
+#ifdef TRACE
+
+#define TRACE_INIT(process)       trace_init(process)
+#define TRACE_CHILD(process)      trace_child(process)
+#define TRACE_BEGIN(name)         trace_record(name, 'B', 0)
+#define TRACE_END(name)           trace_record(name, 'E', 0)
+#define TRACE_INSTANT(name, arg)  trace_record(name, 'i', arg)
+#define TRACE_SAMPLE(count)       ((count) % TRACE_CHUNK_INTERVAL == 0)
+
+/**
+ * function prototypes
+ */
+void trace_init(const char* processName);
+void trace_child(const char* processName);
+void trace_record(const char* name, char phase, long long arg);
+void trace_flush(void);
+
+#else
+
+#define TRACE_INIT(process)       ((void) 0)
+#define TRACE_CHILD(process)      ((void) 0)
+#define TRACE_BEGIN(name)         ((void) 0)
+#define TRACE_END(name)           ((void) 0)
+#define TRACE_INSTANT(name, arg)  ((void) 0)
+#define TRACE_SAMPLE(count)       ((void) (count), 0)
+
+#endif
+
+#endif
@@ -0,0 +1,624 @@
+/**
+ * recreates a directory tree sent by a session, entry by entry, below an
+ *   output directory.
+ *
+ * @sourceFile treeout.c
+ *
+ * @program    client.out
+ *
+ * @function   int tree_out_open(const char* path)
+ * @function   void tree_out_entry(const EntryMsg* msg)
+ * @function   void tree_out_data(const char* data, int len)
+ * @function   bool tree_out_close(void)
+ * @function   static void finish_entry(void)
+ * @function   static bool is_safe_path(const char* path)
+ * @function   static int open_parent(const char* path, const char** name)
+ * @function   static void set_times(int dirFd, const char* name,
+ *   long long mtime)
+ * @function   static void remember_dir(const EntryMsg* msg)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * every entry is created relative to its parent directory, which is opened
+ *   one component at a time without following symbolic links, so an entry
+ *   can never end up outside the output directory; not even through a link
+ *   that came earlier in the same tree. paths that are absolute, or that
+ *   hold . or .. components, are refused.
+ *
+ * the data of a regular file or symbolic link follows its entry, and the
+ *   entry is finished (mode & modification time set) once all of it has
+ *   arrived. directories are created writable, and only get their own mode
+ *   & time at the end, deepest first, since creating their entries changes
+ *   their modification time.
+ */
+#include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "treeout.h"
+
+/**
+ * a directory of the tree, to be given its mode & time once the tree is
+ *   complete.
+ */
+typedef struct
+{
+    char* path;
+    unsigned int mode;
+    long long mtime;
+}
+TreeDir;
+
+/* function prototypes */
+static void finish_entry(void);
+static bool is_safe_path(const char*);
+static int open_parent(const char*, const char**);
+static void set_times(int, const char*, long long);
+static void remember_dir(const EntryMsg*);
+
+/* the output directory */
+static int rootFd = -1;
+
+/* set once anything of the tree could not be recreated */
+static bool failed = false;
+
+/* parent directory of the last entry, kept open for its siblings */
+static int parentFd = -1;
+static char parentPath[MAX_ENTRY_PATH_LEN];
+
+/* entry whose data is arriving; fileFd is -1 unless it is a regular file,
+ *   and data is discarded while remaining is above 0 but entry.path is "" */
+static EntryMsg entry;
+static int fileFd = -1;
+static long long remaining = 0;
+static char target[PATH_MAX];
+static long long targetLen = 0;
+
+/* directories of the tree, in the order they were created */
+static TreeDir* dirs = 0;
+static long long dirCount = 0;
+static long long dirCapacity = 0;
+
+/**
+ * opens the output directory, creating it if it does not exist.
+ *
+ * @function   tree_out_open
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  int tree_out_open(const char* path)
+ *
+ * @param      path path of the output directory.
+ *
+ * @return     0 upon success; -1 if the directory could not be opened.
+ */
+int tree_out_open(const char* path)
+{
+    if(mkdir(path, 0755) < 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+    rootFd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return rootFd < 0 ? -1 : 0;
+}
+
+/**
+ * creates the entry described by an entry message, and gets ready for its
+ *   data.
+ *
+ * @function   tree_out_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * an existing regular file is overwritten, and an existing directory is
+ *   reused. entries that can not be created are reported on stderr, and
+ *   their data is skipped. devices & sockets are not recreated.
+ *
+ * @signature  void tree_out_entry(const EntryMsg* msg)
+ *
+ * @param      msg pointer to the entry message.
+ */
+void tree_out_entry(const EntryMsg* msg)
+{
+    const char* name;
+    int dirFd;
+    struct stat st;
+
+    /* an entry that is still missing data was cut short */
+    finish_entry();
+    entry = *msg;
+    remaining = entry.size;
+    targetLen = 0;
+
+    errno = EINVAL;
+    dirFd = is_safe_path(entry.path) ? open_parent(entry.path, &name) : -1;
+    if(dirFd < 0)
+    {
+        fprintf(stderr, "failed to create %s: %d\n", entry.path, errno);
+        failed = true;
+        entry.path[0] = '\0';
+        return;
+    }
+
+    if(S_ISDIR(entry.mode))
+    {
+        if(mkdirat(dirFd, name, 0700) < 0 && (errno != EEXIST
+            || fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) < 0
+            || !S_ISDIR(st.st_mode)))
+        {
+            fprintf(stderr, "failed to create %s: %d\n", entry.path, errno);
+            failed = true;
+        }
+        else
+        {
+            remember_dir(&entry);
+        }
+        entry.path[0] = '\0';
+    }
+    else if(S_ISREG(entry.mode))
+    {
+        fileFd = openat(dirFd, name,
+            O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if(fileFd < 0)
+        {
+            fprintf(stderr, "failed to create %s: %d\n", entry.path, errno);
+            failed = true;
+            entry.path[0] = '\0';
+        }
+    }
+    else if(S_ISLNK(entry.mode))
+    {
+        if(entry.size >= PATH_MAX)
+        {
+            fprintf(stderr, "failed to create %s: %d\n", entry.path,
+                ENAMETOOLONG);
+            failed = true;
+            entry.path[0] = '\0';
+        }
+    }
+    else if(S_ISFIFO(entry.mode))
+    {
+        if(mkfifoat(dirFd, name, entry.mode & 07777) < 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "failed to create %s: %d\n", entry.path, errno);
+            failed = true;
+        }
+        entry.path[0] = '\0';
+    }
+    else
+    {
+        fprintf(stderr, "skipped special file %s\n", entry.path);
+        entry.path[0] = '\0';
+    }
+
+    /* entries without data are done already */
+    if(remaining == 0)
+    {
+        finish_entry();
+    }
+}
+
+/**
+ * writes data that follows an entry message to the entry.
+ *
+ * @function   tree_out_data
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       data beyond the size of the entry is ignored.
+ *
+ * @signature  void tree_out_data(const char* data, int len)
+ *
+ * @param      data pointer to the data.
+ * @param      len number of bytes of data.
+ */
+void tree_out_data(const char* data, int len)
+{
+    ssize_t written;
+
+    if(len > remaining)
+    {
+        len = remaining;
+    }
+    remaining -= len;
+
+    if(fileFd >= 0)
+    {
+        while(len > 0)
+        {
+            written = write(fileFd, data, len);
+            if(written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(written < 0)
+            {
+                fprintf(stderr, "failed to write %s: %d\n", entry.path,
+                    errno);
+                failed = true;
+                close(fileFd);
+                fileFd = -1;
+                entry.path[0] = '\0';
+                break;
+            }
+            data += written;
+            len -= written;
+        }
+    }
+    else if(entry.path[0] != '\0' && S_ISLNK(entry.mode))
+    {
+        memcpy(target + targetLen, data, len);
+        targetLen += len;
+    }
+
+    if(remaining == 0)
+    {
+        finish_entry();
+    }
+}
+
+/**
+ * finishes the last entry, and gives the directories of the tree their mode
+ *   & modification time.
+ *
+ * @function   tree_out_close
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  bool tree_out_close(void)
+ *
+ * @return     true if the whole tree was recreated; false otherwise.
+ */
+bool tree_out_close(void)
+{
+    const char* name;
+    int dirFd;
+
+    finish_entry();
+
+    /* deepest directories come last, so go backwards */
+    while(dirCount > 0)
+    {
+        TreeDir* dir = &dirs[--dirCount];
+        dirFd = open_parent(dir->path, &name);
+        if(dirFd < 0 || fchmodat(dirFd, name, dir->mode & 07777, 0) < 0)
+        {
+            failed = true;
+        }
+        else
+        {
+            set_times(dirFd, name, dir->mtime);
+        }
+        free(dir->path);
+    }
+    free(dirs);
+    dirs = 0;
+
+    if(parentFd >= 0)
+    {
+        close(parentFd);
+        parentFd = -1;
+    }
+    close(rootFd);
+    rootFd = -1;
+    return !failed;
+}
+
+/**
+ * gives the entry whose data was arriving its mode & modification time, or
+ *   creates it in the case of a symbolic link.
+ *
+ * @function   finish_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       does nothing if there is no such entry.
+ *
+ * @signature  static void finish_entry(void)
+ */
+static void finish_entry(void)
+{
+    const char* name;
+    int dirFd;
+    struct timespec times[2];
+
+    if(remaining > 0 && entry.path[0] != '\0')
+    {
+        fprintf(stderr, "%s was cut short\n", entry.path);
+        failed = true;
+    }
+
+    if(fileFd >= 0)
+    {
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = entry.mtime;
+        times[1].tv_nsec = 0;
+        if(fchmod(fileFd, entry.mode & 07777) < 0
+            || futimens(fileFd, times) < 0)
+        {
+            failed = true;
+        }
+        close(fileFd);
+        fileFd = -1;
+    }
+    else if(entry.path[0] != '\0' && S_ISLNK(entry.mode)
+        && (dirFd = open_parent(entry.path, &name)) >= 0)
+    {
+        target[targetLen] = '\0';
+        if(symlinkat(target, dirFd, name) < 0 && (errno != EEXIST
+            || unlinkat(dirFd, name, 0) < 0
+            || symlinkat(target, dirFd, name) < 0))
+        {
+            fprintf(stderr, "failed to create %s: %d\n", entry.path, errno);
+            failed = true;
+        }
+        else
+        {
+            set_times(dirFd, name, entry.mtime);
+        }
+    }
+
+    entry.path[0] = '\0';
+    remaining = 0;
+}
+
+/**
+ * tells whether a path sent by the session stays below the output directory.
+ *
+ * @function   is_safe_path
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool is_safe_path(const char* path)
+ *
+ * @param      path path of an entry, relative to the output directory.
+ *
+ * @return     true if the path is relative, and every one of its components
+ *   is a plain name; false otherwise.
+ */
+static bool is_safe_path(const char* path)
+{
+    const char* component = path;
+    size_t len;
+
+    if(strnlen(path, MAX_ENTRY_PATH_LEN) == MAX_ENTRY_PATH_LEN)
+    {
+        return false;
+    }
+
+    for(;;)
+    {
+        len = strcspn(component, "/");
+        if(len == 0 || (len == 1 && component[0] == '.')
+            || (len == 2 && component[0] == '.' && component[1] == '.'))
+        {
+            return false;
+        }
+        if(component[len] == '\0')
+        {
+            return true;
+        }
+        component += len + 1;
+    }
+}
+
+/**
+ * opens the parent directory of an entry, one component at a time.
+ *
+ * @function   open_parent
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the parent is kept open until an entry in another directory comes along;
+ *   the walk sends the entries of a directory mostly together.
+ *
+ * @signature  static int open_parent(const char* path, const char** name)
+ *
+ * @param      path path of the entry, relative to the output directory.
+ * @param      name set to the last component of the path.
+ *
+ * @return     descriptor of the parent directory, owned by this module; -1
+ *   if it could not be opened.
+ */
+static int open_parent(const char* path, const char** name)
+{
+    const char* slash = strrchr(path, '/');
+    char component[NAME_MAX + 1];
+    const char* pos = path;
+    size_t len;
+    int dirFd;
+    int nextFd;
+
+    if(slash == 0)
+    {
+        *name = path;
+        return rootFd;
+    }
+    *name = slash + 1;
+
+    len = slash - path;
+    if(parentFd >= 0 && strlen(parentPath) == len
+        && memcmp(parentPath, path, len) == 0)
+    {
+        return parentFd;
+    }
+
+    /* walk down from the output directory */
+    dirFd = rootFd;
+    while(pos < slash)
+    {
+        len = strcspn(pos, "/");
+        if(len > NAME_MAX)
+        {
+            errno = ENAMETOOLONG;
+            nextFd = -1;
+        }
+        else
+        {
+            memcpy(component, pos, len);
+            component[len] = '\0';
+            nextFd = openat(dirFd, component,
+                O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+        if(dirFd != rootFd)
+        {
+            close(dirFd);
+        }
+        if(nextFd < 0)
+        {
+            return -1;
+        }
+        dirFd = nextFd;
+        pos += len + 1;
+    }
+
+    if(parentFd >= 0)
+    {
+        close(parentFd);
+    }
+    parentFd = dirFd;
+    memcpy(parentPath, path, slash - path);
+    parentPath[slash - path] = '\0';
+    return parentFd;
+}
+
+/**
+ * sets the modification time of an entry, without following it if it is a
+ *   symbolic link.
+ *
+ * @function   set_times
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void set_times(int dirFd, const char* name,
+ *   long long mtime)
+ *
+ * @param      dirFd descriptor of the directory that holds the entry.
+ * @param      name name of the entry in the directory.
+ * @param      mtime modification time to set, in seconds.
+ */
+static void set_times(int dirFd, const char* name, long long mtime)
+{
+    struct timespec times[2];
+
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = mtime;
+    times[1].tv_nsec = 0;
+    if(utimensat(dirFd, name, times, AT_SYMLINK_NOFOLLOW) < 0)
+    {
+        failed = true;
+    }
+}
+
+/**
+ * records a directory of the tree, to finish it in tree_out_close.
+ *
+ * @function   remember_dir
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void remember_dir(const EntryMsg* msg)
+ *
+ * @param      msg pointer to the entry message of the directory.
+ */
+static void remember_dir(const EntryMsg* msg)
+{
+    if(dirCount == dirCapacity)
+    {
+        long long capacity = dirCapacity == 0 ? 64 : dirCapacity * 2;
+        TreeDir* grown = realloc(dirs, capacity * sizeof(TreeDir));
+        if(grown == 0)
+        {
+            failed = true;
+            return;
+        }
+        dirs = grown;
+        dirCapacity = capacity;
+    }
+
+    dirs[dirCount].path = strdup(msg->path);
+    dirs[dirCount].mode = msg->mode;
+    dirs[dirCount].mtime = msg->mtime;
+    if(dirs[dirCount].path == 0)
+    {
+        failed = true;
+        return;
+    }
+    ++dirCount;
+}
@@ -0,0 +1,36 @@
+/**
+ * header file for treeout.c, exposing its interface.
+ *
+ * @sourceFile treeout.h
+ *
+ * @program    client.out
+ *
+ * @function   int tree_out_open(const char* path);
+ * @function   void tree_out_entry(const EntryMsg* msg);
+ * @function   void tree_out_data(const char* data, int len);
+ * @function   bool tree_out_close(void);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef TREEOUT_H
+#define TREEOUT_H
+
+#include "messagequeuehelper.h"
+
+/**
+ * function prototypes
+ */
+int tree_out_open(const char* path);
+void tree_out_entry(const EntryMsg* msg);
+void tree_out_data(const char* data, int len);
+bool tree_out_close(void);
+
+#endif
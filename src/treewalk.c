@@ -0,0 +1,856 @@
+/**
+ * sends a whole directory tree to a client, walking its directories with a
+ *   pool of threads while the session streams the entries already found.
+ *
+ * @sourceFile treewalk.c
+ *
+ * @program    server.out
+ *
+ * @function   int tree_send(int msgQId, long clientType, int dirFd,
+ *   int priority, RateLimiter* limiter)
+ * @function   static void* walk_worker(void* arg)
+ * @function   static void walk_dir(TreeItem* dir)
+ * @function   static void add_entry(TreeItem* dir, int dirFd,
+ *   const char* name, unsigned char type)
+ * @function   static TreeItem* new_item(const char* path, const char* name)
+ * @function   static void report(const char* path, int error)
+ * @function   static void push_dir(TreeItem* dir)
+ * @function   static TreeItem* next_dir(void)
+ * @function   static void done_dir(void)
+ * @function   static void push_ready(TreeItem* item)
+ * @function   static TreeItem* pop_ready(void)
+ * @function   static void send_item(TreeItem* item)
+ * @function   static void send_data(TreeItem* item, long long size)
+ * @function   static void free_item(TreeItem* item)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * directories waiting to be walked are kept on a stack, so the walk goes
+ *   deep before it goes wide, and few of them are pending at once. every
+ *   worker takes a directory off the stack, reads its entries with
+ *   getdents64, and opens or stats each one relative to the directory, so no
+ *   path is ever resolved from the root again. subdirectories go back onto
+ *   the stack, and every entry onto a bounded queue of ready entries.
+ *
+ * the session's own thread takes entries off that queue in order, and sends
+ *   each as an entry message followed by its data. a directory is queued
+ *   before it is pushed onto the stack, so its entry always reaches the
+ *   client before the entries inside it. the queue is bounded, so the
+ *   walkers stay only a little ahead of the messages that the client has
+ *   taken, and hold few files open.
+ */
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "treewalk.h"
+#include "clockhelper.h"
+#include "serverstats.h"
+#include "chunkctl.h"
+
+/**
+ * layout of the records that getdents64 fills its buffer with.
+ */
+typedef struct
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+}
+Dirent64;
+
+/**
+ * an entry of the tree, on its way from a walker to the session; or a
+ *   directory waiting to be walked.
+ *
+ * fd is the open directory or regular file, or -1. target is the target of a
+ *   symbolic link. error is the errno of a failure to read the entry, which
+ *   is reported to the client instead of the entry.
+ */
+typedef struct TreeItem
+{
+    struct TreeItem* next;
+    int fd;
+    int error;
+    struct stat info;
+    char* target;
+    char path[];
+}
+TreeItem;
+
+/* function prototypes */
+static void* walk_worker(void*);
+static void walk_dir(TreeItem*);
+static void add_entry(TreeItem*, int, const char*, unsigned char);
+static TreeItem* new_item(const char*, const char*);
+static void report(const char*, int);
+static void push_dir(TreeItem*);
+static TreeItem* next_dir(void);
+static void done_dir(void);
+static void push_ready(TreeItem*);
+static TreeItem* pop_ready(void);
+static void send_item(TreeItem*);
+static void send_data(TreeItem*, long long);
+static void free_item(TreeItem*);
+
+/* where the tree is sent */
+static int queueId;
+static long destType;
+static ChunkCtl chunk;
+static int clientPriority;
+static RateLimiter* rateLimiter;
+static int rootFd;
+
+/* guards everything below */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dirsChanged = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t readyNotEmpty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t readyNotFull = PTHREAD_COND_INITIALIZER;
+
+/* directories waiting to be walked, and how many of them are open */
+static TreeItem* dirStack = 0;
+static int openDirs = 0;
+
+/* directories that are waiting to be walked, or being walked; the walk is
+ *   over when this drops to 0 */
+static int pendingDirs = 0;
+
+/* entries waiting to be sent, in order */
+static TreeItem* readyHead = 0;
+static TreeItem* readyTail = 0;
+static int readyCount = 0;
+
+/**
+ * walks the directory tree below the passed directory, and sends every entry
+ *   of it to the client.
+ *
+ * @function   tree_send
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * entries that can not be read are reported to the client with a print
+ *   message, and left out; the rest of the tree is still sent. the walk runs
+ *   on fewer threads if not all of them can be started.
+ *
+ * @signature  int tree_send(int msgQId, long clientType, int dirFd,
+ *   int priority, RateLimiter* limiter)
+ *
+ * @param      msgQId id of the message queue to use.
+ * @param      clientType message type that the client receives messages with.
+ * @param      dirFd file descriptor of the directory to send.
+ * @param      priority priority of the client; the size of data messages
+ *   is chosen the same way as for a plain transfer.
+ * @param      limiter pointer to the rate limiter of the client; every entry
+ *   counts as a message.
+ *
+ * @return     0 upon success; -1 if dirFd is not a directory (errno is
+ *   ENOTDIR), or the walk could not be started.
+ */
+int tree_send(int msgQId, long clientType, int dirFd, int priority,
+    RateLimiter* limiter)
+{
+    pthread_t workers[TREE_WORKERS];
+    int workerCount;
+    struct stat info;
+    TreeItem* root;
+    TreeItem* item;
+
+    if(fstat(dirFd, &info) < 0)
+    {
+        return -1;
+    }
+    if(!S_ISDIR(info.st_mode))
+    {
+        errno = ENOTDIR;
+        return -1;
+    }
+
+    queueId = msgQId;
+    destType = clientType;
+    clientPriority = priority;
+    rateLimiter = limiter;
+    rootFd = dirFd;
+    chunk_ctl_init(&chunk, msgQId, priority);
+
+    /* the walk starts at the root, which is not an entry itself */
+    root = new_item("", 0);
+    if(root == 0 || (root->fd = dup(dirFd)) < 0)
+    {
+        free(root);
+        return -1;
+    }
+    push_dir(root);
+
+    for(workerCount = 0; workerCount < TREE_WORKERS; ++workerCount)
+    {
+        if(pthread_create(&workers[workerCount], 0, walk_worker, 0) != 0)
+        {
+            break;
+        }
+    }
+    if(workerCount == 0)
+    {
+        return -1;
+    }
+
+    /* send the entries as the walkers find them */
+    stats_first_byte();
+    while((item = pop_ready()) != 0)
+    {
+        send_item(item);
+        free_item(item);
+    }
+
+    while(workerCount > 0)
+    {
+        pthread_join(workers[--workerCount], 0);
+    }
+    return 0;
+}
+
+/**
+ * body of the walker threads; walks directories until there are none left.
+ *
+ * @function   walk_worker
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void* walk_worker(void* arg)
+ *
+ * @param      arg unused.
+ *
+ * @return     always 0.
+ */
+static void* walk_worker(void* arg)
+{
+    TreeItem* dir;
+
+    (void) arg;
+    while((dir = next_dir()) != 0)
+    {
+        walk_dir(dir);
+        free_item(dir);
+        done_dir();
+    }
+    return 0;
+}
+
+/**
+ * reads the entries of a directory, and hands each of them to add_entry.
+ *
+ * @function   walk_dir
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * a directory that was closed while it waited is reopened relative to the
+ *   root, without following symbolic links at its last component.
+ *
+ * @signature  static void walk_dir(TreeItem* dir)
+ *
+ * @param      dir directory to walk; its descriptor is closed.
+ */
+static void walk_dir(TreeItem* dir)
+{
+    long buf[TREE_DENTS_LEN / sizeof(long)];
+    Dirent64* entry;
+    long nRead;
+    long pos;
+
+    if(dir->fd < 0)
+    {
+        dir->fd = openat(rootFd, dir->path,
+            O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    if(dir->fd < 0)
+    {
+        report(dir->path, errno);
+        return;
+    }
+
+    while((nRead = syscall(SYS_getdents64, dir->fd, buf, sizeof(buf))) > 0)
+    {
+        for(pos = 0; pos < nRead; pos += entry->d_reclen)
+        {
+            entry = (Dirent64*) ((char*) buf + pos);
+            if(strcmp(entry->d_name, ".") != 0
+                && strcmp(entry->d_name, "..") != 0)
+            {
+                add_entry(dir, dir->fd, entry->d_name, entry->d_type);
+            }
+        }
+    }
+    if(nRead < 0)
+    {
+        report(dir->path, errno);
+    }
+
+    close(dir->fd);
+    dir->fd = -1;
+}
+
+/**
+ * reads what needs to be sent about one entry of a directory, and queues it
+ *   for the session.
+ *
+ * @function   add_entry
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * directories & regular files are opened, without following symbolic links
+ *   and without blocking, in case the entry was replaced by a fifo since it
+ *   was read; everything else is only stat'ed. a subdirectory is queued
+ *   before it is pushed onto the stack, keeping its entry ahead of its
+ *   contents.
+ *
+ * @signature  static void add_entry(TreeItem* dir, int dirFd,
+ *   const char* name, unsigned char type)
+ *
+ * @param      dir directory that holds the entry.
+ * @param      dirFd open descriptor of that directory.
+ * @param      name name of the entry in the directory.
+ * @param      type d_type of the entry; DT_UNKNOWN if the file system did
+ *   not tell.
+ */
+static void add_entry(TreeItem* dir, int dirFd, const char* name,
+    unsigned char type)
+{
+    TreeItem* item = new_item(dir->path, name);
+    TreeItem* sub;
+    char target[PATH_MAX];
+    ssize_t targetLen;
+
+    if(item == 0)
+    {
+        report(dir->path, ENOMEM);
+        return;
+    }
+    if(strlen(item->path) >= MAX_ENTRY_PATH_LEN)
+    {
+        item->error = ENAMETOOLONG;
+        push_ready(item);
+        return;
+    }
+
+    if(type == DT_DIR || type == DT_REG)
+    {
+        item->fd = openat(dirFd, name,
+            O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+        if(item->fd < 0 || fstat(item->fd, &item->info) < 0)
+        {
+            item->error = errno;
+        }
+    }
+    else if(fstatat(dirFd, name, &item->info, AT_SYMLINK_NOFOLLOW) < 0)
+    {
+        item->error = errno;
+    }
+    else if(S_ISDIR(item->info.st_mode) || S_ISREG(item->info.st_mode))
+    {
+        /* the file system gave no type; open it now that it is known */
+        add_entry(dir, dirFd, name,
+            S_ISDIR(item->info.st_mode) ? DT_DIR : DT_REG);
+        free_item(item);
+        return;
+    }
+
+    if(item->error == 0 && S_ISLNK(item->info.st_mode))
+    {
+        targetLen = readlinkat(dirFd, name, target, sizeof(target) - 1);
+        if(targetLen < 0 || (item->target = malloc(targetLen + 1)) == 0)
+        {
+            item->error = targetLen < 0 ? errno : ENOMEM;
+        }
+        else
+        {
+            memcpy(item->target, target, targetLen);
+            item->target[targetLen] = '\0';
+        }
+    }
+
+    /* only keep descriptors that are needed */
+    if(item->fd >= 0 && (item->error != 0 || !S_ISREG(item->info.st_mode)))
+    {
+        if(item->error == 0 && S_ISDIR(item->info.st_mode)
+            && (sub = new_item(item->path, 0)) != 0)
+        {
+            sub->fd = item->fd;
+            item->fd = -1;
+            push_ready(item);
+            push_dir(sub);
+            return;
+        }
+        close(item->fd);
+        item->fd = -1;
+    }
+    else if(item->fd >= 0)
+    {
+        posix_fadvise(item->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    push_ready(item);
+}
+
+/**
+ * allocates an item for the entry with the passed name in the directory at
+ *   the passed path.
+ *
+ * @function   new_item
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static TreeItem* new_item(const char* path, const char* name)
+ *
+ * @param      path path of the directory, relative to the root; "" for the
+ *   root itself.
+ * @param      name name of the entry; 0 for the item to take path as is.
+ *
+ * @return     pointer to the new item; 0 if it could not be allocated.
+ */
+static TreeItem* new_item(const char* path, const char* name)
+{
+    size_t pathLen = strlen(path);
+    size_t nameLen = name == 0 ? 0 : strlen(name);
+    TreeItem* item = calloc(1, sizeof(TreeItem) + pathLen + nameLen + 2);
+
+    if(item == 0)
+    {
+        return 0;
+    }
+
+    item->fd = -1;
+    memcpy(item->path, path, pathLen);
+    if(name != 0 && pathLen > 0)
+    {
+        item->path[pathLen++] = '/';
+    }
+    if(name != 0)
+    {
+        memcpy(item->path + pathLen, name, nameLen);
+    }
+    return item;
+}
+
+/**
+ * queues the report of an entry that could not be read.
+ *
+ * @function   report
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void report(const char* path, int error)
+ *
+ * @param      path path of the entry, relative to the root.
+ * @param      error errno of the failure.
+ */
+static void report(const char* path, int error)
+{
+    TreeItem* item = new_item(path, 0);
+
+    if(item == 0)
+    {
+        fprintf(stderr, "failed to read %s: %d\n", path, error);
+        return;
+    }
+    item->error = error;
+    push_ready(item);
+}
+
+/**
+ * pushes a directory onto the stack of directories waiting to be walked.
+ *
+ * @function   push_dir
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * once TREE_OPEN_DIRS_MAX waiting directories are open, further ones are
+ *   closed, so a wide tree can not use up the session's descriptors.
+ *
+ * @signature  static void push_dir(TreeItem* dir)
+ *
+ * @param      dir directory to push.
+ */
+static void push_dir(TreeItem* dir)
+{
+    pthread_mutex_lock(&lock);
+    if(openDirs >= TREE_OPEN_DIRS_MAX)
+    {
+        close(dir->fd);
+        dir->fd = -1;
+    }
+    else
+    {
+        ++openDirs;
+    }
+    dir->next = dirStack;
+    dirStack = dir;
+    ++pendingDirs;
+    pthread_cond_signal(&dirsChanged);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * takes the next directory to walk off the stack, waiting for one if other
+ *   walkers may still push some.
+ *
+ * @function   next_dir
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static TreeItem* next_dir(void)
+ *
+ * @return     the directory to walk; 0 once the walk is over.
+ */
+static TreeItem* next_dir(void)
+{
+    TreeItem* dir;
+
+    pthread_mutex_lock(&lock);
+    while(dirStack == 0 && pendingDirs > 0)
+    {
+        pthread_cond_wait(&dirsChanged, &lock);
+    }
+    dir = dirStack;
+    if(dir != 0)
+    {
+        dirStack = dir->next;
+        if(dir->fd >= 0)
+        {
+            --openDirs;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return dir;
+}
+
+/**
+ * records that a directory has been walked, and wakes everybody up if it was
+ *   the last one.
+ *
+ * @function   done_dir
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void done_dir(void)
+ */
+static void done_dir(void)
+{
+    pthread_mutex_lock(&lock);
+    if(--pendingDirs == 0)
+    {
+        pthread_cond_broadcast(&dirsChanged);
+        pthread_cond_broadcast(&readyNotEmpty);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * appends an entry to the queue of entries to send, waiting while the queue
+ *   is full.
+ *
+ * @function   push_ready
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void push_ready(TreeItem* item)
+ *
+ * @param      item entry to append.
+ */
+static void push_ready(TreeItem* item)
+{
+    pthread_mutex_lock(&lock);
+    while(readyCount >= TREE_READY_MAX)
+    {
+        pthread_cond_wait(&readyNotFull, &lock);
+    }
+    item->next = 0;
+    if(readyTail == 0)
+    {
+        readyHead = item;
+    }
+    else
+    {
+        readyTail->next = item;
+    }
+    readyTail = item;
+    ++readyCount;
+    pthread_cond_signal(&readyNotEmpty);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * takes the next entry to send off the queue, waiting for one while the
+ *   walk is still going on.
+ *
+ * @function   pop_ready
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static TreeItem* pop_ready(void)
+ *
+ * @return     the entry to send; 0 once the whole tree has been sent.
+ */
+static TreeItem* pop_ready(void)
+{
+    TreeItem* item;
+
+    pthread_mutex_lock(&lock);
+    while(readyHead == 0 && pendingDirs > 0)
+    {
+        pthread_cond_wait(&readyNotEmpty, &lock);
+    }
+    item = readyHead;
+    if(item != 0)
+    {
+        readyHead = item->next;
+        if(readyHead == 0)
+        {
+            readyTail = 0;
+        }
+        --readyCount;
+        pthread_cond_signal(&readyNotFull);
+    }
+    pthread_mutex_unlock(&lock);
+    return item;
+}
+
+/**
+ * sends the entry message of an entry, followed by its data; or a print
+ *   message if the entry could not be read.
+ *
+ * @function   send_item
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void send_item(TreeItem* item)
+ *
+ * @param      item entry to send.
+ */
+static void send_item(TreeItem* item)
+{
+    Message msg;
+    EntryMsg* entry = &msg.data.entryMsg;
+
+    if(item->error != 0)
+    {
+        msg.dataType = MSG_DATA_PRINT;
+        snprintf(msg.data.printMsg.str, MAX_MSG_PRNTMSGSTR_LEN,
+            "failed to read %s: %d\n", item->path[0] ? item->path : ".",
+            item->error);
+        msg_send(queueId, &msg, destType);
+        return;
+    }
+
+    msg.dataType = MSG_DATA_ENTRY;
+    entry->mode = item->info.st_mode;
+    entry->size = 0;
+    if(S_ISREG(item->info.st_mode))
+    {
+        entry->size = item->info.st_size;
+    }
+    else if(item->target != 0)
+    {
+        entry->size = strlen(item->target);
+    }
+    entry->mtime = item->info.st_mtime;
+    strcpy(entry->path, item->path);
+
+    rate_limit_wait(rateLimiter, 0);
+    msg_send(queueId, &msg, destType);
+    send_data(item, entry->size);
+}
+
+/**
+ * sends the data that follows the entry message of an entry.
+ *
+ * @function   send_data
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * exactly size bytes are sent, as announced in the entry message; a file
+ *   that shrank since it was stat'ed is padded with zeros, and one that grew
+ *   is cut off.
+ *
+ * @signature  static void send_data(TreeItem* item, long long size)
+ *
+ * @param      item entry whose data to send.
+ * @param      size number of bytes to send.
+ */
+static void send_data(TreeItem* item, long long size)
+{
+    Message msg;
+    long long sent = 0;
+    ssize_t len;
+
+    msg.dataType = MSG_DATA_DATA;
+    while(sent < size)
+    {
+        len = size - sent < chunk.len ? size - sent : chunk.len;
+        if(item->target != 0)
+        {
+            memcpy(msg.data.dataMsg.data, item->target + sent, len);
+        }
+        else
+        {
+            len = pread(item->fd, msg.data.dataMsg.data, len, sent);
+            if(len <= 0)
+            {
+                len = size - sent < chunk.len ? size - sent : chunk.len;
+                memset(msg.data.dataMsg.data, 0, len);
+            }
+        }
+
+        rate_limit_wait(rateLimiter, len);
+        msg.data.dataMsg.len = len;
+        msg.data.dataMsg.eventTime = clock_now_ns();
+        msg_send(queueId, &msg, destType);
+        chunk_ctl_sent(&chunk, clock_now_ns() - msg.sendTime);
+        stats_add_bytes(clientPriority, len);
+        sent += len;
+    }
+}
+
+/**
+ * releases an item, and whatever it holds.
+ *
+ * @function   free_item
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static void free_item(TreeItem* item)
+ *
+ * @param      item item to release.
+ */
+static void free_item(TreeItem* item)
+{
+    if(item->fd >= 0)
+    {
+        close(item->fd);
+    }
+    free(item->target);
+    free(item);
+}
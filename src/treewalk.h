@@ -0,0 +1,46 @@
+/**
+ * header file for treewalk.c, exposing its interface.
+ *
+ * @sourceFile treewalk.h
+ *
+ * @program    server.out
+ *
+ * @function   int tree_send(int msgQId, long clientType, int dirFd,
+ *   int priority, RateLimiter* limiter);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef TREEWALK_H
+#define TREEWALK_H
+
+#include "messagequeuehelper.h"
+#include "ratelimit.h"
+
+/* number of threads that walk the directories of a tree */
+#define TREE_WORKERS 4
+
+/* number of entries that the walkers may find ahead of the session */
+#define TREE_READY_MAX 256
+
+/* number of directories waiting to be walked that are kept open; others are
+ *   reopened by path when their turn comes */
+#define TREE_OPEN_DIRS_MAX 128
+
+/* size of the buffer that directory entries are read into */
+#define TREE_DENTS_LEN 32768
+
+/**
+ * function prototypes
+ */
+int tree_send(int msgQId, long clientType, int dirFd, int priority,
+    RateLimiter* limiter);
+
+#endif
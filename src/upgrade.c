@@ -0,0 +1,219 @@
+/**
+ * this file contains the hand over of a running server's state to a new
+ *   server binary, which the running server execs in its own place.
+ *
+ * @sourceFile upgrade.c
+ *
+ * @program    server.out
+ *
+ * @function   int upgrade_save(int msgQId)
+ * @function   int upgrade_load(int stateFd, int* msgQId)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * exec keeps the process id, so the sessions stay children of the server,
+ *   and it keeps open file descriptors that are not close-on-exec. the state
+ *   is written to a memfd that survives the exec, and the new server is told
+ *   its number on the command line. the state holds the id of the message
+ *   queue, which is never removed, the memfds of the shared statistics, and
+ *   the rate limits, which the sessions keep using, the listening socket of
+ *   the metrics endpoint, which can not be bound again while sessions still
+ *   hold it, and the session registry, so that the new server keeps track
+ *   of the sessions started by the old one.
+ *
+ * the new server never removes the message queue; the sessions of the old
+ *   one are still using it. state that it can not take over is set up
+ *   afresh instead.
+ *
+ * CONNECT messages that arrive during the exec wait in the queue, and are
+ *   served by the new server.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "upgrade.h"
+#include "registry.h"
+#include "serverstats.h"
+#include "ratelimit.h"
+#include "metrics.h"
+#include "messagequeuehelper.h"
+
+/* identifies the state; changes whenever UpgradeHeader does */
+#define UPGRADE_MAGIC 0x55504733
+
+/**
+ * start of the state handed over; followed by the session registry.
+ *
+ * the sizes let a new server built with different structures take what it
+ *   can use, and start the rest afresh.
+ */
+typedef struct
+{
+    unsigned int magic;
+    int msgQId;
+    int statsFd;
+    int limitsFd;
+    int metricsFd;          /* -1 if metrics are not served */
+    unsigned int statsSize;
+    unsigned int limitsSize;
+    unsigned int entrySize;
+}
+UpgradeHeader;
+
+/**
+ * writes the state of the server to a memfd that a new server can take over.
+ *
+ * @function   upgrade_save
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - hands over the rate limits.
+ * @revision   2026-10-18 - hands over the metrics socket.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the memfd, the memfds of the statistics and the rate limits, and the
+ *   metrics socket are left open across exec.
+ *
+ * @signature  int upgrade_save(int msgQId)
+ *
+ * @param      msgQId id of the message queue that the server serves.
+ *
+ * @return     file descriptor of the state, positioned at its start; -1 if
+ *   the state could not be written.
+ */
+int upgrade_save(int msgQId)
+{
+    UpgradeHeader header;
+    int fd = memfd_create("upgrade", 0);
+
+    if(fd < 0)
+    {
+        return -1;
+    }
+
+    header.magic = UPGRADE_MAGIC;
+    header.msgQId = msgQId;
+    header.statsFd = stats_fd();
+    header.limitsFd = rate_limit_fd();
+    header.metricsFd = metrics_fd();
+    header.statsSize = sizeof(ServerStats);
+    header.limitsSize = sizeof(RateTable);
+    header.entrySize = sizeof(SessionEntry);
+
+    if(write(fd, &header, sizeof(header)) != sizeof(header)
+        || registry_save(fd) < 0 || lseek(fd, 0, SEEK_SET) < 0
+        || fcntl(header.statsFd, F_SETFD, 0) < 0
+        || fcntl(header.limitsFd, F_SETFD, 0) < 0
+        || (header.metricsFd >= 0 && fcntl(header.metricsFd, F_SETFD, 0) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * takes over the state written by upgrade_save in the server that exec'd
+ *   this one.
+ *
+ * @function   upgrade_load
+ *
+ * @date       2026-10-18
+ *
+ * @revision   2026-10-18 - takes over the rate limits.
+ * @revision   2026-10-18 - takes over the metrics socket, and starts afresh
+ *   from state it can not read.
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * statistics, rate limits or a registry written by a server with a
+ *   different layout are not taken over; new ones are set up, and the old
+ *   sessions are only reaped, not joined. the same goes for state that can
+ *   not be read at all, or has another magic number; the message queue is
+ *   then looked up by its key. the memfd of the state is closed.
+ *
+ * @signature  int upgrade_load(int stateFd, int* msgQId)
+ *
+ * @param      stateFd file descriptor of the state.
+ * @param      msgQId pointer to the message queue id to set.
+ *
+ * @return     0 upon success; -1 if neither the state could be taken over,
+ *   nor fresh statistics or rate limits set up.
+ */
+int upgrade_load(int stateFd, int* msgQId)
+{
+    UpgradeHeader header;
+    int result = -1;
+
+    if(read(stateFd, &header, sizeof(header)) != sizeof(header)
+        || header.magic != UPGRADE_MAGIC)
+    {
+        fprintf(stderr, "upgrade state unusable; starting afresh\n");
+        get_message_queue(msgQId);
+        result = stats_init();
+        if(result == 0)
+        {
+            result = rate_limit_init();
+        }
+    }
+    else
+    {
+        *msgQId = header.msgQId;
+        if(header.metricsFd >= 0)
+        {
+            metrics_attach(header.metricsFd);
+        }
+
+        if(header.statsSize != sizeof(ServerStats)
+            || stats_attach(header.statsFd) < 0)
+        {
+            close(header.statsFd);
+            result = stats_init();
+        }
+        else
+        {
+            fcntl(header.statsFd, F_SETFD, FD_CLOEXEC);
+            result = 0;
+        }
+
+        if(result == 0 && (header.limitsSize != sizeof(RateTable)
+            || rate_limit_attach(header.limitsFd) < 0))
+        {
+            close(header.limitsFd);
+            result = rate_limit_init();
+        }
+        else if(result == 0)
+        {
+            fcntl(header.limitsFd, F_SETFD, FD_CLOEXEC);
+        }
+
+        if(result == 0 && header.entrySize == sizeof(SessionEntry)
+            && registry_load(stateFd) < 0)
+        {
+            fprintf(stderr, "registry_load failed; sessions can not be "
+                "joined\n");
+        }
+    }
+
+    close(stateFd);
+    return result;
+}
@@ -0,0 +1,33 @@
+/**
+ * header file for upgrade.c, exposing its interface.
+ *
+ * @sourceFile upgrade.h
+ *
+ * @program    server.out
+ *
+ * @function   int upgrade_save(int msgQId);
+ * @function   int upgrade_load(int stateFd, int* msgQId);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+/* tells a freshly exec'd server that it takes over; -U fd */
+#define UPGRADE_OPTION "-U"
+
+/**
+ * function prototypes
+ */
+int upgrade_save(int msgQId);
+int upgrade_load(int stateFd, int* msgQId);
+
+#endif
@@ -0,0 +1,472 @@
+/**
+ * tells whether a client that asked for a file only if it changed already
+ *   has its current version, and keeps the digests of the versions of files
+ *   in a cache shared by the server and all of its sessions.
+ *
+ * @sourceFile validator.c
+ *
+ * @program    server.out
+ *
+ * @function   int validator_cache_init(int slots)
+ * @function   int validator_check(int msgQId, long clientType, int fd,
+ *   const Validator* have, RateLimiter* limiter)
+ * @function   static bool get_digest(int fd, const struct stat* st,
+ *   unsigned char* digest)
+ * @function   static bool cache_find(const struct stat* st,
+ *   unsigned char* digest)
+ * @function   static void cache_store(const struct stat* st,
+ *   const unsigned char* digest)
+ * @function   static CacheSlot* slot_of(const struct stat* st)
+ * @function   static bool same_version(const struct stat* a,
+ *   const struct stat* b)
+ * @function   static long long time_ns(const struct timespec* time)
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * the client's version is current if the size, modification & change times
+ *   and inode that it holds are those of the file, which only costs a fstat;
+ *   the change time catches a file whose modification time was put back.
+ *   failing that, if the digest that it holds is that of the file's content,
+ *   which catches a file that was written again unchanged, like a config
+ *   file that every deploy puts in place anew.
+ *
+ * the digest of a version is computed once, by the first session that needs
+ *   it, and kept in a table in shared memory, keyed by device, inode, size,
+ *   and modification & change time, so any change to the file makes a new
+ *   version. the table is direct-mapped; a version pushed out by another
+ *   that maps to the same slot is hashed again when it is next needed. a
+ *   version is only kept if the file's stat did not change while it was
+ *   hashed.
+ *
+ * every slot is guarded by a sequence number, which is odd while the slot is
+ *   written. a reader that finds it odd, or changed after reading the slot,
+ *   counts a miss, and a writer that finds it odd leaves the slot alone; a
+ *   slot whose writer was killed half way is never used again.
+ *
+ * the table is set up by the server before it forks any session; a server
+ *   that exec's itself on SIGUSR1 starts over with an empty one.
+ */
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "validator.h"
+#include "checksum.h"
+#include "serverstats.h"
+
+/**
+ * a version of a file, and the digest of its content.
+ */
+typedef struct
+{
+    _Atomic unsigned int seq;
+    unsigned long long dev;
+    unsigned long long inode;
+    long long size;
+    long long mtimeNs;
+    long long ctimeNs;
+    unsigned char digest[SHA256_LEN];
+}
+CacheSlot;
+
+/* function prototypes */
+static bool get_digest(int, const struct stat*, unsigned char*);
+static bool cache_find(const struct stat*, unsigned char*);
+static void cache_store(const struct stat*, const unsigned char*);
+static CacheSlot* slot_of(const struct stat*);
+static bool same_version(const struct stat*, const struct stat*);
+static long long time_ns(const struct timespec*);
+
+/* digests of the versions of files, shared with every session; 0 if the
+ *   cache is not set up */
+static CacheSlot* cacheSlots = 0;
+static unsigned int slotMask = 0;
+
+/**
+ * sets up the cache of digests.
+ *
+ * @function   validator_cache_init
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * must be called before any session is forked. without the cache, every
+ *   check that gets past the stat hashes the file.
+ *
+ * @signature  int validator_cache_init(int slots)
+ *
+ * @param      slots number of versions to keep; rounded up to a power of 2.
+ *   0 disables the cache.
+ *
+ * @return     0 upon success; -1 if the shared memory could not be mapped.
+ */
+int validator_cache_init(int slots)
+{
+    unsigned int count = 1;
+    void* mem;
+
+    if(slots <= 0)
+    {
+        return 0;
+    }
+    while(count < (unsigned int) slots)
+    {
+        count <<= 1;
+    }
+
+    mem = mmap(0, count * sizeof(CacheSlot), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED)
+    {
+        return -1;
+    }
+    cacheSlots = mem;
+    slotMask = count - 1;
+    return 0;
+}
+
+/**
+ * tells the client whether its version of the file is current.
+ *
+ * @function   validator_check
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note
+ *
+ * sends NOTMODIFIED if it is, and VALIDATOR otherwise, which the file is to
+ *   follow. either carries the validator of the file as it is now.
+ *
+ * @signature  int validator_check(int msgQId, long clientType, int fd,
+ *   const Validator* have, RateLimiter* limiter)
+ *
+ * @param      msgQId id of the message queue to use.
+ * @param      clientType message type that the client receives messages with.
+ * @param      fd file descriptor of the requested file.
+ * @param      have pointer to the validator of the client's version.
+ * @param      limiter pointer to the rate limiter of the client.
+ *
+ * @return     1 if the client's version is current; 0 if the file has to be
+ *   sent; -1 if the file could not be read.
+ */
+int validator_check(int msgQId, long clientType, int fd,
+    const Validator* have, RateLimiter* limiter)
+{
+    static const unsigned char noDigest[SHA256_LEN];
+    ServerStats* stats = stats_get();
+    Message msg;
+    Validator* now = &msg.data.validatorMsg;
+    struct stat st;
+    bool current;
+
+    if(fstat(fd, &st) < 0)
+    {
+        return -1;
+    }
+    now->size = st.st_size;
+    now->mtimeNs = time_ns(&st.st_mtim);
+    now->ctimeNs = time_ns(&st.st_ctim);
+    now->inode = st.st_ino;
+
+    /* the same stat is the same version; only look at content otherwise */
+    current = have->inode != 0 && have->inode == now->inode
+        && have->size == now->size && have->mtimeNs == now->mtimeNs
+        && have->ctimeNs == now->ctimeNs;
+    if(current)
+    {
+        memcpy(now->digest, have->digest, SHA256_LEN);
+    }
+    else
+    {
+        if(!get_digest(fd, &st, now->digest))
+        {
+            return -1;
+        }
+        current = have->size == now->size
+            && memcmp(have->digest, noDigest, SHA256_LEN) != 0
+            && memcmp(have->digest, now->digest, SHA256_LEN) == 0;
+    }
+
+    msg.dataType = current ? MSG_DATA_NOTMODIFIED : MSG_DATA_VALIDATOR;
+    rate_limit_wait(limiter, 0);
+    msg_send(msgQId, &msg, clientType);
+    atomic_fetch_add_explicit(current ? &stats->conditionalCurrent
+        : &stats->conditionalChanged, 1, memory_order_relaxed);
+    return current ? 1 : 0;
+}
+
+/**
+ * gets the digest of the content of a file, from the cache if it has it.
+ *
+ * @function   get_digest
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool get_digest(int fd, const struct stat* st,
+ *   unsigned char* digest)
+ *
+ * @param      fd file descriptor of the file.
+ * @param      st pointer to the stat of the file.
+ * @param      digest set to the sha-256 digest of the file's content.
+ *
+ * @return     true upon success; false if the file could not be read.
+ */
+static bool get_digest(int fd, const struct stat* st, unsigned char* digest)
+{
+    static char buf[VALIDATOR_READ_LEN];
+    struct stat after;
+    Sha256 ctx;
+    off_t pos = 0;
+    ssize_t nRead;
+
+    if(cache_find(st, digest))
+    {
+        return true;
+    }
+
+    sha256_init(&ctx);
+    while((nRead = pread(fd, buf, VALIDATOR_READ_LEN, pos)) != 0)
+    {
+        if(nRead < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        sha256_update(&ctx, buf, nRead);
+        pos += nRead;
+    }
+    sha256_final(&ctx, digest);
+    atomic_fetch_add_explicit(&stats_get()->digestsComputed, 1,
+        memory_order_relaxed);
+
+    if(pos == st->st_size && fstat(fd, &after) == 0
+        && same_version(st, &after))
+    {
+        cache_store(st, digest);
+    }
+    return true;
+}
+
+/**
+ * looks up the digest of a version of a file.
+ *
+ * @function   cache_find
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool cache_find(const struct stat* st,
+ *   unsigned char* digest)
+ *
+ * @param      st pointer to the stat of the file.
+ * @param      digest set to the digest of the version, if it is cached;
+ *   clobbered otherwise.
+ *
+ * @return     true if the version is cached; false otherwise.
+ */
+static bool cache_find(const struct stat* st, unsigned char* digest)
+{
+    CacheSlot* slot = slot_of(st);
+    unsigned int seq;
+    bool found;
+
+    if(slot == 0)
+    {
+        return false;
+    }
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if(seq & 1)
+    {
+        return false;
+    }
+
+    found = slot->dev == (unsigned long long) st->st_dev
+        && slot->inode == (unsigned long long) st->st_ino
+        && slot->size == st->st_size
+        && slot->mtimeNs == time_ns(&st->st_mtim)
+        && slot->ctimeNs == time_ns(&st->st_ctim);
+    memcpy(digest, slot->digest, SHA256_LEN);
+
+    atomic_thread_fence(memory_order_acquire);
+    return found && atomic_load_explicit(&slot->seq, memory_order_relaxed)
+        == seq;
+}
+
+/**
+ * keeps the digest of a version of a file.
+ *
+ * @function   cache_store
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       the version replaces whatever was in its slot.
+ *
+ * @signature  static void cache_store(const struct stat* st,
+ *   const unsigned char* digest)
+ *
+ * @param      st pointer to the stat of the file.
+ * @param      digest pointer to the digest of the version.
+ */
+static void cache_store(const struct stat* st, const unsigned char* digest)
+{
+    CacheSlot* slot = slot_of(st);
+    unsigned int seq;
+
+    if(slot == 0)
+    {
+        return;
+    }
+    seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    if((seq & 1) || !atomic_compare_exchange_strong(&slot->seq, &seq,
+        seq + 1))
+    {
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+
+    slot->dev = st->st_dev;
+    slot->inode = st->st_ino;
+    slot->size = st->st_size;
+    slot->mtimeNs = time_ns(&st->st_mtim);
+    slot->ctimeNs = time_ns(&st->st_ctim);
+    memcpy(slot->digest, digest, SHA256_LEN);
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+/**
+ * finds the slot that a file's versions are kept in.
+ *
+ * @function   slot_of
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static CacheSlot* slot_of(const struct stat* st)
+ *
+ * @param      st pointer to the stat of the file.
+ *
+ * @return     pointer to the slot; 0 if the cache is not set up.
+ */
+static CacheSlot* slot_of(const struct stat* st)
+{
+    unsigned long long key;
+
+    if(cacheSlots == 0)
+    {
+        return 0;
+    }
+    key = ((unsigned long long) st->st_ino
+        ^ ((unsigned long long) st->st_dev << 40)) * 0x9e3779b97f4a7c15ULL;
+    return &cacheSlots[(key >> 32) & slotMask];
+}
+
+/**
+ * tells whether two stats of a file are of the same version.
+ *
+ * @function   same_version
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static bool same_version(const struct stat* a,
+ *   const struct stat* b)
+ *
+ * @param      a pointer to one stat.
+ * @param      b pointer to the other stat.
+ *
+ * @return     true if the file was not changed in between; false otherwise.
+ */
+static bool same_version(const struct stat* a, const struct stat* b)
+{
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino
+        && a->st_size == b->st_size
+        && time_ns(&a->st_mtim) == time_ns(&b->st_mtim)
+        && time_ns(&a->st_ctim) == time_ns(&b->st_ctim);
+}
+
+/**
+ * converts a time of a stat to nanoseconds.
+ *
+ * @function   time_ns
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ *
+ * @signature  static long long time_ns(const struct timespec* time)
+ *
+ * @param      time pointer to the time.
+ *
+ * @return     the time in nanoseconds since the epoch.
+ */
+static long long time_ns(const struct timespec* time)
+{
+    return time->tv_sec * 1000000000LL + time->tv_nsec;
+}
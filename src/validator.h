@@ -0,0 +1,41 @@
+/**
+ * header file for validator.c, exposing its interface.
+ *
+ * @sourceFile validator.h
+ *
+ * @program    server.out
+ *
+ * @function   int validator_cache_init(int slots);
+ * @function   int validator_check(int msgQId, long clientType, int fd,
+ *   const Validator* have, RateLimiter* limiter);
+ *
+ * @date       2026-10-18
+ *
+ * @revision   none
+ *
+ * @designer   EricTsang
+ *
+ * @programmer EricTsang
+ *
+ * @note       none
+ */
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include "messagequeuehelper.h"
+#include "ratelimit.h"
+
+/* number of file versions whose digest the server keeps */
+#define VALIDATOR_CACHE_SLOTS 4096
+
+/* bytes read at a time while hashing a file */
+#define VALIDATOR_READ_LEN (64 << 10)
+
+/**
+ * function prototypes
+ */
+int validator_cache_init(int slots);
+int validator_check(int msgQId, long clientType, int fd,
+    const Validator* have, RateLimiter* limiter);
+
+#endif